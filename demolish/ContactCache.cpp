@@ -0,0 +1,166 @@
+#include "ContactCache.h"
+#include <cstring>
+
+demolish::ContactCache::ContactCache(int capacity):
+  _size(0)
+{
+  int n = 16;
+  while(n < capacity) n *= 2;
+
+  Entry empty;
+  empty.step = -1;
+  _entries.assign(n, empty);
+  _spare.assign(n, empty);
+}
+
+unsigned demolish::ContactCache::hash(int indexA, int indexB, int feature)
+{
+  return (unsigned(indexA)*73856093u) ^ (unsigned(indexB)*19349663u) ^ (unsigned(feature)*83492791u);
+}
+
+demolish::ContactCache::Entry* demolish::ContactCache::insert(
+  std::vector<Entry>& table,
+  int indexA,
+  int indexB,
+  int feature)
+{
+  unsigned mask = table.size()-1;
+  unsigned slot = hash(indexA, indexB, feature) & mask;
+
+  while(table[slot].step >= 0)
+  {
+    if(table[slot].indexA == indexA && table[slot].indexB == indexB && table[slot].feature == feature)
+    {
+      return &table[slot];
+    }
+    slot = (slot+1) & mask;
+  }
+
+  table[slot].indexA  = indexA;
+  table[slot].indexB  = indexB;
+  table[slot].feature = feature;
+  table[slot].step    = -2; // caller fills in the step
+  for(int k=0; k<3; k++)
+  {
+    table[slot].displacement[k]         = 0.0;
+    table[slot].previousDisplacement[k] = 0.0;
+  }
+  return &table[slot];
+}
+
+iREAL* demolish::ContactCache::find(int indexA, int indexB, int feature, int step)
+{
+  // keep the load factor below one half, probes stay short
+  if(2*(_size+1) > int(_entries.size())) grow();
+
+  Entry* entry = insert(_entries, indexA, indexB, feature);
+  if(entry->step == -2)
+  {
+    _size++;
+  }
+  else if(entry->step != step)
+  {
+    // first touch in this step, remember the state for a rollback
+    for(int k=0; k<3; k++) entry->previousDisplacement[k] = entry->displacement[k];
+  }
+  entry->step = step;
+  return entry->displacement;
+}
+
+void demolish::ContactCache::reserve(int contacts)
+{
+  // find() grows one insertion early, keep one spare slot for it
+  while(2*(_size+contacts+1) > int(_entries.size())) grow();
+}
+
+void demolish::ContactCache::expire(int step)
+{
+  for(int i=0; i<_spare.size(); i++) _spare[i].step = -1;
+
+  _size = 0;
+  for(int i=0; i<_entries.size(); i++)
+  {
+    if(_entries[i].step != step) continue;
+
+    Entry* entry = insert(_spare, _entries[i].indexA, _entries[i].indexB, _entries[i].feature);
+    *entry = _entries[i];
+    _size++;
+  }
+  _entries.swap(_spare);
+}
+
+void demolish::ContactCache::rollback()
+{
+  for(int i=0; i<_entries.size(); i++)
+  {
+    if(_entries[i].step < 0) continue;
+    for(int k=0; k<3; k++) _entries[i].displacement[k] = _entries[i].previousDisplacement[k];
+  }
+}
+
+void demolish::ContactCache::rollback(const char* bodies)
+{
+  for(int i=0; i<_entries.size(); i++)
+  {
+    if(_entries[i].step < 0) continue;
+    if(!bodies[_entries[i].indexA] && !bodies[_entries[i].indexB]) continue;
+    for(int k=0; k<3; k++) _entries[i].displacement[k] = _entries[i].previousDisplacement[k];
+  }
+}
+
+void demolish::ContactCache::grow()
+{
+  Entry empty;
+  empty.step = -1;
+  _spare.assign(2*_entries.size(), empty);
+
+  for(int i=0; i<_entries.size(); i++)
+  {
+    if(_entries[i].step < 0) continue;
+
+    Entry* entry = insert(_spare, _entries[i].indexA, _entries[i].indexB, _entries[i].feature);
+    *entry = _entries[i];
+  }
+  _entries.swap(_spare);
+  _spare.assign(_entries.size(), empty);
+}
+
+int demolish::ContactCache::size() const
+{
+  return _size;
+}
+
+int demolish::ContactCache::capacity() const
+{
+  return _entries.size();
+}
+
+void demolish::ContactCache::save(std::vector<char>& buffer) const
+{
+  // size and capacity as two ints, the entries start 8 byte aligned
+  int header[2] = {_size, int(_entries.size())};
+  buffer.resize(sizeof(header) + _entries.size()*sizeof(Entry));
+  std::memcpy(buffer.data(), header, sizeof(header));
+  std::memcpy(buffer.data()+sizeof(header), _entries.data(), _entries.size()*sizeof(Entry));
+}
+
+bool demolish::ContactCache::load(const char* data, std::size_t bytes)
+{
+  int header[2];
+  if(bytes < sizeof(header)) return false;
+  std::memcpy(header, data, sizeof(header));
+
+  const int size     = header[0];
+  const int capacity = header[1];
+  if(capacity < 16 || (capacity & (capacity-1)) != 0 || size < 0 || size > capacity) return false;
+  if(bytes != sizeof(header) + std::size_t(capacity)*sizeof(Entry)) return false;
+
+  _entries.resize(capacity);
+  std::memcpy(_entries.data(), data+sizeof(header), capacity*sizeof(Entry));
+
+  Entry empty;
+  empty.step = -1;
+  _spare.assign(capacity, empty);
+  _size = size;
+  return true;
+}
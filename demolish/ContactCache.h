@@ -0,0 +1,99 @@
+#ifndef _DEMOLISH_CONTACTCACHE
+#define _DEMOLISH_CONTACTCACHE
+
+#include "demolish.h"
+#include <vector>
+
+namespace demolish {
+  class ContactCache;
+}
+
+
+/**
+ * Contacts that persist over several time steps
+ *
+ * Every contact is identified by the particle pair and the feature
+ * (triangle, vertex, ...) it was detected on. The cache stores the
+ * accumulated tangential spring displacement of the contact so friction
+ * can remember where a contact started to stick.
+ *
+ * The table uses open addressing with linear probing on a power of two
+ * capacity. Entries that were not touched during a step are dropped by
+ * expire(), which rehashes the live entries into a second table of the
+ * same size. Both tables keep their storage, so a simulation in steady
+ * state does not allocate.
+ */
+class demolish::ContactCache {
+  public:
+	ContactCache(int capacity = 1024);
+
+	/**
+	 * Returns the tangential displacement of the contact (A, B, feature).
+	 * Unknown contacts are inserted with zero displacement. The entry is
+	 * marked as alive for the given step.
+	 */
+	iREAL* find(int indexA, int indexB, int feature, int step);
+
+	/**
+	 * Grows the table so that the given number of new contacts can be
+	 * inserted without moving it. The pointers returned by find() stay
+	 * valid until then, so contacts can be looked up first and their
+	 * displacements updated concurrently afterwards.
+	 */
+	void reserve(int contacts);
+
+	/**
+	 * Removes every entry that was not found during the given step.
+	 */
+	void expire(int step);
+
+	/**
+	 * Resets all displacements to the values they had before the last
+	 * step. Used when the step is rolled back and redone.
+	 */
+	void rollback();
+
+	/**
+	 * Resets only the contacts of flagged bodies, for a step that is
+	 * redone by some of the bodies.
+	 *
+	 * @param bodies : one flag per particle id
+	 */
+	void rollback(const char* bodies);
+
+	int size() const;
+	int capacity() const;
+
+	/**
+	 * Writes the table as it is, so a restored cache probes and expires
+	 * exactly like the saved one. The buffer is overwritten.
+	 */
+	void save(std::vector<char>& buffer) const;
+
+	/**
+	 * Restores a table written by save(). Returns false if the data is
+	 * not a saved table.
+	 */
+	bool load(const char* data, std::size_t bytes);
+
+  private:
+	struct Entry {
+	  int   indexA;
+	  int   indexB;
+	  int   feature;
+	  int   step;   // -1 marks an empty slot
+	  iREAL displacement[3];
+	  iREAL previousDisplacement[3];
+	};
+
+	static unsigned hash(int indexA, int indexB, int feature);
+
+	Entry* insert(std::vector<Entry>& table, int indexA, int indexB, int feature);
+	void   grow();
+
+	std::vector<Entry> _entries;
+	std::vector<Entry> _spare;
+	int                _size;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "ContactIslands.h"
+
+demolish::ContactIslands::ContactIslands():
+  _numberOfIslands(0)
+{
+  _bodyOffsets.assign(1, 0);
+  _contactOffsets.assign(1, 0);
+}
+
+int demolish::ContactIslands::find(int body)
+{
+  // path halving, every visited body skips its parent
+  while(_parent[body] != body)
+  {
+    _parent[body] = _parent[_parent[body]];
+    body = _parent[body];
+  }
+  return body;
+}
+
+void demolish::ContactIslands::build(
+  int                        numberOfBodies,
+  const std::array<int, 2>*  contactBodies,
+  int                        numberOfContacts,
+  const char*                isObstacle)
+{
+  // there are never more islands than bodies, the offsets are sized once
+  _parent.resize(numberOfBodies);
+  _bodyOffsets.reserve(numberOfBodies+1);
+  _contactOffsets.reserve(numberOfBodies+1);
+  for(int i=0; i<numberOfBodies; i++) _parent[i] = i;
+
+  for(int c=0; c<numberOfContacts; c++)
+  {
+    const int a = contactBodies[c][0];
+    const int b = contactBodies[c][1];
+    if(isObstacle[a] || isObstacle[b]) continue;
+
+    // the lower root wins, the result does not depend on the contact order
+    const int rootA = find(a);
+    const int rootB = find(b);
+    if(rootA < rootB)      _parent[rootB] = rootA;
+    else if(rootB < rootA) _parent[rootA] = rootB;
+  }
+
+  // a root is the lowest body of its island, it is reached first
+  _island.assign(numberOfBodies, -1);
+  _numberOfIslands = 0;
+  for(int i=0; i<numberOfBodies; i++)
+  {
+    if(isObstacle[i]) continue;
+    const int root = find(i);
+    if(root == i) _island[i] = _numberOfIslands++;
+    else          _island[i] = _island[root];
+  }
+
+  // counting sorts keep the order of bodies and contacts within an island
+  _bodyOffsets.assign(_numberOfIslands+1, 0);
+  for(int i=0; i<numberOfBodies; i++)
+  {
+    if(_island[i] >= 0) _bodyOffsets[_island[i]+1]++;
+  }
+  for(int k=0; k<_numberOfIslands; k++) _bodyOffsets[k+1] += _bodyOffsets[k];
+
+  // the union-find is done, _parent holds the fill positions from here
+  _bodies.resize(_bodyOffsets[_numberOfIslands]);
+  _parent.assign(_bodyOffsets.begin(), _bodyOffsets.end()-1);
+  for(int i=0; i<numberOfBodies; i++)
+  {
+    if(_island[i] >= 0) _bodies[_parent[_island[i]]++] = i;
+  }
+
+  _contactOffsets.assign(_numberOfIslands+1, 0);
+  for(int c=0; c<numberOfContacts; c++)
+  {
+    const int body = isObstacle[contactBodies[c][0]] ? contactBodies[c][1] : contactBodies[c][0];
+    _contactOffsets[_island[body]+1]++;
+  }
+  for(int k=0; k<_numberOfIslands; k++) _contactOffsets[k+1] += _contactOffsets[k];
+
+  _contacts.resize(_contactOffsets[_numberOfIslands]);
+  _parent.assign(_contactOffsets.begin(), _contactOffsets.end()-1);
+  for(int c=0; c<numberOfContacts; c++)
+  {
+    const int body = isObstacle[contactBodies[c][0]] ? contactBodies[c][1] : contactBodies[c][0];
+    _contacts[_parent[_island[body]]++] = c;
+  }
+}
+
+int demolish::ContactIslands::getNumberOfIslands() const
+{
+  return _numberOfIslands;
+}
+
+int demolish::ContactIslands::getNumberOfBodies(int island) const
+{
+  return _bodyOffsets[island+1]-_bodyOffsets[island];
+}
+
+const int* demolish::ContactIslands::getBodies(int island) const
+{
+  return _bodies.data()+_bodyOffsets[island];
+}
+
+int demolish::ContactIslands::getNumberOfContacts(int island) const
+{
+  return _contactOffsets[island+1]-_contactOffsets[island];
+}
+
+const int* demolish::ContactIslands::getContacts(int island) const
+{
+  return _contacts.data()+_contactOffsets[island];
+}
+
+int demolish::ContactIslands::getIsland(int body) const
+{
+  return _island[body];
+}
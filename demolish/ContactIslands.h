@@ -0,0 +1,78 @@
+#ifndef _DEMOLISH_CONTACTISLANDS
+#define _DEMOLISH_CONTACTISLANDS
+
+#include "demolish.h"
+#include <vector>
+#include <array>
+
+namespace demolish {
+  class ContactIslands;
+}
+
+
+/**
+ * Connected components of the contact graph
+ *
+ * Two moving bodies are in the same island if a chain of contacts
+ * connects them. Obstacles do not move, so contacts with an obstacle
+ * belong to the island of the moving body and never join two islands.
+ * Bodies in different islands do not influence each other within a
+ * step, their contacts can be resolved concurrently.
+ *
+ * Islands are found with a union-find over the contacts and numbered in
+ * the order of their first body. The bodies and the contacts of an
+ * island keep their relative order, so resolving an island on its own
+ * gives the same result as the serial contact loop. The storage is kept
+ * between builds.
+ */
+class demolish::ContactIslands {
+  public:
+	ContactIslands();
+
+	/**
+	 * Finds the islands of the given contacts.
+	 *
+	 * @param numberOfBodies   : bodies are numbered 0 to numberOfBodies-1
+	 * @param contactBodies    : the two bodies of every contact
+	 * @param numberOfContacts : number of contacts
+	 * @param isObstacle       : one flag per body, obstacles are in no island
+	 */
+	void build(
+		int                        numberOfBodies,
+		const std::array<int, 2>*  contactBodies,
+		int                        numberOfContacts,
+		const char*                isObstacle);
+
+	int        getNumberOfIslands() const;
+
+	/**
+	 * Bodies of an island, a moving body without contacts is an island
+	 * of its own.
+	 */
+	int        getNumberOfBodies(int island) const;
+	const int* getBodies(int island) const;
+
+	/**
+	 * Indices of the contacts of an island in the contact list.
+	 */
+	int        getNumberOfContacts(int island) const;
+	const int* getContacts(int island) const;
+
+	/**
+	 * Island of a body, -1 for obstacles.
+	 */
+	int        getIsland(int body) const;
+
+  private:
+	int  find(int body);
+
+	std::vector<int>  _parent;
+	std::vector<int>  _island;
+	std::vector<int>  _bodyOffsets;
+	std::vector<int>  _bodies;
+	std::vector<int>  _contactOffsets;
+	std::vector<int>  _contacts;
+	int               _numberOfIslands;
+};
+
+#endif
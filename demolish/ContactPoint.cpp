@@ -1,12 +1,14 @@
 #include "ContactPoint.h"
 #include <iomanip>
 
-demolish::ContactPoint::ContactPoint() {}
+demolish::ContactPoint::ContactPoint():
+  feature(0) {}
 
 demolish::ContactPoint::ContactPoint(const ContactPoint& copy):
   distance(copy.distance),
   indexA(copy.indexA),
   indexB(copy.indexB),
+  feature(copy.feature),
   friction(copy.friction),
   depth(copy.depth)
   {
@@ -46,7 +48,8 @@ demolish::ContactPoint::ContactPoint(
   const bool&       outside
 ):
   indexA(-1),
-  indexB(-1) {
+  indexB(-1),
+  feature(0) {
   x[0] = (xPA+xQB)/2.0;
   x[1] = (yPA+yQB)/2.0;
   x[2] = (zPA+zQB)/2.0;
@@ -57,11 +60,14 @@ demolish::ContactPoint::ContactPoint(
 
   const iREAL normalLength = std::sqrt( normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2] );
 
-  normal[0] /= normalLength;
-  normal[1] /= normalLength;
-  normal[2] /= normalLength;
+  // PA-QB points from B to A while the shapes are apart and the other
+  // way round once they overlap
+  const iREAL direction = outside ? normalLength : -normalLength;
+  normal[0] /= direction;
+  normal[1] /= direction;
+  normal[2] /= direction;
 
-  distance = outside ? normalLength : -normalLength;
+  distance = direction;
 
   // note that this version of the constructor is useless if we need depth information.
   depth = 0;
@@ -85,7 +91,8 @@ demolish::ContactPoint::ContactPoint(
    bool             fric
 ):
   indexA(-1),
-  indexB(-1) {
+  indexB(-1),
+  feature(0) {
   x[0] = (xPA+xQB)/2.0;
   x[1] = (yPA+yQB)/2.0;
   x[2] = (zPA+zQB)/2.0;
@@ -97,13 +104,16 @@ demolish::ContactPoint::ContactPoint(
 
   const iREAL normalLength = std::sqrt( normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2] );
 
-  normal[0] /= normalLength;
-  normal[1] /= normalLength;
-  normal[2] /= normalLength;
+  // PA-QB points from B to A while the shapes are apart and the other
+  // way round once they overlap
+  const iREAL direction = outside ? normalLength : -normalLength;
+  normal[0] /= direction;
+  normal[1] /= direction;
+  normal[2] /= direction;
 
-  distance = outside ? normalLength : -normalLength;
+  distance = direction;
 
-  depth = (epsilonA+epsilonB)-normalLength;
+  depth = (epsilonA+epsilonB)-distance;
 }
 
 demolish::ContactPoint::ContactPoint(
@@ -127,6 +137,7 @@ demolish::ContactPoint::ContactPoint(
 ):
   indexA(particleA),
   indexB(particleB),
+  feature(0),
   friction(fric){
   x[0] = (xPA+xQB)/2.0;
   x[1] = (yPA+yQB)/2.0;
@@ -140,13 +151,16 @@ demolish::ContactPoint::ContactPoint(
   iREAL normalLength = std::sqrt( normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2] );
 
   friction = fric;
-  normal[0] /= normalLength;
-  normal[1] /= normalLength;
-  normal[2] /= normalLength;
+  // PA-QB points from B to A while the shapes are apart and the other
+  // way round once they overlap
+  const iREAL direction = outside ? normalLength : -normalLength;
+  normal[0] /= direction;
+  normal[1] /= direction;
+  normal[2] /= direction;
 
-  distance = outside ? normalLength : -normalLength;
+  distance = direction;
 
-  depth = (epsilonA+epsilonB)-normalLength;
+  depth = (epsilonA+epsilonB)-distance;
 }
 
 void demolish::ContactPoint::printInformation()
@@ -27,7 +27,8 @@ struct demolish::ContactPoint {
   iREAL 	x[3];
 
   /**
-   * Normal onto next surface. Always normalised.
+   * Normal onto next surface. Always normalised and always from B to A,
+   * whether the shapes are apart or overlap.
    */
   iREAL 	normal[3];
 
@@ -44,9 +45,17 @@ struct demolish::ContactPoint {
   int 	    indexA;
   int 	    indexB;
 
+  /**
+   * Identifies the feature (triangle pair, triangle, vertex) the contact
+   * was found on, so a contact can be recognised in the next time step.
+   * Zero if the pair only ever has one contact.
+   */
+  int       feature;
+
 
   /**
-   * Tells us how far the objects have overlapped
+   * Tells us how far the objects have overlapped: the sum of the epsilons
+   * less the distance
    */
 
   iREAL depth;
@@ -61,7 +70,8 @@ struct demolish::ContactPoint {
    * This constructor is given two points on two triangles that are close to
    * each other. The points are PA and PB. The operation determines the
    * contact point at x,y,z (which is half the distance between the two
-   * points PA and PB) and the corresponding normal xN,yN,zN.
+   * points PA and PB) and the corresponding normal xN,yN,zN. outside tells
+   * whether PA lies outside of B, the normal is turned round if it does not.
    */
   ContactPoint(
     const iREAL&  	xPA,
@@ -1,6 +1,8 @@
 
 
 #include "Mesh.h"
+#include "resolution/dynamics.h"
+#include "math.h"
 
 #include <vector>
 #include <map>
@@ -14,9 +16,11 @@
 #include <iomanip>
 #include <functional>
 #include <unordered_set>
+#include <algorithm>
 
 demolish::Mesh::Mesh()
 {
+  _isIndexed = false;
 
 }
 
@@ -24,10 +28,30 @@ demolish::Mesh::Mesh(
 	std::vector<std::array<int, 3>> 		&triangleFaces,
 	std::vector<Vertex>                  	&uniqueVertices)
 {
+  _isIndexed = false;
   _triangleFaces = triangleFaces;
   _uniqueVertices = uniqueVertices;
+  _originalTriangleIndices.resize(_triangleFaces.size());
+  for(int i=0; i<_triangleFaces.size(); i++) _originalTriangleIndices[i] = i;
 
+  reorderTriangles();
   demolish::Mesh::flatten();
+  computeVertexAdjacency();
+}
+
+demolish::Mesh::Mesh(
+	std::vector<std::array<int, 3>> 		&triangleFaces,
+	std::vector<Vertex>                  	&uniqueVertices,
+	std::vector<int>                        &originalTriangleIndices)
+{
+  _isIndexed = false;
+  _triangleFaces = triangleFaces;
+  _uniqueVertices = uniqueVertices;
+  _originalTriangleIndices = originalTriangleIndices;
+  _originalTriangleIndices.resize(_triangleFaces.size(), -1);
+
+  demolish::Mesh::flatten();
+  computeVertexAdjacency();
 }
 
 demolish::Mesh::Mesh(
@@ -35,6 +59,7 @@ demolish::Mesh::Mesh(
 	std::vector<iREAL>& yCoordinates,
 	std::vector<iREAL>& zCoordinates)
 {
+  _isIndexed = false;
   _maxMeshSize = 0;
   _minMeshSize = 1E99;
 
@@ -92,78 +117,71 @@ demolish::Mesh::Mesh(
   _avgMeshSize = _avgMeshSize / xCoordinates.size();
 
   compressFromVectors();
+  reorderTriangles();
+  computeVertexAdjacency();
 }
 
-void demolish::Mesh::compressFromVectors()
-{
-  _uniqueVertices.clear();
-  _triangleFaces.clear();
-
-  //#pragma omp parallel for
-  for(int i=0; i<_xCoordinates.size(); i+=3)
+namespace {
+  /*
+   * Welds the corners of a triangle soup and appends the unique vertices
+   * and the faces. Triangle t keeps corners 3t, 3t+1 and 3t+2, also if
+   * welding collapses it, so the faces stay aligned with the SoA arrays.
+   */
+  void compress(
+	const std::vector<iREAL>&          xCoordinates,
+	const std::vector<iREAL>&          yCoordinates,
+	const std::vector<iREAL>&          zCoordinates,
+	std::vector<std::array<int, 3>>&   triangleFaces,
+	std::vector<demolish::Vertex>&     uniqueVertices)
   {
-	iREAL xA = _xCoordinates[i];
-	iREAL yA = _yCoordinates[i];
-	iREAL zA = _zCoordinates[i];
-
-	iREAL xB = _xCoordinates[i+1];
-	iREAL yB = _yCoordinates[i+1];
-	iREAL zB = _zCoordinates[i+1];
-
-	iREAL xC = _xCoordinates[i+2];
-	iREAL yC = _yCoordinates[i+2];
-	iREAL zC = _zCoordinates[i+2];
-
-	std::map<unsigned int, demolish::Vertex> 	                hashToVerticesMap;
-	std::map<unsigned int, unsigned int> 		    hashToUniqueVertexPositionMap;
-
-	std::hash<std::string> v_hash;
-
-	std::ostringstream ssA;
-	ssA << xA << yA << zA;
-	std::string A(ssA.str());
-	unsigned int uniqueIDA = v_hash(A);
-
-	if(hashToVerticesMap.count(uniqueIDA) == 0)
-	{
-	  hashToVerticesMap[uniqueIDA] = demolish::Vertex(xA, yA, zA);
-	  _uniqueVertices.push_back(hashToVerticesMap[uniqueIDA]);
-	  hashToUniqueVertexPositionMap[uniqueIDA] = _uniqueVertices.size()-1;
-	}
+    const int n = xCoordinates.size() - xCoordinates.size()%3;
 
-	std::ostringstream ssB;
-	ssB << xB << yB << zB;
-	std::string B(ssB.str());
-	unsigned int uniqueIDB = v_hash(B);
+    iREAL minX = 1E99, minY = 1E99, minZ = 1E99;
+    iREAL maxX = -1E99, maxY = -1E99, maxZ = -1E99;
+    #pragma omp parallel for reduction(min:minX,minY,minZ) reduction(max:maxX,maxY,maxZ)
+    for(int i=0; i<n; i++)
+    {
+      minX = std::min(minX, xCoordinates[i]); maxX = std::max(maxX, xCoordinates[i]);
+      minY = std::min(minY, yCoordinates[i]); maxY = std::max(maxY, yCoordinates[i]);
+      minZ = std::min(minZ, zCoordinates[i]); maxZ = std::max(maxZ, zCoordinates[i]);
+    }
+    const iREAL diagonal = n > 0 ? std::sqrt((maxX-minX)*(maxX-minX) + (maxY-minY)*(maxY-minY) + (maxZ-minZ)*(maxZ-minZ)) : 0.0;
 
-	if(hashToVerticesMap.count(uniqueIDB) == 0)
-	{
-	  hashToVerticesMap[uniqueIDB] = demolish::Vertex(xA, yA, zA);
-	  _uniqueVertices.push_back(hashToVerticesMap[uniqueIDB]);
-	  hashToUniqueVertexPositionMap[uniqueIDB] = _uniqueVertices.size()-1;
-	}
+    std::vector<int>              uniqueIndex;
+    std::vector<demolish::Vertex> welded;
+    demolish::operators::weldVertices(xCoordinates.data(), yCoordinates.data(), zCoordinates.data(), n,
+                                      demolish::operators::weldTolerance*diagonal, uniqueIndex, welded);
 
-	std::ostringstream ssC;
-	ssC << xC << yC << zC;
-	std::string C(ssC.str());
-	unsigned int uniqueIDC = v_hash(C);
+    const int offset = uniqueVertices.size();
+    uniqueVertices.insert(uniqueVertices.end(), welded.begin(), welded.end());
 
-	if(hashToVerticesMap.count(uniqueIDC) == 0)
-	{
-	  hashToVerticesMap[uniqueIDC] = demolish::Vertex(xC, yC, zC);
-	  _uniqueVertices.push_back(hashToVerticesMap[uniqueIDC]);
-	  hashToUniqueVertexPositionMap[uniqueIDC] = _uniqueVertices.size()-1;
-	}
+    const int first = triangleFaces.size();
+    triangleFaces.resize(first + n/3);
+    #pragma omp parallel for
+    for(int t=0; t<n/3; t++)
+    {
+      triangleFaces[first+t] = {offset+uniqueIndex[3*t], offset+uniqueIndex[3*t+1], offset+uniqueIndex[3*t+2]};
+    }
+  }
+}
 
-	int a = hashToUniqueVertexPositionMap[uniqueIDA];
-	int b = hashToUniqueVertexPositionMap[uniqueIDB];
-	int c = hashToUniqueVertexPositionMap[uniqueIDC];
-	std::array<int, 3> loc = {a, b, c};
+void demolish::Mesh::compressFromVectors()
+{
+  _uniqueVertices.clear();
+  _triangleFaces.clear();
 
-    //#pragma omp critical
-	_triangleFaces.push_back(loc);
-  }
-//  printf("compressed vertices: %i\n", _uniqueVertices.size());
+#ifdef DEMOLISH_MIXED_PRECISION
+  // the weld runs in iREAL, the float vertices are widened for it
+  std::vector<iREAL> xCoordinates(_xCoordinates.begin(), _xCoordinates.end());
+  std::vector<iREAL> yCoordinates(_yCoordinates.begin(), _yCoordinates.end());
+  std::vector<iREAL> zCoordinates(_zCoordinates.begin(), _zCoordinates.end());
+  compress(xCoordinates, yCoordinates, zCoordinates, _triangleFaces, _uniqueVertices);
+#else
+  compress(_xCoordinates, _yCoordinates, _zCoordinates, _triangleFaces, _uniqueVertices);
+#endif
+
+  _originalTriangleIndices.resize(_triangleFaces.size());
+  for(int i=0; i<_triangleFaces.size(); i++) _originalTriangleIndices[i] = i;
 }
 
 void demolish::Mesh::compressFromVectors(
@@ -171,138 +189,148 @@ void demolish::Mesh::compressFromVectors(
 	std::vector<iREAL>& yCoordinates,
 	std::vector<iREAL>& zCoordinates)
 {
-  std::hash<std::string> v_hash;
-  std::map<unsigned int, std::array<iREAL,3>> vertices;
+  compress(xCoordinates, yCoordinates, zCoordinates, _triangleFaces, _uniqueVertices);
 
-  //#pragma omp parallel for
-  for(int i=0; i<xCoordinates.size(); i+=3)
-  {
-	iREAL xA = xCoordinates[i];
-	iREAL yA = yCoordinates[i];
-	iREAL zA = zCoordinates[i];
-
-	iREAL xB = xCoordinates[i+1];
-	iREAL yB = yCoordinates[i+1];
-	iREAL zB = zCoordinates[i+1];
-
-	iREAL xC = xCoordinates[i+2];
-	iREAL yC = yCoordinates[i+2];
-	iREAL zC = zCoordinates[i+2];
-
-	std::map<unsigned int, Vertex> 	            hashToVerticesMap;
-	std::map<unsigned int, unsigned int> 		hashToVertexPositionMap;
-
-	std::ostringstream ssA;
-	ssA << xA << yA << zA;
-	std::string A(ssA.str());
-	unsigned int uniqueIDA = v_hash(A);
+  for(int i=_originalTriangleIndices.size(); i<_triangleFaces.size(); i++) _originalTriangleIndices.push_back(i);
+}
 
-	if(hashToVerticesMap.count(uniqueIDA) == 0)
-	{
-	  hashToVerticesMap[uniqueIDA] = demolish::Vertex(xA, yA, zA);
-	  _uniqueVertices.push_back(hashToVerticesMap[uniqueIDA]);
-	  hashToVertexPositionMap[uniqueIDA] = _uniqueVertices.size()-1;
-	}
+void demolish::Mesh::reorderTriangles()
+{
+  const int numberOfTriangles = _triangleFaces.size();
+  const int numberOfVertices  = _uniqueVertices.size();
+  if(numberOfTriangles < 2) return;
+
+  std::vector<std::array<iREAL, 3>> centroids(numberOfTriangles);
+  iREAL lower[3] = { 1E99,  1E99,  1E99};
+  iREAL upper[3] = {-1E99, -1E99, -1E99};
+  #pragma omp parallel for reduction(min:lower[:3]) reduction(max:upper[:3])
+  for(int t=0; t<numberOfTriangles; t++)
+  {
+    const demolish::Vertex& A = _uniqueVertices[_triangleFaces[t][0]];
+    const demolish::Vertex& B = _uniqueVertices[_triangleFaces[t][1]];
+    const demolish::Vertex& C = _uniqueVertices[_triangleFaces[t][2]];
+    centroids[t] = {(A.getX() + B.getX() + C.getX()) / 3.0,
+                    (A.getY() + B.getY() + C.getY()) / 3.0,
+                    (A.getZ() + B.getZ() + C.getZ()) / 3.0};
+    for(int d=0; d<3; d++)
+    {
+      lower[d] = std::min(lower[d], centroids[t][d]);
+      upper[d] = std::max(upper[d], centroids[t][d]);
+    }
+  }
 
-	std::ostringstream ssB;
-	ssB << xB << yB << zB;
-	std::string B(ssB.str());
-	unsigned int uniqueIDB = v_hash(B);
+  // the index breaks ties, so the order is unique
+  std::vector<std::pair<uint64_t, int>> order(numberOfTriangles);
+  #pragma omp parallel for
+  for(int t=0; t<numberOfTriangles; t++)
+  {
+    order[t] = {demolish::mortonCode(centroids[t].data(), lower, upper), t};
+  }
+  std::sort(order.begin(), order.end());
 
-	if(hashToVerticesMap.count(uniqueIDB) == 0)
-	{
-	  hashToVerticesMap[uniqueIDB] = demolish::Vertex(xB, yB, zB);
-	  _uniqueVertices.push_back(hashToVerticesMap[uniqueIDB]);
-	  hashToVertexPositionMap[uniqueIDB] = _uniqueVertices.size()-1;
-	}
+  std::vector<std::array<int, 3>> faces(numberOfTriangles);
+  std::vector<int>                original(numberOfTriangles);
+  #pragma omp parallel for
+  for(int t=0; t<numberOfTriangles; t++)
+  {
+    faces[t]    = _triangleFaces[order[t].second];
+    original[t] = _originalTriangleIndices[order[t].second];
+  }
 
-	std::ostringstream ssC;
-	ssC << xC << yC << zC;
-	std::string C(ssC.str());
-	unsigned int uniqueIDC = v_hash(C);
+  // corner arrays that exist already follow their triangles
+  std::vector<iVERTEX>* corners[9] = {&_xCoordinates, &_yCoordinates, &_zCoordinates,
+                                      &_prevxCoordinates, &_prevyCoordinates, &_prevzCoordinates,
+                                      &_refxCoordinates, &_refyCoordinates, &_refzCoordinates};
+  for(int a=0; a<9; a++)
+  {
+    if(corners[a]->size() != 3*numberOfTriangles) continue;
+    std::vector<iVERTEX> permuted(3*numberOfTriangles);
+    #pragma omp parallel for
+    for(int t=0; t<numberOfTriangles; t++)
+    for(int k=0; k<3; k++) permuted[3*t+k] = (*corners[a])[3*order[t].second+k];
+    corners[a]->swap(permuted);
+  }
 
-	if(hashToVerticesMap.count(uniqueIDC) == 0)
-	{
-	  hashToVerticesMap[uniqueIDC] = demolish::Vertex(xC, yC, zC);
-	  _uniqueVertices.push_back(hashToVerticesMap[uniqueIDC]);
-	  hashToVertexPositionMap[uniqueIDC] = _uniqueVertices.size()-1;
-	}
+  // vertices are renumbered in order of first use, so the triangles
+  // also gather their corners from nearby memory
+  std::vector<int> renumbered(numberOfVertices, -1);
+  int next = 0;
+  for(int t=0; t<numberOfTriangles; t++)
+  for(int k=0; k<3; k++)
+  {
+    int& v = renumbered[faces[t][k]];
+    if(v < 0) v = next++;
+  }
+  for(int v=0; v<numberOfVertices; v++)
+  {
+    if(renumbered[v] < 0) renumbered[v] = next++;
+  }
 
-	int a = hashToVertexPositionMap[uniqueIDA];
-	int b = hashToVertexPositionMap[uniqueIDB];
-	int c = hashToVertexPositionMap[uniqueIDC];
-	std::array<int, 3> loc = {a, b, c};
+  std::vector<demolish::Vertex> vertices(numberOfVertices);
+  #pragma omp parallel for
+  for(int v=0; v<numberOfVertices; v++) vertices[renumbered[v]] = _uniqueVertices[v];
+  #pragma omp parallel for
+  for(int t=0; t<numberOfTriangles; t++)
+  for(int k=0; k<3; k++) faces[t][k] = renumbered[faces[t][k]];
 
-    //#pragma omp critical
-	_triangleFaces.push_back(loc);
-  }
+  _triangleFaces.swap(faces);
+  _uniqueVertices.swap(vertices);
+  _originalTriangleIndices.swap(original);
 }
 
 void demolish::Mesh::flatten()
 {
-  _xCoordinates.clear();
-  _yCoordinates.clear();
-  _zCoordinates.clear();
+  const int numberOfTriangles = _triangleFaces.size();
 
-  _maxMeshSize = 0;
-  _minMeshSize = 1E99;
+  // sized once, every triangle writes its own three corners
+  _xCoordinates.resize(3*numberOfTriangles);
+  _yCoordinates.resize(3*numberOfTriangles);
+  _zCoordinates.resize(3*numberOfTriangles);
+  _refxCoordinates.resize(3*numberOfTriangles);
+  _refyCoordinates.resize(3*numberOfTriangles);
+  _refzCoordinates.resize(3*numberOfTriangles);
 
   iREAL min = 1E99;
   iREAL max = 0;
+  iREAL sum = 0;
 
-  //#pragma omp parallel for
-  for(int i=0; i<_triangleFaces.size(); i++)
+  #pragma omp parallel for reduction(min:min) reduction(max:max) reduction(+:sum)
+  for(int i=0; i<numberOfTriangles; i++)
   {
-    int idxA = _triangleFaces[i][0];
-    int idxB = _triangleFaces[i][1];
-    int idxC = _triangleFaces[i][2];
-
-	demolish::Vertex A = _uniqueVertices[idxA];
-	demolish::Vertex B = _uniqueVertices[idxB];
-	demolish::Vertex C = _uniqueVertices[idxC];
-
-	_xCoordinates.push_back(A[0]);
-	_yCoordinates.push_back(A[1]);
-	_zCoordinates.push_back(A[2]);
-
-	_xCoordinates.push_back(B[0]);
-	_yCoordinates.push_back(B[1]);
-	_zCoordinates.push_back(B[2]);
-
-	_xCoordinates.push_back(C[0]);
-	_yCoordinates.push_back(C[1]);
-	_zCoordinates.push_back(C[2]);
-
-	_refxCoordinates.push_back(A[0]);
-	_refyCoordinates.push_back(A[1]);
-	_refzCoordinates.push_back(A[2]);
+    iREAL corners[3][3];
+    for(int k=0; k<3; k++)
+    {
+      const demolish::Vertex& vertex = _uniqueVertices[_triangleFaces[i][k]];
+      corners[k][0] = vertex.getX();
+      corners[k][1] = vertex.getY();
+      corners[k][2] = vertex.getZ();
+
+      _xCoordinates[3*i+k] = _refxCoordinates[3*i+k] = corners[k][0];
+      _yCoordinates[3*i+k] = _refyCoordinates[3*i+k] = corners[k][1];
+      _zCoordinates[3*i+k] = _refzCoordinates[3*i+k] = corners[k][2];
+    }
 
-	_refxCoordinates.push_back(B[0]);
-	_refyCoordinates.push_back(B[1]);
-	_refzCoordinates.push_back(B[2]);
+    const iREAL* A = corners[0];
+    const iREAL* B = corners[1];
+    const iREAL* C = corners[2];
 
-	_refxCoordinates.push_back(C[0]);
-	_refyCoordinates.push_back(C[1]);
-	_refzCoordinates.push_back(C[2]);
-	
     iREAL AB = sqrt((A[0]-B[0])*(A[0]-B[0])+(A[1]-B[1])*(A[1]-B[1])+(A[2]-B[2])*(A[2]-B[2]));
-	iREAL BC = sqrt((B[0]-C[0])*(B[0]-C[0])+(B[1]-C[1])*(B[1]-C[1])+(B[2]-C[2])*(B[2]-C[2]));
-	iREAL CA = sqrt((C[0]-A[0])*(C[0]-A[0])+(C[1]-A[1])*(C[1]-A[1])+(C[2]-A[2])*(C[2]-A[2]));
+    iREAL BC = sqrt((B[0]-C[0])*(B[0]-C[0])+(B[1]-C[1])*(B[1]-C[1])+(B[2]-C[2])*(B[2]-C[2]));
+    iREAL CA = sqrt((C[0]-A[0])*(C[0]-A[0])+(C[1]-A[1])*(C[1]-A[1])+(C[2]-A[2])*(C[2]-A[2]));
 
-	iREAL hmin = std::min(std::min(AB, BC), CA);
-	iREAL hmax = std::max(std::max(AB, BC), CA);
+    iREAL hmin = std::min(std::min(AB, BC), CA);
+    iREAL hmax = std::max(std::max(AB, BC), CA);
 
-	if (hmin < min) min = hmin;
-	if (hmax > max) max = hmax;
-
-	_avgMeshSize += hmax - hmin;
+    min = std::min(min, hmin);
+    max = std::max(max, hmax);
+    sum += hmax - hmin;
   }
 
   if(min == 1E99) min = 0.0;
 
   _minMeshSize = min;
   _maxMeshSize = max;
-  _avgMeshSize = _avgMeshSize / _xCoordinates.size();
+  _avgMeshSize = _xCoordinates.empty() ? 0.0 : sum / _xCoordinates.size();
 }
 
 std::vector<demolish::Vertex> demolish::Mesh::getVertices()
@@ -320,6 +348,7 @@ void demolish::Mesh::flatten(
 	std::vector<iREAL>& yCoordinates,
 	std::vector<iREAL>& zCoordinates)
 {
+  _isIndexed = false;
   _maxMeshSize = 0;
   _minMeshSize = 1E99;
 
@@ -397,65 +426,65 @@ void demolish::Mesh::replace (
   compressFromVectors();
 }
 
-std::vector<iREAL> demolish::Mesh::getXCoordinatesAsVector()
+std::vector<iVERTEX> demolish::Mesh::getXCoordinatesAsVector()
 {
   return _xCoordinates;
 }
 
-std::vector<iREAL> demolish::Mesh::getYCoordinatesAsVector()
+std::vector<iVERTEX> demolish::Mesh::getYCoordinatesAsVector()
 {
   return _yCoordinates;
 }
 
-std::vector<iREAL> demolish::Mesh::getZCoordinatesAsVector()
+std::vector<iVERTEX> demolish::Mesh::getZCoordinatesAsVector()
 {
   return _zCoordinates;
 }
 
-iREAL*  demolish::Mesh::getXCoordinates()
+iVERTEX*  demolish::Mesh::getXCoordinates()
 {
   return _xCoordinates.data();
 }
 
-iREAL*  demolish::Mesh::getYCoordinates()
+iVERTEX*  demolish::Mesh::getYCoordinates()
 {
   return _yCoordinates.data();
 }
 
-iREAL*  demolish::Mesh::getZCoordinates()
+iVERTEX*  demolish::Mesh::getZCoordinates()
 {
   return _zCoordinates.data();
 }
 
 
 
-iREAL*  demolish::Mesh::getPrevXCoordinates()
+iVERTEX*  demolish::Mesh::getPrevXCoordinates()
 {
   return _prevxCoordinates.data();
 }
 
-iREAL*  demolish::Mesh::getPrevYCoordinates()
+iVERTEX*  demolish::Mesh::getPrevYCoordinates()
 {
   return _prevyCoordinates.data();
 }
 
-iREAL*  demolish::Mesh::getPrevZCoordinates()
+iVERTEX*  demolish::Mesh::getPrevZCoordinates()
 {
   return _prevzCoordinates.data();
 }
 
 
-iREAL*  demolish::Mesh::getRefXCoordinates()
+iVERTEX*  demolish::Mesh::getRefXCoordinates()
 {
   return _refxCoordinates.data();
 }
 
-iREAL*  demolish::Mesh::getRefYCoordinates()
+iVERTEX*  demolish::Mesh::getRefYCoordinates()
 {
   return _refyCoordinates.data();
 }
 
-iREAL*  demolish::Mesh::getRefZCoordinates()
+iVERTEX*  demolish::Mesh::getRefZCoordinates()
 {
   return _refzCoordinates.data();
 }
@@ -491,6 +520,13 @@ void demolish::Mesh::rotateZ(iREAL alphaZ)
 
 void demolish::Mesh::setCurrentCoordinatesEqualToPrevCoordinates()
 {
+    if(_isIndexed)
+    {
+        _xVertices = _prevxVertices;
+        _yVertices = _prevyVertices;
+        _zVertices = _prevzVertices;
+        return;
+    }
     _xCoordinates = _prevxCoordinates;
     _yCoordinates = _prevyCoordinates;
     _zCoordinates = _prevzCoordinates;
@@ -498,11 +534,111 @@ void demolish::Mesh::setCurrentCoordinatesEqualToPrevCoordinates()
 
 void demolish::Mesh::setPreviousCoordinatesEqualToCurrCoordinates()
 {
+    if(_isIndexed)
+    {
+        _prevxVertices = _xVertices;
+        _prevyVertices = _yVertices;
+        _prevzVertices = _zVertices;
+        return;
+    }
     _prevxCoordinates = _xCoordinates;
     _prevyCoordinates = _yCoordinates;
     _prevzCoordinates = _zCoordinates;
 }
 
+void demolish::Mesh::useIndexedStorage()
+{
+  if(_isIndexed) return;
+
+  const int numberOfVertices = _uniqueVertices.size();
+  // meshes built from corners never had reference or previous corners
+  const std::vector<iVERTEX>* ref[3]  = {&_refxCoordinates, &_refyCoordinates, &_refzCoordinates};
+  const std::vector<iVERTEX>* prev[3] = {&_prevxCoordinates, &_prevyCoordinates, &_prevzCoordinates};
+  const std::vector<iVERTEX>* curr[3] = {&_xCoordinates, &_yCoordinates, &_zCoordinates};
+  for(int d=0;d<3;d++)
+  {
+    if(ref[d]->size()  != curr[d]->size()) ref[d]  = curr[d];
+    if(prev[d]->size() != curr[d]->size()) prev[d] = curr[d];
+  }
+
+  std::vector<iVERTEX>* vertices[9] = {&_xVertices, &_yVertices, &_zVertices,
+                                       &_prevxVertices, &_prevyVertices, &_prevzVertices,
+                                       &_refxVertices, &_refyVertices, &_refzVertices};
+  const std::vector<iVERTEX>* corners[9] = {curr[0], curr[1], curr[2],
+                                            prev[0], prev[1], prev[2],
+                                            ref[0],  ref[1],  ref[2]};
+  _indexedVertexCorners.resize(numberOfVertices);
+  for(int a=0;a<9;a++) vertices[a]->assign(numberOfVertices, 0.0);
+
+  #pragma omp parallel for
+  for(int v=0;v<numberOfVertices;v++)
+  {
+    const int c = _vertexCorners[v];
+    _indexedVertexCorners[v] = c < 0 ? -1 : v;
+    if(c < 0) continue;
+    for(int a=0;a<9;a++) (*vertices[a])[v] = (*corners[a])[c];
+  }
+
+  std::vector<iVERTEX>* released[9] = {&_xCoordinates, &_yCoordinates, &_zCoordinates,
+                                       &_prevxCoordinates, &_prevyCoordinates, &_prevzCoordinates,
+                                       &_refxCoordinates, &_refyCoordinates, &_refzCoordinates};
+  for(int a=0;a<9;a++) std::vector<iVERTEX>().swap(*released[a]);
+  _isIndexed = true;
+}
+
+bool demolish::Mesh::getIsIndexed()
+{
+  return _isIndexed;
+}
+
+iVERTEX* demolish::Mesh::getVertexXCoordinates()
+{
+  return _isIndexed ? _xVertices.data() : nullptr;
+}
+
+iVERTEX* demolish::Mesh::getVertexYCoordinates()
+{
+  return _isIndexed ? _yVertices.data() : nullptr;
+}
+
+iVERTEX* demolish::Mesh::getVertexZCoordinates()
+{
+  return _isIndexed ? _zVertices.data() : nullptr;
+}
+
+iVERTEX* demolish::Mesh::getRefVertexXCoordinates()
+{
+  return _isIndexed ? _refxVertices.data() : nullptr;
+}
+
+iVERTEX* demolish::Mesh::getRefVertexYCoordinates()
+{
+  return _isIndexed ? _refyVertices.data() : nullptr;
+}
+
+iVERTEX* demolish::Mesh::getRefVertexZCoordinates()
+{
+  return _isIndexed ? _refzVertices.data() : nullptr;
+}
+
+int* demolish::Mesh::getIndexedVertexCorners()
+{
+  return _isIndexed ? _indexedVertexCorners.data() : nullptr;
+}
+
+void demolish::Mesh::updateVertices(
+  iREAL rotation[9],
+  iREAL position[3],
+  iREAL refPosition[3])
+{
+  for(int v=0;v<_xVertices.size();v++)
+  {
+    demolish::dynamics::updateVertices(&_xVertices[v], &_yVertices[v], &_zVertices[v],
+                                       &_refxVertices[v], &_refyVertices[v], &_refzVertices[v],
+                                       rotation, position, refPosition);
+  }
+}
+
 iREAL demolish::Mesh::computeDiameter()
 {
   return demolish::operators::computeXYZw(
@@ -779,6 +915,109 @@ demolish::Vertex demolish::Mesh::getBoundaryMaxVertex()
   return _maxBoundary;
 }
 
+void demolish::Mesh::computeVertexAdjacency()
+{
+  int numberOfVertices = _uniqueVertices.size();
+
+  _vertexCorners.assign(numberOfVertices, -1);
+  _vertexNeighbourOffsets.assign(numberOfVertices+1, 0);
+
+  // every corner contributes its two triangle neighbours
+  for(int i=0; i<_triangleFaces.size(); i++)
+  {
+    for(int k=0; k<3; k++)
+    {
+      int v = _triangleFaces[i][k];
+      if(_vertexCorners[v] == -1) _vertexCorners[v] = 3*i+k;
+      _vertexNeighbourOffsets[v+1] += 2;
+    }
+  }
+
+  for(int v=0; v<numberOfVertices; v++)
+  {
+    _vertexNeighbourOffsets[v+1] += _vertexNeighbourOffsets[v];
+  }
+
+  std::vector<int> fill(_vertexNeighbourOffsets.begin(), _vertexNeighbourOffsets.end()-1);
+  std::vector<int> neighbours(_vertexNeighbourOffsets[numberOfVertices]);
+
+  for(int i=0; i<_triangleFaces.size(); i++)
+  {
+    for(int k=0; k<3; k++)
+    {
+      int v = _triangleFaces[i][k];
+      neighbours[fill[v]++] = _triangleFaces[i][(k+1)%3];
+      neighbours[fill[v]++] = _triangleFaces[i][(k+2)%3];
+    }
+  }
+
+  // every interior edge is seen from both of its triangles, so drop duplicates
+  _vertexNeighbours.clear();
+  _vertexNeighbours.reserve(neighbours.size()/2);
+  int begin = 0;
+  for(int v=0; v<numberOfVertices; v++)
+  {
+    int end = _vertexNeighbourOffsets[v+1];
+    std::sort(neighbours.begin()+begin, neighbours.begin()+end);
+    auto last = std::unique(neighbours.begin()+begin, neighbours.begin()+end);
+
+    _vertexNeighbourOffsets[v] = _vertexNeighbours.size();
+    _vertexNeighbours.insert(_vertexNeighbours.end(), neighbours.begin()+begin, last);
+    begin = end;
+  }
+  _vertexNeighbourOffsets[numberOfVertices] = _vertexNeighbours.size();
+}
+
+int demolish::Mesh::getNumberOfUniqueVertices()
+{
+  return _uniqueVertices.size();
+}
+
+int demolish::Mesh::getNumberOfTriangles()
+{
+  return _triangleFaces.size();
+}
+
+int* demolish::Mesh::getVertexCorners()
+{
+  return _vertexCorners.data();
+}
+
+int* demolish::Mesh::getVertexNeighbourOffsets()
+{
+  return _vertexNeighbourOffsets.data();
+}
+
+int* demolish::Mesh::getVertexNeighbours()
+{
+  return _vertexNeighbours.data();
+}
+
+int* demolish::Mesh::getOriginalTriangleIndices()
+{
+  return _originalTriangleIndices.data();
+}
+
+void demolish::Mesh::updateTriangleGeometry()
+{
+  _triangleGeometry.resize(_triangleFaces.size());
+  if(_isIndexed)
+  {
+    demolish::detection::computeTriangleGeometry(
+        _xVertices.data(), _yVertices.data(), _zVertices.data(),
+        _triangleFaces.data(), _triangleFaces.size(), _triangleGeometry.data());
+    return;
+  }
+  demolish::detection::computeTriangleGeometry(
+      _xCoordinates.data(), _yCoordinates.data(), _zCoordinates.data(),
+      _triangleFaces.size(), _triangleGeometry.data());
+}
+
+const demolish::detection::TriangleGeometry<iVERTEX>* demolish::Mesh::getTriangleGeometry()
+{
+  return _triangleGeometry.data();
+}
+
 void demolish::Mesh::toString()
 {
   for(int i=0; i<_xCoordinates.size(); i+=3)
@@ -9,6 +9,7 @@
 #include "operators/physics.h"
 #include "operators/mesh.h"
 #include "operators/vertex.h"
+#include "detection/triangles.h"
 
 namespace demolish{
 	  class Mesh;
@@ -18,10 +19,27 @@ class demolish::Mesh {
   public:
 	Mesh();
 
+	/*
+	 *  The triangles of a new mesh are reordered along a Morton curve of
+	 *  their centroids, and the vertices are renumbered in order of first
+	 *  use, so that nearby triangles and vertices are close in memory.
+	 *  getOriginalTriangleIndices maps back to the order given.
+	 */
 	Mesh(
 		std::vector<std::array<int, 3>> 		&triangleFaces,
 		std::vector<Vertex>              	    &uniqueVertices);
 
+	/*
+	 *  Builds a mesh whose triangles are in their final order already,
+	 *  e.g. restored from a checkpoint, and are not reordered.
+	 *
+	 *  @param originalTriangleIndices : original index of every triangle
+	 */
+	Mesh(
+		std::vector<std::array<int, 3>> 		&triangleFaces,
+		std::vector<Vertex>              	    &uniqueVertices,
+		std::vector<int>                        &originalTriangleIndices);
+
 	Mesh(
 		std::vector<iREAL>& xCoordinates,
 		std::vector<iREAL>& yCoordinates,
@@ -125,17 +143,17 @@ class demolish::Mesh {
 	 */
 	iREAL computeDiagonal();
 
-	iREAL* getXCoordinates();
+	iVERTEX* getXCoordinates();
 
-	iREAL* getYCoordinates();
+	iVERTEX* getYCoordinates();
 
-	iREAL* getZCoordinates();
+	iVERTEX* getZCoordinates();
 
-	iREAL* getPrevXCoordinates();
+	iVERTEX* getPrevXCoordinates();
 
-	iREAL* getPrevYCoordinates();
+	iVERTEX* getPrevYCoordinates();
 
-	iREAL* getPrevZCoordinates();
+	iVERTEX* getPrevZCoordinates();
 
 	/*
 	 *  Get Width of the X Coordinates
@@ -146,7 +164,7 @@ class demolish::Mesh {
 	 *  @param none
 	 *  @returns iREAL value
 	 */
-	iREAL* getRefXCoordinates();
+	iVERTEX* getRefXCoordinates();
 
 	/*
 	 *  Get Y Coordinates
@@ -157,7 +175,7 @@ class demolish::Mesh {
 	 *  @param none
 	 *  @returns vector of iREAL values
 	 */
-	iREAL* getRefYCoordinates();
+	iVERTEX* getRefYCoordinates();
 
 	/*
 	 *  Get Z Coordinates
@@ -168,7 +186,72 @@ class demolish::Mesh {
 	 *  @param none
 	 *  @returns vector of iREAL values
 	 */
-	iREAL* getRefZCoordinates();
+	iVERTEX* getRefZCoordinates();
+
+	/*
+	 *  Use Indexed Storage
+	 *
+	 *  Switches the mesh from three corners per triangle to one position
+	 *  per unique vertex. The current, previous and reference positions
+	 *  are taken from the corners (through getVertexCorners), then the
+	 *  corner arrays are released. Afterwards the mesh is moved with
+	 *  updateVertices and read through the vertex arrays and
+	 *  getTriangleFaces; the corner accessors return nullptr, and the
+	 *  operations on the corners (shift, rotate, volume, inertia,
+	 *  flatten) must not be used any more. Does nothing if the mesh is
+	 *  indexed already.
+	 *
+	 *  @param none
+	 *  @returns void
+	 */
+	void useIndexedStorage();
+
+	bool getIsIndexed();
+
+	/*
+	 *  Get Vertex Coordinates
+	 *
+	 *  Current and reference positions of the unique vertices of an
+	 *  indexed mesh, numberOfUniqueVertices entries each.
+	 *
+	 *  @param none
+	 *  @returns pointer to the positions, nullptr if not indexed
+	 */
+	iVERTEX* getVertexXCoordinates();
+	iVERTEX* getVertexYCoordinates();
+	iVERTEX* getVertexZCoordinates();
+	iVERTEX* getRefVertexXCoordinates();
+	iVERTEX* getRefVertexYCoordinates();
+	iVERTEX* getRefVertexZCoordinates();
+
+	/*
+	 *  Get Indexed Vertex Corners
+	 *
+	 *  The counterpart of getVertexCorners for the vertex arrays: v for
+	 *  every vertex referenced by a triangle, -1 otherwise. Lets the
+	 *  kernels that take coordinates and a corner map run on an indexed
+	 *  mesh.
+	 *
+	 *  @param none
+	 *  @returns pointer to numberOfUniqueVertices ints
+	 */
+	int* getIndexedVertexCorners();
+
+	/*
+	 *  Update Vertices
+	 *
+	 *  Moves an indexed mesh rigidly, every unique vertex once:
+	 *  x = rotation (ref - refPosition) + position.
+	 *
+	 *  @param rotation    : orientation of the body, column-major
+	 *  @param position    : centre of mass
+	 *  @param refPosition : centre of mass in the reference configuration
+	 *  @returns void
+	 */
+	void updateVertices(
+		iREAL rotation[9],
+		iREAL position[3],
+		iREAL refPosition[3]);
 
 	/*
 	 *  Get Width of the X Coordinates
@@ -395,7 +478,7 @@ class demolish::Mesh {
 	 *  @param none
 	 *  @returns vector
 	 */
-	std::vector<iREAL> getXCoordinatesAsVector();
+	std::vector<iVERTEX> getXCoordinatesAsVector();
 
 	/*
 	 *  Get X Coordinates
@@ -406,7 +489,7 @@ class demolish::Mesh {
 	 *  @param none
 	 *  @returns vector
 	 */
-	std::vector<iREAL> getYCoordinatesAsVector();
+	std::vector<iVERTEX> getYCoordinatesAsVector();
 
 	/*
 	 *  Get X Coordinates
@@ -417,7 +500,7 @@ class demolish::Mesh {
 	 *  @param none
 	 *  @returns vector
 	 */
-	std::vector<iREAL> getZCoordinatesAsVector();
+	std::vector<iVERTEX> getZCoordinatesAsVector();
 
 	void computeExplode(iREAL length);
 
@@ -499,6 +582,85 @@ class demolish::Mesh {
 	demolish::Vertex getBoundaryMinVertex();
 	demolish::Vertex getBoundaryMaxVertex();
 
+	/*
+	 *  Get Number of Unique Vertices
+	 *
+	 *  Returns the number of unique vertices without copying them.
+	 *
+	 *  @param none
+	 *  @returns int
+	 */
+	int getNumberOfUniqueVertices();
+
+	/*
+	 *  Get Number of Triangles
+	 *
+	 *  Returns the number of triangles without copying the faces.
+	 *
+	 *  @param none
+	 *  @returns int
+	 */
+	int getNumberOfTriangles();
+
+	/*
+	 *  Get Vertex Corners
+	 *
+	 *  Returns, for every unique vertex, the index of one triangle
+	 *  corner in the flattened SoA arrays that holds its spatial
+	 *  coordinates (-1 if the vertex is not referenced by any triangle).
+	 *
+	 *  @param none
+	 *  @returns pointer to numberOfUniqueVertices ints
+	 */
+	int* getVertexCorners();
+
+	/*
+	 *  Get Vertex Neighbours
+	 *
+	 *  Returns the edge adjacency of the unique vertices in compressed
+	 *  row form. The neighbours of vertex v are
+	 *  neighbours[offsets[v]] .. neighbours[offsets[v+1]-1].
+	 *
+	 *  @param none
+	 *  @returns pointer to offsets (numberOfUniqueVertices+1 ints)
+	 *           and neighbours respectively
+	 */
+	int* getVertexNeighbourOffsets();
+	int* getVertexNeighbours();
+
+	/*
+	 *  Get Original Triangle Indices
+	 *
+	 *  Returns, for every triangle, its index in the order the mesh was
+	 *  built from (by the builder or file loader), for output.
+	 *
+	 *  @param none
+	 *  @returns pointer to numberOfTriangles ints
+	 */
+	int* getOriginalTriangleIndices();
+
+	/*
+	 *  Update Triangle Geometry
+	 *
+	 *  Recomputes the narrow phase terms of every triangle from the
+	 *  current coordinates. Call it once after the vertices moved.
+	 *
+	 *  @param none
+	 *  @returns void
+	 */
+	void updateTriangleGeometry();
+
+	/*
+	 *  Get Triangle Geometry
+	 *
+	 *  Returns the terms of the last updateTriangleGeometry, one entry
+	 *  per triangle.
+	 *
+	 *  @param none
+	 *  @returns pointer to numberOfTriangles entries
+	 */
+	const demolish::detection::TriangleGeometry<iVERTEX>* getTriangleGeometry();
+
 
 	virtual ~Mesh();
 
@@ -512,6 +674,8 @@ class demolish::Mesh {
 	 *
 	 *  Compresses SoA data structure into triangle
 	 *  faces pointer and unique vertices.
+	 *  Corners closer than operators::weldTolerance of the
+	 *  bounding box diagonal become one unique vertex.
 	 *  This modifies the local data.
 	 *
 	 *  @returns void
@@ -522,7 +686,8 @@ class demolish::Mesh {
 	 *  Compress from vectors
 	 *
 	 *  Compresses SoA data structure into triangle
-	 *  faces pointer and unique vertices.
+	 *  faces pointer and unique vertices. The faces and
+	 *  vertices are appended to the ones already held.
 	 *  This modifies the local data.
 	 *
 	 *  @returns void
@@ -541,20 +706,63 @@ class demolish::Mesh {
 
     void toString();
 
-	std::vector<std::array<int, 3>> 			_triangleFaces;
-	std::vector<demolish::Vertex>             	_uniqueVertices;
+	/*
+	 *  Compute Vertex Adjacency
+	 *
+	 *  Builds the vertex to corner map and the vertex edge
+	 *  adjacency from the triangle faces. Used by the support
+	 *  mapping of the convex narrow phase.
+	 *
+	 *  @returns void
+	 */
+	void computeVertexAdjacency();
 
-    std::vector<iREAL>   						_prevxCoordinates;
-    std::vector<iREAL>   						_prevyCoordinates;
-    std::vector<iREAL>   						_prevzCoordinates;
+	/*
+	 *  Reorder Triangles
+	 *
+	 *  Sorts the triangles by the Morton code of their centroids within
+	 *  the mesh, moving the corner arrays that exist already with them,
+	 *  and renumbers the vertices in order of first use. The original
+	 *  triangle indices are carried along.
+	 *
+	 *  @returns void
+	 */
+	void reorderTriangles();
 
-    std::vector<iREAL>   						_xCoordinates;
-    std::vector<iREAL>   						_yCoordinates;
-    std::vector<iREAL>   						_zCoordinates;
+	std::vector<std::array<int, 3>> 			_triangleFaces;
+	std::vector<demolish::Vertex>             	_uniqueVertices;
 
-    std::vector<iREAL>                          _refxCoordinates;                          
-    std::vector<iREAL>                          _refyCoordinates;                          
-    std::vector<iREAL>                          _refzCoordinates;                          
+    std::vector<iVERTEX>   						_prevxCoordinates;
+    std::vector<iVERTEX>   						_prevyCoordinates;
+    std::vector<iVERTEX>   						_prevzCoordinates;
+
+    std::vector<iVERTEX>   						_xCoordinates;
+    std::vector<iVERTEX>   						_yCoordinates;
+    std::vector<iVERTEX>   						_zCoordinates;
+
+    std::vector<iVERTEX>                          _refxCoordinates;                          
+    std::vector<iVERTEX>                          _refyCoordinates;                          
+    std::vector<iVERTEX>                          _refzCoordinates;                          
+
+    std::vector<int>                            _vertexCorners;
+    std::vector<int>                            _vertexNeighbourOffsets;
+    std::vector<int>                            _vertexNeighbours;
+    std::vector<int>                            _originalTriangleIndices;
+
+    // one entry per unique vertex once the mesh is indexed
+    bool                                        _isIndexed;
+    std::vector<iVERTEX>                        _xVertices;
+    std::vector<iVERTEX>                        _yVertices;
+    std::vector<iVERTEX>                        _zVertices;
+    std::vector<iVERTEX>                        _prevxVertices;
+    std::vector<iVERTEX>                        _prevyVertices;
+    std::vector<iVERTEX>                        _prevzVertices;
+    std::vector<iVERTEX>                        _refxVertices;
+    std::vector<iVERTEX>                        _refyVertices;
+    std::vector<iVERTEX>                        _refzVertices;
+    std::vector<int>                            _indexedVertexCorners;
+
+    std::vector<demolish::detection::TriangleGeometry<iVERTEX>> _triangleGeometry;
 
     demolish::Vertex						    _minBoundary;
     demolish::Vertex						    _maxBoundary;
@@ -5,6 +5,8 @@
 
 demolish::Object::Object()
 {
+  _mesh          = nullptr;
+  _distanceField = nullptr;
 }
 
 demolish::Object::Object(
@@ -45,6 +47,7 @@ demolish::Object::Object(
   this->_isConvex 			= isConvex;
 
   this->_mesh			= 	nullptr;
+  this->_distanceField  =   nullptr;
   this->_mass			=	0;
 
   _wx = 0;
@@ -97,6 +100,7 @@ std::array<iREAL, 3> 					angular)
 
 
   this-> _mesh			= 	mesh;
+  this->_distanceField  =   nullptr;
 
 
     this->_orientation[0] = 1.0;
@@ -210,10 +214,25 @@ std::array<iREAL, 3> 					angular)
   this->_angularVelocity[1] = angular[1];
   this->_angularVelocity[2] = angular[2];
 
-  this->_haloDiameter 	= 	(_diameter+epsilon*2) * 1.1;
+  this->_refAngularVelocity[0] = angular[0];
+  this->_refAngularVelocity[1] = angular[1];
+  this->_refAngularVelocity[2] = angular[2];
+
+  this->_referenceLocation = _location;
+  this->_isConvex       =   true;
+
   this->_diameter		=	rad*2;
+  this->_haloDiameter 	= 	(_diameter+epsilon*2) * 1.1;
   this->_mass			=	(4.0/3.0)*M_PI*rad*rad*rad*demolish::material::materialToDensitymap[material];
   this->_mesh			= 	nullptr;
+  this->_distanceField  =   nullptr;
+
+  // solid sphere, 2/5 m r^2 about every axis
+  iREAL I = 0.4*_mass*rad*rad;
+  this->_orientation = {1,0,0, 0,1,0, 0,0,1};
+  this->_inertia     = {I,0,0, 0,I,0, 0,0,I};
+  this->_inverse     = {1/I,0,0, 0,1/I,0, 0,0,1/I};
+  if(_isObstacle) this->_inverse = {0,0,0, 0,0,0, 0,0,0};
 
   this->_minBoundBox 	=	{centre[0] - _rad, centre[1] - _rad, centre[2] - _rad};
   this->_maxBoundBox 	=	{centre[0] + _rad, centre[1] + _rad, centre[2] + _rad};
@@ -580,6 +599,113 @@ bool demolish::Object::getIsSphere()
 {
   return _isSphere;
 }
+
+demolish::detection::DistanceField* demolish::Object::getDistanceField()
+{
+  return _distanceField;
+}
+
+void demolish::Object::setDistanceField(demolish::detection::DistanceField* field)
+{
+  _distanceField = field;
+}
+demolish::Object::State demolish::Object::getState()
+{
+  State state;
+  state.globalParticleID = _globalParticleID;
+  state.localParticleID  = _localParticleID;
+  state.material         = int(_material);
+  state.isObstacle       = _isObstacle;
+  state.isFriction       = _isFriction;
+  state.isConvex         = _isConvex;
+  state.isSphere         = _isSphere;
+
+  state.rad              = _rad;
+  state.haloDiameter     = _haloDiameter;
+  state.diameter         = _diameter;
+  state.mass             = _mass;
+  state.epsilon          = _epsilon;
+  state.wx               = _wx;
+  state.wy               = _wy;
+  state.wz               = _wz;
+
+  for(int k=0; k<3; k++)
+  {
+    state.location[k]               = _location[k];
+    state.prevLocation[k]           = _prevLocation[k];
+    state.linearVelocity[k]         = _linearVelocity[k];
+    state.prevLinearVelocity[k]     = _prevLinearVelocity[k];
+    state.angularVelocity[k]        = _angularVelocity[k];
+    state.prevAngularVelocity[k]    = _prevAngularVelocity[k];
+    state.refAngularVelocity[k]     = _refAngularVelocity[k];
+    state.prevRefAngularVelocity[k] = _prevRefAngularVelocity[k];
+    state.referenceLocation[k]      = _referenceLocation[k];
+    state.centreOfMass[k]           = _centreOfMass[k];
+  }
+  for(int k=0; k<9; k++)
+  {
+    state.orientation[k]     = _orientation[k];
+    state.prevOrientation[k] = _prevOrientation[k];
+    state.inertia[k]         = _inertia[k];
+    state.inverse[k]         = _inverse[k];
+  }
+
+  state.minBoundBox[0] = _minBoundBox.getX();
+  state.minBoundBox[1] = _minBoundBox.getY();
+  state.minBoundBox[2] = _minBoundBox.getZ();
+  state.maxBoundBox[0] = _maxBoundBox.getX();
+  state.maxBoundBox[1] = _maxBoundBox.getY();
+  state.maxBoundBox[2] = _maxBoundBox.getZ();
+  return state;
+}
+
+void demolish::Object::setState(const State& state, demolish::Mesh* mesh)
+{
+  _globalParticleID = state.globalParticleID;
+  _localParticleID  = state.localParticleID;
+  _material         = demolish::material::MaterialType(state.material);
+  _isObstacle       = state.isObstacle;
+  _isFriction       = state.isFriction;
+  _isConvex         = state.isConvex;
+  _isSphere         = state.isSphere;
+
+  _rad              = state.rad;
+  _haloDiameter     = state.haloDiameter;
+  _diameter         = state.diameter;
+  _mass             = state.mass;
+  _epsilon          = state.epsilon;
+  _wx               = state.wx;
+  _wy               = state.wy;
+  _wz               = state.wz;
+
+  for(int k=0; k<3; k++)
+  {
+    _location[k]               = state.location[k];
+    _prevLocation[k]           = state.prevLocation[k];
+    _linearVelocity[k]         = state.linearVelocity[k];
+    _prevLinearVelocity[k]     = state.prevLinearVelocity[k];
+    _angularVelocity[k]        = state.angularVelocity[k];
+    _prevAngularVelocity[k]    = state.prevAngularVelocity[k];
+    _refAngularVelocity[k]     = state.refAngularVelocity[k];
+    _prevRefAngularVelocity[k] = state.prevRefAngularVelocity[k];
+    _referenceLocation[k]      = state.referenceLocation[k];
+    _centreOfMass[k]           = state.centreOfMass[k];
+  }
+  for(int k=0; k<9; k++)
+  {
+    _orientation[k]     = state.orientation[k];
+    _prevOrientation[k] = state.prevOrientation[k];
+    _inertia[k]         = state.inertia[k];
+    _inverse[k]         = state.inverse[k];
+  }
+
+  _minBoundBox = demolish::Vertex(state.minBoundBox[0], state.minBoundBox[1], state.minBoundBox[2]);
+  _maxBoundBox = demolish::Vertex(state.maxBoundBox[0], state.maxBoundBox[1], state.maxBoundBox[2]);
+
+  _mesh          = mesh;
+  _distanceField = nullptr;
+}
+
 demolish::Vertex demolish::Object::getMinBoundaryVertex()
 {
   return _minBoundBox;
@@ -9,6 +9,7 @@
 
 #include "material.h"
 #include "Mesh.h"
+#include "detection/field.h"
 
 namespace demolish {
     class Object;
@@ -191,6 +192,65 @@ class demolish::Object
 	bool getIsConvex();
     bool getIsSphere();
 
+    /*
+     * Distance field of an obstacle. If set, contacts with this
+     * object are detected against the field instead of the mesh.
+     */
+    demolish::detection::DistanceField* getDistanceField();
+    void setDistanceField(demolish::detection::DistanceField* field);
+
+    /*
+     * Complete body state as plain data, for checkpoints. The mesh and
+     * the distance field are not part of it, they are owned elsewhere.
+     */
+    struct State {
+      int     globalParticleID;
+      int     localParticleID;
+      int     material;
+      char    isObstacle;
+      char    isFriction;
+      char    isConvex;
+      char    isSphere;
+
+      iREAL   rad;
+      iREAL   haloDiameter;
+      iREAL   diameter;
+      iREAL   mass;
+      iREAL   epsilon;
+      iREAL   wx, wy, wz;
+
+      iREAL   location[3];
+      iREAL   prevLocation[3];
+      iREAL   linearVelocity[3];
+      iREAL   prevLinearVelocity[3];
+      iREAL   angularVelocity[3];
+      iREAL   prevAngularVelocity[3];
+      iREAL   refAngularVelocity[3];
+      iREAL   prevRefAngularVelocity[3];
+      iREAL   referenceLocation[3];
+      iREAL   centreOfMass[3];
+
+      iREAL   orientation[9];
+      iREAL   prevOrientation[9];
+      iREAL   inertia[9];
+      iREAL   inverse[9];
+
+      iREAL   minBoundBox[3];
+      iREAL   maxBoundBox[3];
+    };
+
+    State getState();
+
+    /*
+     *  Set State
+     *
+     *  Restores a state returned by getState.
+     *
+     *  @param state : body state
+     *  @param mesh  : mesh of the body, nullptr for spheres
+     */
+    void setState(const State& state, demolish::Mesh* mesh);
+
     virtual ~Object();
 
 
@@ -227,6 +287,7 @@ class demolish::Object
     iREAL                	_wz;
 
 	demolish::Mesh*      			    _mesh;
+	demolish::detection::DistanceField* _distanceField;
     demolish::material::MaterialType 	_material;
 
     bool                  	_isObstacle;
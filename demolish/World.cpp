@@ -1,23 +1,217 @@
 
 
 #include"World.h"
+#include"profile.h"
+#include"math.h"
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
 
 #define epsilon 1E-3
 
 demolish::World::World(
       std::vector<demolish::Object>&                 objects,
-      iREAL                                          gravity)
+      iREAL                                          gravity,
+      bool                                           visualise)
 {
     _particles = objects;
-    _visuals.Init();
-    _visuals.BuildBuffers(objects);
+    _visualise = visualise;
     _worldPaused = false;
     _timestep = 0.005;
     _timeStamp =0;
     _lastTimeStampChanged = 0; 
     _penetrationThreshold = 0.2;
+    _multiRateLevels = 0;
+    _maxTimestep = _timestep;
+    _predictedPenetration = 0.0;
+    _contactSolver = demolish::resolution::ContactSolver::PENALTY;
+    _solverSweeps = 50;
+    _solverResidual = 1e-4;
     _gravity = gravity;
 
+    initialise();
+}
+
+demolish::World::World(
+      const std::string&                             checkpointFile,
+      bool                                           visualise)
+{
+    _visualise = visualise;
+    _worldPaused = false;
+    _timestep = 0.005;
+    _timeStamp =0;
+    _lastTimeStampChanged = 0;
+    _penetrationThreshold = 0.2;
+    _multiRateLevels = 0;
+    _maxTimestep = _timestep;
+    _predictedPenetration = 0.0;
+    _contactSolver = demolish::resolution::ContactSolver::PENALTY;
+    _solverSweeps = 50;
+    _solverResidual = 1e-4;
+    _gravity = 0.0;
+
+    demolish::checkpoint::Snapshot snapshot;
+    if(!demolish::checkpoint::read(checkpointFile, snapshot, _shapes))
+    {
+        std::cout << "cannot read checkpoint " << checkpointFile << std::endl;
+        _shapes.clear();
+        initialise();
+        return;
+    }
+
+    _gravity              = snapshot.gravity;
+    _timestep             = snapshot.timestep;
+    _maxTimestep          = snapshot.maxTimestep;
+    _predictedPenetration = snapshot.predictedPenetration;
+    _penetrationThreshold = snapshot.penetrationThreshold;
+    _timeStamp            = snapshot.timeStamp;
+    _lastTimeStampChanged = snapshot.lastTimeStampChanged;
+    _multiRateLevels      = snapshot.multiRateLevels;
+    _contactSolver        = demolish::resolution::ContactSolver(snapshot.contactSolver);
+    _solverSweeps         = snapshot.solverSweeps;
+    _solverResidual       = snapshot.solverResidual;
+    std::memcpy(demolish::material::interactionTable, snapshot.materials, sizeof(snapshot.materials));
+    if(!_contactCache.load(snapshot.cache.data(), snapshot.cache.size()))
+    {
+        std::cout << "checkpoint " << checkpointFile << " has no valid contact cache, friction restarts" << std::endl;
+    }
+
+    // unique vertices of every shape, shared by all meshes built from it
+    std::vector<std::vector<demolish::Vertex>> vertices(_shapes.size());
+    for(int s=0;s<_shapes.size();s++)
+    {
+        for(int v=0;v<_shapes[s].vertices.size();v+=3)
+        {
+            vertices[s].push_back(demolish::Vertex(_shapes[s].vertices[v], _shapes[s].vertices[v+1], _shapes[s].vertices[v+2]));
+        }
+    }
+
+    // every body goes back to its slot, a reordered World sums its
+    // contacts in the same order as the one that was saved
+    _shapeOfParticle = snapshot.shapeOfBody;
+    _particles.resize(snapshot.bodies.size());
+    for(int b=0;b<_particles.size();b++)
+    {
+        const int i     = snapshot.slotOfBody[b];
+        const int shape = _shapeOfParticle[b];
+        demolish::Mesh* mesh = nullptr;
+        if(shape >= 0)
+        {
+            _meshes.push_back(std::unique_ptr<demolish::Mesh>(new demolish::Mesh(_shapes[shape].triangles, vertices[shape], _shapes[shape].originalTriangles)));
+            mesh = _meshes.back().get();
+        }
+        _particles[i].setState(snapshot.bodies[b], mesh);
+        if(mesh == nullptr) continue;
+
+        // place the mesh as the Object constructor does, obstacles are
+        // never moved afterwards
+        auto refLoc = _particles[i].getReferenceLocation();
+        auto loc    = _particles[i].getLocation();
+        iREAL minusLocation[3] = {-loc[0], -loc[1], -loc[2]};
+        mesh->shiftMesh(refLoc.data());
+        mesh->shiftMesh(minusLocation);
+        mesh->setPreviousCoordinatesEqualToCurrCoordinates();
+        if(_particles[i].getIsObstacle() || _timeStamp == 0) continue;
+
+        // moving meshes hold the vertex update of the last step, and the
+        // one of the step before for a rollback
+        auto prevLoc = _particles[i].getPrevLocation();
+        auto prevOri = _particles[i].getPrevOrientation();
+        auto ori     = _particles[i].getOrientation();
+        for(int j=0;j<mesh->getNumberOfTriangles()*3;j++)
+        {
+            demolish::dynamics::updateVertices(&mesh->getXCoordinates()[j],
+                                               &mesh->getYCoordinates()[j],
+                                               &mesh->getZCoordinates()[j],
+                                               &mesh->getRefXCoordinates()[j],
+                                               &mesh->getRefYCoordinates()[j],
+                                               &mesh->getRefZCoordinates()[j],
+                                               prevOri.data(), prevLoc.data(), refLoc.data());
+        }
+        mesh->setPreviousCoordinatesEqualToCurrCoordinates();
+        for(int j=0;j<mesh->getNumberOfTriangles()*3;j++)
+        {
+            demolish::dynamics::updateVertices(&mesh->getXCoordinates()[j],
+                                               &mesh->getYCoordinates()[j],
+                                               &mesh->getZCoordinates()[j],
+                                               &mesh->getRefXCoordinates()[j],
+                                               &mesh->getRefYCoordinates()[j],
+                                               &mesh->getRefZCoordinates()[j],
+                                               ori.data(), loc.data(), refLoc.data());
+        }
+    }
+
+    initialise();
+
+    for(int f=0;f<snapshot.fields.size();f++)
+    {
+        const demolish::checkpoint::Field& field = snapshot.fields[f];
+        createDistanceField(field.particle, field.cellSize, field.bandWidth, field.maxMemory);
+    }
+}
+
+void demolish::World::initialise()
+{
+    _checkpointWritten = true;
+    _trajectoryInterval = 1;
+    _reorderInterval    = _visualise ? 0 : 100;
+    _conservativeAdvancement = true;
+
+    _slotOfParticle.resize(_particles.size());
+    for(int i=0;i<_particles.size();i++)
+    {
+        _slotOfParticle[_particles[i].getGlobalParticleId()] = i;
+    }
+
+    // the World moves every vertex once per step, not every corner
+    #pragma omp parallel for schedule(dynamic)
+    for(int i=0;i<_particles.size();i++)
+    {
+        if(_particles[i].getIsSphere()) continue;
+        _particles[i].getMesh()->useIndexedStorage();
+    }
+
+    if(_visualise)
+    {
+        _visuals.Init();
+        _visuals.BuildBuffers(_particles);
+    }
+
+    // bounding sphere around the centre of mass, the mesh only rotates
+    // about it, so the radius does not change
+    _boundingRadius.resize(_particles.size());
+    for(int i=0;i<_particles.size();i++)
+    {
+        if(_particles[i].getIsSphere())
+        {
+            _boundingRadius[i] = _particles[i].getRad();
+            continue;
+        }
+        demolish::Mesh* mesh = _particles[i].getMesh();
+        auto refLoc = _particles[i].getReferenceLocation();
+        iREAL radius = 0.0;
+        for(int v=0;v<mesh->getNumberOfUniqueVertices();v++)
+        {
+            if(mesh->getIndexedVertexCorners()[v] < 0) continue;
+            iREAL d[3] = {mesh->getRefVertexXCoordinates()[v]-refLoc[0],
+                          mesh->getRefVertexYCoordinates()[v]-refLoc[1],
+                          mesh->getRefVertexZCoordinates()[v]-refLoc[2]};
+            radius = std::max(radius, iREAL(std::sqrt(d[0]*d[0]+d[1]*d[1]+d[2]*d[2])));
+        }
+        _boundingRadius[i] = radius;
+    }
+
+    // the narrow phase reads the triangles from the meshes' geometry
+    // cache, it follows every vertex update from here on
+    #pragma omp parallel for schedule(dynamic)
+    for(int i=0;i<_particles.size();i++)
+    {
+        if(_particles[i].getIsSphere()) continue;
+        _particles[i].getMesh()->updateTriangleGeometry();
+    }
 }
  
 
@@ -26,121 +220,142 @@ int demolish::World::runSimulation()
     while(_visuals.UpdateTheMessageQueue())
     {
         updateWorld();
-        _visuals.setContactPoints(_contactpoints);
-        _visuals.UpdateScene(_particles);
+        {
+            DEMOLISH_PROFILE_SCOPE(RENDERING);
+            _visuals.setContactPoints(_contactpoints);
+            _visuals.UpdateScene(_particles);
+        }
     }
+    demolish::profile::endStep();
     
     return 1;
 }
 
+int demolish::World::runSimulation(int steps)
+{
+    for(int i=0;i<steps;i++)
+    {
+        updateWorld();
+        if(_visualise)
+        {
+            DEMOLISH_PROFILE_SCOPE(RENDERING);
+            if(!_visuals.UpdateTheMessageQueue()) break;
+            _visuals.setContactPoints(_contactpoints);
+            _visuals.UpdateScene(_particles);
+        }
+    }
+    demolish::profile::endStep();
+
+    return 1;
+}
+
+iREAL demolish::World::getMargin(int i)
+{
+    // spheres are always detected with a margin of 0.1
+    return _particles[i].getIsSphere() ? 0.1 : std::max(_particles[i].getEpsilon(), iREAL(0.1));
+}
+
+void demolish::World::updateBoundingBoxes()
+{
+    const int n = _particles.size();
+    _minX.resize(n); _minY.resize(n); _minZ.resize(n);
+    _maxX.resize(n); _maxY.resize(n); _maxZ.resize(n);
+    _isObstacle.resize(n);
+    _sweep.resize(n);
+
+    #pragma omp parallel for schedule(static)
+    for(int i=0;i<n;i++)
+    {
+        iREAL margin = getMargin(i);
+        _isObstacle[i] = _particles[i].getIsObstacle();
+        _sweep[i] = 0.0;
+
+        if(_particles[i].getIsObstacle() && !_particles[i].getIsSphere())
+        {
+            // obstacles are large, their vertex box is much tighter than the sphere
+            demolish::Mesh* mesh = _particles[i].getMesh();
+            iREAL lower[3] = { iREAL_MAX,  iREAL_MAX,  iREAL_MAX};
+            iREAL upper[3] = {-iREAL_MAX, -iREAL_MAX, -iREAL_MAX};
+            for(int v=0;v<mesh->getNumberOfUniqueVertices();v++)
+            {
+                if(mesh->getIndexedVertexCorners()[v] < 0) continue;
+                lower[0] = std::min(lower[0], iREAL(mesh->getVertexXCoordinates()[v]));
+                lower[1] = std::min(lower[1], iREAL(mesh->getVertexYCoordinates()[v]));
+                lower[2] = std::min(lower[2], iREAL(mesh->getVertexZCoordinates()[v]));
+                upper[0] = std::max(upper[0], iREAL(mesh->getVertexXCoordinates()[v]));
+                upper[1] = std::max(upper[1], iREAL(mesh->getVertexYCoordinates()[v]));
+                upper[2] = std::max(upper[2], iREAL(mesh->getVertexZCoordinates()[v]));
+            }
+            _minX[i] = lower[0]-margin; _minY[i] = lower[1]-margin; _minZ[i] = lower[2]-margin;
+            _maxX[i] = upper[0]+margin; _maxY[i] = upper[1]+margin; _maxZ[i] = upper[2]+margin;
+            continue;
+        }
+
+        // a particle that can leave its margin within a step looks ahead
+        // as far as it can move, limitAdvancement keeps it in this box
+        if(_conservativeAdvancement && !_particles[i].getIsObstacle())
+        {
+            auto velocity = _particles[i].getLinearVelocity();
+            const iREAL travel = _maxTimestep*(std::sqrt(velocity[0]*velocity[0]+velocity[1]*velocity[1]+velocity[2]*velocity[2]) +
+                                               std::abs(_gravity)*_maxTimestep);
+            if(travel > margin) _sweep[i] = travel;
+        }
+
+        auto loc = _particles[i].getLocation();
+        iREAL r  = _boundingRadius[i] + margin + _sweep[i];
+        _minX[i] = loc[0]-r; _minY[i] = loc[1]-r; _minZ[i] = loc[2]-r;
+        _maxX[i] = loc[0]+r; _maxY[i] = loc[1]+r; _maxZ[i] = loc[2]+r;
+    }
+}
+
 
 void demolish::World::updateWorld()
 {
-   _contactpoints.clear();
-   _timeStepAltered = false;
+   // the step stays open until the next call, so the rendering that
+   // follows is attributed to it
+   demolish::profile::beginStep(_timeStamp);
+
+   // before the detection, the contacts, islands and everything else
+   // indexed by slot are built on the new order within the step
+   if(_reorderInterval > 0 && _timeStamp > 0 && _timeStamp % _reorderInterval == 0)
+   {
+       reorderParticles();
+   }
+
 //**********************************************************************
 //
 // DETECTION
 //
 //**********************************************************************
-   for(int i=0;i<_particles.size();i++)
+   detectContacts(false);
+
+   iREAL penetration = 0.0;
+   for(int i=0;i< _contactpoints.size();i++)
    {
-       for(int j=i+1;j<_particles.size();j++)
-       {
-           if(_particles[i].getIsSphere() && _particles[j].getIsSphere())
-           {
-               auto locationi = _particles[i].getLocation();
-               auto locationj = _particles[j].getLocation();
-               auto radi      = _particles[i].getRad();
-               auto radj      = _particles[j].getRad();
-               auto contactpoints = demolish::detection::spherewithsphere(std::get<0>(locationi),
-                                                                             std::get<1>(locationi),
-                                                                             std::get<2>(locationi),
-                                                                             radi,
-                                                                             0.1,       // we should get eps
-                                                                             false,
-                                                                             _particles[i].getGlobalParticleId(),
-                                                                             std::get<0>(locationj),
-                                                                             std::get<1>(locationj),
-                                                                             std::get<2>(locationj),
-                                                                             radj,
-                                                                             0.1,       // same as above
-                                                                             false,
-                                                                             _particles[j].getGlobalParticleId());
-               if(contactpoints.size()>0)
-               {
-                   _contactpoints.push_back(contactpoints[0]);
-               };
-               continue;
-           }
-           if(_particles[i].getIsSphere() || _particles[j].getIsSphere())
-           {
-               //we need to deduce which one is a mesh and which one is a sphere.
-               int sphereIndex = (_particles[i].getIsSphere()) ? i : j;
-               int meshIndex   = (i==sphereIndex)              ? j : i;
-
-               auto locationSphere = _particles[sphereIndex].getLocation();
-               auto radiusOfSphere = _particles[sphereIndex].getRad();
-               int numberOfTris    = _particles[meshIndex].getMesh()->getTriangles().size();
-
-               auto contactpoints = demolish::detection::sphereWithMesh(locationSphere[0],
-                                                                        locationSphere[1],
-                                                                        locationSphere[2],
-                                                                        radiusOfSphere,
-                                                                        0.1,
-                                                                        true,
-                                                                        _particles[sphereIndex].getGlobalParticleId(),
-                                                                        _particles[meshIndex].getMesh()->getXCoordinates(),
-                                                                        _particles[meshIndex].getMesh()->getYCoordinates(),
-                                                                        _particles[meshIndex].getMesh()->getZCoordinates(),
-                                                                        numberOfTris,
-                                                                        0.1,
-                                                                        true,
-                                                                        _particles[meshIndex].getGlobalParticleId());
-               if(contactpoints.size()>0)
-               {
-                   _contactpoints.push_back(contactpoints[0]);
-               }
-               continue;
-           }
-
-           auto cntpnts = demolish::detection::penalty(
-                          _particles[i].getMesh()->getXCoordinates(),
-                          _particles[i].getMesh()->getYCoordinates(),
-                          _particles[i].getMesh()->getZCoordinates(),
-                          _particles[i].getMesh()->getTriangles().size(),
-                          _particles[i].getEpsilon(),
-                          _particles[i].getIsFriction(),
-                          _particles[i].getGlobalParticleId(),
-                          _particles[j].getMesh()->getXCoordinates(),
-                          _particles[j].getMesh()->getYCoordinates(),
-                          _particles[j].getMesh()->getZCoordinates(),
-                          _particles[j].getMesh()->getTriangles().size(),
-                          _particles[j].getEpsilon(),
-                          _particles[j].getIsFriction(),
-                          _particles[j].getGlobalParticleId());
-           
-           for(int i=0;i<cntpnts.size();i++)
-           {
-               _contactpoints.push_back(cntpnts[i]);
-           }
-
-           
-        }
-    }
-    for(int i=0;i< _contactpoints.size();i++)
-    { 
-        if(_contactpoints[i].depth > _penetrationThreshold && _lastTimeStampChanged != _timeStamp && _timestep > 0.001)
-        {
-          std::cout << "the timestep has been reduced" << std::endl;
-          std::cout << _timeStamp << ' ' <<  _timestep << std::endl;
-          std::cout << _contactpoints[i].depth << std::endl;
-          _timestep       *= 0.5;
-          _timeStepAltered = true;
-          _lastTimeStampChanged = _timeStamp;
-          break;
-        }    
-    }
+       penetration = std::max(penetration, _contactpoints[i].depth);
+   }
+   DEMOLISH_PROFILE_GAUGE(PENETRATION, penetration);
+   DEMOLISH_PROFILE_GAUGE(PREDICTEDPENETRATION, _predictedPenetration);
+
+   // the finest level bounds the step of every island from below
+   const iREAL finestTimestep = _timestep/(1 << _multiRateLevels);
+   // the contacts are detected anew every step, their depth jumps a
+   // little when other features come closest. Misses within the
+   // tolerance are such jumps, not a step that was too long.
+   const iREAL tolerance = 0.1;
+   if(_contactSolver == demolish::resolution::ContactSolver::PENALTY &&
+      penetration > (1.0+tolerance)*std::max(_penetrationThreshold, _predictedPenetration) && _lastTimeStampChanged != _timeStamp && finestTimestep > 0.001)
+   {
+       // the prediction missed, the last step was too long for the
+       // islands with a deep contact. They go back and redo it in
+       // substeps, the rest of the world keeps its step.
+       DEMOLISH_PROFILE_SCOPE(ROLLBACK);
+       DEMOLISH_PROFILE_COUNT(ROLLBACKS, 1);
+       const int bodies = resimulateIslands();
+       DEMOLISH_PROFILE_COUNT(RESIMULATED, bodies);
+       _lastTimeStampChanged = _timeStamp;
+   }
+   DEMOLISH_PROFILE_COUNT(CONTACTS, _contactpoints.size());
 
 //**********************************************************************
 //
@@ -148,155 +363,1466 @@ void demolish::World::updateWorld()
 //
 //**********************************************************************
 
-    if(_timeStepAltered){
+    _timeStamp++;
+    for(int i=0;i<_particles.size();i++)
+    {
+        _particles[i].setPrevLocation(_particles[i].getLocation());
+        _particles[i].setPrevLinearVelocity(_particles[i].getLinearVelocity());
+        _particles[i].setPrevRefAngularVelocity(_particles[i].getReferenceAngularVelocity());
+        _particles[i].setPrevOrientation(_particles[i].getOrientation());
+        if(_particles[i].getIsSphere()) continue;
+        _particles[i].getMesh()->setPreviousCoordinatesEqualToCurrCoordinates();
+    }
+
+    {
+    DEMOLISH_PROFILE_SCOPE(RESOLUTION);
+    buildIslands();
+    predictTimestep();
+    DEMOLISH_PROFILE_GAUGE(TIMESTEP, _timestep);
 
-        for(int i=0;i<_particles.size();i++)
+    // the cache is not thread safe, look every contact up first. Its
+    // storage does not move during the lookups, they start a step.
+    // Islands on finer levels look their contacts up per substep.
+    _contactCache.reserve(_contactpoints.size());
+    _displacements.assign(_contactpoints.size(), nullptr);
+    for(int i=0;i<_contactpoints.size();i++)
+    {
+        const int body = _isObstacle[_contactBodies[i][0]] ? _contactBodies[i][1] : _contactBodies[i][0];
+        if(_islandLevels[_islands.getIsland(body)] > 0) continue;
+        _displacements[i] = _contactCache.find(_contactpoints[i].indexA,
+                                               _contactpoints[i].indexB,
+                                               _contactpoints[i].feature,
+                                               _timeStamp);
+    }
+
+    if(_contactSolver == demolish::resolution::ContactSolver::GAUSSSEIDEL)
+    {
+        solveContacts();
+    }
+    else
+    {
+        // islands do not share moving bodies. Within an island the
+        // contacts are resolved in the order of the serial loop, so the
+        // result does not depend on the number of threads.
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(int w=0;w<_workItems.size();w++)
         {
-            _particles[i].setLocation(_particles[i].getPrevLocation());
-            _particles[i].setLinearVelocity(_particles[i].getPrevLinearVelocity());
-            _particles[i].setReferenceAngularVelocity(_particles[i].getPrevRefAngularVelocity());
-            _particles[i].setOrientation(_particles[i].getPrevOrientation());
-            _particles[i].getMesh()->setCurrentCoordinatesEqualToPrevCoordinates();
+            for(int island=_workItems[w][0];island<_workItems[w][1];island++)
+            {
+                if(_islandLevels[island] > 0) continue;
+                const int* contacts = _islands.getContacts(island);
+                for(int c=0;c<_islands.getNumberOfContacts(island);c++)
+                {
+                    const int i = contacts[c];
+                    resolveContact(_contactpoints[i], _contactBodies[i][0], _contactBodies[i][1], _displacements[i], _timestep);
+                }
+            }
         }
     }
-    else
+    }
+
     {
-        _timeStamp++; 
-        for(int i=0;i<_particles.size();i++)
+    DEMOLISH_PROFILE_SCOPE(INTEGRATION);
+    #pragma omp parallel for schedule(static)
+    for(int i=0;i<_particles.size();i++)
+    {
+        if(_isObstacle[i] || _islandLevels[_islands.getIsland(i)] > 0) continue;
+        integrate(i, _timestep);
+        if(_contactSolver == demolish::resolution::ContactSolver::GAUSSSEIDEL) correctPosition(i);
+    }
+    }
+
+    if(_conservativeAdvancement)
+    {
+    DEMOLISH_PROFILE_SCOPE(ADVANCEMENT);
+    limitAdvancement();
+    }
+
+    {
+    DEMOLISH_PROFILE_SCOPE(VERTICES);
+    #pragma omp parallel for schedule(dynamic)
+    for(int i=0;i<_particles.size();i++)
+    {
+        if(_isObstacle[i] || _islandLevels[_islands.getIsland(i)] > 0) continue;
+        moveMesh(i);
+    }
+    }
+
+    if(_multiRateLevels > 0)
+    {
+        DEMOLISH_PROFILE_SCOPE(SUBSTEPS);
+        substepLevels();
+    }
+
+    // contacts that were not seen in this step have separated
+    _contactCache.expire(_timeStamp);
+
+    if(_trajectory && _timeStamp % _trajectoryInterval == 0)
+    {
+        writeFrame();
+    }
+}
+
+void demolish::World::detectContacts(bool resimulatedOnly)
+{
+   // every thread appends into its own buffer. The buffers keep their
+   // capacity between steps, so detection does not allocate once they
+   // have grown to the working size.
+   if(_threadContactPoints.size() < omp_get_max_threads())
+   {
+       _threadContactPoints.resize(omp_get_max_threads());
+   }
+   for(int t=0;t<_threadContactPoints.size();t++)
+   {
+       _threadContactPoints[t].clear();
+   }
+
+   {
+       DEMOLISH_PROFILE_SCOPE(BROADPHASE);
+       updateBoundingBoxes();
+       _broadPhase.update(_particles.size(),
+                          _minX.data(), _minY.data(), _minZ.data(),
+                          _maxX.data(), _maxY.data(), _maxZ.data(),
+                          _isObstacle.data());
+   }
+   const std::vector<std::array<int, 2>>& pairs = _broadPhase.getPairs();
+   DEMOLISH_PROFILE_COUNT(PAIRS, pairs.size());
+
+   {
+   DEMOLISH_PROFILE_SCOPE(DETECTION);
+   #pragma omp parallel
+   {
+       std::vector<demolish::ContactPoint>& contactpoints = _threadContactPoints[omp_get_thread_num()];
+
+       #pragma omp for schedule(dynamic, 16)
+       for(int p=0;p<pairs.size();p++)
+       {
+           if(resimulatedOnly && !_resimulated[_particles[pairs[p][0]].getGlobalParticleId()]
+                              && !_resimulated[_particles[pairs[p][1]].getGlobalParticleId()]) continue;
+           detectPair(pairs[p][0], pairs[p][1], contactpoints);
+       }
+   }
+   }
+
+   if(resimulatedOnly)
+   {
+       // the other contacts are still valid
+       _contactpoints.erase(std::remove_if(_contactpoints.begin(), _contactpoints.end(),
+                                           [this](const demolish::ContactPoint& contact)
+                                           {
+                                               return _resimulated[contact.indexA] || _resimulated[contact.indexB];
+                                           }),
+                            _contactpoints.end());
+   }
+   else
+   {
+       _contactpoints.clear();
+   }
+   gatherContacts(_contactpoints);
+}
+
+void demolish::World::gatherContacts(std::vector<demolish::ContactPoint>& contactpoints)
+{
+   for(int t=0;t<_threadContactPoints.size();t++)
+   {
+       contactpoints.insert(contactpoints.end(), _threadContactPoints[t].begin(), _threadContactPoints[t].end());
+       _threadContactPoints[t].clear();
+   }
+
+   // the distribution over the threads varies, sort to keep the order of
+   // the force accumulation reproducible
+   std::sort(contactpoints.begin(), contactpoints.end(),
+             [](const demolish::ContactPoint& a, const demolish::ContactPoint& b)
+             {
+                 return a.indexA < b.indexA || (a.indexA == b.indexA && a.indexB < b.indexB);
+             });
+}
+
+int demolish::World::resimulateIslands()
+{
+    buildIslands();
+
+    // islands with a contact deeper than the threshold. The substeps
+    // are halved until they are short enough for the deepest of them,
+    // the penetration shrinks about linearly with the step.
+    _resimulated.assign(_particles.size(), 0);
+    iREAL deepest = 0.0;
+    for(int i=0;i<_contactpoints.size();i++)
+    {
+        if(_contactpoints[i].depth <= _penetrationThreshold) continue;
+        deepest = std::max(deepest, _contactpoints[i].depth);
+
+        const int body   = _isObstacle[_contactBodies[i][0]] ? _contactBodies[i][1] : _contactBodies[i][0];
+        const int island = _islands.getIsland(body);
+        const int* bodies = _islands.getBodies(island);
+        for(int k=0;k<_islands.getNumberOfBodies(island);k++)
         {
-            _particles[i].setPrevLocation(_particles[i].getLocation());
-            _particles[i].setPrevLinearVelocity(_particles[i].getLinearVelocity());
-            _particles[i].setPrevRefAngularVelocity(_particles[i].getReferenceAngularVelocity());
-            _particles[i].setPrevOrientation(_particles[i].getOrientation());
-            _particles[i].getMesh()->setPreviousCoordinatesEqualToCurrCoordinates();
+            _resimulated[_particles[bodies[k]].getGlobalParticleId()] = 1;
         }
-         
-        _timestep*=1.001;
+    }
+    int substeps = 2;
+    while(substeps < 16 && deepest > substeps*_penetrationThreshold) substeps *= 2;
 
-        
-        for(int i=0;i<_contactpoints.size();i++)
+    // back to the start of the last step, with the friction of then
+    const int bodies = collectLocalBodies();
+    for(int k=0;k<_localBodies.size();k++)
+    {
+        const int i = _localBodies[k];
+        if(_particles[i].getIsObstacle()) continue;
+
+        _particles[i].setLocation(_particles[i].getPrevLocation());
+        _particles[i].setLinearVelocity(_particles[i].getPrevLinearVelocity());
+        _particles[i].setReferenceAngularVelocity(_particles[i].getPrevRefAngularVelocity());
+        _particles[i].setOrientation(_particles[i].getPrevOrientation());
+        if(_particles[i].getIsSphere()) continue;
+        _particles[i].getMesh()->setCurrentCoordinatesEqualToPrevCoordinates();
+        _particles[i].getMesh()->updateTriangleGeometry();
+    }
+    _contactCache.rollback(_resimulated.data());
+
+    // the contacts are filed under the step that is redone
+    substepLocalBodies(substeps, _timestep/substeps, false);
+
+    // the contacts of the bodies that moved are out of date
+    detectContacts(true);
+    return bodies;
+}
+
+int demolish::World::collectLocalBodies()
+{
+    int bodies = 0;
+    _localBodies.clear();
+    for(int i=0;i<_particles.size();i++)
+    {
+        if(_particles[i].getIsObstacle())
         {
-            std::array<iREAL, 3> force;
-            std::array<iREAL, 3> torq;
-            demolish::resolution::getContactForces(_contactpoints[i],
-                                                   _particles[_contactpoints[i].indexA].getLocation().data(),
-                                                   _particles[_contactpoints[i].indexA].getReferenceLocation().data(),
-                                                   _particles[_contactpoints[i].indexA].getAngularVelocity().data(),
-                                                   _particles[_contactpoints[i].indexA].getLinearVelocity().data(),
-                                                   _particles[_contactpoints[i].indexA].getMass(),
-                                                   _particles[_contactpoints[i].indexA].getInverse().data(),
-                                                   _particles[_contactpoints[i].indexA].getOrientation().data(),
-                                                   int(_particles[_contactpoints[i].indexA].getMaterial()),
-                                                   _particles[_contactpoints[i].indexB].getLocation().data(),
-                                                   _particles[_contactpoints[i].indexB].getReferenceLocation().data(),
-                                                   _particles[_contactpoints[i].indexB].getAngularVelocity().data(),
-                                                   _particles[_contactpoints[i].indexB].getLinearVelocity().data(),
-                                                   _particles[_contactpoints[i].indexB].getMass(),
-                                                   _particles[_contactpoints[i].indexB].getInertia().data(),
-                                                   _particles[_contactpoints[i].indexB].getOrientation().data(),
-                                                   int(_particles[_contactpoints[i].indexB].getMaterial()),
-                                                   force,
-                                                   torq,
-                                                   (_particles[_contactpoints[i].indexA].getIsSphere() && _particles[_contactpoints[i].indexB].getIsSphere()));
-
-
-            if(!_particles[_contactpoints[i].indexA].getIsObstacle()) 
+            _localBodies.push_back(i);
+            continue;
+        }
+        if(!_resimulated[_particles[i].getGlobalParticleId()]) continue;
+        _localBodies.push_back(i);
+        bodies++;
+    }
+    return bodies;
+}
+
+void demolish::World::substepLocalBodies(int substeps, iREAL timestep, bool reuseContacts)
+{
+    // the flagged bodies only meet each other and the obstacles
+    const int numberOfBodies = _localBodies.size();
+    for(int substep=0;substep<substeps;substep++)
+    {
+        _localContacts.clear();
+        if(substep == 0 && reuseContacts)
+        {
+            // the bodies have not moved since the detection of the step
+            for(int i=0;i<_contactpoints.size();i++)
+            {
+                if(_resimulated[_contactpoints[i].indexA] || _resimulated[_contactpoints[i].indexB]) _localContacts.push_back(_contactpoints[i]);
+            }
+        }
+        else
+        {
+            updateBoundingBoxes();
+            _localBoxes.resize(6*numberOfBodies);
+            _localIsObstacle.resize(numberOfBodies);
+            for(int k=0;k<numberOfBodies;k++)
             {
-                auto velocityOfA = _particles[_contactpoints[i].indexA].getLinearVelocity();
-                auto massA = _particles[_contactpoints[i].indexA].getMass();
+                const int i = _localBodies[k];
+                _localBoxes[k]                  = _minX[i];
+                _localBoxes[k+  numberOfBodies] = _minY[i];
+                _localBoxes[k+2*numberOfBodies] = _minZ[i];
+                _localBoxes[k+3*numberOfBodies] = _maxX[i];
+                _localBoxes[k+4*numberOfBodies] = _maxY[i];
+                _localBoxes[k+5*numberOfBodies] = _maxZ[i];
+                _localIsObstacle[k]             = _isObstacle[i];
+            }
+            _localBroadPhase.update(numberOfBodies,
+                                    _localBoxes.data(),                  _localBoxes.data()+  numberOfBodies, _localBoxes.data()+2*numberOfBodies,
+                                    _localBoxes.data()+3*numberOfBodies, _localBoxes.data()+4*numberOfBodies, _localBoxes.data()+5*numberOfBodies,
+                                    _localIsObstacle.data());
+            const std::vector<std::array<int, 2>>& pairs = _localBroadPhase.getPairs();
 
-                std::array<iREAL, 3> newVelocityOfA = {velocityOfA[0] - _timestep*force[0]*(1/massA),
-                                                       velocityOfA[1] - _timestep*force[1]*(1/massA),
-                                                       velocityOfA[2] - _timestep*force[2]*(1/massA)};
-                _particles[_contactpoints[i].indexA].setLinearVelocity(newVelocityOfA);
+            #pragma omp parallel
+            {
+                std::vector<demolish::ContactPoint>& contactpoints = _threadContactPoints[omp_get_thread_num()];
 
+                #pragma omp for schedule(dynamic, 16)
+                for(int p=0;p<pairs.size();p++)
+                {
+                    detectPair(_localBodies[pairs[p][0]], _localBodies[pairs[p][1]], contactpoints);
+                }
+            }
+            gatherContacts(_localContacts);
+        }
 
-                auto ang = _particles[_contactpoints[i].indexA].getReferenceAngularVelocity();
-                
-                auto negtorq = torq;
-                negtorq[0] *=-1;
-                negtorq[1] *=-1;
-                negtorq[2] *=-1;
-                demolish::dynamics::updateAngular(ang.data(),
-                                                  _particles[_contactpoints[i].indexA].getOrientation().data(),
-                                                  _particles[_contactpoints[i].indexA].getInertia().data(),
-                                                  _particles[_contactpoints[i].indexA].getInverse().data(),
-                                                  negtorq.data(),
-                                                  _timestep);          
-                _particles[_contactpoints[i].indexA].setReferenceAngularVelocity(ang);
-                
-                
-                
+        _contactCache.reserve(_localContacts.size());
+        for(int i=0;i<_localContacts.size();i++)
+        {
+            iREAL* displacement = _contactCache.find(_localContacts[i].indexA,
+                                                     _localContacts[i].indexB,
+                                                     _localContacts[i].feature,
+                                                     _timeStamp);
+            resolveContact(_localContacts[i],
+                           _slotOfParticle[_localContacts[i].indexA],
+                           _slotOfParticle[_localContacts[i].indexB],
+                           displacement,
+                           timestep);
+        }
+
+        #pragma omp parallel for schedule(dynamic)
+        for(int k=0;k<numberOfBodies;k++)
+        {
+            integrate(_localBodies[k], timestep);
+            moveMesh(_localBodies[k]);
+        }
+    }
+}
+
+void demolish::World::substepLevels()
+{
+    for(int level=1;level<=_multiRateLevels;level++)
+    {
+        _resimulated.assign(_particles.size(), 0);
+        bool found = false;
+        for(int island=0;island<_islands.getNumberOfIslands();island++)
+        {
+            if(_islandLevels[island] != level) continue;
+            const int* bodies = _islands.getBodies(island);
+            for(int k=0;k<_islands.getNumberOfBodies(island);k++)
+            {
+                _resimulated[_particles[bodies[k]].getGlobalParticleId()] = 1;
             }
-            if(!_particles[_contactpoints[i].indexB].getIsObstacle()) 
+            DEMOLISH_PROFILE_COUNT(SUBSTEPPED, _islands.getNumberOfBodies(island));
+            found = true;
+        }
+        if(!found) continue;
+
+        collectLocalBodies();
+        substepLocalBodies(1 << level, _timestep/(1 << level), true);
+    }
+}
+
+void demolish::World::limitAdvancement()
+{
+    // particles of the full step that moved further than their contact
+    // epsilon, and their broad phase partners. The other particles are
+    // caught by the next detection before they can pass anything.
+    const int n = _particles.size();
+    _partnerOffsets.assign(n+1, 0);
+    _travel.assign(n, 0.0);
+    bool found = false;
+    for(int i=0;i<n;i++)
+    {
+        if(_isObstacle[i]) continue;
+        if(_islandLevels[_islands.getIsland(i)] > 0)
+        {
+            // moved in the substeps that are still to come
+            auto velocity = _particles[i].getLinearVelocity();
+            _travel[i] = _timestep*std::sqrt(velocity[0]*velocity[0]+velocity[1]*velocity[1]+velocity[2]*velocity[2]);
+            continue;
+        }
+        auto location = _particles[i].getLocation();
+        auto previous = _particles[i].getPrevLocation();
+        const iREAL d[3] = {location[0]-previous[0], location[1]-previous[1], location[2]-previous[2]};
+        _travel[i] = std::sqrt(d[0]*d[0]+d[1]*d[1]+d[2]*d[2]);
+        if(_travel[i] <= _particles[i].getEpsilon()) continue;
+        _partnerOffsets[i+1] = 1;
+        found = true;
+    }
+    if(!found) return;
+
+    const std::vector<std::array<int, 2>>& pairs = _broadPhase.getPairs();
+    _partners.clear();
+    for(int p=0;p<pairs.size();p++)
+    {
+        for(int k=0;k<2;k++)
+        {
+            if(_partnerOffsets[pairs[p][k]+1] > 0) _partners.push_back({pairs[p][k], pairs[p][1-k]});
+        }
+    }
+    std::sort(_partners.begin(), _partners.end());
+
+    std::fill(_partnerOffsets.begin(), _partnerOffsets.end(), 0);
+    for(int k=0;k<_partners.size();k++) _partnerOffsets[_partners[k][0]+1]++;
+    for(int i=0;i<n;i++) _partnerOffsets[i+1] += _partnerOffsets[i];
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int i=0;i<n;i++)
+    {
+        if(_isObstacle[i] || _islandLevels[_islands.getIsland(i)] > 0) continue;
+        auto location = _particles[i].getLocation();
+        auto previous = _particles[i].getPrevLocation();
+        iREAL d[3] = {location[0]-previous[0], location[1]-previous[1], location[2]-previous[2]};
+        const iREAL length = _travel[i];
+        if(length <= _particles[i].getEpsilon()) continue;
+
+        // the step of the particle ends at its first time of impact, the
+        // fraction of its displacement after which it leaves its swept
+        // box, beyond which it does not know its neighbours, or comes
+        // closer to a partner than a contact permits
+        const iREAL reach = _sweep[i] + getMargin(i);
+        iREAL impact = length > reach ? reach/length : 1.0;
+
+        for(int k=_partnerOffsets[i];k<_partnerOffsets[i+1];k++)
+        {
+            const int j = _partners[k][1];
+
+            // conservative advancement: the particle moves at most the
+            // length of its displacement towards the partner, the partner
+            // at most its own travel. Advance by the time it takes to
+            // close what is left of the gap, measured again at every new
+            // position, until a contact is that deep or the step ends.
+            iREAL time = 0.0;
+            for(int iteration=0;iteration<4 && time<impact;iteration++)
             {
-                auto velocityOfB = _particles[_contactpoints[i].indexB].getLinearVelocity();
-                auto massB     = _particles[_contactpoints[i].indexB].getMass();
+                const iREAL position[3] = {previous[0]+time*d[0], previous[1]+time*d[1], previous[2]+time*d[2]};
+                iREAL normal[3];
+                iREAL gap = getGap(i, position, j, normal);
+
+                // without a contact the pair started further apart than
+                // the detection reaches
+                if(iteration == 0 && !hasContact(i, j)) gap = std::max(gap, _particles[i].getEpsilon()+_particles[j].getEpsilon());
+
+                // a contact is as deep as the epsilons overlap, the pair may
+                // come half as close as the penetration threshold permits, as
+                // in the timestep prediction
+                const iREAL permitted = gap - _travel[j] - (_particles[i].getEpsilon()+_particles[j].getEpsilon()-0.5*_penetrationThreshold);
+                const iREAL approach  = d[0]*normal[0]+d[1]*normal[1]+d[2]*normal[2];
+                if((1.0-time)*approach <= std::max(permitted, iREAL(0.0)))
+                {
+                    // the rest of the step does not close the gap
+                    time = 1.0;
+                    break;
+                }
+                if(permitted <= 0.0) break;
+                time += permitted/length;
+            }
+            impact = std::min(impact, time);
+        }
+
+        // the particle keeps its velocity, the contact solver responds to
+        // the contact the next detection finds
+        if(impact >= 1.0) continue;
+        _particles[i].setLocation({previous[0]+impact*d[0], previous[1]+impact*d[1], previous[2]+impact*d[2]});
+        DEMOLISH_PROFILE_COUNT(LIMITED, 1);
+    }
+}
 
-                std::array<iREAL, 3> newVelocityOfB = {velocityOfB[0] + _timestep*force[0]*(1/massB),
-                                                    velocityOfB[1] + _timestep*force[1]*(1/massB),
-                                                    velocityOfB[2] + _timestep*force[2]*(1/massB)};
+iREAL demolish::World::getGap(int i, const iREAL position[3], int j, iREAL normal[3])
+{
+    // from the bounding sphere of i at position to j, the normal points
+    // towards j. 0 without a normal when they are centred on each other.
+    normal[0] = normal[1] = normal[2] = 0.0;
+    if(_isObstacle[j] && !_particles[j].getIsSphere())
+    {
+        // closest point of the obstacle surface to the centre
+        demolish::Mesh* mesh = _particles[j].getMesh();
+        const demolish::detection::TriangleGeometry<iVERTEX>* triangles = mesh->getTriangleGeometry();
+        const iVERTEX P[3] = {iVERTEX(position[0]), iVERTEX(position[1]), iVERTEX(position[2])};
+        iREAL distance = iREAL_MAX;
+        iREAL towards[3];
+        for(int t=0;t<mesh->getNumberOfTriangles();t++)
+        {
+            iVERTEX c[3] = {triangles[t].centre[0]-P[0], triangles[t].centre[1]-P[1], triangles[t].centre[2]-P[2]};
+            const iREAL bound = distance + triangles[t].radius;
+            if(distance < iREAL_MAX && c[0]*c[0]+c[1]*c[1]+c[2]*c[2] > bound*bound) continue;
+
+            iVERTEX Q[3];
+            const iREAL candidate = demolish::detection::pt(triangles[t], P, Q);
+            if(candidate >= distance) continue;
+            distance = candidate;
+            for(int a=0;a<3;a++) towards[a] = Q[a]-P[a];
+        }
+        if(!(distance > 0.0) || distance == iREAL_MAX) return 0.0;
+        for(int a=0;a<3;a++) normal[a] = towards[a]/distance;
+        return distance - _boundingRadius[i];
+    }
+
+    auto other = _isObstacle[j] ? _particles[j].getLocation() : _particles[j].getPrevLocation();
+    iREAL towards[3] = {other[0]-position[0], other[1]-position[1], other[2]-position[2]};
+    const iREAL distance = std::sqrt(towards[0]*towards[0]+towards[1]*towards[1]+towards[2]*towards[2]);
+    if(distance <= 0.0) return 0.0;
+    for(int a=0;a<3;a++) normal[a] = towards[a]/distance;
+    return distance - _boundingRadius[i] - _boundingRadius[j];
+}
+
+bool demolish::World::hasContact(int i, int j)
+{
+    // the contacts are sorted by their global ids
+    for(int k=0;k<2;k++)
+    {
+        const int a = _particles[k == 0 ? i : j].getGlobalParticleId();
+        const int b = _particles[k == 0 ? j : i].getGlobalParticleId();
+        auto contact = std::lower_bound(_contactpoints.begin(), _contactpoints.end(), std::make_pair(a, b),
+                                        [](const demolish::ContactPoint& c, const std::pair<int, int>& key)
+                                        {
+                                            return c.indexA < key.first || (c.indexA == key.first && c.indexB < key.second);
+                                        });
+        if(contact != _contactpoints.end() && contact->indexA == a && contact->indexB == b) return true;
+    }
+    return false;
+}
+
+void demolish::World::integrate(int i, iREAL timestep)
+{
+    if(_particles[i].getIsObstacle()) return;
+    auto loc    = _particles[i].getLocation();
+    auto linVel = _particles[i].getLinearVelocity();
+    linVel[1] += timestep*_gravity;
+    _particles[i].setLinearVelocity(linVel);
+    loc[0] += timestep*linVel[0];
+    loc[1] += timestep*linVel[1];
+    loc[2] += timestep*linVel[2];
+    _particles[i].setLocation(loc);
+
+    // update rotation matrix
+    auto ori = _particles[i].getOrientation();
+
+    demolish::dynamics::updateRotationMatrix(
+                                             _particles[i].getAngularVelocity().data(),
+                                             _particles[i].getReferenceAngularVelocity().data(),
+                                             ori.data(),
+                                             timestep);
+    _particles[i].setOrientation(ori);
+}
+
+void demolish::World::correctPosition(int i)
+{
+    // the correction velocities of the impulse solver move the particle
+    // out of a deep contact without any momentum
+    const demolish::resolution::ImpulseBody& body = _impulseBodies[i];
+    auto loc = _particles[i].getLocation();
+    auto ori = _particles[i].getOrientation();
+    iREAL angular[3];
+    iREAL refAngular[3];
+    for(int k=0;k<3;k++)
+    {
+        loc[k]       += _timestep*body.linearCorrection[k];
+        refAngular[k] = ori[3*k]*body.angularCorrection[0] + ori[3*k+1]*body.angularCorrection[1] + ori[3*k+2]*body.angularCorrection[2];
+    }
+    _particles[i].setLocation(loc);
+    demolish::dynamics::updateRotationMatrix(angular, refAngular, ori.data(), _timestep);
+    _particles[i].setOrientation(ori);
+}
 
-                _particles[_contactpoints[i].indexB].setLinearVelocity(newVelocityOfB);
+void demolish::World::moveMesh(int i)
+{
+    if(_particles[i].getIsObstacle() || _particles[i].getIsSphere()) return;
+    auto loc    = _particles[i].getLocation();
+    auto refLoc = _particles[i].getReferenceLocation();
+    auto ori    = _particles[i].getOrientation();
+
+    _particles[i].getMesh()->updateVertices(ori.data(), loc.data(), refLoc.data());
+    _particles[i].getMesh()->updateTriangleGeometry();
+}
+
+void demolish::World::detectPair(
+      int                                            i,
+      int                                            j,
+      std::vector<demolish::ContactPoint>&           contactpoints)
+{
+    // A is the lower global id, whatever the order of the particles
+    if(_particles[i].getGlobalParticleId() > _particles[j].getGlobalParticleId()) std::swap(i, j);
+
+    if(_particles[i].getIsSphere() && _particles[j].getIsSphere())
+    {
+        DEMOLISH_PROFILE_SCOPE(SPHERESPHERE);
+        auto locationi = _particles[i].getLocation();
+        auto locationj = _particles[j].getLocation();
+        auto radi      = _particles[i].getRad();
+        auto radj      = _particles[j].getRad();
+        demolish::detection::spherewithsphere(std::get<0>(locationi),
+                                              std::get<1>(locationi),
+                                              std::get<2>(locationi),
+                                              radi,
+                                              0.1,       // we should get eps
+                                              false,
+                                              _particles[i].getGlobalParticleId(),
+                                              std::get<0>(locationj),
+                                              std::get<1>(locationj),
+                                              std::get<2>(locationj),
+                                              radj,
+                                              0.1,       // same as above
+                                              false,
+                                              _particles[j].getGlobalParticleId(),
+                                              contactpoints);
+        return;
+    }
+    if(_particles[i].getIsSphere() || _particles[j].getIsSphere())
+    {
+        //we need to deduce which one is a mesh and which one is a sphere.
+        int sphereIndex = (_particles[i].getIsSphere()) ? i : j;
+        int meshIndex   = (i==sphereIndex)              ? j : i;
+
+        auto locationSphere = _particles[sphereIndex].getLocation();
+        auto radiusOfSphere = _particles[sphereIndex].getRad();
+
+        if(_particles[meshIndex].getDistanceField())
+        {
+            DEMOLISH_PROFILE_SCOPE(SPHEREFIELD);
+            demolish::detection::sphereWithField(locationSphere[0],
+                                                 locationSphere[1],
+                                                 locationSphere[2],
+                                                 radiusOfSphere,
+                                                 0.1,
+                                                 true,
+                                                 _particles[sphereIndex].getGlobalParticleId(),
+                                                 *_particles[meshIndex].getDistanceField(),
+                                                 0.1,
+                                                 true,
+                                                 _particles[meshIndex].getGlobalParticleId(),
+                                                 contactpoints);
+            return;
+        }
+
+        DEMOLISH_PROFILE_SCOPE(SPHEREMESH);
+        int numberOfTris    = _particles[meshIndex].getMesh()->getNumberOfTriangles();
+
+        demolish::detection::sphereWithMesh(locationSphere[0],
+                                            locationSphere[1],
+                                            locationSphere[2],
+                                            radiusOfSphere,
+                                            0.1,
+                                            true,
+                                            _particles[sphereIndex].getGlobalParticleId(),
+                                            _particles[meshIndex].getMesh()->getTriangleGeometry(),
+                                            numberOfTris,
+                                            0.1,
+                                            true,
+                                            _particles[meshIndex].getGlobalParticleId(),
+                                            contactpoints);
+        return;
+    }
+
+    if(_particles[i].getDistanceField() || _particles[j].getDistanceField())
+    {
+        DEMOLISH_PROFILE_SCOPE(MESHFIELD);
+        //the obstacle with the field is always B.
+        int fieldIndex = (_particles[j].getDistanceField()) ? j : i;
+        int meshIndex  = (i==fieldIndex)                    ? j : i;
+
+        demolish::Mesh* meshA = _particles[meshIndex].getMesh();
+        demolish::detection::meshWithField(
+                       meshA->getVertexXCoordinates(),
+                       meshA->getVertexYCoordinates(),
+                       meshA->getVertexZCoordinates(),
+                       meshA->getIndexedVertexCorners(),
+                       meshA->getNumberOfUniqueVertices(),
+                       _particles[meshIndex].getEpsilon(),
+                       _particles[meshIndex].getIsFriction(),
+                       _particles[meshIndex].getGlobalParticleId(),
+                       *_particles[fieldIndex].getDistanceField(),
+                       _particles[fieldIndex].getEpsilon(),
+                       _particles[fieldIndex].getIsFriction(),
+                       _particles[fieldIndex].getGlobalParticleId(),
+                       contactpoints);
+        return;
+    }
+
+    if(_particles[i].getIsConvex() && _particles[j].getIsConvex())
+    {
+        DEMOLISH_PROFILE_SCOPE(GJK);
+        demolish::Mesh* meshA = _particles[i].getMesh();
+        demolish::Mesh* meshB = _particles[j].getMesh();
+        demolish::detection::gjk(
+                       meshA->getVertexXCoordinates(),
+                       meshA->getVertexYCoordinates(),
+                       meshA->getVertexZCoordinates(),
+                       meshA->getIndexedVertexCorners(),
+                       meshA->getNumberOfUniqueVertices(),
+                       meshA->getVertexNeighbourOffsets(),
+                       meshA->getVertexNeighbours(),
+                       _particles[i].getEpsilon(),
+                       _particles[i].getIsFriction(),
+                       _particles[i].getGlobalParticleId(),
+                       meshB->getVertexXCoordinates(),
+                       meshB->getVertexYCoordinates(),
+                       meshB->getVertexZCoordinates(),
+                       meshB->getIndexedVertexCorners(),
+                       meshB->getNumberOfUniqueVertices(),
+                       meshB->getVertexNeighbourOffsets(),
+                       meshB->getVertexNeighbours(),
+                       _particles[j].getEpsilon(),
+                       _particles[j].getIsFriction(),
+                       _particles[j].getGlobalParticleId(),
+                       contactpoints);
+        return;
+    }
+
+    DEMOLISH_PROFILE_SCOPE(PENALTY);
+    demolish::detection::penalty(
+                   _particles[i].getMesh()->getTriangleGeometry(),
+                   _particles[i].getMesh()->getNumberOfTriangles(),
+                   _particles[i].getEpsilon(),
+                   _particles[i].getIsFriction(),
+                   _particles[i].getGlobalParticleId(),
+                   _particles[j].getMesh()->getTriangleGeometry(),
+                   _particles[j].getMesh()->getNumberOfTriangles(),
+                   _particles[j].getEpsilon(),
+                   _particles[j].getIsFriction(),
+                   _particles[j].getGlobalParticleId(),
+                   contactpoints);
+}
+
+void demolish::World::buildIslands()
+{
+    // contacts refer to global ids, islands to positions in _particles
+    _contactBodies.resize(_contactpoints.size());
+    for(int i=0;i<_contactpoints.size();i++)
+    {
+        _contactBodies[i] = {_slotOfParticle[_contactpoints[i].indexA], _slotOfParticle[_contactpoints[i].indexB]};
+    }
+    _islands.build(_particles.size(), _contactBodies.data(), _contactBodies.size(), _isObstacle.data());
+
+    // an island is as fine as its most demanding body
+    _bodyLoads.resize(_particles.size());
+    _bodyForces.resize(_particles.size());
+    _approaches.resize(_contactpoints.size());
+    _closingAccelerations.resize(_contactpoints.size());
+    _islandTimesteps.reserve(_particles.size());
+    _islandLevels.reserve(_particles.size());
+    _islandTimesteps.resize(_islands.getNumberOfIslands());
+    _islandLevels.assign(_islands.getNumberOfIslands(), 0);
+    // impulses hold every contact within the full step
+    const int levels = _contactSolver == demolish::resolution::ContactSolver::PENALTY ? _multiRateLevels : 0;
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(int island=0;island<_islands.getNumberOfIslands();island++)
+    {
+        _islandTimesteps[island] = stableTimestep(island);
+        while(_islandLevels[island] < levels && _islandTimesteps[island] < _timestep/(1 << _islandLevels[island])) _islandLevels[island]++;
+    }
+
+    // consecutive islands of the full step are merged into work items of
+    // about the same number of contacts, a few per thread. An island is
+    // never split, a single large one is resolved by one thread.
+    const int target = std::max(1, int(_contactpoints.size()/(4*omp_get_max_threads())));
+    int first = 0;
+    int cost  = 0;
+    int withContacts = 0;
+    _workItems.reserve(_particles.size());
+    _workItems.clear();
+    for(int island=0;island<_islands.getNumberOfIslands();island++)
+    {
+        if(_islandLevels[island] == 0) cost += _islands.getNumberOfContacts(island);
+        if(_islands.getNumberOfContacts(island) > 0) withContacts++;
+        if(cost < target && island+1 < _islands.getNumberOfIslands()) continue;
+        if(cost > 0) _workItems.push_back({first, island+1, cost});
+        first = island+1;
+        cost  = 0;
+    }
+    DEMOLISH_PROFILE_COUNT(ISLANDS, withContacts);
+
+    // the most expensive first, a large island must not start last. Ties
+    // keep the island order; stable_sort would allocate a buffer per step.
+    std::sort(_workItems.begin(), _workItems.end(),
+              [](const std::array<int, 3>& a, const std::array<int, 3>& b)
+              {
+                  return a[2] > b[2] || (a[2] == b[2] && a[0] < b[0]);
+              });
+}
+
+iREAL demolish::World::stableTimestep(int island)
+{
+    // the contacts of a body act as parallel springs, their stiffness
+    // adds up. Obstacles do not give way and are skipped.
+    const int* bodies = _islands.getBodies(island);
+    for(int k=0;k<_islands.getNumberOfBodies(island);k++)
+    {
+        _bodyLoads[bodies[k]]  = {0.0, 0.0};
+        _bodyForces[bodies[k]] = {0.0, 0.0, 0.0};
+    }
+
+    const int* contacts = _islands.getContacts(island);
+    for(int c=0;c<_islands.getNumberOfContacts(island);c++)
+    {
+        const int i = contacts[c];
+        const int body[2] = {_contactBodies[i][0], _contactBodies[i][1]};
+        const bool isSphere = _particles[body[0]].getIsSphere() && _particles[body[1]].getIsSphere();
+        const iREAL stiffness = demolish::material::getInteraction(isSphere ? demolish::material::SPHERE : demolish::material::MESH,
+                                                                   int(_particles[body[0]].getMaterial()),
+                                                                   int(_particles[body[1]].getMaterial())).spring;
+
+        // normal velocity of the contact point, v + w x r of both bodies
+        iREAL velocity[2][3];
+        for(int k=0;k<2;k++)
+        {
+            auto location = _particles[body[k]].getLocation();
+            auto linear   = _particles[body[k]].getLinearVelocity();
+            auto angular  = _particles[body[k]].getAngularVelocity();
+            iREAL r[3] = {_contactpoints[i].x[0]-location[0], _contactpoints[i].x[1]-location[1], _contactpoints[i].x[2]-location[2]};
+            velocity[k][0] = linear[0] + angular[1]*r[2] - angular[2]*r[1];
+            velocity[k][1] = linear[1] + angular[2]*r[0] - angular[0]*r[2];
+            velocity[k][2] = linear[2] + angular[0]*r[1] - angular[1]*r[0];
+        }
+        // the normal points from B to A, B closes in along it. A pair
+        // that separates does not penetrate any deeper.
+        const iREAL* normal = _contactpoints[i].normal;
+        const iREAL approach = std::max(iREAL(0.0), (velocity[1][0]-velocity[0][0])*normal[0] +
+                                                    (velocity[1][1]-velocity[0][1])*normal[1] +
+                                                    (velocity[1][2]-velocity[0][2])*normal[2]);
+        _approaches[i] = approach;
+
+        // the spring pushes A along the normal and B against it
+        const iREAL force = stiffness*_contactpoints[i].depth;
+        for(int k=0;k<2;k++)
+        {
+            if(_isObstacle[body[k]]) continue;
+            _bodyLoads[body[k]][0] += stiffness;
+            _bodyLoads[body[k]][1]  = std::max(_bodyLoads[body[k]][1], approach);
+            for(int d=0;d<3;d++) _bodyForces[body[k]][d] += (k == 0 ? force : -force)*normal[d];
+        }
+    }
+
+    // the contacts keep their current load through the step, the
+    // closing acceleration is that of B relative to A along the normal
+    for(int c=0;c<_islands.getNumberOfContacts(island);c++)
+    {
+        const int i = contacts[c];
+        iREAL acceleration[2][3];
+        for(int k=0;k<2;k++)
+        {
+            const int b = _contactBodies[i][k];
+            const iREAL inverseMass = _isObstacle[b] ? 0.0 : 1.0/_particles[b].getMass();
+            acceleration[k][0] = _bodyForces[b][0]*inverseMass;
+            acceleration[k][1] = _bodyForces[b][1]*inverseMass + (_isObstacle[b] ? 0.0 : _gravity);
+            acceleration[k][2] = _bodyForces[b][2]*inverseMass;
+        }
+        const iREAL* normal = _contactpoints[i].normal;
+        _closingAccelerations[i] = (acceleration[1][0]-acceleration[0][0])*normal[0] +
+                                   (acceleration[1][1]-acceleration[0][1])*normal[1] +
+                                   (acceleration[1][2]-acceleration[0][2])*normal[2];
+    }
+
+    iREAL timestep = iREAL_MAX;
+    for(int k=0;k<_islands.getNumberOfBodies(island);k++)
+    {
+        const int i = bodies[k];
+        if(_bodyLoads[i][0] == 0.0) continue;
+        timestep = std::min(timestep, demolish::resolution::stableTimestep(_bodyLoads[i][0],
+                                                                           _particles[i].getMass(),
+                                                                           _bodyLoads[i][1],
+                                                                           _penetrationThreshold));
+    }
+    return timestep;
+}
+
+void demolish::World::resolveContact(
+      demolish::ContactPoint&                        contact,
+      int                                            a,
+      int                                            b,
+      iREAL*                                         displacement,
+      iREAL                                          timestep)
+{
+    // getContactForces accumulates into these
+    std::array<iREAL, 3> force = {0.0, 0.0, 0.0};
+    std::array<iREAL, 3> torq  = {0.0, 0.0, 0.0};
+    demolish::resolution::getContactForces(contact,
+                                           _particles[a].getLocation().data(),
+                                           _particles[a].getAngularVelocity().data(),
+                                           _particles[a].getLinearVelocity().data(),
+                                           _particles[a].getMass(),
+                                           _particles[a].getInverse().data(),
+                                           _particles[a].getOrientation().data(),
+                                           int(_particles[a].getMaterial()),
+                                           _particles[b].getLocation().data(),
+                                           _particles[b].getAngularVelocity().data(),
+                                           _particles[b].getLinearVelocity().data(),
+                                           _particles[b].getMass(),
+                                           _particles[b].getInertia().data(),
+                                           _particles[b].getOrientation().data(),
+                                           int(_particles[b].getMaterial()),
+                                           force,
+                                           torq,
+                                           (_particles[a].getIsSphere() && _particles[b].getIsSphere()),
+                                           displacement,
+                                           timestep);
+
+
+    if(!_particles[a].getIsObstacle()) 
+    {
+        auto velocityOfA = _particles[a].getLinearVelocity();
+        auto massA = _particles[a].getMass();
+
+        std::array<iREAL, 3> newVelocityOfA = {velocityOfA[0] - timestep*force[0]*(1/massA),
+                                               velocityOfA[1] - timestep*force[1]*(1/massA),
+                                               velocityOfA[2] - timestep*force[2]*(1/massA)};
+        _particles[a].setLinearVelocity(newVelocityOfA);
+
+
+        auto ang = _particles[a].getReferenceAngularVelocity();
+        
+        auto negtorq = torq;
+        negtorq[0] *=-1;
+        negtorq[1] *=-1;
+        negtorq[2] *=-1;
+        demolish::dynamics::updateAngular(ang.data(),
+                                          _particles[a].getOrientation().data(),
+                                          _particles[a].getInertia().data(),
+                                          _particles[a].getInverse().data(),
+                                          negtorq.data(),
+                                          timestep);          
+        _particles[a].setReferenceAngularVelocity(ang);
         
-                auto ang = _particles[_contactpoints[i].indexB].getReferenceAngularVelocity();
-
-                demolish::dynamics::updateAngular(ang.data(),
-                                                  _particles[_contactpoints[i].indexB].getOrientation().data(),
-                                                  _particles[_contactpoints[i].indexB].getInertia().data(),
-                                                  _particles[_contactpoints[i].indexB].getInverse().data(),
-                                                  torq.data(),
-                                                  _timestep);          
-                _particles[_contactpoints[i].indexB].setReferenceAngularVelocity(ang);
-            } 
-            
-        }
-     
-
-        for(int i=0;i<_particles.size();i++)
-        {
-           if(_particles[i].getIsObstacle()) continue;
-           auto loc    = _particles[i].getLocation();
-           auto refLoc = _particles[i].getReferenceLocation();
-           auto linVel = _particles[i].getLinearVelocity();
-           linVel[1] += _timestep*_gravity;
-           _particles[i].setLinearVelocity(linVel);
-           loc[0] += _timestep*linVel[0];
-           loc[1] += _timestep*linVel[1];
-           loc[2] += _timestep*linVel[2];
-           _particles[i].setLocation(loc);
         
-          // update rotation matrix
-          auto ori = _particles[i].getOrientation();
-
-          demolish::dynamics::updateRotationMatrix(
-                                                   _particles[i].getAngularVelocity().data(),
-                                                   _particles[i].getReferenceAngularVelocity().data(),
-                                                   ori.data(),
-                                                   _timestep);
-          _particles[i].setOrientation(ori);
-          
-          // update verts 
-          for(int j=0;j<(_particles[i].getMesh())->getTriangles().size()*3;j++)
-          {
-              demolish::dynamics::updateVertices(&_particles[i].getMesh()->getXCoordinates()[j],
-                                                 &_particles[i].getMesh()->getYCoordinates()[j],
-                                                 &_particles[i].getMesh()->getZCoordinates()[j],
-                                                 &_particles[i].getMesh()->getRefXCoordinates()[j],
-                                                 &_particles[i].getMesh()->getRefYCoordinates()[j],
-                                                 &_particles[i].getMesh()->getRefZCoordinates()[j],
-                                                 _particles[i].getOrientation().data(),
-                                                 loc.data(),refLoc.data());
-
-          }
-          
+        
+    }
+    if(!_particles[b].getIsObstacle()) 
+    {
+        auto velocityOfB = _particles[b].getLinearVelocity();
+        auto massB     = _particles[b].getMass();
+
+        std::array<iREAL, 3> newVelocityOfB = {velocityOfB[0] + timestep*force[0]*(1/massB),
+                                            velocityOfB[1] + timestep*force[1]*(1/massB),
+                                            velocityOfB[2] + timestep*force[2]*(1/massB)};
+
+        _particles[b].setLinearVelocity(newVelocityOfB);
+
+        auto ang = _particles[b].getReferenceAngularVelocity();
+
+        demolish::dynamics::updateAngular(ang.data(),
+                                          _particles[b].getOrientation().data(),
+                                          _particles[b].getInertia().data(),
+                                          _particles[b].getInverse().data(),
+                                          torq.data(),
+                                          timestep);          
+        _particles[b].setReferenceAngularVelocity(ang);
+    }
+}
+
+void demolish::World::reorderParticles()
+{
+    DEMOLISH_PROFILE_SCOPE(REORDER);
+    const int n = _particles.size();
+    if(n < 2) return;
+
+    iREAL lower[3] = { iREAL_MAX,  iREAL_MAX,  iREAL_MAX};
+    iREAL upper[3] = {-iREAL_MAX, -iREAL_MAX, -iREAL_MAX};
+    for(int i=0;i<n;i++)
+    {
+        auto loc = _particles[i].getLocation();
+        for(int d=0;d<3;d++)
+        {
+            lower[d] = std::min(lower[d], loc[d]);
+            upper[d] = std::max(upper[d], loc[d]);
+        }
+    }
+
+    _reorder.resize(n);
+    #pragma omp parallel for schedule(static)
+    for(int i=0;i<n;i++)
+    {
+        auto loc = _particles[i].getLocation();
+        _reorder[i] = std::make_pair(demolish::mortonCode(loc.data(), lower, upper), i);
+    }
+    std::sort(_reorder.begin(), _reorder.end());
+
+    // everything indexed by particle moves along, the meshes stay where
+    // they are and only their pointers move
+    _reorderedParticles.resize(n);
+    _reorderedRadius.resize(n);
+    #pragma omp parallel for schedule(static)
+    for(int k=0;k<n;k++)
+    {
+        const int i = _reorder[k].second;
+        _reorderedParticles[k] = _particles[i];
+        _reorderedRadius[k]    = _boundingRadius[i];
+        _slotOfParticle[_reorderedParticles[k].getGlobalParticleId()] = k;
+    }
+    _particles.swap(_reorderedParticles);
+    _boundingRadius.swap(_reorderedRadius);
+}
+
+void demolish::World::setReorderInterval(int steps)
+{
+    _reorderInterval = _visualise ? 0 : std::max(steps, 0);
+}
+
+void demolish::World::setConservativeAdvancement(bool enabled)
+{
+    _conservativeAdvancement = enabled;
+}
+
+void demolish::World::setTimestep(iREAL timestep)
+{
+    _timestep    = timestep;
+    _maxTimestep = timestep;
+}
+
+void demolish::World::predictTimestep()
+{
+    // with multi-rate stepping the islands pick their level instead,
+    // the impulses are not bound by the stiffness
+    if(_contactSolver == demolish::resolution::ContactSolver::GAUSSSEIDEL)
+    {
+        _timestep = _maxTimestep;
+    }
+    else if(_multiRateLevels == 0)
+    {
+        _timestep = _maxTimestep;
+        for(int island=0;island<_islands.getNumberOfIslands();island++)
+        {
+            _timestep = std::min(_timestep, _islandTimesteps[island]);
+        }
+    }
+
+    // every contact closes at its current speed and acceleration for the
+    // whole step, one that is pushed apart gets no shallower than now
+    _predictedPenetration = 0.0;
+    for(int i=0;i<_contactpoints.size();i++)
+    {
+        const int body = _isObstacle[_contactBodies[i][0]] ? _contactBodies[i][1] : _contactBodies[i][0];
+        const iREAL timestep = _timestep/(1 << _islandLevels[_islands.getIsland(body)]);
+        const iREAL closing  = _approaches[i]*timestep + 0.5*_closingAccelerations[i]*timestep*timestep;
+        _predictedPenetration = std::max(_predictedPenetration, _contactpoints[i].depth + std::max(closing, iREAL(0.0)));
+    }
+}
+
+void demolish::World::setMultiRateLevels(int levels)
+{
+    _multiRateLevels = std::min(std::max(levels, 0), 8);
+}
+
+void demolish::World::setContactSolver(demolish::resolution::ContactSolver solver)
+{
+    _contactSolver = solver;
+}
+
+void demolish::World::setSolverLimits(int sweeps, iREAL residual)
+{
+    _solverSweeps   = std::max(sweeps, 1);
+    _solverResidual = std::max(residual, iREAL(0.0));
+}
+
+void demolish::World::solveContacts()
+{
+    // the velocities the bodies would have at the end of the step. The
+    // gravity of the step is taken in here and handed back to integrate.
+    const int n = _particles.size();
+    _impulseBodies.resize(n);
+    #pragma omp parallel for schedule(static)
+    for(int i=0;i<n;i++)
+    {
+        demolish::resolution::ImpulseBody& body = _impulseBodies[i];
+        auto linear   = _particles[i].getLinearVelocity();
+        auto angular  = _particles[i].getReferenceAngularVelocity();
+        auto rotation = _particles[i].getOrientation();
+        auto inverse  = _particles[i].getInverse();
+        for(int k=0;k<3;k++)
+        {
+            body.linear[k]  = linear[k];
+            body.angular[k] = rotation[k]*angular[0] + rotation[k+3]*angular[1] + rotation[k+6]*angular[2];
+            body.linearCorrection[k] = body.angularCorrection[k] = 0.0;
+        }
+        if(_isObstacle[i])
+        {
+            body.inverseMass = 0.0;
+            std::fill(body.inverseInertia, body.inverseInertia+9, iREAL(0.0));
+            continue;
+        }
+        body.linear[1]  += _timestep*_gravity;
+        body.inverseMass = 1.0/_particles[i].getMass();
+
+        // the referential inverse inertia turned into space, R I^-1 R^T
+        for(int r=0;r<3;r++)
+        {
+            for(int c=0;c<3;c++)
+            {
+                iREAL sum = 0.0;
+                for(int p=0;p<3;p++)
+                {
+                    for(int q=0;q<3;q++) sum += rotation[r+3*p]*inverse[p+3*q]*rotation[c+3*q];
+                }
+                body.inverseInertia[r+3*c] = sum;
+            }
+        }
+    }
+
+    const int m = _contactpoints.size();
+    _impulseContacts.resize(m);
+    #pragma omp parallel for schedule(static)
+    for(int c=0;c<m;c++)
+    {
+        const demolish::ContactPoint& point = _contactpoints[c];
+        const int a = _contactBodies[c][0];
+        const int b = _contactBodies[c][1];
+
+        // the rows take the normal from A to B
+        const iREAL normal[3] = {-point.normal[0], -point.normal[1], -point.normal[2]};
+
+        const bool isSphere = _particles[a].getIsSphere() && _particles[b].getIsSphere();
+        const iREAL friction = point.friction ?
+                               demolish::material::getInteraction(isSphere ? demolish::material::SPHERE : demolish::material::MESH,
+                                                                  int(_particles[a].getMaterial()),
+                                                                  int(_particles[b].getMaterial())).friction : 0.0;
+        auto centreA = _particles[a].getLocation();
+        auto centreB = _particles[b].getLocation();
+
+        demolish::resolution::ImpulseContact& contact = _impulseContacts[c];
+        contact.a = a;
+        contact.b = b;
+        demolish::resolution::prepareImpulseContact(contact, _impulseBodies[a], _impulseBodies[b],
+                                                    point.x, centreA.data(), centreB.data(), normal,
+                                                    point.depth,
+                                                    0.5*_penetrationThreshold, friction, _timestep, _displacements[c]);
+    }
+
+    colourContacts();
+    sweepContacts(true);
+
+    int sweeps = 0;
+    iREAL residual = iREAL_MAX;
+    while(sweeps < _solverSweeps && residual > _solverResidual)
+    {
+        residual = sweepContacts(false);
+        sweeps++;
+    }
+    DEMOLISH_PROFILE_COUNT(SWEEPS, sweeps);
+    DEMOLISH_PROFILE_GAUGE(RESIDUAL, m > 0 ? residual : 0.0);
+
+    #pragma omp parallel for schedule(static)
+    for(int i=0;i<n;i++)
+    {
+        if(_isObstacle[i]) continue;
+        const demolish::resolution::ImpulseBody& body = _impulseBodies[i];
+        auto rotation = _particles[i].getOrientation();
+        std::array<iREAL, 3> linear;
+        std::array<iREAL, 3> angular;
+        for(int k=0;k<3;k++)
+        {
+            linear[k]  = body.linear[k];
+            angular[k] = rotation[3*k]*body.angular[0] + rotation[3*k+1]*body.angular[1] + rotation[3*k+2]*body.angular[2];
+        }
+        linear[1] -= _timestep*_gravity;
+        _particles[i].setLinearVelocity(linear);
+        _particles[i].setReferenceAngularVelocity(angular);
+    }
+
+    // two contacts of a pair may share their cache entry
+    for(int c=0;c<m;c++)
+    {
+        if(_displacements[c]) demolish::resolution::getImpulse(_impulseContacts[c], _displacements[c]);
+    }
+}
+
+void demolish::World::colourContacts()
+{
+    // every contact takes the lowest colour none of the contacts of its
+    // moving bodies has, obstacles are shared as impulses leave them
+    // alone. Contacts that find all colours taken form the last one,
+    // which is solved by one thread.
+    const int m = _impulseContacts.size();
+    _colourMasks.assign(_particles.size(), 0);
+    _contactColours.resize(m);
+    int numberOfColours = 0;
+    for(int c=0;c<m;c++)
+    {
+        const int a = _impulseContacts[c].a;
+        const int b = _impulseContacts[c].b;
+        const std::uint64_t used = (_isObstacle[a] ? 0 : _colourMasks[a]) | (_isObstacle[b] ? 0 : _colourMasks[b]);
+        int colour = 0;
+        while(colour < 64 && (used >> colour & 1)) colour++;
+        if(colour < 64)
+        {
+            if(!_isObstacle[a]) _colourMasks[a] |= std::uint64_t(1) << colour;
+            if(!_isObstacle[b]) _colourMasks[b] |= std::uint64_t(1) << colour;
+        }
+        _contactColours[c] = colour;
+        numberOfColours = std::max(numberOfColours, colour+1);
+    }
+    DEMOLISH_PROFILE_COUNT(COLOURS, numberOfColours);
+
+    // a counting sort keeps the order of the contacts within a colour
+    _colourOffsets.assign(numberOfColours+1, 0);
+    for(int c=0;c<m;c++) _colourOffsets[_contactColours[c]+1]++;
+    for(int k=0;k<numberOfColours;k++) _colourOffsets[k+1] += _colourOffsets[k];
+    _colouredContacts.resize(m);
+    for(int c=0;c<m;c++) _colouredContacts[_colourOffsets[_contactColours[c]]++] = c;
+    for(int k=numberOfColours;k>0;k--) _colourOffsets[k] = _colourOffsets[k-1];
+    _colourOffsets[0] = 0;
+}
+
+iREAL demolish::World::sweepContacts(bool warmStart)
+{
+    // the contacts of a colour share no moving body, they are updated in
+    // parallel and the result does not depend on the number of threads
+    const int numberOfColours = int(_colourOffsets.size())-1;
+    iREAL residual = 0.0;
+    #pragma omp parallel
+    for(int colour=0;colour<numberOfColours;colour++)
+    {
+        if(colour < 64)
+        {
+            #pragma omp for schedule(static) reduction(max:residual)
+            for(int k=_colourOffsets[colour];k<_colourOffsets[colour+1];k++)
+            {
+                demolish::resolution::ImpulseContact& contact = _impulseContacts[_colouredContacts[k]];
+                if(warmStart) demolish::resolution::applyImpulse(contact, contact.impulse, _impulseBodies[contact.a], _impulseBodies[contact.b]);
+                else          residual = std::max(residual, demolish::resolution::solveImpulseContact(contact, _impulseBodies[contact.a], _impulseBodies[contact.b]));
+            }
+        }
+        else
+        {
+            #pragma omp single
+            for(int k=_colourOffsets[colour];k<_colourOffsets[colour+1];k++)
+            {
+                demolish::resolution::ImpulseContact& contact = _impulseContacts[_colouredContacts[k]];
+                if(warmStart) demolish::resolution::applyImpulse(contact, contact.impulse, _impulseBodies[contact.a], _impulseBodies[contact.b]);
+                else          residual = std::max(residual, demolish::resolution::solveImpulseContact(contact, _impulseBodies[contact.a], _impulseBodies[contact.b]));
+            }
         }
     }
+    return residual;
+}
+
+void demolish::World::writeFrame()
+{
+    DEMOLISH_PROFILE_SCOPE(OUTPUT);
+
+    // blocks while the writer still holds all buffers
+    demolish::trajectory::Frame& frame = _trajectory->acquire();
+    frame.step     = _timeStamp;
+    frame.timestep = _timestep;
+    frame.bodies.resize(_particles.size());
+
+    #pragma omp parallel for schedule(static)
+    for(int i=0;i<_particles.size();i++)
+    {
+        demolish::trajectory::Body& body = frame.bodies[_particles[i].getGlobalParticleId()];
+        body.id    = _particles[i].getGlobalParticleId();
+        body.flags = (_particles[i].getIsSphere()   ? demolish::trajectory::SPHERE   : 0) |
+                     (_particles[i].getIsObstacle() ? demolish::trajectory::OBSTACLE : 0);
+
+        auto location    = _particles[i].getLocation();
+        auto orientation = _particles[i].getOrientation();
+        auto linear      = _particles[i].getLinearVelocity();
+        auto angular     = _particles[i].getAngularVelocity();
+        std::copy(location.begin(),    location.end(),    body.location);
+        std::copy(orientation.begin(), orientation.end(), body.orientation);
+        std::copy(linear.begin(),      linear.end(),      body.linearVelocity);
+        std::copy(angular.begin(),     angular.end(),     body.angularVelocity);
+    }
+
+    frame.contacts.clear();
+    if(_trajectory->getWritesContacts())
+    {
+        frame.contacts.resize(_contactpoints.size());
+        for(int i=0;i<_contactpoints.size();i++)
+        {
+            demolish::trajectory::Contact& contact = frame.contacts[i];
+            contact.indexA = _contactpoints[i].indexA;
+            contact.indexB = _contactpoints[i].indexB;
+            std::copy(_contactpoints[i].x,      _contactpoints[i].x+3,      contact.x);
+            std::copy(_contactpoints[i].normal, _contactpoints[i].normal+3, contact.normal);
+            contact.depth  = _contactpoints[i].depth;
+        }
+    }
+
+    _trajectory->submit();
+}
+
+bool demolish::World::openTrajectory(
+      const std::string&                             filename,
+      int                                            interval,
+      bool                                           contacts,
+      int                                            numberOfBuffers)
+{
+    closeTrajectory();
+    _trajectory.reset(new demolish::trajectory::Writer(numberOfBuffers));
+    _trajectoryInterval = std::max(interval, 1);
+    if(_trajectory->open(filename, contacts)) return true;
+
+    _trajectory.reset();
+    return false;
+}
+
+bool demolish::World::closeTrajectory()
+{
+    if(!_trajectory) return true;
+    bool success = _trajectory->close();
+    _trajectory.reset();
+    return success;
 }
                 
+bool demolish::World::createDistanceField(
+      int                                            particleIndex,
+      iREAL                                          cellSize,
+      iREAL                                          bandWidth,
+      std::size_t                                    maxMemory)
+{
+    if(particleIndex < 0 || particleIndex >= _particles.size()) return false;
+
+    demolish::Object& object = _particles[_slotOfParticle[particleIndex]];
+    if(!object.getIsObstacle() || object.getIsSphere() || object.getMesh()==nullptr) return false;
+
+    // a sphere is found by the distance of its centre, a mesh by that of
+    // its vertices. The band has to reach beyond the contact shell of the
+    // largest of them, outside of it the field only knows it is far.
+    iREAL reach = 0.0;
+    for(int i=0;i<_particles.size();i++)
+    {
+        if(_particles[i].getIsObstacle()) continue;
+        const iREAL radius = _particles[i].getIsSphere() ? _particles[i].getRad() : 0.0;
+        reach = std::max(reach, radius + _particles[i].getEpsilon() + object.getEpsilon());
+    }
+    if(bandWidth <= reach)
+    {
+        std::cout << "distance field of particle " << particleIndex << ": band width " << bandWidth
+                  << " does not reach beyond the contact shell of " << reach << ", widened to "
+                  << reach + cellSize << std::endl;
+        bandWidth = reach + cellSize;
+    }
+
+    demolish::Mesh* mesh = object.getMesh();
+    const int numberOfTriangles = mesh->getNumberOfTriangles();
+    const iVERTEX* corners[3] = {mesh->getXCoordinates(), mesh->getYCoordinates(), mesh->getZCoordinates()};
+
+    // the field is built from triangle corners, an indexed mesh lends them
+    std::vector<iVERTEX> gathered[3];
+    if(mesh->getIsIndexed())
+    {
+        const iVERTEX* vertices[3] = {mesh->getVertexXCoordinates(), mesh->getVertexYCoordinates(), mesh->getVertexZCoordinates()};
+        std::vector<std::array<int, 3>> faces = mesh->getTriangleFaces();
+        for(int d=0;d<3;d++)
+        {
+            gathered[d].resize(3*numberOfTriangles);
+            for(int t=0;t<numberOfTriangles;t++)
+            for(int k=0;k<3;k++) gathered[d][3*t+k] = vertices[d][faces[t][k]];
+            corners[d] = gathered[d].data();
+        }
+    }
+
+    _distanceFields.push_back(std::unique_ptr<demolish::detection::DistanceField>(
+                  new demolish::detection::DistanceField(corners[0],
+                                                         corners[1],
+                                                         corners[2],
+                                                         numberOfTriangles,
+                                                         cellSize,
+                                                         bandWidth,
+                                                         maxMemory)));
+    object.setDistanceField(_distanceFields.back().get());
+    _fields.push_back({particleIndex, cellSize, bandWidth, maxMemory});
+    return true;
+}
+
+void demolish::World::registerShapes()
+{
+    // meshes built from the same geometry share a shape. The hash only
+    // preselects, candidates are compared exactly.
+    std::unordered_map<uint64_t, std::vector<int>> shapesOfHash;
+    _shapeOfParticle.assign(_particles.size(), -1);
+
+    for(int i=0;i<_particles.size();i++)
+    {
+        demolish::Object& particle = _particles[_slotOfParticle[i]];
+        if(particle.getIsSphere()) continue;
+
+        // the World holds every mesh indexed, one reference position
+        // per unique vertex reproduces all corners
+        demolish::Mesh* mesh = particle.getMesh();
+        const iVERTEX* ref[3] = {mesh->getRefVertexXCoordinates(), mesh->getRefVertexYCoordinates(), mesh->getRefVertexZCoordinates()};
+
+        demolish::checkpoint::Shape shape;
+        shape.triangles = mesh->getTriangleFaces();
+        shape.vertices.assign(3*mesh->getNumberOfUniqueVertices(), 0.0);
+        for(int v=0;v<mesh->getNumberOfUniqueVertices();v++)
+        {
+            if(mesh->getIndexedVertexCorners()[v] < 0) continue;
+            for(int d=0;d<3;d++) shape.vertices[3*v+d] = ref[d][v];
+        }
+        shape.originalTriangles.assign(mesh->getOriginalTriangleIndices(),
+                                       mesh->getOriginalTriangleIndices()+mesh->getNumberOfTriangles());
+
+        // FNV-1a over the faces and vertices
+        uint64_t hash = 14695981039346656037ull;
+        const unsigned char* bytes[2] = {reinterpret_cast<const unsigned char*>(shape.triangles.data()),
+                                         reinterpret_cast<const unsigned char*>(shape.vertices.data())};
+        const std::size_t length[2]   = {shape.triangles.size()*sizeof(std::array<int, 3>),
+                                         shape.vertices.size()*sizeof(iREAL)};
+        for(int b=0;b<2;b++)
+        for(std::size_t c=0;c<length[b];c++) hash = (hash ^ bytes[b][c]) * 1099511628211ull;
+
+        std::vector<int>& candidates = shapesOfHash[hash];
+        for(int c=0;c<candidates.size() && _shapeOfParticle[i]<0;c++)
+        {
+            if(_shapes[candidates[c]].triangles         == shape.triangles &&
+               _shapes[candidates[c]].vertices          == shape.vertices &&
+               _shapes[candidates[c]].originalTriangles == shape.originalTriangles) _shapeOfParticle[i] = candidates[c];
+        }
+        if(_shapeOfParticle[i] >= 0) continue;
+
+        _shapeOfParticle[i] = _shapes.size();
+        candidates.push_back(_shapes.size());
+        _shapes.push_back(std::move(shape));
+    }
+}
+
+void demolish::World::writeCheckpoint(const std::string& filename)
+{
+    waitForCheckpoint();
+    if(_shapeOfParticle.size() != _particles.size()) registerShapes();
+
+    // the copy is taken here, the file is written while the World goes on
+    std::shared_ptr<demolish::checkpoint::Snapshot> snapshot(new demolish::checkpoint::Snapshot);
+    snapshot->gravity              = _gravity;
+    snapshot->timestep             = _timestep;
+    snapshot->maxTimestep          = _maxTimestep;
+    snapshot->predictedPenetration = _predictedPenetration;
+    snapshot->penetrationThreshold = _penetrationThreshold;
+    snapshot->timeStamp            = _timeStamp;
+    snapshot->lastTimeStampChanged = _lastTimeStampChanged;
+    snapshot->multiRateLevels      = _multiRateLevels;
+    snapshot->contactSolver        = int(_contactSolver);
+    snapshot->solverSweeps         = _solverSweeps;
+    snapshot->solverResidual       = _solverResidual;
+    snapshot->shapeOfBody          = _shapeOfParticle;
+    snapshot->slotOfBody           = _slotOfParticle;
+    snapshot->fields               = _fields;
+    snapshot->bodies.resize(_particles.size());
+    #pragma omp parallel for schedule(static)
+    for(int i=0;i<_particles.size();i++)
+    {
+        snapshot->bodies[i] = _particles[_slotOfParticle[i]].getState();
+    }
+    _contactCache.save(snapshot->cache);
+    std::memcpy(snapshot->materials, demolish::material::interactionTable, sizeof(snapshot->materials));
+
+    // shapes do not change after registerShapes, the writer reads them in place
+    _checkpointWriter = std::thread([this, snapshot, filename]()
+    {
+        _checkpointWritten = demolish::checkpoint::write(filename, *snapshot, _shapes);
+    });
+}
+
+bool demolish::World::waitForCheckpoint()
+{
+    if(_checkpointWriter.joinable()) _checkpointWriter.join();
+    return _checkpointWritten;
+}
+
 std::vector<demolish::Object> demolish::World::getObjects()
 {
-    return _particles;
+    std::vector<demolish::Object> objects;
+    objects.reserve(_particles.size());
+    for(int i=0;i<_particles.size();i++)
+    {
+        objects.push_back(_particles[_slotOfParticle[i]]);
+    }
+    return objects;
+}
+
+std::vector<std::vector<int>> demolish::World::getIslands()
+{
+    std::vector<std::vector<int>> islands(_islands.getNumberOfIslands());
+    for(int island=0;island<islands.size();island++)
+    {
+        const int* bodies = _islands.getBodies(island);
+        for(int k=0;k<_islands.getNumberOfBodies(island);k++)
+        {
+            islands[island].push_back(_particles[bodies[k]].getGlobalParticleId());
+        }
+    }
+    return islands;
 }
 
 std::vector<demolish::ContactPoint> demolish::World::getContactPoints()
@@ -304,6 +1830,11 @@ std::vector<demolish::ContactPoint> demolish::World::getContactPoints()
     return _contactpoints;
 }
 
-demolish::World::~World() {
+int demolish::World::getNumberOfContactPoints()
+{
+    return _contactpoints.size();
+}
 
+demolish::World::~World() {
+    waitForCheckpoint();
 }
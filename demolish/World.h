@@ -6,15 +6,25 @@
 #include <string>
 #include <array>
 #include <memory>
+#include <thread>
+#include <atomic>
 #include "Object.h"
 #include "visuals/DEMDriver.h"
 #include "detection/sphere.h"
 #include "resolution/sphere.h"
 #include "resolution/forces.h"
+#include "resolution/impulses.h"
 #include "ContactPoint.h"
+#include "ContactCache.h"
+#include "ContactIslands.h"
 #include "Object.h"
 #include "resolution/dynamics.h"
 #include "detection/penalty.h"
+#include "detection/gjk.h"
+#include "detection/field.h"
+#include "detection/broadphase.h"
+#include "filio/checkpoint.h"
+#include "filio/trajectory.h"
 
 
 namespace demolish{
@@ -24,29 +34,328 @@ namespace demolish{
 class demolish::World {
 
   public:
+	/*
+	 *  World
+	 *
+	 *  @param objects   : particles and obstacles, the global particle id
+	 *                     of every object has to be its index
+	 *  @param gravity   : acceleration in y
+	 *  @param visualise : false runs without a window, for batch runs
+	 *                     and benchmarks; runSimulation then needs a
+	 *                     number of steps
+	 */
 	World(
     std::vector<Object>&                objects,
-    iREAL                               gravity);
+    iREAL                               gravity,
+    bool                                visualise = true);
+
+	/*
+	 *  World
+	 *
+	 *  Continues a run from a checkpoint written by writeCheckpoint. The
+	 *  World owns the meshes of a restored run. If the file cannot be
+	 *  read, a message is printed and the World has no particles.
+	 *
+	 *  @param checkpointFile : file written by writeCheckpoint
+	 *  @param visualise      : as above
+	 */
+	World(
+    const std::string&                  checkpointFile,
+    bool                                visualise = true);
 
 	virtual ~World();
 
     int                                   runSimulation();
+    int                                   runSimulation(int steps);
 
 	std::vector<Object>                   getObjects();
     std::vector<ContactPoint>             getContactPoints();
+    int                                   getNumberOfContactPoints();
+
+    /*
+     *  Get Islands
+     *
+     *  Moving bodies grouped by the contact islands of the last step, as
+     *  global particle ids. A body without contacts is an island of its
+     *  own. Obstacles are in no island. See ContactIslands.
+     */
+    std::vector<std::vector<int>>         getIslands();
     void                                  updateWorld();
+
+    /*
+     *  Create Distance Field
+     *
+     *  Precomputes a distance field for the obstacle at particleIndex.
+     *  Afterwards all contacts with that obstacle are detected against
+     *  the field. The band has to be wider than the largest sphere
+     *  radius plus the epsilons of the sphere and the obstacle, or
+     *  contacts are missed; a narrower one is widened to that plus one
+     *  cell.
+     *
+     *  @param particleIndex : index of an obstacle mesh
+     *  @param cellSize      : grid spacing of the field
+     *  @param bandWidth     : half width of the stored band
+     *  @param maxMemory     : memory bound of the field in bytes (0 for none)
+     *  @returns false if the particle is not an obstacle mesh
+     */
+    bool                                  createDistanceField(
+    int                                 particleIndex,
+    iREAL                               cellSize,
+    iREAL                               bandWidth,
+    std::size_t                         maxMemory = 0);
+
+    /*
+     *  Write Checkpoint
+     *
+     *  Copies the state of the World and writes it to a file on a
+     *  background thread, so the simulation goes on while the file is
+     *  written. A World restored from the file continues bitwise like
+     *  this one. Call between steps; a checkpoint that is still being
+     *  written is finished first.
+     *
+     *  @param filename : checkpoint file, replaced once it is complete
+     */
+    void                                  writeCheckpoint(const std::string& filename);
+
+    /*
+     *  Wait For Checkpoint
+     *
+     *  Blocks until the last checkpoint has been written.
+     *
+     *  @returns false if writing the last checkpoint failed
+     */
+    bool                                  waitForCheckpoint();
+
+    /*
+     *  Open Trajectory
+     *
+     *  Appends a frame with the state of every body to a trajectory
+     *  file after every interval-th step. The frames are written on a
+     *  background thread; the simulation only waits when all buffers
+     *  are still queued.
+     *
+     *  @param filename        : trajectory file, see filio/trajectory.h
+     *  @param interval        : steps between two frames
+     *  @param contacts        : also write the contact points
+     *  @param numberOfBuffers : frames that may be in flight
+     *  @returns false if the files cannot be created
+     */
+    bool                                  openTrajectory(
+    const std::string&                  filename,
+    int                                 interval,
+    bool                                contacts = false,
+    int                                 numberOfBuffers = 2);
+
+    /*
+     *  Close Trajectory
+     *
+     *  @returns false if a frame could not be written
+     */
+    bool                                  closeTrajectory();
+
+    /*
+     *  Set Reorder Interval
+     *
+     *  Sorts the particles along a Morton curve of their locations after
+     *  every steps-th step, so bodies that are close in space are close
+     *  in memory for the broad phase and the contact loops. Contacts, the
+     *  contact cache, trajectories and checkpoints refer to the global
+     *  particle ids, which do not change, and the results do not depend
+     *  on the order. A visualised World keeps its order, the render
+     *  buffers follow the particles by index.
+     *
+     *  @param steps : steps between two sorts, 0 never sorts
+     */
+    void                                  setReorderInterval(int steps);
+
+    /*
+     *  Set Conservative Advancement
+     *
+     *  A particle that can move further than its contact epsilon within
+     *  a step looks ahead in the broad phase as far as it can move, and
+     *  its step ends at the first time of impact with a broad phase
+     *  partner, so it cannot pass through a thin body. It keeps its
+     *  velocity, the contact solver responds to the contact. Scenes
+     *  without such particles are not changed. Not kept in checkpoints.
+     *
+     *  @param enabled : limit the advancement, true by default
+     */
+    void                                  setConservativeAdvancement(bool enabled);
+
+    /*
+     *  Set Timestep
+     *
+     *  Longest step. Every step is as long as the stiffest and fastest
+     *  contact tolerates, see resolution::stableTimestep, up to this
+     *  one. With multi-rate stepping every step is this long.
+     *
+     *  @param timestep : longest step, 0.005 by default
+     */
+    void                                  setTimestep(iREAL timestep);
+
+    /*
+     *  Set Multi Rate Levels
+     *
+     *  Lets every contact island take the step its stiffest and fastest
+     *  contact tolerates. An island on level l takes 2^l substeps of
+     *  the step, free bodies and islands of slow contacts take the full
+     *  step, and all levels meet at the end of every step. The step
+     *  keeps its length instead of following the stiffest contact of
+     *  the World; an island that still goes too deep redoes its step.
+     *
+     *  @param levels : finest level, 0 steps every body with the same step
+     */
+    void                                  setMultiRateLevels(int levels);
+
+    /*
+     *  Set Contact Solver
+     *
+     *  See resolution::ContactSolver. The impulse solver takes every
+     *  step as long as set by setTimestep; it needs neither multi-rate
+     *  stepping nor the redoing of steps, both are off with it. Its
+     *  sweeps run over a colouring of the contacts: the contacts of a
+     *  colour share no moving body and are solved in parallel. Every
+     *  contact starts from its impulse of the last step, which the
+     *  contact cache holds instead of the tangential displacement.
+     *
+     *  @param solver : PENALTY by default
+     */
+    void                                  setContactSolver(demolish::resolution::ContactSolver solver);
+
+    /*
+     *  Set Solver Limits
+     *
+     *  The impulse solver sweeps until no contact changes a velocity by
+     *  more than the residual, or until the number of sweeps is reached.
+     *
+     *  @param sweeps   : at most, 50 by default
+     *  @param residual : velocity change, 1e-4 by default
+     */
+    void                                  setSolverLimits(int sweeps, iREAL residual);
   private:
+    void                                  initialise();
+    void                                  writeFrame();
+    iREAL                                 getMargin(int i);
+    void                                  updateBoundingBoxes();
+    void                                  registerShapes();
+    void                                  reorderParticles();
+    void                                  buildIslands();
+    void                                  detectContacts(bool resimulatedOnly);
+    void                                  detectPair(int i, int j, std::vector<ContactPoint>& contactpoints);
+    void                                  gatherContacts(std::vector<ContactPoint>& contactpoints);
+    int                                   resimulateIslands();
+    int                                   collectLocalBodies();
+    void                                  substepLocalBodies(int substeps, iREAL timestep, bool reuseContacts);
+    void                                  substepLevels();
+    iREAL                                 stableTimestep(int island);
+    void                                  predictTimestep();
+    void                                  resolveContact(ContactPoint& contact, int a, int b, iREAL* displacement, iREAL timestep);
+    void                                  solveContacts();
+    void                                  colourContacts();
+    iREAL                                 sweepContacts(bool warmStart);
+    void                                  integrate(int i, iREAL timestep);
+    void                                  correctPosition(int i);
+    void                                  limitAdvancement();
+    iREAL                                 getGap(int i, const iREAL position[3], int j, iREAL normal[3]);
+    bool                                  hasContact(int i, int j);
+    void                                  moveMesh(int i);
+
     bool                                  _worldPaused;
-    bool                                  _timeStepAltered;
+    bool                                  _visualise;
 
   	std::vector<Object> 	                _particles;
+    // index into _particles of every global particle id
+    std::vector<int>                      _slotOfParticle;
+    int                                   _reorderInterval;
+    // scratch of the reordering, it swaps with the particle arrays
+    std::vector<std::pair<uint64_t, int>> _reorder;
+    std::vector<Object>                   _reorderedParticles;
+    std::vector<iREAL>                    _reorderedRadius;
     std::vector<ContactPoint>             _contactpoints;
+    std::vector<std::vector<ContactPoint>> _threadContactPoints;
+
+    // broad phase input, one box per particle including the contact margin
+    demolish::detection::BroadPhase       _broadPhase;
+    std::vector<iREAL>                    _boundingRadius;
+    std::vector<iREAL>                    _minX, _minY, _minZ;
+    std::vector<iREAL>                    _maxX, _maxY, _maxZ;
+    std::vector<char>                     _isObstacle;
+    bool                                  _conservativeAdvancement;
+    // distance a fast particle's box looks ahead, 0 for the others
+    std::vector<iREAL>                    _sweep;
+    // distance every particle covered in the step before it was limited
+    std::vector<iREAL>                    _travel;
+    // broad phase partners {particle, partner} of the fast particles,
+    // sorted, and the first partner of every particle
+    std::vector<std::array<int, 2>>       _partners;
+    std::vector<int>                      _partnerOffsets;
+
+    ContactCache                          _contactCache;
+
+    // contact islands of the current step, the particles of every
+    // contact, its cache entry and the work items {first island, last
+    // island, contacts} of the parallel resolution
+    ContactIslands                        _islands;
+    std::vector<std::array<int, 2>>       _contactBodies;
+    std::vector<iREAL*>                   _displacements;
+    std::vector<std::array<int, 3>>       _workItems;
+
+    // finest timestep level, the stable step and level of every island,
+    // the summed contact stiffness, fastest approach and spring force of
+    // every particle, and the closing speed and acceleration of every
+    // contact
+    int                                   _multiRateLevels;
+    std::vector<iREAL>                    _islandTimesteps;
+    std::vector<int>                      _islandLevels;
+    std::vector<std::array<iREAL, 2>>     _bodyLoads;
+    std::vector<std::array<iREAL, 3>>     _bodyForces;
+    std::vector<iREAL>                    _approaches;
+    std::vector<iREAL>                    _closingAccelerations;
+
+    // impulse solver: its limits, the velocities of every particle,
+    // kept for the position correction, the rows of every contact
+    // during the solve, the colours taken at every particle, the colour
+    // of every contact and the contacts sorted by colour
+    demolish::resolution::ContactSolver   _contactSolver;
+    int                                   _solverSweeps;
+    iREAL                                 _solverResidual;
+    std::vector<demolish::resolution::ImpulseBody>    _impulseBodies;
+    std::vector<demolish::resolution::ImpulseContact> _impulseContacts;
+    std::vector<std::uint64_t>            _colourMasks;
+    std::vector<int>                      _contactColours;
+    std::vector<int>                      _colourOffsets;
+    std::vector<int>                      _colouredContacts;
+
+    // islands that redo a step or take substeps: a flag per global id, their
+    // particles and all obstacles, and their own broad phase
+    std::vector<char>                     _resimulated;
+    std::vector<int>                      _localBodies;
+    std::vector<iREAL>                    _localBoxes;
+    std::vector<char>                     _localIsObstacle;
+    demolish::detection::BroadPhase       _localBroadPhase;
+    std::vector<ContactPoint>             _localContacts;
     iREAL                                 _gravity;
     iREAL                                 _timestep;
+    iREAL                                 _maxTimestep;
+    iREAL                                 _predictedPenetration;
     int                                   _timeStamp;
     int                                   _lastTimeStampChanged;
     iREAL                                 _penetrationThreshold;
     DEMDriver                             _visuals;
+
+    std::vector<std::unique_ptr<demolish::detection::DistanceField>> _distanceFields;
+
+    // checkpoints: reference geometry once per shape, the parameters the
+    // fields were built with, and the meshes of a restored run
+    std::vector<demolish::checkpoint::Shape> _shapes;
+    std::vector<int>                      _shapeOfParticle;
+    std::vector<demolish::checkpoint::Field> _fields;
+    std::vector<std::unique_ptr<demolish::Mesh>> _meshes;
+    std::thread                           _checkpointWriter;
+    std::atomic<bool>                     _checkpointWritten;
+
+    std::unique_ptr<demolish::trajectory::Writer> _trajectory;
+    int                                   _trajectoryInterval;
 };
 
 #endif /* DELTA_WORLD_WORLD_H_ */
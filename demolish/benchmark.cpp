@@ -0,0 +1,293 @@
+#include "demolish.h"
+#include "Mesh.h"
+#include "ContactPoint.h"
+#include "builder/GeometryBuilder.h"
+#include "detection/penalty.h"
+#include "detection/point.h"
+#include "detection/sphere.h"
+#include "resolution/forces.h"
+#include "resolution/dynamics.h"
+#include <omp.h>
+#include <cmath>
+#include <random>
+#include <iostream>
+
+/*
+ * Micro benchmarks of the detection and dynamics kernels
+ *
+ * Every benchmark prepares its inputs from a fixed seed, calls the
+ * kernel once to warm up and then repeats the batch until at least
+ * minimumTime has passed. The results go to stdout as CSV:
+ *
+ *   kernel,items,repetitions,seconds,ns/op,items/s
+ *
+ * where an item is one kernel call (one triangle pair, one sphere, ...).
+ * Run with OMP_NUM_THREADS=1 for stable numbers.
+ */
+
+namespace {
+  const double minimumTime = 0.2;
+
+  // results are added here, so the compiler cannot drop the kernels
+  volatile iREAL sink = 0.0;
+
+  std::mt19937 generator(20240101);
+
+  iREAL uniform(iREAL low, iREAL high)
+  {
+    return std::uniform_real_distribution<iREAL>(low, high)(generator);
+  }
+
+  template<typename Kernel>
+  void run(const char* name, int items, Kernel kernel)
+  {
+    kernel();
+
+    long   repetitions = 0;
+    double start       = omp_get_wtime();
+    double elapsed     = 0.0;
+    do
+    {
+      kernel();
+      repetitions++;
+      elapsed = omp_get_wtime() - start;
+    } while(elapsed < minimumTime);
+
+    double operations = double(repetitions)*items;
+    std::cout << name << "," << items << "," << repetitions << "," << elapsed << ","
+              << 1E9*elapsed/operations << "," << operations/elapsed << std::endl;
+  }
+
+  // random triangle with corners in a unit cube around centre
+  void triangle(iREAL centre[3], iREAL* x, iREAL* y, iREAL* z)
+  {
+    for(int k=0; k<3; k++)
+    {
+      x[k] = centre[0] + uniform(-0.5, 0.5);
+      y[k] = centre[1] + uniform(-0.5, 0.5);
+      z[k] = centre[2] + uniform(-0.5, 0.5);
+    }
+  }
+
+  /*
+   * Triangle pairs whose bounding cubes are offset by distance in y:
+   * a negative distance overlaps, a small positive one is just apart.
+   */
+  void benchmarkPenaltySolver(const char* name, int n, iREAL distance)
+  {
+    std::vector<iREAL> xA(3*n), yA(3*n), zA(3*n), xB(3*n), yB(3*n), zB(3*n);
+    for(int i=0; i<n; i++)
+    {
+      iREAL centreA[3] = {0.0, 0.0, 0.0};
+      iREAL centreB[3] = {uniform(-0.2, 0.2), 1.0+distance, uniform(-0.2, 0.2)};
+      triangle(centreA, &xA[3*i], &yA[3*i], &zA[3*i]);
+      triangle(centreB, &xB[3*i], &yB[3*i], &zB[3*i]);
+    }
+
+    run(name, n, [&]()
+    {
+      for(int i=0; i<n; i++)
+      {
+        iREAL xPA, yPA, zPA, xPB, yPB, zPB;
+        int   iterations;
+        demolish::detection::penaltySolver(&xA[3*i], &yA[3*i], &zA[3*i],
+                                           &xB[3*i], &yB[3*i], &zB[3*i],
+                                           xPA, yPA, zPA, xPB, yPB, zPB,
+                                           iREAL(1.0/16.0), iterations);
+        sink = sink + xPA - xPB;
+      }
+    });
+  }
+}
+
+int main() {
+  const int n = 1024;
+
+  std::cout << "kernel,items,repetitions,seconds,ns/op,items/s" << std::endl;
+
+  // ***********************************
+  // detection
+  // ***********************************
+
+  benchmarkPenaltySolver("penaltySolver/touching", n, -1.0);
+  benchmarkPenaltySolver("penaltySolver/near",     n,  0.1);
+  benchmarkPenaltySolver("penaltySolver/far",      n,  5.0);
+
+  {
+    std::vector<iREAL> x(3*n), y(3*n), z(3*n), points(3*n);
+    for(int i=0; i<n; i++)
+    {
+      iREAL centre[3] = {0.0, 0.0, 0.0};
+      triangle(centre, &x[3*i], &y[3*i], &z[3*i]);
+      for(int k=0; k<3; k++) points[3*i+k] = uniform(-1.0, 1.0);
+    }
+
+    run("pt", n, [&]()
+    {
+      for(int i=0; i<n; i++)
+      {
+        iREAL A[3] = {x[3*i],   y[3*i],   z[3*i]};
+        iREAL B[3] = {x[3*i+1], y[3*i+1], z[3*i+1]};
+        iREAL C[3] = {x[3*i+2], y[3*i+2], z[3*i+2]};
+        iREAL closest[3];
+        sink = sink + demolish::detection::pt(A, B, C, &points[3*i], closest);
+      }
+    });
+  }
+
+  {
+    std::vector<iREAL> centres(6*n);
+    for(int i=0; i<6*n; i++) centres[i] = uniform(0.0, 3.0);
+    std::vector<demolish::ContactPoint> contactpoints;
+
+    run("spherewithsphere", n, [&]()
+    {
+      contactpoints.clear();
+      for(int i=0; i<n; i++)
+      {
+        const iREAL* a = &centres[6*i];
+        const iREAL* b = &centres[6*i+3];
+        demolish::detection::spherewithsphere(a[0], a[1], a[2], 1.0, 0.1, false, 0,
+                                              b[0], b[1], b[2], 1.0, 0.1, false, 1,
+                                              contactpoints);
+      }
+      sink = sink + contactpoints.size();
+    });
+  }
+
+  {
+    std::vector<demolish::Vertex> meshVertices;
+    std::vector<std::array<int, 3>> meshTriangles;
+    demolish::CreateHopper(40.0,10.0,20.0,meshVertices,meshTriangles);
+    demolish::Mesh hopper(meshTriangles,meshVertices);
+    const int numberOfTriangles = hopper.getNumberOfTriangles();
+
+    // spheres just above random hopper triangles
+    const int spheres = 64;
+    std::vector<iREAL> centres(3*spheres);
+    for(int i=0; i<spheres; i++)
+    {
+      int t = 3*int(numberOfTriangles*uniform(0.0, 1.0));
+      centres[3*i]   = (hopper.getXCoordinates()[t] + hopper.getXCoordinates()[t+1] + hopper.getXCoordinates()[t+2])/3.0;
+      centres[3*i+1] = (hopper.getYCoordinates()[t] + hopper.getYCoordinates()[t+1] + hopper.getYCoordinates()[t+2])/3.0 + uniform(0.9, 1.2);
+      centres[3*i+2] = (hopper.getZCoordinates()[t] + hopper.getZCoordinates()[t+1] + hopper.getZCoordinates()[t+2])/3.0;
+    }
+    std::vector<demolish::ContactPoint> contactpoints;
+
+    run("sphereWithMesh/hopper", spheres, [&]()
+    {
+      contactpoints.clear();
+      for(int i=0; i<spheres; i++)
+      {
+        demolish::detection::sphereWithMesh(centres[3*i], centres[3*i+1], centres[3*i+2], 1.0, 0.1, false, 0,
+                                            hopper.getXCoordinates(), hopper.getYCoordinates(), hopper.getZCoordinates(),
+                                            numberOfTriangles, 0.1, false, 1,
+                                            contactpoints);
+      }
+      sink = sink + contactpoints.size();
+    });
+
+    // ***********************************
+    // vertex update
+    // ***********************************
+
+    std::vector<iVERTEX> x(hopper.getXCoordinates(), hopper.getXCoordinates()+3*numberOfTriangles);
+    std::vector<iVERTEX> y(hopper.getYCoordinates(), hopper.getYCoordinates()+3*numberOfTriangles);
+    std::vector<iVERTEX> z(hopper.getZCoordinates(), hopper.getZCoordinates()+3*numberOfTriangles);
+    iREAL rotation[9];
+    demolish::dynamics::expmap(0.1, 0.2, 0.3, rotation[0], rotation[1], rotation[2], rotation[3], rotation[4], rotation[5], rotation[6], rotation[7], rotation[8]);
+    iREAL position[3]    = {1.0, 2.0, 3.0};
+    iREAL refposition[3] = {0.0, 0.0, 0.0};
+
+    run("updateVertices/hopper", 3*numberOfTriangles, [&]()
+    {
+      for(int j=0; j<3*numberOfTriangles; j++)
+      {
+        demolish::dynamics::updateVertices(&x[j], &y[j], &z[j],
+                                           &hopper.getRefXCoordinates()[j],
+                                           &hopper.getRefYCoordinates()[j],
+                                           &hopper.getRefZCoordinates()[j],
+                                           rotation, position, refposition);
+      }
+      sink = sink + x[0];
+    });
+  }
+
+  // ***********************************
+  // resolution
+  // ***********************************
+
+  {
+    std::vector<demolish::ContactPoint> contactpoints;
+    for(int i=0; i<n; i++)
+    {
+      iREAL PA[3] = {uniform(-1.0, 1.0), uniform(-0.05, 0.05), uniform(-1.0, 1.0)};
+      iREAL QB[3] = {PA[0]+uniform(-0.01, 0.01), PA[1]+uniform(-0.1, 0.1), PA[2]+uniform(-0.01, 0.01)};
+      demolish::ContactPoint contactpoint(PA[0], PA[1], PA[2], QB[0], QB[1], QB[2], true, 0.1, 0.1, true);
+      contactpoint.indexA = 0;
+      contactpoint.indexB = 1;
+      contactpoints.push_back(contactpoint);
+    }
+    std::vector<iREAL> displacements(3*n, 0.0);
+
+    iREAL positionA[3] = {0.0,  1.0, 0.0}, positionB[3] = {0.0, -1.0, 0.0};
+    iREAL angularA[3]  = {0.1,  0.0, 0.2}, angularB[3]  = {0.0, 0.0, 0.0};
+    iREAL linearA[3]   = {0.0, -1.0, 0.5}, linearB[3]   = {0.0, 0.0, 0.0};
+    iREAL identity[9]  = {1,0,0, 0,1,0, 0,0,1};
+    int   material     = int(demolish::material::MaterialType::WOOD);
+
+    run("getContactForces", n, [&]()
+    {
+      for(int i=0; i<n; i++)
+      {
+        std::array<iREAL, 3> force, torque;
+        demolish::resolution::getContactForces(contactpoints[i],
+                                               positionA, angularA, linearA, 1.0, identity, identity, material,
+                                               positionB, angularB, linearB, 1.0, identity, identity, material,
+                                               force, torque, false, &displacements[3*i], 1E-3);
+        sink = sink + force[0] + torque[0];
+      }
+    });
+  }
+
+  {
+    std::vector<iREAL> angular(3*n), rotation(9*n);
+    for(int i=0; i<3*n; i++) angular[i] = uniform(-1.0, 1.0);
+
+    run("expmap", n, [&]()
+    {
+      for(int i=0; i<n; i++)
+      {
+        iREAL* R = &rotation[9*i];
+        demolish::dynamics::expmap(angular[3*i], angular[3*i+1], angular[3*i+2],
+                                   R[0], R[1], R[2], R[3], R[4], R[5], R[6], R[7], R[8]);
+      }
+      sink = sink + rotation[0];
+    });
+
+    iREAL inertia[9] = {2,0,0, 0,3,0, 0,0,4};
+    iREAL inverse[9] = {0.5,0,0, 0,1.0/3.0,0, 0,0,0.25};
+    iREAL torque[3]  = {0.1, -0.2, 0.3};
+
+    run("updateAngular", n, [&]()
+    {
+      for(int i=0; i<n; i++)
+      {
+        demolish::dynamics::updateAngular(&angular[3*i], &rotation[9*i], inertia, inverse, torque, 1E-4);
+      }
+      sink = sink + angular[0];
+    });
+
+    std::vector<iREAL> spatial(angular);
+    run("updateRotationMatrix", n, [&]()
+    {
+      for(int i=0; i<n; i++)
+      {
+        demolish::dynamics::updateRotationMatrix(&spatial[3*i], &angular[3*i], &rotation[9*i], 1E-4);
+      }
+      sink = sink + rotation[0];
+    });
+  }
+
+  return 0;
+}
@@ -0,0 +1,518 @@
+#include "demolish.h"
+#include "World.h"
+#include "builder/GeometryBuilder.h"
+#include "detection/sphere.h"
+#include "detection/penalty.h"
+#include "detection/gjk.h"
+#include "detection/field.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+
+/*
+ * Checks
+ *
+ * Runs the step, or parts of it, headless and checks properties that the
+ * demos do not show. Prints one line per check and exits with 1 if one
+ * of them fails.
+ *
+ *   allocations : the contact detection must not allocate once the
+ *                 caller-owned contact buffer has grown to its working
+ *                 size. The global operator new and delete are replaced
+ *                 by counting versions; every detection kernel is run
+ *                 on a touching pair into one buffer that is cleared,
+ *                 not freed, between the calls.
+ *
+ *                 Neither may the whole step once the buffers have
+ *                 grown to the size of the scene. Contact buffers, broad
+ *                 phase pairs, the contact cache, islands and the
+ *                 colouring of the impulse solver are all reused. A
+ *                 scene with spheres, convex boxes and a concave floor
+ *                 settles during the warm up, then no step may allocate,
+ *                 with either contact solver.
+ *
+ *   manifold    : a convex box resting on a face, one hanging over the
+ *                 edge of the floor and two boxes side by side touch in
+ *                 four points each, the corners of the overlap.
+ *
+ *   islands     : the particles are sorted along a space filling curve
+ *                 while the islands refer to their positions. A scene
+ *                 reordered every step must report the same islands, as
+ *                 sets of global ids, as one that is never reordered.
+ *
+ *   restart     : a World restored from a checkpoint written between
+ *                 two reorderings continues in the saved particle order.
+ *                 Its bodies must be bitwise the same as those of the
+ *                 World that went on.
+ *
+ *   advancement : a sphere that covers 2 in every step must not pass a
+ *                 plate 0.1 thick, its step ends where it would touch
+ *                 the plate and the impulses stop it there. A scene in
+ *                 which nothing moves further than its epsilon must be
+ *                 bitwise the same without the advancement limit.
+ *
+ *   separation  : two convex boxes that start deep in each other are
+ *                 pushed apart by the impulse solver along the normal
+ *                 of their GJK contact. Without gravity they must end
+ *                 less deep than the penetration threshold and must not
+ *                 move towards each other.
+ *
+ *   resting box : a convex box placed on a floor slab at the depth where
+ *                 the penalty spring carries its weight must stay within
+ *                 the contact shell and come to rest. A spring that
+ *                 attracts inside the shell, or pushes the wrong body,
+ *                 pulls it through the floor or throws it off.
+ *
+ * Usage:
+ *   demolish-check [warm up steps] [counted steps]
+ */
+
+namespace {
+  std::atomic<bool> counting(false);
+  std::atomic<long> allocations(0);
+
+  void* allocate(std::size_t size)
+  {
+    if(counting) allocations++;
+    void* pointer = std::malloc(size ? size : 1);
+    if(!pointer) throw std::bad_alloc();
+    return pointer;
+  }
+
+  void* allocate(std::size_t size, std::size_t alignment)
+  {
+    if(counting) allocations++;
+    void* pointer = nullptr;
+    if(posix_memalign(&pointer, alignment < sizeof(void*) ? sizeof(void*) : alignment, size ? size : 1) != 0) throw std::bad_alloc();
+    return pointer;
+  }
+}
+
+void* operator new(std::size_t size)                                    { return allocate(size); }
+void* operator new[](std::size_t size)                                  { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment)        { return allocate(size, std::size_t(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment)      { return allocate(size, std::size_t(alignment)); }
+void  operator delete(void* pointer) noexcept                           { std::free(pointer); }
+void  operator delete[](void* pointer) noexcept                         { std::free(pointer); }
+void  operator delete(void* pointer, std::size_t) noexcept              { std::free(pointer); }
+void  operator delete[](void* pointer, std::size_t) noexcept            { std::free(pointer); }
+void  operator delete(void* pointer, std::align_val_t) noexcept         { std::free(pointer); }
+void  operator delete[](void* pointer, std::align_val_t) noexcept       { std::free(pointer); }
+void  operator delete(void* pointer, std::size_t, std::align_val_t) noexcept   { std::free(pointer); }
+void  operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+namespace {
+  std::unique_ptr<demolish::Mesh> createBox(iREAL dx, iREAL dy, iREAL dz, iREAL x, iREAL y, iREAL z)
+  {
+    std::vector<demolish::Vertex> meshVertices;
+    std::vector<std::array<int, 3>> meshTriangles;
+    demolish::CreateBox(dx, dy, dz, meshVertices, meshTriangles);
+    std::unique_ptr<demolish::Mesh> mesh(new demolish::Mesh(meshTriangles, meshVertices));
+    iREAL centre[3] = {-x, -y, -z};
+    mesh->shiftMesh(centre);
+    return mesh;
+  }
+
+  // a sphere resting on a box resting on a floor, and a second box
+  // leaning into the first one
+  struct Pairs {
+    std::unique_ptr<demolish::Mesh>                 floor, box, other;
+    std::unique_ptr<demolish::detection::DistanceField> field;
+
+    Pairs():
+      floor(createBox(20.0, 1.0, 20.0, 0.0, -0.5, 0.0)),
+      box(createBox(2.0, 2.0, 2.0, 0.0, 1.05, 0.0)),
+      other(createBox(2.0, 2.0, 2.0, 2.05, 1.2, 0.0))
+    {
+      field.reset(new demolish::detection::DistanceField(
+          floor->getXCoordinates(), floor->getYCoordinates(), floor->getZCoordinates(),
+          floor->getNumberOfTriangles(), 0.1, 1.0));
+    }
+
+    void detect(std::vector<demolish::ContactPoint>& contactpoints)
+    {
+      demolish::detection::spherewithsphere(
+          0.0, 2.6, 0.0, 0.5, 0.1, true, 0,
+          0.0, 3.65, 0.0, 0.5, 0.1, true, 1, contactpoints);
+
+      demolish::detection::sphereWithMesh(
+          0.0, 2.6, 0.0, 0.5, 0.1, true, 0,
+          box->getXCoordinates(), box->getYCoordinates(), box->getZCoordinates(),
+          box->getNumberOfTriangles(), 0.1, true, 2, contactpoints);
+
+      demolish::detection::penalty(
+          box->getXCoordinates(), box->getYCoordinates(), box->getZCoordinates(),
+          box->getNumberOfTriangles(), 0.1, true, 2,
+          floor->getXCoordinates(), floor->getYCoordinates(), floor->getZCoordinates(),
+          floor->getNumberOfTriangles(), 0.1, true, 3, contactpoints);
+
+      demolish::detection::gjk(
+          box->getXCoordinates(), box->getYCoordinates(), box->getZCoordinates(),
+          box->getVertexCorners(), box->getNumberOfUniqueVertices(),
+          box->getVertexNeighbourOffsets(), box->getVertexNeighbours(), 0.1, true, 2,
+          other->getXCoordinates(), other->getYCoordinates(), other->getZCoordinates(),
+          other->getVertexCorners(), other->getNumberOfUniqueVertices(),
+          other->getVertexNeighbourOffsets(), other->getVertexNeighbours(), 0.1, true, 4, contactpoints);
+
+      demolish::detection::sphereWithField(
+          0.0, 0.55, 5.0, 0.5, 0.1, true, 0,
+          *field, 0.1, true, 3, contactpoints);
+
+      demolish::detection::meshWithField(
+          box->getXCoordinates(), box->getYCoordinates(), box->getZCoordinates(),
+          box->getVertexCorners(), box->getNumberOfUniqueVertices(), 0.1, true, 2,
+          *field, 0.1, true, 3, contactpoints);
+    }
+  };
+
+  bool checkDetectionAllocations(int warmUp, int calls)
+  {
+    Pairs pairs;
+    std::vector<demolish::ContactPoint> contactpoints;
+
+    for(int i=0; i<warmUp; i++)
+    {
+      contactpoints.clear();
+      pairs.detect(contactpoints);
+    }
+
+    allocations = 0;
+    counting    = true;
+    for(int i=0; i<calls; i++)
+    {
+      contactpoints.clear();
+      pairs.detect(contactpoints);
+    }
+    counting    = false;
+
+    std::cout << "allocations, detection: " << allocations << " in " << calls << " calls, "
+              << contactpoints.size() << " contacts" << (allocations == 0 ? "" : ", failed") << std::endl;
+    return allocations == 0 && contactpoints.size() > 0;
+  }
+
+  // the points of a convex box resting on a face, of one hanging over
+  // the edge of the floor and of two boxes side by side
+  bool checkManifold()
+  {
+    std::unique_ptr<demolish::Mesh> floor(createBox(20.0, 1.0, 20.0, 0.0, -0.5, 0.0));
+    std::unique_ptr<demolish::Mesh> boxes[3] = {createBox(2.0, 2.0, 2.0, 0.0, 1.05, 0.0),
+                                                createBox(2.0, 2.0, 2.0, 10.0, 1.05, 0.0),
+                                                createBox(2.0, 2.0, 2.0, 2.05, 1.2, 0.0)};
+    demolish::Mesh* under[3] = {floor.get(), floor.get(), boxes[0].get()};
+    const char* names[3] = {"on the floor", "over the edge", "side by side"};
+
+    bool passed = true;
+    std::cout << "manifold:";
+    for(int i=0; i<3; i++)
+    {
+      demolish::Mesh* a = boxes[i].get();
+      demolish::Mesh* b = under[i];
+      std::vector<demolish::ContactPoint> contactpoints;
+      demolish::detection::gjk(
+          a->getXCoordinates(), a->getYCoordinates(), a->getZCoordinates(),
+          a->getVertexCorners(), a->getNumberOfUniqueVertices(),
+          a->getVertexNeighbourOffsets(), a->getVertexNeighbours(), 0.1, true, 0,
+          b->getXCoordinates(), b->getYCoordinates(), b->getZCoordinates(),
+          b->getVertexCorners(), b->getNumberOfUniqueVertices(),
+          b->getVertexNeighbourOffsets(), b->getVertexNeighbours(), 0.1, true, 1, contactpoints);
+
+      // four corners of the overlap, 0.05 apart, each its own feature
+      bool correct = contactpoints.size() == 4;
+      for(int k=0; k<contactpoints.size(); k++)
+      {
+        correct &= std::abs(contactpoints[k].distance - 0.05) < 1E-6;
+        for(int l=0; l<k; l++) correct &= contactpoints[k].feature != contactpoints[l].feature;
+      }
+      std::cout << (i == 0 ? " " : ", ") << contactpoints.size() << " points " << names[i];
+      passed &= correct;
+    }
+    std::cout << (passed ? "" : ", failed") << std::endl;
+    return passed;
+  }
+
+  struct Scene {
+    std::vector<demolish::Object>                  objects;
+    // every mesh object points into this storage, it has to outlive the World
+    std::vector<std::unique_ptr<demolish::Mesh>>   meshes;
+
+    void addBox(iREAL dx, iREAL dy, iREAL dz, std::array<iREAL, 3> location, bool isObstacle, bool isConvex, iREAL epsilon = 0.5)
+    {
+      std::vector<demolish::Vertex> meshVertices;
+      std::vector<std::array<int, 3>> meshTriangles;
+      demolish::CreateBox(dx, dy, dz, meshVertices, meshTriangles);
+      std::array<iREAL, 3> zero = {0,0,0};
+      meshes.push_back(std::unique_ptr<demolish::Mesh>(new demolish::Mesh(meshTriangles, meshVertices)));
+      objects.push_back(demolish::Object(objects.size(), meshes.back().get(), location,
+                                         demolish::material::MaterialType::WOOD,
+                                         isObstacle, true, isConvex, epsilon, zero, zero));
+    }
+
+    void addSphere(std::array<iREAL, 3> location, std::array<iREAL, 3> velocity = {0,0,0})
+    {
+      std::array<iREAL, 3> zero = {0,0,0};
+      objects.push_back(demolish::Object(0.5, objects.size(), location,
+                                         demolish::material::MaterialType::WOOD,
+                                         false, true, 0.1, velocity, zero));
+    }
+  };
+
+  // boxes and spheres resting on a concave floor, a sphere on every box
+  void createScene(Scene& scene)
+  {
+    scene.addBox(40.0, 1.0, 40.0, {0, -0.5, 0}, true, false);
+    for(int i=0; i<9; i++)
+    {
+      const iREAL x = -8.0 + 4.0*(i%3);
+      const iREAL z = -8.0 + 4.0*(i/3);
+      scene.addBox(2.0, 2.0, 2.0, {x, 1.05, z}, false, true);
+      scene.addSphere({x, 2.65, z});
+      scene.addSphere({x+12.0, 0.55, z});
+      scene.addSphere({x+12.0, 1.65, z});
+    }
+  }
+
+  bool checkAllocations(demolish::resolution::ContactSolver solver, const char* name, int warmUp, int steps)
+  {
+    Scene scene;
+    createScene(scene);
+    demolish::World world(scene.objects, -9.81, false);
+    world.setContactSolver(solver);
+    scene.objects.clear();
+    scene.objects.shrink_to_fit();
+
+    for(int i=0; i<warmUp; i++) world.updateWorld();
+
+    allocations = 0;
+    counting    = true;
+    for(int i=0; i<steps; i++) world.updateWorld();
+    counting    = false;
+
+    std::cout << "allocations, " << name << ": " << allocations << " in " << steps << " steps, "
+              << world.getNumberOfContactPoints() << " contacts" << (allocations == 0 ? "" : ", failed") << std::endl;
+    return allocations == 0;
+  }
+
+  // islands as sets of global ids, in an order that does not depend on
+  // the order of the particles
+  std::vector<std::vector<int>> getSortedIslands(demolish::World& world)
+  {
+    std::vector<std::vector<int>> islands = world.getIslands();
+    for(auto& island : islands) std::sort(island.begin(), island.end());
+    std::sort(islands.begin(), islands.end());
+    return islands;
+  }
+
+  bool checkIslands(int steps)
+  {
+    // the worlds move the meshes, each needs its own
+    Scene scene, other;
+    createScene(scene);
+    createScene(other);
+    demolish::World world(scene.objects, -9.81, false);
+    demolish::World reordered(other.objects, -9.81, false);
+    world.setReorderInterval(0);
+    reordered.setReorderInterval(1);
+    scene.objects.clear();
+    other.objects.clear();
+
+    bool passed = true;
+    for(int i=0; i<steps; i++)
+    {
+      world.updateWorld();
+      reordered.updateWorld();
+      passed &= getSortedIslands(world) == getSortedIslands(reordered);
+    }
+
+    std::cout << "islands: " << world.getIslands().size() << " with and without reordering, "
+              << steps << " steps" << (passed ? "" : ", failed") << std::endl;
+    return passed;
+  }
+
+  bool checkRestart(int steps)
+  {
+    const std::string checkpoint = "demolish-check.checkpoint";
+
+    // a pile, every sphere sums the forces of several neighbours
+    Scene scene;
+    createScene(scene);
+    for(int i=0; i<64; i++)
+    {
+      scene.addSphere({-8.0 + 1.05*(i%4) + 0.1*(i/16), 4.0 + 1.05*(i/16), 1.05*((i/4)%4) + 0.05*(i%3)});
+    }
+    demolish::World world(scene.objects, -9.81, false);
+    world.setReorderInterval(50);
+    scene.objects.clear();
+
+    for(int i=0; i<steps; i++) world.updateWorld();
+    world.writeCheckpoint(checkpoint);
+    bool passed = world.waitForCheckpoint();
+
+    demolish::World restored(checkpoint, false);
+    restored.setReorderInterval(50);
+    std::remove(checkpoint.c_str());
+    for(int i=0; i<steps; i++)
+    {
+      world.updateWorld();
+      restored.updateWorld();
+    }
+
+    std::vector<demolish::Object> objects = world.getObjects();
+    std::vector<demolish::Object> others  = restored.getObjects();
+    passed &= objects.size() == others.size();
+    for(int i=0; passed && i<objects.size(); i++)
+    {
+      passed &= objects[i].getLocation() == others[i].getLocation();
+      passed &= objects[i].getLinearVelocity() == others[i].getLinearVelocity();
+      passed &= objects[i].getAngularVelocity() == others[i].getAngularVelocity();
+    }
+
+    std::cout << "restart: the same as the run that went on after "
+              << steps << " steps" << (passed ? "" : ", failed") << std::endl;
+    return passed;
+  }
+
+  bool checkFastSphere(int steps)
+  {
+    // a plate 0.1 thick, the sphere covers 2 in every step
+    Scene scene;
+    scene.addBox(0.1, 4.0, 4.0, {0.0, 0.0, 0.0}, true, true, 0.1);
+    scene.addSphere({-2.0, 0.0, 0.0}, {400.0, 0.0, 0.0});
+    demolish::World world(scene.objects, 0.0, false);
+    world.setContactSolver(demolish::resolution::ContactSolver::GAUSSSEIDEL);
+    scene.objects.clear();
+
+    iREAL furthest = -2.0;
+    for(int i=0; i<steps; i++)
+    {
+      world.updateWorld();
+      furthest = std::max(furthest, world.getObjects()[1].getLocation()[0]);
+    }
+
+    // the centre must stay in front of the plate, at least a radius
+    const bool passed = furthest < -0.5;
+    std::cout << "fast sphere: nearest " << -furthest << " in front of the plate after "
+              << steps << " steps" << (passed ? "" : ", failed") << std::endl;
+    return passed;
+  }
+
+  bool checkSlowScene(int steps)
+  {
+    // the worlds move the meshes, each needs its own
+    Scene scene, other;
+    createScene(scene);
+    createScene(other);
+    demolish::World world(scene.objects, -9.81, false);
+    demolish::World limited(other.objects, -9.81, false);
+    world.setConservativeAdvancement(false);
+    scene.objects.clear();
+    other.objects.clear();
+
+    for(int i=0; i<steps; i++)
+    {
+      world.updateWorld();
+      limited.updateWorld();
+    }
+
+    // nothing moves further than its epsilon, the advancement must not
+    // change a single bit
+    bool passed = true;
+    std::vector<demolish::Object> objects = world.getObjects();
+    std::vector<demolish::Object> others  = limited.getObjects();
+    for(int i=0; i<objects.size(); i++)
+    {
+      passed &= objects[i].getLocation() == others[i].getLocation();
+      passed &= objects[i].getLinearVelocity() == others[i].getLinearVelocity();
+    }
+
+    std::cout << "slow scene: the same with and without conservative advancement after "
+              << steps << " steps" << (passed ? "" : ", failed") << std::endl;
+    return passed;
+  }
+
+  bool checkSeparation(int steps)
+  {
+    Scene scene;
+    scene.addBox(2.0, 2.0, 2.0, {0.0, 0.0, 0.0}, false, true);
+    scene.addBox(2.0, 2.0, 2.0, {1.5, 0.2, 0.0}, false, true);
+    demolish::World world(scene.objects, 0.0, false);
+    world.setContactSolver(demolish::resolution::ContactSolver::GAUSSSEIDEL);
+    world.setTimestep(0.01);
+    scene.objects.clear();
+
+    for(int i=0; i<steps; i++) world.updateWorld();
+
+    // they start 1.5 deep, the solver leaves about half the penetration
+    // threshold of 0.2
+    iREAL depth = 0.0;
+    for(auto& point : world.getContactPoints()) depth = std::max(depth, point.depth);
+    std::vector<demolish::Object> objects = world.getObjects();
+    const iREAL closing = objects[1].getLinearVelocity()[0]-objects[0].getLinearVelocity()[0];
+    const bool passed = depth < 0.2 && closing >= 0.0 && objects[0].getLocation()[0] < objects[1].getLocation()[0];
+
+    std::cout << "separation: depth " << depth << ", separating speed " << closing
+              << " after " << steps << " steps" << (passed ? "" : ", failed") << std::endl;
+    return passed;
+  }
+
+  bool checkRestingBox(int steps)
+  {
+    // the default mesh stiffness of 5e3 carries a 160 t box only at a
+    // depth of 314, far outside the contact shell; this one carries it
+    // on its four corners at 0.049. The damping scales with the
+    // stiffness, its ratio is lowered so the explicit step stays stable.
+    demolish::material::InteractionParameters& parameters =
+        demolish::material::interactionTable[demolish::material::MESH][int(demolish::material::MaterialType::WOOD)][int(demolish::material::MaterialType::WOOD)];
+    parameters.spring = 8E6;
+    parameters.damper = 1E-4;
+
+    Scene scene;
+    scene.addBox(40.0, 1.0, 40.0, {0.0, -0.5, 0.0}, true, true, 0.05);
+    scene.addBox(2.0, 2.0, 2.0, {0.0, 1.05, 0.0}, false, true, 0.05);
+    demolish::World world(scene.objects, -9.81, false);
+    world.setContactSolver(demolish::resolution::ContactSolver::PENALTY);
+    scene.objects.clear();
+
+    // the box starts at its static depth, its bottom 0.05 above the floor
+    iREAL lowest = 1.05, highest = 1.05;
+    for(int i=0; i<steps; i++)
+    {
+      world.updateWorld();
+      const iREAL height = world.getObjects()[1].getLocation()[1];
+      lowest  = std::min(lowest, height);
+      highest = std::max(highest, height);
+    }
+    demolish::material::materialInit();
+
+    // it must stay within the contact shell of 0.1 and come to rest
+    const iREAL speed = std::abs(world.getObjects()[1].getLinearVelocity()[1]);
+    const bool passed = lowest > 1.0 && highest < 1.1 && speed < 0.1;
+
+    std::cout << "resting box: height " << lowest << " to " << highest << ", speed " << speed
+              << " after " << steps << " steps" << (passed ? "" : ", failed") << std::endl;
+    return passed;
+  }
+}
+
+int main(int argc, char** argv) {
+  const int warmUp = argc > 1 ? std::atoi(argv[1]) : 600;
+  const int steps  = argc > 2 ? std::atoi(argv[2]) : 100;
+
+  bool passed = true;
+  passed &= checkDetectionAllocations(10, 100);
+  passed &= checkManifold();
+  passed &= checkAllocations(demolish::resolution::ContactSolver::PENALTY,     "penalty",  warmUp, steps);
+  passed &= checkAllocations(demolish::resolution::ContactSolver::GAUSSSEIDEL, "impulses", warmUp, steps);
+  passed &= checkIslands(50);
+  passed &= checkRestart(80);
+  passed &= checkFastSphere(50);
+  passed &= checkSlowScene(200);
+  passed &= checkSeparation(100);
+  passed &= checkRestingBox(2000);
+  std::cout << (passed ? "passed" : "failed") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -9,6 +9,19 @@
   #define iREAL double
 #endif
 
+/*
+ * Scalar type of the mesh vertices. With DEMOLISH_MIXED_PRECISION the
+ * vertices are stored and the narrow phase runs in float, while body
+ * state and force accumulation stay in iREAL.
+ */
+#ifndef iVERTEX
+  #ifdef DEMOLISH_MIXED_PRECISION
+    #define iVERTEX float
+  #else
+    #define iVERTEX iREAL
+  #endif
+#endif
+
 
 namespace demolish {
   std::string getOutputPrefix();
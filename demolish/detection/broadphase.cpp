@@ -0,0 +1,143 @@
+#include "broadphase.h"
+#include <omp.h>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+  inline bool overlap(
+    int a, int b,
+    const iREAL* minX, const iREAL* minY, const iREAL* minZ,
+    const iREAL* maxX, const iREAL* maxY, const iREAL* maxZ)
+  {
+    return minX[a] <= maxX[b] && minX[b] <= maxX[a] &&
+           minY[a] <= maxY[b] && minY[b] <= maxY[a] &&
+           minZ[a] <= maxZ[b] && minZ[b] <= maxZ[a];
+  }
+}
+
+unsigned demolish::detection::BroadPhase::cellHash(int i, int j, int k) const
+{
+  return ((unsigned(i)*73856093u) ^ (unsigned(j)*19349663u) ^ (unsigned(k)*83492791u)) & _mask;
+}
+
+void demolish::detection::BroadPhase::update(
+  int           numberOfParticles,
+  const iREAL*  minX,
+  const iREAL*  minY,
+  const iREAL*  minZ,
+  const iREAL*  maxX,
+  const iREAL*  maxY,
+  const iREAL*  maxZ,
+  const char*   isObstacle)
+{
+  _pairs.clear();
+  _large.clear();
+
+  // the largest moving particle sets the cell size
+  iREAL cellSize = 0.0;
+  for(int i=0; i<numberOfParticles; i++)
+  {
+    if(isObstacle[i]) continue;
+    cellSize = std::max(cellSize, std::max(maxX[i]-minX[i], std::max(maxY[i]-minY[i], maxZ[i]-minZ[i])));
+  }
+  if(cellSize <= 0.0) return;
+
+  // hash table with at least twice as many buckets as particles
+  unsigned numberOfBuckets = 16;
+  while(numberOfBuckets < 2*unsigned(numberOfParticles)) numberOfBuckets *= 2;
+  _mask = numberOfBuckets-1;
+
+  _cell.resize(numberOfParticles);
+  _sorted.resize(numberOfParticles);
+  _bucketOffsets.assign(numberOfBuckets+1, 0);
+
+  const iREAL inverseCellSize = 1.0/cellSize;
+  for(int i=0; i<numberOfParticles; i++)
+  {
+    if(std::max(maxX[i]-minX[i], std::max(maxY[i]-minY[i], maxZ[i]-minZ[i])) > cellSize)
+    {
+      _large.push_back(i);
+      continue;
+    }
+    _cell[i][0] = int(std::floor(0.5*(minX[i]+maxX[i])*inverseCellSize));
+    _cell[i][1] = int(std::floor(0.5*(minY[i]+maxY[i])*inverseCellSize));
+    _cell[i][2] = int(std::floor(0.5*(minZ[i]+maxZ[i])*inverseCellSize));
+    _bucketOffsets[cellHash(_cell[i][0], _cell[i][1], _cell[i][2])+1]++;
+  }
+
+  // counting sort of the small particles by bucket
+  for(unsigned b=0; b<numberOfBuckets; b++) _bucketOffsets[b+1] += _bucketOffsets[b];
+  _fill.assign(_bucketOffsets.begin(), _bucketOffsets.end()-1);
+  int largeIndex = 0;
+  for(int i=0; i<numberOfParticles; i++)
+  {
+    if(largeIndex < _large.size() && _large[largeIndex] == i)
+    {
+      largeIndex++;
+      continue;
+    }
+    _sorted[_fill[cellHash(_cell[i][0], _cell[i][1], _cell[i][2])]++] = i;
+  }
+
+  if(_threadPairs.size() < omp_get_max_threads()) _threadPairs.resize(omp_get_max_threads());
+  for(int t=0; t<_threadPairs.size(); t++) _threadPairs[t].clear();
+
+  const int numberOfSmall = _bucketOffsets[numberOfBuckets];
+
+  #pragma omp parallel
+  {
+    std::vector<std::array<int, 2>>& pairs = _threadPairs[omp_get_thread_num()];
+
+    // small against small, through the 27 neighbour cells
+    #pragma omp for schedule(static)
+    for(int s=0; s<numberOfSmall; s++)
+    {
+      const int a = _sorted[s];
+      for(int di=-1; di<=1; di++)
+      for(int dj=-1; dj<=1; dj++)
+      for(int dk=-1; dk<=1; dk++)
+      {
+        const int ci = _cell[a][0]+di;
+        const int cj = _cell[a][1]+dj;
+        const int ck = _cell[a][2]+dk;
+        const unsigned bucket = cellHash(ci, cj, ck);
+        for(unsigned e=_bucketOffsets[bucket]; e<_bucketOffsets[bucket+1]; e++)
+        {
+          const int b = _sorted[e];
+          if(b <= a) continue;
+          // different cells may share a bucket
+          if(_cell[b][0] != ci || _cell[b][1] != cj || _cell[b][2] != ck) continue;
+          if(isObstacle[a] && isObstacle[b]) continue;
+          if(!overlap(a, b, minX, minY, minZ, maxX, maxY, maxZ)) continue;
+          pairs.push_back({a, b});
+        }
+      }
+    }
+
+    // large against everything
+    for(int l=0; l<_large.size(); l++)
+    {
+      const int a = _large[l];
+      #pragma omp for schedule(static) nowait
+      for(int b=0; b<numberOfParticles; b++)
+      {
+        if(b == a) continue;
+        if(isObstacle[a] && isObstacle[b]) continue;
+        // a pair of two large particles is found from the smaller index
+        if(b < a && std::binary_search(_large.begin(), _large.end(), b)) continue;
+        if(!overlap(a, b, minX, minY, minZ, maxX, maxY, maxZ)) continue;
+        pairs.push_back({std::min(a, b), std::max(a, b)});
+      }
+    }
+  }
+
+  for(int t=0; t<_threadPairs.size(); t++)
+  {
+    _pairs.insert(_pairs.end(), _threadPairs[t].begin(), _threadPairs[t].end());
+  }
+}
+
+const std::vector<std::array<int, 2>>& demolish::detection::BroadPhase::getPairs() const
+{
+  return _pairs;
+}
@@ -0,0 +1,63 @@
+#ifndef DEMOLISH_CONTACT_DETECTION_BROADPHASE_H_
+#define DEMOLISH_CONTACT_DETECTION_BROADPHASE_H_
+
+#include "../demolish.h"
+#include <vector>
+#include <array>
+
+namespace demolish {
+	namespace detection {
+	  class BroadPhase;
+	}
+}
+
+/*
+ * Uniform grid broad phase on axis aligned bounding boxes.
+ *
+ * The cell size is the largest box extent of the moving particles, so a
+ * box can only overlap boxes whose centre lies in one of the 27 cells
+ * around its own centre. Boxes are sorted into a hashed grid by a
+ * counting sort, the neighbour search runs in parallel. Boxes that are
+ * larger than a cell (typically floors, walls and hoppers) are tested
+ * against every particle instead.
+ *
+ * Pairs of two obstacles are never reported. The storage is kept between
+ * updates, so the broad phase does not allocate in a steady state.
+ */
+class demolish::detection::BroadPhase {
+  public:
+	/*
+	 *  Update
+	 *
+	 *  Finds all pairs (i, j), i < j, whose boxes overlap.
+	 *
+	 *  @param numberOfParticles : number of boxes
+	 *  @param minX ... maxZ     : box corners, including the contact margin
+	 *  @param isObstacle        : obstacles do not interact with each other
+	 */
+	void update(
+		int           numberOfParticles,
+		const iREAL*  minX,
+		const iREAL*  minY,
+		const iREAL*  minZ,
+		const iREAL*  maxX,
+		const iREAL*  maxY,
+		const iREAL*  maxZ,
+		const char*   isObstacle);
+
+	const std::vector<std::array<int, 2>>& getPairs() const;
+
+  private:
+	unsigned cellHash(int i, int j, int k) const;
+
+	std::vector<std::array<int, 3>>              _cell;
+	std::vector<unsigned>                        _bucketOffsets;
+	std::vector<unsigned>                        _fill;
+	std::vector<int>                             _sorted;
+	std::vector<int>                             _large;
+	std::vector<std::vector<std::array<int, 2>>> _threadPairs;
+	std::vector<std::array<int, 2>>              _pairs;
+	unsigned                                     _mask;
+};
+
+#endif
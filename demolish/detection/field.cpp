@@ -0,0 +1,584 @@
+#include "field.h"
+#include "point.h"
+#include "../algo.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+
+#define FIELD_SIGN_TOLERANCE 1E-9
+
+namespace {
+
+  /*
+   * Signed distance of x to the candidate triangles. The sign is taken
+   * from the triangle that sees x most face-on among all triangles that
+   * realise the minimum, which resolves the ambiguity at edges and
+   * vertices of closed meshes.
+   */
+  template<typename T>
+  iREAL signedDistance(
+    const T*                 xCoordinates,
+    const T*                 yCoordinates,
+    const T*                 zCoordinates,
+    const std::vector<int>&  candidates,
+    const iREAL              x[3])
+  {
+    iREAL minimum = iREAL_MAX;
+    iREAL bestCosine = -1;
+    iREAL sign = 1;
+
+    for(std::size_t k=0; k<candidates.size(); k++)
+    {
+      int i = 3*candidates[k];
+      iREAL TP1[3] = {xCoordinates[i],   yCoordinates[i],   zCoordinates[i]};
+      iREAL TP2[3] = {xCoordinates[i+1], yCoordinates[i+1], zCoordinates[i+1]};
+      iREAL TP3[3] = {xCoordinates[i+2], yCoordinates[i+2], zCoordinates[i+2]};
+      iREAL P[3]   = {x[0], x[1], x[2]};
+      iREAL Q[3];
+
+      iREAL distance = demolish::detection::pt(TP1, TP2, TP3, P, Q);
+      if(distance > minimum + FIELD_SIGN_TOLERANCE*(1.0+minimum)) continue;
+
+      iREAL E0[3], E1[3], N[3], D[3];
+      SUB(TP2, TP1, E0);
+      SUB(TP3, TP1, E1);
+      PRODUCT(E0, E1, N);
+      SUB(P, Q, D);
+
+      iREAL length = LEN(N)*distance;
+      iREAL cosine = length > 0 ? DOT(N, D)/length : 0;
+
+      if(distance < minimum - FIELD_SIGN_TOLERANCE*(1.0+minimum) || fabs(cosine) > bestCosine)
+      {
+        bestCosine = fabs(cosine);
+        sign = cosine < 0 ? -1 : 1;
+      }
+      minimum = MIN(minimum, distance);
+    }
+
+    return sign*minimum;
+  }
+
+  /*
+   * The winding of the nearest triangle only tells inside from outside
+   * on a closed shell whose triangles all face the same way: then every
+   * edge is shared by exactly two triangles that run along it in
+   * opposite directions. Corners are matched by their coordinates.
+   */
+  template<typename T>
+  bool isClosedShell(
+    const T*  xCoordinates,
+    const T*  yCoordinates,
+    const T*  zCoordinates,
+    int       numberOfTriangles)
+  {
+    std::map<std::array<T, 3>, int>     corners;
+    std::map<std::pair<int, int>, int>  edges;
+    for(int t=0; t<numberOfTriangles; t++)
+    {
+      int corner[3];
+      for(int k=0; k<3; k++)
+      {
+        const int i = 3*t+k;
+        corner[k] = corners.insert({{xCoordinates[i], yCoordinates[i], zCoordinates[i]}, int(corners.size())}).first->second;
+      }
+      for(int k=0; k<3; k++) edges[{corner[k], corner[(k+1)%3]}]++;
+    }
+
+    for(auto& edge : edges)
+    {
+      if(edge.second != 1) return false;
+      auto opposite = edges.find({edge.first.second, edge.first.first});
+      if(opposite == edges.end() || opposite->second != 1) return false;
+    }
+    return numberOfTriangles > 0;
+  }
+}
+
+/*
+ * Triangles binned on a uniform grid that covers the field: every
+ * triangle is listed in all cells its bounding box overlaps. The cells
+ * are as large as the distance around a brick that matters, so the
+ * triangles near a brick are found in the few cells around it instead
+ * of by testing all of them.
+ */
+struct demolish::detection::DistanceField::TriangleGrid {
+  iREAL             origin[3];
+  iREAL             size;
+  int               cells[3];
+  std::vector<int>  offsets;
+  std::vector<int>  triangles;
+
+  template<typename T>
+  void build(
+    const T*      xCoordinates,
+    const T*      yCoordinates,
+    const T*      zCoordinates,
+    int           numberOfTriangles,
+    const iREAL   fieldOrigin[3],
+    const iREAL   extent[3],
+    iREAL         cellSize)
+  {
+    size = cellSize;
+    for(int d=0; d<3; d++)
+    {
+      origin[d] = fieldOrigin[d];
+      cells[d]  = std::max(1, int(std::ceil(extent[d]/size)));
+    }
+    const T* coordinates[3] = {xCoordinates, yCoordinates, zCoordinates};
+
+    // two passes over the triangles, the first counts, the second fills
+    offsets.assign(std::size_t(cells[0])*cells[1]*cells[2]+1, 0);
+    for(int pass=0; pass<2; pass++)
+    {
+      for(int t=0; t<numberOfTriangles; t++)
+      {
+        int lower[3], upper[3];
+        for(int d=0; d<3; d++)
+        {
+          const iREAL minimum = MIN(MIN(coordinates[d][3*t], coordinates[d][3*t+1]), coordinates[d][3*t+2]);
+          const iREAL maximum = MAX(MAX(coordinates[d][3*t], coordinates[d][3*t+1]), coordinates[d][3*t+2]);
+          lower[d] = cell(minimum, d);
+          upper[d] = cell(maximum, d);
+        }
+        for(int x=lower[0]; x<=upper[0]; x++)
+        for(int y=lower[1]; y<=upper[1]; y++)
+        for(int z=lower[2]; z<=upper[2]; z++)
+        {
+          const std::size_t c = (std::size_t(x)*cells[1] + y)*cells[2] + z;
+          if(pass == 0) offsets[c+1]++;
+          else          triangles[offsets[c]++] = t;
+        }
+      }
+
+      if(pass == 0)
+      {
+        for(std::size_t c=0; c+1<offsets.size(); c++) offsets[c+1] += offsets[c];
+        triangles.resize(offsets.back());
+      }
+      else
+      {
+        // the fill moved every offset to the start of the next cell
+        for(std::size_t c=offsets.size()-1; c>0; c--) offsets[c] = offsets[c-1];
+        offsets[0] = 0;
+      }
+    }
+  }
+
+  int cell(iREAL x, int d) const
+  {
+    return std::max(0, std::min(cells[d]-1, int(std::floor((x - origin[d])/size))));
+  }
+
+  // the triangles in the cells that overlap the box of half width range
+  // around centre, each once. stamp holds the last brick a triangle was
+  // gathered for.
+  void gather(const iREAL centre[3], iREAL range, int brick, std::vector<int>& stamp, std::vector<int>& candidates) const
+  {
+    int lower[3], upper[3];
+    for(int d=0; d<3; d++)
+    {
+      lower[d] = cell(centre[d] - range, d);
+      upper[d] = cell(centre[d] + range, d);
+    }
+
+    candidates.clear();
+    for(int x=lower[0]; x<=upper[0]; x++)
+    for(int y=lower[1]; y<=upper[1]; y++)
+    for(int z=lower[2]; z<=upper[2]; z++)
+    {
+      const std::size_t c = (std::size_t(x)*cells[1] + y)*cells[2] + z;
+      for(int k=offsets[c]; k<offsets[c+1]; k++)
+      {
+        const int t = triangles[k];
+        if(stamp[t] == brick) continue;
+        stamp[t] = brick;
+        candidates.push_back(t);
+      }
+    }
+  }
+};
+
+template<typename T>
+demolish::detection::DistanceField::DistanceField(
+  const T*      xCoordinates,
+  const T*      yCoordinates,
+  const T*      zCoordinates,
+  int           numberOfTriangles,
+  iREAL         cellSize,
+  iREAL         bandWidth,
+  std::size_t   maxMemory):
+  _cellSize(cellSize),
+  _bandWidth(bandWidth),
+  _isSigned(isClosedShell(xCoordinates, yCoordinates, zCoordinates, numberOfTriangles))
+{
+  iREAL minimum[3] = { iREAL_MAX,  iREAL_MAX,  iREAL_MAX};
+  iREAL maximum[3] = {-iREAL_MAX, -iREAL_MAX, -iREAL_MAX};
+  for(int i=0; i<numberOfTriangles*3; i++)
+  {
+    minimum[0] = MIN(minimum[0], xCoordinates[i]); maximum[0] = MAX(maximum[0], xCoordinates[i]);
+    minimum[1] = MIN(minimum[1], yCoordinates[i]); maximum[1] = MAX(maximum[1], yCoordinates[i]);
+    minimum[2] = MIN(minimum[2], zCoordinates[i]); maximum[2] = MAX(maximum[2], zCoordinates[i]);
+  }
+
+  const int nodesPerBrick = (BRICK+1)*(BRICK+1)*(BRICK+1);
+
+  std::vector<iREAL> brickDistance;
+  TriangleGrid       grid;
+
+  for(;;)
+  {
+    for(int d=0; d<3; d++)
+    {
+      _origin[d] = minimum[d] - _bandWidth;
+      int cells  = std::ceil((maximum[d] - minimum[d] + 2*_bandWidth)/_cellSize) + 1;
+      _numberOfBricks[d] = (cells + BRICK - 1)/BRICK;
+    }
+
+    const int   numberOfBricks = _numberOfBricks[0]*_numberOfBricks[1]*_numberOfBricks[2];
+    const iREAL halfDiagonal   = 0.5*std::sqrt(3.0)*BRICK*_cellSize;
+    const iREAL extent[3]      = {_numberOfBricks[0]*BRICK*_cellSize,
+                                  _numberOfBricks[1]*BRICK*_cellSize,
+                                  _numberOfBricks[2]*BRICK*_cellSize};
+
+    // the build below looks furthest, as far as its cells reach
+    grid.build(xCoordinates, yCoordinates, zCoordinates, numberOfTriangles, _origin, extent, _bandWidth + 3*halfDiagonal);
+
+    // a brick is kept if the surface passes within the band of any of its
+    // nodes, only triangles that close to the brick matter
+    brickDistance.assign(numberOfBricks, iREAL_MAX);
+
+    #pragma omp parallel
+    {
+      std::vector<int> stamp(numberOfTriangles, -1);
+      std::vector<int> candidates;
+
+      #pragma omp for schedule(dynamic, 16)
+      for(int b=0; b<numberOfBricks; b++)
+      {
+        int bx = b/(_numberOfBricks[1]*_numberOfBricks[2]);
+        int by = (b/_numberOfBricks[2])%_numberOfBricks[1];
+        int bz = b%_numberOfBricks[2];
+
+        iREAL centre[3] = {_origin[0] + (bx*BRICK + 0.5*BRICK)*_cellSize,
+                           _origin[1] + (by*BRICK + 0.5*BRICK)*_cellSize,
+                           _origin[2] + (bz*BRICK + 0.5*BRICK)*_cellSize};
+
+        grid.gather(centre, _bandWidth + halfDiagonal, b, stamp, candidates);
+
+        iREAL minimumDistance = iREAL_MAX;
+        for(std::size_t k=0; k<candidates.size(); k++)
+        {
+          const int t = 3*candidates[k];
+          iREAL TP1[3] = {xCoordinates[t],   yCoordinates[t],   zCoordinates[t]};
+          iREAL TP2[3] = {xCoordinates[t+1], yCoordinates[t+1], zCoordinates[t+1]};
+          iREAL TP3[3] = {xCoordinates[t+2], yCoordinates[t+2], zCoordinates[t+2]};
+          iREAL Q[3];
+          minimumDistance = MIN(minimumDistance, demolish::detection::pt(TP1, TP2, TP3, centre, Q));
+        }
+        brickDistance[b] = minimumDistance;
+      }
+    }
+
+    _brickIndex.assign(numberOfBricks, -1);
+    int allocated = 0;
+    for(int b=0; b<numberOfBricks; b++)
+    {
+      if(brickDistance[b] <= _bandWidth + halfDiagonal) _brickIndex[b] = allocated++;
+    }
+
+    std::size_t memory = std::size_t(allocated)*nodesPerBrick*sizeof(float);
+    if(maxMemory == 0 || memory <= maxMemory || allocated == 0) break;
+    _cellSize *= 2;
+  }
+
+  // the grid was binned for the final cell size
+  build(xCoordinates, yCoordinates, zCoordinates, numberOfTriangles, grid);
+}
+
+template<typename T>
+void demolish::detection::DistanceField::build(
+  const T*      xCoordinates,
+  const T*      yCoordinates,
+  const T*      zCoordinates,
+  int           numberOfTriangles,
+  const TriangleGrid& grid)
+{
+  const int   nodesPerAxis   = BRICK+1;
+  const int   nodesPerBrick  = nodesPerAxis*nodesPerAxis*nodesPerAxis;
+  const int   numberOfBricks = _brickIndex.size();
+  const iREAL halfDiagonal   = 0.5*std::sqrt(3.0)*BRICK*_cellSize;
+
+  _values.assign(std::size_t(getNumberOfBricks())*nodesPerBrick, _bandWidth);
+
+  // a kept brick has the surface within the band and half a diagonal of
+  // its centre, the closest triangle of any of its nodes within another
+  // two half diagonals
+  const iREAL range = _bandWidth + 3*halfDiagonal;
+
+  #pragma omp parallel
+  {
+    std::vector<int>   stamp(numberOfTriangles, -1);
+    std::vector<int>   nearby;
+    std::vector<int>   candidates;
+    std::vector<iREAL> distances;
+
+    #pragma omp for schedule(dynamic, 4)
+    for(int b=0; b<numberOfBricks; b++)
+    {
+      if(_brickIndex[b] < 0) continue;
+
+      int bx = b/(_numberOfBricks[1]*_numberOfBricks[2]);
+      int by = (b/_numberOfBricks[2])%_numberOfBricks[1];
+      int bz = b%_numberOfBricks[2];
+
+      iREAL centre[3] = {_origin[0] + (bx*BRICK + 0.5*BRICK)*_cellSize,
+                         _origin[1] + (by*BRICK + 0.5*BRICK)*_cellSize,
+                         _origin[2] + (bz*BRICK + 0.5*BRICK)*_cellSize};
+
+      grid.gather(centre, range, b, stamp, nearby);
+
+      // the closest triangle of any node is within this radius of the brick centre
+      iREAL minimumDistance = iREAL_MAX;
+      distances.resize(nearby.size());
+      for(std::size_t k=0; k<nearby.size(); k++)
+      {
+        const int t = nearby[k];
+        iREAL TP1[3] = {xCoordinates[3*t],   yCoordinates[3*t],   zCoordinates[3*t]};
+        iREAL TP2[3] = {xCoordinates[3*t+1], yCoordinates[3*t+1], zCoordinates[3*t+1]};
+        iREAL TP3[3] = {xCoordinates[3*t+2], yCoordinates[3*t+2], zCoordinates[3*t+2]};
+        iREAL Q[3];
+        distances[k] = demolish::detection::pt(TP1, TP2, TP3, centre, Q);
+        minimumDistance = MIN(minimumDistance, distances[k]);
+      }
+
+      // in the order of the triangles, so the sign picks as before
+      candidates.clear();
+      for(std::size_t k=0; k<nearby.size(); k++)
+      {
+        if(distances[k] <= minimumDistance + 2*halfDiagonal) candidates.push_back(nearby[k]);
+      }
+      std::sort(candidates.begin(), candidates.end());
+
+      float* values = _values.data() + std::size_t(_brickIndex[b])*nodesPerBrick;
+      for(int i=0; i<nodesPerAxis; i++)
+      for(int j=0; j<nodesPerAxis; j++)
+      for(int k=0; k<nodesPerAxis; k++)
+      {
+        iREAL x[3] = {_origin[0] + (bx*BRICK + i)*_cellSize,
+                      _origin[1] + (by*BRICK + j)*_cellSize,
+                      _origin[2] + (bz*BRICK + k)*_cellSize};
+
+        iREAL d = signedDistance(xCoordinates, yCoordinates, zCoordinates, candidates, x);
+        if(!_isSigned) d = fabs(d);
+        d = d >  _bandWidth ?  _bandWidth : d;
+        d = d < -_bandWidth ? -_bandWidth : d;
+        values[(i*nodesPerAxis + j)*nodesPerAxis + k] = d;
+      }
+    }
+  }
+}
+
+iREAL demolish::detection::DistanceField::distance(const iREAL x[3], iREAL gradient[3]) const
+{
+  const int nodesPerAxis = BRICK+1;
+
+  gradient[0] = gradient[1] = gradient[2] = 0;
+
+  int   cell[3], brick[3], local[3];
+  iREAL f[3];
+  for(int d=0; d<3; d++)
+  {
+    iREAL g = (x[d] - _origin[d])/_cellSize;
+    if(!(g >= 0) || g >= _numberOfBricks[d]*BRICK) return _bandWidth;
+
+    cell[d]  = int(g);
+    f[d]     = g - cell[d];
+    brick[d] = cell[d]/BRICK;
+    local[d] = cell[d] - brick[d]*BRICK;
+  }
+
+  int b = _brickIndex[(brick[0]*_numberOfBricks[1] + brick[1])*_numberOfBricks[2] + brick[2]];
+  if(b < 0) return _bandWidth;
+
+  const float* values = _values.data() + std::size_t(b)*nodesPerAxis*nodesPerAxis*nodesPerAxis;
+  const float* c = values + (local[0]*nodesPerAxis + local[1])*nodesPerAxis + local[2];
+
+  const int dx = nodesPerAxis*nodesPerAxis;
+  const int dy = nodesPerAxis;
+  const int dz = 1;
+
+  iREAL c000 = c[0],     c001 = c[dz],
+        c010 = c[dy],    c011 = c[dy+dz],
+        c100 = c[dx],    c101 = c[dx+dz],
+        c110 = c[dx+dy], c111 = c[dx+dy+dz];
+
+  // interpolate along z, then y, then x
+  iREAL c00 = c000 + (c001-c000)*f[2];
+  iREAL c01 = c010 + (c011-c010)*f[2];
+  iREAL c10 = c100 + (c101-c100)*f[2];
+  iREAL c11 = c110 + (c111-c110)*f[2];
+
+  iREAL c0 = c00 + (c01-c00)*f[1];
+  iREAL c1 = c10 + (c11-c10)*f[1];
+
+  gradient[0] = (c1 - c0)/_cellSize;
+  gradient[1] = ((1-f[0])*(c01-c00) + f[0]*(c11-c10))/_cellSize;
+  gradient[2] = ((1-f[0])*((1-f[1])*(c001-c000) + f[1]*(c011-c010)) +
+                    f[0] *((1-f[1])*(c101-c100) + f[1]*(c111-c110)))/_cellSize;
+
+  return c0 + (c1-c0)*f[0];
+}
+
+iREAL demolish::detection::DistanceField::getCellSize() const
+{
+  return _cellSize;
+}
+
+iREAL demolish::detection::DistanceField::getBandWidth() const
+{
+  return _bandWidth;
+}
+
+bool demolish::detection::DistanceField::isSigned() const
+{
+  return _isSigned;
+}
+
+int demolish::detection::DistanceField::getNumberOfBricks() const
+{
+  int allocated = 0;
+  for(std::size_t b=0; b<_brickIndex.size(); b++)
+  {
+    if(_brickIndex[b] >= 0) allocated++;
+  }
+  return allocated;
+}
+
+std::size_t demolish::detection::DistanceField::getMemoryFootprint() const
+{
+  return _values.size()*sizeof(float) + _brickIndex.size()*sizeof(int);
+}
+
+void demolish::detection::sphereWithField(
+  const iREAL   xCoordinatesOfPointsOfGeometryA,
+  const iREAL   yCoordinatesOfPointsOfGeometryA,
+  const iREAL   zCoordinatesOfPointsOfGeometryA,
+  const iREAL   radA,
+  const iREAL   epsilonA,
+  const bool    frictionA,
+  const int	    particleA,
+
+  const demolish::detection::DistanceField& fieldB,
+  const iREAL   epsilonB,
+  const bool 	frictionB,
+  const int 	particleB,
+
+  std::vector<demolish::ContactPoint>& contactpoints)
+{
+  iREAL P[3] = {xCoordinatesOfPointsOfGeometryA, yCoordinatesOfPointsOfGeometryA, zCoordinatesOfPointsOfGeometryA};
+  iREAL gradient[3];
+  iREAL phi = fieldB.distance(P, gradient);
+  iREAL distance = phi - radA;
+
+  if(distance > epsilonA + epsilonB) return;
+
+  iREAL length = LEN(gradient);
+  if(length <= 0) return;
+  SCALE(gradient, 1.0/length);
+
+  // PA on the sphere surface, PB on the obstacle surface, normal from B to A
+  demolish::ContactPoint newContactPoint(P[0] - radA*gradient[0], P[1] - radA*gradient[1], P[2] - radA*gradient[2],
+                                         P[0] - phi*gradient[0],  P[1] - phi*gradient[1],  P[2] - phi*gradient[2],
+                                         distance >= 0,
+                                         epsilonA,
+                                         epsilonB,
+                                         particleA,
+                                         particleB,
+                                         (frictionA && frictionB));
+  newContactPoint.normal[0] = gradient[0];
+  newContactPoint.normal[1] = gradient[1];
+  newContactPoint.normal[2] = gradient[2];
+  newContactPoint.distance  = distance;
+  newContactPoint.depth     = (epsilonA+epsilonB)-distance;
+
+  contactpoints.push_back(newContactPoint);
+}
+
+template<typename T>
+void demolish::detection::meshWithField(
+  const T*      xCoordinatesOfPointsOfGeometryA,
+  const T*      yCoordinatesOfPointsOfGeometryA,
+  const T*      zCoordinatesOfPointsOfGeometryA,
+  const int*    vertexCornersA,
+  const int     numberOfVerticesA,
+  const iREAL   epsilonA,
+  const bool    frictionA,
+  const int	    particleA,
+
+  const demolish::detection::DistanceField& fieldB,
+  const iREAL   epsilonB,
+  const bool 	frictionB,
+  const int 	particleB,
+
+  std::vector<demolish::ContactPoint>& contactpoints)
+{
+  int   deepest = -1;
+  iREAL minimum = epsilonA + epsilonB;
+  iREAL normal[3] = {0.0, 0.0, 0.0};
+
+  for(int v=0; v<numberOfVerticesA; v++)
+  {
+    int c = vertexCornersA[v];
+    if(c < 0) continue;
+
+    iREAL P[3] = {xCoordinatesOfPointsOfGeometryA[c], yCoordinatesOfPointsOfGeometryA[c], zCoordinatesOfPointsOfGeometryA[c]};
+    iREAL gradient[3];
+    iREAL phi = fieldB.distance(P, gradient);
+    if(phi >= minimum) continue;
+
+    iREAL length = LEN(gradient);
+    if(length <= 0) continue;
+
+    minimum = phi;
+    deepest = c;
+    normal[0] = gradient[0]/length;
+    normal[1] = gradient[1]/length;
+    normal[2] = gradient[2]/length;
+  }
+
+  if(deepest < 0) return;
+
+  iREAL P[3] = {xCoordinatesOfPointsOfGeometryA[deepest], yCoordinatesOfPointsOfGeometryA[deepest], zCoordinatesOfPointsOfGeometryA[deepest]};
+  demolish::ContactPoint newContactPoint(P[0], P[1], P[2],
+                                         P[0] - minimum*normal[0], P[1] - minimum*normal[1], P[2] - minimum*normal[2],
+                                         minimum >= 0,
+                                         epsilonA,
+                                         epsilonB,
+                                         particleA,
+                                         particleB,
+                                         (frictionA && frictionB));
+  newContactPoint.normal[0] = normal[0];
+  newContactPoint.normal[1] = normal[1];
+  newContactPoint.normal[2] = normal[2];
+  newContactPoint.distance  = minimum;
+  newContactPoint.depth     = (epsilonA+epsilonB)-minimum;
+  newContactPoint.feature   = deepest;
+
+  contactpoints.push_back(newContactPoint);
+}
+
+#define DEMOLISH_INSTANTIATE_FIELD(T) \
+  template demolish::detection::DistanceField::DistanceField<T>( \
+    const T*, const T*, const T*, int, iREAL, iREAL, std::size_t); \
+  template void demolish::detection::meshWithField<T>( \
+    const T*, const T*, const T*, const int*, const int, const iREAL, const bool, const int, \
+    const demolish::detection::DistanceField&, const iREAL, const bool, const int, \
+    std::vector<demolish::ContactPoint>&);
+
+DEMOLISH_INSTANTIATE_FIELD(float)
+DEMOLISH_INSTANTIATE_FIELD(double)
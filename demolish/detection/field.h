@@ -0,0 +1,161 @@
+#ifndef DEMOLISH_CONTACT_DETECTION_FIELD_H_
+#define DEMOLISH_CONTACT_DETECTION_FIELD_H_
+
+#include "../ContactPoint.h"
+#include <vector>
+#include <cstddef>
+
+namespace demolish {
+	namespace detection {
+	  class DistanceField;
+	}
+}
+
+/*
+ * Sparse narrow-band signed distance field of a static triangle mesh.
+ *
+ * The field is sampled on a regular grid that is split into bricks of
+ * BRICK^3 cells. Only bricks that lie within bandWidth of the surface
+ * are stored, everything else reports +bandWidth. Distances are positive
+ * outside of the mesh (with respect to the triangle normals) and
+ * negative inside. An open shell, or one whose triangles are not wound
+ * consistently, has no inside; its field holds the unsigned distance.
+ * Queries are a trilinear lookup, the gradient of the interpolant gives
+ * the normal.
+ *
+ * The field is built once, in world coordinates, so it is only valid
+ * for obstacles.
+ */
+class demolish::detection::DistanceField {
+  public:
+	static const int BRICK = 8;
+
+	/*
+	 *  Build Distance Field
+	 *
+	 *  Precomputes the field for the flattened triangle soup. The bricks
+	 *  are evaluated in parallel.
+	 *
+	 *  @param xCoordinates      : flattened x coordinates of the triangles
+	 *  @param yCoordinates      : flattened y coordinates of the triangles
+	 *  @param zCoordinates      : flattened z coordinates of the triangles
+	 *  @param numberOfTriangles : number of triangles
+	 *  @param cellSize          : grid spacing, controls the accuracy
+	 *  @param bandWidth         : half width of the stored band around the surface
+	 *  @param maxMemory         : upper bound for the brick storage in bytes (0 for none);
+	 *                             the cell size is coarsened until the field fits
+	 *
+	 *  The coordinates may be float or double, the field is always
+	 *  computed in iREAL.
+	 */
+	template<typename T>
+	DistanceField(
+		const T*      xCoordinates,
+		const T*      yCoordinates,
+		const T*      zCoordinates,
+		int           numberOfTriangles,
+		iREAL         cellSize,
+		iREAL         bandWidth,
+		std::size_t   maxMemory = 0);
+
+	/*
+	 *  Distance
+	 *
+	 *  Returns the interpolated signed distance at x and its gradient.
+	 *  The gradient is zero outside of the band.
+	 *
+	 *  @param x        : query point
+	 *  @param gradient : gradient of the field at x
+	 *  @returns signed distance
+	 */
+	iREAL distance(const iREAL x[3], iREAL gradient[3]) const;
+
+	iREAL       getCellSize() const;
+	iREAL       getBandWidth() const;
+	// false for an open or inconsistently wound shell
+	bool        isSigned() const;
+	int         getNumberOfBricks() const;
+	std::size_t getMemoryFootprint() const;
+
+  private:
+	// the triangles binned on the brick lattice
+	struct TriangleGrid;
+
+	template<typename T>
+	void build(
+		const T*      xCoordinates,
+		const T*      yCoordinates,
+		const T*      zCoordinates,
+		int           numberOfTriangles,
+		const TriangleGrid& grid);
+
+	iREAL                _cellSize;
+	iREAL                _bandWidth;
+	bool                 _isSigned;
+	iREAL                _origin[3];
+	int                  _numberOfBricks[3];
+
+	// dense brick lookup (-1 for empty bricks) and the sparse node storage
+	std::vector<int>     _brickIndex;
+	std::vector<float>   _values;
+};
+
+namespace demolish {
+	namespace detection {
+
+	  /*
+	   *  Sphere With Field
+	   *
+	   *  Contact between a sphere A and an obstacle B represented by its
+	   *  distance field. Replaces sphereWithMesh for that obstacle.
+	   *
+	   *  @param contactpoints : buffer the contact point is appended to (at most one)
+	   */
+	  void sphereWithField(
+		const iREAL   xCoordinatesOfPointsOfGeometryA,
+		const iREAL   yCoordinatesOfPointsOfGeometryA,
+		const iREAL   zCoordinatesOfPointsOfGeometryA,
+		const iREAL   radA,
+		const iREAL   epsilonA,
+		const bool    frictionA,
+		const int	  particleA,
+
+		const demolish::detection::DistanceField& fieldB,
+		const iREAL   epsilonB,
+		const bool 	  frictionB,
+		const int 	  particleB,
+
+		std::vector<demolish::ContactPoint>& contactpoints
+		);
+
+	  /*
+	   *  Mesh With Field
+	   *
+	   *  Contact between the vertices of mesh A and an obstacle B
+	   *  represented by its distance field. Replaces the triangle pair
+	   *  test for that obstacle. Returns the deepest vertex.
+	   *
+	   *  @param contactpoints : buffer the contact point is appended to (at most one)
+	   */
+	  template<typename T>
+	  void meshWithField(
+		const T*      xCoordinatesOfPointsOfGeometryA,
+		const T*      yCoordinatesOfPointsOfGeometryA,
+		const T*      zCoordinatesOfPointsOfGeometryA,
+		const int*    vertexCornersA,
+		const int     numberOfVerticesA,
+		const iREAL   epsilonA,
+		const bool    frictionA,
+		const int	  particleA,
+
+		const demolish::detection::DistanceField& fieldB,
+		const iREAL   epsilonB,
+		const bool 	  frictionB,
+		const int 	  particleB,
+
+		std::vector<demolish::ContactPoint>& contactpoints
+		);
+	}
+}
+
+#endif
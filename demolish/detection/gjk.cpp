@@ -0,0 +1,1028 @@
+#include "gjk.h"
+#include "../algo.h"
+#include <cmath>
+
+#define GJK_MAX_ITERATIONS 64
+#define GJK_TOLERANCE 1E-10
+#define GJK_HILLCLIMBING_THRESHOLD 32
+
+#define EPA_MAX_ITERATIONS 64
+#define EPA_MAX_POINTS 96
+#define EPA_MAX_FACES 192
+#define EPA_TOLERANCE 1E-8
+
+#define MANIFOLD_MAX_VERTICES 16
+#define MANIFOLD_MAX_POINTS (4*MANIFOLD_MAX_VERTICES)
+
+namespace {
+
+  /*
+   * A convex hull given by the flattened spatial coordinates of a mesh
+   * plus the unique vertex to corner map and the vertex adjacency.
+   */
+  template<typename T>
+  struct Hull
+  {
+    const T       *x;
+    const T       *y;
+    const T       *z;
+    const int     *corners;
+    int            numberOfVertices;
+    const int     *offsets;
+    const int     *neighbours;
+    int            lastVertex;
+  };
+
+  /*
+   * A point of the Minkowski difference A-B together with the two
+   * hull points it was built from, so we can recover witness points.
+   */
+  struct SupportPoint
+  {
+    iREAL w[3];
+    iREAL a[3];
+    iREAL b[3];
+  };
+
+  struct Face
+  {
+    int   v[3];
+    iREAL normal[3];
+    iREAL distance;
+  };
+
+  /*
+   * Returns the flattened corner index of the hull vertex that is
+   * furthest along d. Small hulls are scanned, large hulls are
+   * hill-climbed starting from the vertex found by the previous query.
+   */
+  template<typename T>
+  int support(Hull<T>& hull, const iREAL d[3])
+  {
+    int best = -1;
+    iREAL bestDot = -iREAL_MAX;
+
+    if(hull.offsets == nullptr || hull.numberOfVertices <= GJK_HILLCLIMBING_THRESHOLD || hull.corners[hull.lastVertex] < 0)
+    {
+      for(int v=0; v<hull.numberOfVertices; v++)
+      {
+        int c = hull.corners[v];
+        if(c < 0) continue;
+        iREAL dot = hull.x[c]*d[0] + hull.y[c]*d[1] + hull.z[c]*d[2];
+        if(dot > bestDot)
+        {
+          bestDot = dot;
+          best    = v;
+        }
+      }
+    }
+    else
+    {
+      best = hull.lastVertex;
+      int c = hull.corners[best];
+      bestDot = hull.x[c]*d[0] + hull.y[c]*d[1] + hull.z[c]*d[2];
+
+      // on a convex hull every local maximum of the support function is global
+      bool improved = true;
+      while(improved)
+      {
+        improved = false;
+        for(int k=hull.offsets[best]; k<hull.offsets[best+1]; k++)
+        {
+          int v = hull.neighbours[k];
+          c = hull.corners[v];
+          iREAL dot = hull.x[c]*d[0] + hull.y[c]*d[1] + hull.z[c]*d[2];
+          if(dot > bestDot)
+          {
+            bestDot  = dot;
+            best     = v;
+            improved = true;
+          }
+        }
+      }
+    }
+
+    hull.lastVertex = best;
+    return hull.corners[best];
+  }
+
+  template<typename T>
+  void supportPoint(Hull<T>& A, Hull<T>& B, const iREAL d[3], SupportPoint& p)
+  {
+    iREAL minusD[3] = {-d[0], -d[1], -d[2]};
+
+    int a = support(A, d);
+    int b = support(B, minusD);
+
+    p.a[0] = A.x[a]; p.a[1] = A.y[a]; p.a[2] = A.z[a];
+    p.b[0] = B.x[b]; p.b[1] = B.y[b]; p.b[2] = B.z[b];
+    SUB(p.a, p.b, p.w);
+  }
+
+  /*
+   * Closest point of the triangle (a,b,c) to the origin. Returns the
+   * barycentric coordinates (Ericson, Real-Time Collision Detection, 5.1.5).
+   */
+  void closestOnTriangle(const iREAL a[3], const iREAL b[3], const iREAL c[3], iREAL lambda[3])
+  {
+    iREAL ab[3], ac[3], ap[3], bp[3], cp[3];
+    SUB(b, a, ab);
+    SUB(c, a, ac);
+    ap[0] = -a[0]; ap[1] = -a[1]; ap[2] = -a[2];
+
+    iREAL d1 = DOT(ab, ap);
+    iREAL d2 = DOT(ac, ap);
+    if(d1 <= 0 && d2 <= 0)
+    {
+      lambda[0] = 1; lambda[1] = 0; lambda[2] = 0;
+      return;
+    }
+
+    bp[0] = -b[0]; bp[1] = -b[1]; bp[2] = -b[2];
+    iREAL d3 = DOT(ab, bp);
+    iREAL d4 = DOT(ac, bp);
+    if(d3 >= 0 && d4 <= d3)
+    {
+      lambda[0] = 0; lambda[1] = 1; lambda[2] = 0;
+      return;
+    }
+
+    iREAL vc = d1*d4 - d3*d2;
+    if(vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+      iREAL v = d1/(d1-d3);
+      lambda[0] = 1-v; lambda[1] = v; lambda[2] = 0;
+      return;
+    }
+
+    cp[0] = -c[0]; cp[1] = -c[1]; cp[2] = -c[2];
+    iREAL d5 = DOT(ab, cp);
+    iREAL d6 = DOT(ac, cp);
+    if(d6 >= 0 && d5 <= d6)
+    {
+      lambda[0] = 0; lambda[1] = 0; lambda[2] = 1;
+      return;
+    }
+
+    iREAL vb = d5*d2 - d1*d6;
+    if(vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+      iREAL w = d2/(d2-d6);
+      lambda[0] = 1-w; lambda[1] = 0; lambda[2] = w;
+      return;
+    }
+
+    iREAL va = d3*d6 - d5*d4;
+    if(va <= 0 && (d4-d3) >= 0 && (d5-d6) >= 0)
+    {
+      iREAL w = (d4-d3)/((d4-d3)+(d5-d6));
+      lambda[0] = 0; lambda[1] = 1-w; lambda[2] = w;
+      return;
+    }
+
+    iREAL denom = 1.0/(va+vb+vc);
+    lambda[1] = vb*denom;
+    lambda[2] = vc*denom;
+    lambda[0] = 1-lambda[1]-lambda[2];
+  }
+
+  /*
+   * Replaces the simplex by the sub-simplex that supports its point
+   * closest to the origin and returns that point in v. Returns true if
+   * the origin lies inside the (full) tetrahedron.
+   */
+  bool solveSimplex(SupportPoint s[4], int& n, iREAL v[3])
+  {
+    iREAL lambda[4] = {1, 0, 0, 0};
+
+    if(n == 2)
+    {
+      iREAL ab[3];
+      SUB(s[1].w, s[0].w, ab);
+      iREAL denom = DOT(ab, ab);
+      iREAL t = denom > 0 ? -DOT(s[0].w, ab)/denom : 0;
+      t = t < 0 ? 0 : (t > 1 ? 1 : t);
+      lambda[0] = 1-t;
+      lambda[1] = t;
+    }
+    else if(n == 3)
+    {
+      closestOnTriangle(s[0].w, s[1].w, s[2].w, lambda);
+    }
+    else if(n == 4)
+    {
+      static const int faces[4][4] = {{0,1,2,3}, {0,3,1,2}, {0,2,3,1}, {1,3,2,0}};
+
+      iREAL e1[3], e2[3], e3[3], cross[3];
+      SUB(s[1].w, s[0].w, e1);
+      SUB(s[2].w, s[0].w, e2);
+      SUB(s[3].w, s[0].w, e3);
+      PRODUCT(e1, e2, cross);
+      iREAL volume = DOT(cross, e3);
+      iREAL scale  = DOT(e1,e1)*sqrt(DOT(e2,e2)*DOT(e3,e3));
+      bool  flat   = fabs(volume) <= GJK_TOLERANCE*scale;
+
+      iREAL best = iREAL_MAX;
+      bool  outside = false;
+      for(int f=0; f<4; f++)
+      {
+        const iREAL *a = s[faces[f][0]].w, *b = s[faces[f][1]].w, *c = s[faces[f][2]].w, *d = s[faces[f][3]].w;
+        iREAL ab[3], ac[3], ad[3], normal[3];
+        SUB(b, a, ab);
+        SUB(c, a, ac);
+        SUB(d, a, ad);
+        PRODUCT(ab, ac, normal);
+
+        iREAL signOrigin   = -DOT(normal, a);
+        iREAL signOpposite = DOT(normal, ad);
+        if(!flat && signOrigin*signOpposite >= 0) continue;
+
+        outside = true;
+        iREAL mu[3], p[3];
+        closestOnTriangle(a, b, c, mu);
+        p[0] = mu[0]*a[0] + mu[1]*b[0] + mu[2]*c[0];
+        p[1] = mu[0]*a[1] + mu[1]*b[1] + mu[2]*c[1];
+        p[2] = mu[0]*a[2] + mu[1]*b[2] + mu[2]*c[2];
+        iREAL distance = DOT(p, p);
+        if(distance < best)
+        {
+          best = distance;
+          lambda[faces[f][0]] = mu[0];
+          lambda[faces[f][1]] = mu[1];
+          lambda[faces[f][2]] = mu[2];
+          lambda[faces[f][3]] = 0;
+        }
+      }
+
+      if(!outside)
+      {
+        v[0] = v[1] = v[2] = 0;
+        return true;
+      }
+    }
+
+    // drop the points that do not support the closest point
+    int m = 0;
+    v[0] = v[1] = v[2] = 0;
+    for(int i=0; i<n; i++)
+    {
+      if(lambda[i] <= 0) continue;
+      v[0] += lambda[i]*s[i].w[0];
+      v[1] += lambda[i]*s[i].w[1];
+      v[2] += lambda[i]*s[i].w[2];
+      s[m++] = s[i];
+    }
+    n = m;
+    return false;
+  }
+
+  void computeFace(SupportPoint* points, Face& face)
+  {
+    iREAL ab[3], ac[3];
+    SUB(points[face.v[1]].w, points[face.v[0]].w, ab);
+    SUB(points[face.v[2]].w, points[face.v[0]].w, ac);
+    PRODUCT(ab, ac, face.normal);
+    iREAL length = LEN(face.normal);
+    if(length <= 0)
+    {
+      face.distance = iREAL_MAX;
+      return;
+    }
+    SCALE(face.normal, 1.0/length);
+    face.distance = DOT(face.normal, points[face.v[0]].w);
+  }
+
+  /*
+   * Grows a degenerate GJK simplex that touches the origin into a
+   * tetrahedron, so that EPA has a volume to start from.
+   */
+  template<typename T>
+  bool completeTetrahedron(Hull<T>& A, Hull<T>& B, SupportPoint s[4], int& n)
+  {
+    static const iREAL axes[6][3] = {{1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1}};
+
+    while(n < 4)
+    {
+      iREAL directions[6][3];
+      int numberOfDirections = 0;
+
+      if(n == 1)
+      {
+        for(int i=0; i<6; i++) COPY(axes[i], directions[i]);
+        numberOfDirections = 6;
+      }
+      else if(n == 2)
+      {
+        iREAL ab[3];
+        SUB(s[1].w, s[0].w, ab);
+        for(int i=0; i<6; i+=2)
+        {
+          PRODUCT(ab, axes[i], directions[numberOfDirections]);
+          COPY(directions[numberOfDirections], directions[numberOfDirections+1]);
+          SCALE(directions[numberOfDirections+1], -1.0);
+          numberOfDirections += 2;
+        }
+      }
+      else
+      {
+        iREAL ab[3], ac[3];
+        SUB(s[1].w, s[0].w, ab);
+        SUB(s[2].w, s[0].w, ac);
+        PRODUCT(ab, ac, directions[0]);
+        COPY(directions[0], directions[1]);
+        SCALE(directions[1], -1.0);
+        numberOfDirections = 2;
+      }
+
+      bool added = false;
+      for(int i=0; i<numberOfDirections && !added; i++)
+      {
+        if(DOT(directions[i], directions[i]) <= 0) continue;
+
+        SupportPoint p;
+        supportPoint(A, B, directions[i], p);
+
+        // the new point has to leave the affine hull of the simplex
+        iREAL offset[3];
+        SUB(p.w, s[0].w, offset);
+        if(fabs(DOT(offset, directions[i])) <= GJK_TOLERANCE*LEN(directions[i])*(1.0+LEN(p.w))) continue;
+        if(n == 1 && DOT(offset, offset) <= GJK_TOLERANCE*(1.0+DOT(p.w,p.w))) continue;
+
+        s[n++] = p;
+        added = true;
+      }
+      if(!added) return false;
+    }
+    return true;
+  }
+
+  /*
+   * Expanding polytope algorithm. Expects a tetrahedron that contains
+   * the origin and returns the penetration depth together with the
+   * witness points and the normal pointing from B to A.
+   */
+  template<typename T>
+  iREAL epa(Hull<T>& A, Hull<T>& B, SupportPoint s[4], iREAL PA[3], iREAL PB[3], iREAL normal[3])
+  {
+    SupportPoint points[EPA_MAX_POINTS];
+    Face         faces[EPA_MAX_FACES];
+    int          numberOfPoints = 4;
+    int          numberOfFaces  = 4;
+
+    for(int i=0; i<4; i++) points[i] = s[i];
+
+    static const int tetrahedron[4][4] = {{0,1,2,3}, {0,3,1,2}, {0,2,3,1}, {1,3,2,0}};
+    for(int f=0; f<4; f++)
+    {
+      faces[f].v[0] = tetrahedron[f][0];
+      faces[f].v[1] = tetrahedron[f][1];
+      faces[f].v[2] = tetrahedron[f][2];
+
+      // orient outwards, away from the opposite vertex
+      iREAL ab[3], ac[3], ad[3], n[3];
+      SUB(points[faces[f].v[1]].w, points[faces[f].v[0]].w, ab);
+      SUB(points[faces[f].v[2]].w, points[faces[f].v[0]].w, ac);
+      SUB(points[tetrahedron[f][3]].w, points[faces[f].v[0]].w, ad);
+      PRODUCT(ab, ac, n);
+      if(DOT(n, ad) > 0)
+      {
+        faces[f].v[1] = tetrahedron[f][2];
+        faces[f].v[2] = tetrahedron[f][1];
+      }
+      computeFace(points, faces[f]);
+    }
+
+    int closest = 0;
+    for(int iteration=0; iteration<EPA_MAX_ITERATIONS; iteration++)
+    {
+      closest = 0;
+      for(int f=1; f<numberOfFaces; f++)
+      {
+        if(faces[f].distance < faces[closest].distance) closest = f;
+      }
+
+      SupportPoint p;
+      supportPoint(A, B, faces[closest].normal, p);
+
+      iREAL distance = DOT(faces[closest].normal, p.w);
+      if(distance - faces[closest].distance <= EPA_TOLERANCE*(1.0+fabs(distance))) break;
+      if(numberOfPoints == EPA_MAX_POINTS) break;
+
+      // remove all faces that see the new point and remember the horizon
+      int horizon[EPA_MAX_FACES][2];
+      int numberOfEdges = 0;
+      bool overflow = false;
+
+      for(int f=0; f<numberOfFaces; )
+      {
+        iREAL offset[3];
+        SUB(p.w, points[faces[f].v[0]].w, offset);
+        if(DOT(faces[f].normal, offset) <= 0)
+        {
+          f++;
+          continue;
+        }
+
+        for(int e=0; e<3; e++)
+        {
+          int a = faces[f].v[e];
+          int b = faces[f].v[(e+1)%3];
+
+          bool shared = false;
+          for(int k=0; k<numberOfEdges; k++)
+          {
+            if(horizon[k][0] == b && horizon[k][1] == a)
+            {
+              horizon[k][0] = horizon[numberOfEdges-1][0];
+              horizon[k][1] = horizon[numberOfEdges-1][1];
+              numberOfEdges--;
+              shared = true;
+              break;
+            }
+          }
+          if(!shared)
+          {
+            if(numberOfEdges == EPA_MAX_FACES)
+            {
+              overflow = true;
+              break;
+            }
+            horizon[numberOfEdges][0] = a;
+            horizon[numberOfEdges][1] = b;
+            numberOfEdges++;
+          }
+        }
+
+        faces[f] = faces[numberOfFaces-1];
+        numberOfFaces--;
+      }
+
+      if(overflow || numberOfFaces + numberOfEdges > EPA_MAX_FACES)
+      {
+        // out of space, the polytope is broken, keep the last estimate
+        numberOfFaces = 0;
+        break;
+      }
+
+      points[numberOfPoints] = p;
+      for(int k=0; k<numberOfEdges; k++)
+      {
+        faces[numberOfFaces].v[0] = horizon[k][0];
+        faces[numberOfFaces].v[1] = horizon[k][1];
+        faces[numberOfFaces].v[2] = numberOfPoints;
+        computeFace(points, faces[numberOfFaces]);
+        numberOfFaces++;
+      }
+      numberOfPoints++;
+    }
+
+    if(numberOfFaces == 0)
+    {
+      // fall back to the deepest point of the initial tetrahedron
+      COPY(s[0].a, PA);
+      COPY(s[0].b, PB);
+      iREAL length = LEN(s[0].w);
+      if(length > 0)
+      {
+        normal[0] = -s[0].w[0]/length;
+        normal[1] = -s[0].w[1]/length;
+        normal[2] = -s[0].w[2]/length;
+      }
+      else
+      {
+        normal[0] = 0; normal[1] = 1; normal[2] = 0;
+      }
+      return length;
+    }
+
+    Face& face = faces[closest];
+
+    // barycentric coordinates of the projection of the origin onto the face
+    iREAL q[3] = {face.normal[0]*face.distance, face.normal[1]*face.distance, face.normal[2]*face.distance};
+    const iREAL *a = points[face.v[0]].w, *b = points[face.v[1]].w, *c = points[face.v[2]].w;
+    iREAL v0[3], v1[3], v2[3];
+    SUB(b, a, v0);
+    SUB(c, a, v1);
+    SUB(q, a, v2);
+    iREAL d00 = DOT(v0,v0), d01 = DOT(v0,v1), d11 = DOT(v1,v1), d20 = DOT(v2,v0), d21 = DOT(v2,v1);
+    iREAL denom = d00*d11 - d01*d01;
+    iREAL lambda[3] = {1, 0, 0};
+    if(denom > 0)
+    {
+      lambda[1] = (d11*d20 - d01*d21)/denom;
+      lambda[2] = (d00*d21 - d01*d20)/denom;
+      lambda[0] = 1 - lambda[1] - lambda[2];
+    }
+
+    for(int i=0; i<3; i++)
+    {
+      PA[i] = lambda[0]*points[face.v[0]].a[i] + lambda[1]*points[face.v[1]].a[i] + lambda[2]*points[face.v[2]].a[i];
+      PB[i] = lambda[0]*points[face.v[0]].b[i] + lambda[1]*points[face.v[1]].b[i] + lambda[2]*points[face.v[2]].b[i];
+    }
+
+    // translating A by -depth*normal(face) separates the hulls
+    normal[0] = -face.normal[0];
+    normal[1] = -face.normal[1];
+    normal[2] = -face.normal[2];
+
+    return face.distance;
+  }
+  /*
+   * The vertices of a hull that lie within shell of its extreme along d,
+   * the cap of the hull that faces the other one. On a convex hull the
+   * cap is connected, so large hulls flood it from the support vertex
+   * over the vertex adjacency. Returns the number of vertices, -1 if
+   * there are more than MANIFOLD_MAX_VERTICES.
+   */
+  template<typename T>
+  int cap(Hull<T>& hull, const iREAL d[3], iREAL shell, int vertices[MANIFOLD_MAX_VERTICES])
+  {
+    support(hull, d);
+    int c = hull.corners[hull.lastVertex];
+    const iREAL extreme = hull.x[c]*d[0] + hull.y[c]*d[1] + hull.z[c]*d[2];
+    int n = 0;
+
+    if(hull.offsets == nullptr || hull.numberOfVertices <= GJK_HILLCLIMBING_THRESHOLD)
+    {
+      for(int v=0; v<hull.numberOfVertices; v++)
+      {
+        c = hull.corners[v];
+        if(c < 0) continue;
+        if(extreme - (hull.x[c]*d[0] + hull.y[c]*d[1] + hull.z[c]*d[2]) > shell) continue;
+        if(n == MANIFOLD_MAX_VERTICES) return -1;
+        vertices[n++] = v;
+      }
+      return n;
+    }
+
+    vertices[n++] = hull.lastVertex;
+    for(int i=0; i<n; i++)
+    {
+      for(int k=hull.offsets[vertices[i]]; k<hull.offsets[vertices[i]+1]; k++)
+      {
+        const int v = hull.neighbours[k];
+        c = hull.corners[v];
+        if(c < 0) continue;
+        if(extreme - (hull.x[c]*d[0] + hull.y[c]*d[1] + hull.z[c]*d[2]) > shell) continue;
+
+        bool known = false;
+        for(int j=0; j<n && !known; j++) known = vertices[j] == v;
+        if(known) continue;
+        if(n == MANIFOLD_MAX_VERTICES) return -1;
+        vertices[n++] = v;
+      }
+    }
+    return n;
+  }
+
+  /*
+   * A cap projected onto the contact plane, reduced to its convex hull
+   * in counter-clockwise order: a polygon, a segment or a point.
+   */
+  struct Polygon
+  {
+    int   n;
+    int   vertex[MANIFOLD_MAX_VERTICES];
+    iREAL p[MANIFOLD_MAX_VERTICES][3];
+    iREAL q[MANIFOLD_MAX_VERTICES][2];
+  };
+
+  iREAL cross(const iREAL o[2], const iREAL a[2], const iREAL b[2])
+  {
+    return (a[0]-o[0])*(b[1]-o[1]) - (a[1]-o[1])*(b[0]-o[0]);
+  }
+
+  template<typename T>
+  void project(Hull<T>& hull, const int* vertices, int n, const iREAL t[2][3], Polygon& polygon)
+  {
+    // sorted by their plane coordinates, for the monotone chain
+    Polygon sorted;
+    for(int i=0; i<n; i++)
+    {
+      const int c = hull.corners[vertices[i]];
+      const iREAL p[3] = {iREAL(hull.x[c]), iREAL(hull.y[c]), iREAL(hull.z[c])};
+      const iREAL q[2] = {DOT(t[0], p), DOT(t[1], p)};
+
+      int k = i;
+      while(k > 0 && (sorted.q[k-1][0] > q[0] || (sorted.q[k-1][0] == q[0] && sorted.q[k-1][1] > q[1])))
+      {
+        sorted.vertex[k] = sorted.vertex[k-1];
+        COPY(sorted.p[k-1], sorted.p[k]);
+        sorted.q[k][0] = sorted.q[k-1][0];
+        sorted.q[k][1] = sorted.q[k-1][1];
+        k--;
+      }
+      sorted.vertex[k] = vertices[i];
+      COPY(p, sorted.p[k]);
+      sorted.q[k][0] = q[0];
+      sorted.q[k][1] = q[1];
+    }
+
+    // Andrew's monotone chain, lower hull then upper hull
+    int hull2d[2*MANIFOLD_MAX_VERTICES];
+    int m = 0;
+    for(int pass=0; pass<2; pass++)
+    {
+      const int start = m;
+      for(int k=0; k<n; k++)
+      {
+        const int i = pass == 0 ? k : n-1-k;
+        while(m >= start+2 && cross(sorted.q[hull2d[m-2]], sorted.q[hull2d[m-1]], sorted.q[i]) <= 0) m--;
+        hull2d[m++] = i;
+      }
+      m--;
+    }
+    if(n == 1) m = 1;
+    // all points in one spot or on one line leave a point or a segment
+    if(m == 2 && sorted.q[hull2d[0]][0] == sorted.q[hull2d[1]][0] && sorted.q[hull2d[0]][1] == sorted.q[hull2d[1]][1]) m = 1;
+
+    polygon.n = m;
+    for(int k=0; k<m; k++)
+    {
+      const int i = hull2d[k];
+      polygon.vertex[k] = sorted.vertex[i];
+      COPY(sorted.p[i], polygon.p[k]);
+      polygon.q[k][0] = sorted.q[i][0];
+      polygon.q[k][1] = sorted.q[i][1];
+    }
+  }
+
+  bool inside(const Polygon& polygon, const iREAL q[2], iREAL tolerance)
+  {
+    if(polygon.n < 3) return false;
+    for(int k=0; k<polygon.n; k++)
+    {
+      const iREAL* a = polygon.q[k];
+      const iREAL* b = polygon.q[(k+1)%polygon.n];
+      const iREAL length = std::sqrt((b[0]-a[0])*(b[0]-a[0]) + (b[1]-a[1])*(b[1]-a[1]));
+      if(cross(a, b, q) < -tolerance*length) return false;
+    }
+    return true;
+  }
+
+  /*
+   * Distance along normal from the plane of the polygon to p, negative
+   * on the far side. False if the plane is parallel to the normal.
+   */
+  bool heightAbove(const Polygon& polygon, const iREAL normal[3], const iREAL p[3], iREAL& height)
+  {
+    // Newell's normal and the centroid are robust for flat polygons
+    iREAL m[3] = {0, 0, 0};
+    iREAL centre[3] = {0, 0, 0};
+    for(int k=0; k<polygon.n; k++)
+    {
+      const iREAL* a = polygon.p[k];
+      const iREAL* b = polygon.p[(k+1)%polygon.n];
+      m[0] += (a[1]-b[1])*(a[2]+b[2]);
+      m[1] += (a[2]-b[2])*(a[0]+b[0]);
+      m[2] += (a[0]-b[0])*(a[1]+b[1]);
+      centre[0] += a[0]/polygon.n; centre[1] += a[1]/polygon.n; centre[2] += a[2]/polygon.n;
+    }
+    const iREAL mn = DOT(m, normal);
+    if(fabs(mn) <= 1E-6*LEN(m)) return false;
+    iREAL offset[3];
+    SUB(p, centre, offset);
+    height = DOT(m, offset)/mn;
+    return true;
+  }
+
+  struct ManifoldPoint
+  {
+    iREAL a[3];
+    iREAL b[3];
+    iREAL distance;
+    int   feature;
+  };
+
+  /*
+   * Contact manifold of two convex hulls closer than epsilon along the
+   * normal from B to A. The caps of both hulls within the contact shell
+   * are projected onto the contact plane and clipped against each
+   * other: every vertex of one cap over the other and every crossing of
+   * their edges is a contact point with its own distance. Face on face
+   * gives the corners of the overlap, edge on face the ends of the
+   * edge, two edges their crossing. The features number the vertices of
+   * A and B and the pairs of edges, so the points are recognised in the
+   * next step. Returns the number of points, 0 if a cap is too large.
+   */
+  template<typename T>
+  int manifold(Hull<T>& A, Hull<T>& B, const iREAL normal[3], iREAL distance, iREAL epsilon, ManifoldPoint points[MANIFOLD_MAX_POINTS])
+  {
+    const iREAL shell = epsilon - distance;
+    const iREAL minusNormal[3] = {-normal[0], -normal[1], -normal[2]};
+
+    int verticesA[MANIFOLD_MAX_VERTICES], verticesB[MANIFOLD_MAX_VERTICES];
+    const int capA = cap(A, minusNormal, shell, verticesA);
+    const int capB = cap(B, normal, shell, verticesB);
+    if(capA <= 0 || capB <= 0) return 0;
+
+    // the contact plane, spanned by t[0] and t[1]
+    iREAL t[2][3];
+    const iREAL axis[3] = {fabs(normal[0]) < 0.6 ? 1.0 : 0.0, fabs(normal[0]) < 0.6 ? 0.0 : 1.0, 0.0};
+    PRODUCT(normal, axis, t[0]);
+    SCALE(t[0], 1.0/LEN(t[0]));
+    PRODUCT(normal, t[0], t[1]);
+
+    Polygon a, b;
+    project(A, verticesA, capA, t, a);
+    project(B, verticesB, capB, t, b);
+
+    const iREAL tolerance = 1E-6*(1.0 + epsilon);
+    int n = 0;
+    auto add = [&](const iREAL pa[3], const iREAL pb[3], iREAL d, int feature)
+    {
+      if(d >= epsilon || n == MANIFOLD_MAX_POINTS) return;
+      for(int k=0; k<n; k++)
+      {
+        iREAL offset[3];
+        SUB(points[k].a, pa, offset);
+        if(fabs(DOT(t[0], offset)) <= tolerance && fabs(DOT(t[1], offset)) <= tolerance) return;
+      }
+      COPY(pa, points[n].a);
+      COPY(pb, points[n].b);
+      points[n].distance = d;
+      points[n].feature  = feature;
+      n++;
+    };
+
+    // vertices of A over the face of B, and of B under the face of A
+    iREAL height;
+    for(int k=0; k<a.n; k++)
+    {
+      if(!inside(b, a.q[k], tolerance) || !heightAbove(b, normal, a.p[k], height)) continue;
+      const iREAL pb[3] = {a.p[k][0]-height*normal[0], a.p[k][1]-height*normal[1], a.p[k][2]-height*normal[2]};
+      add(a.p[k], pb, height, 1 + 3*a.vertex[k] + 1);
+    }
+    for(int k=0; k<b.n; k++)
+    {
+      if(!inside(a, b.q[k], tolerance) || !heightAbove(a, normal, b.p[k], height)) continue;
+      const iREAL pa[3] = {b.p[k][0]-height*normal[0], b.p[k][1]-height*normal[1], b.p[k][2]-height*normal[2]};
+      add(pa, b.p[k], -height, 1 + 3*b.vertex[k] + 2);
+    }
+
+    // crossings of the edges, a segment has one edge, a point none
+    const int edgesA = a.n < 3 ? a.n-1 : a.n;
+    const int edgesB = b.n < 3 ? b.n-1 : b.n;
+    for(int i=0; i<edgesA; i++)
+    {
+      const int i1 = (i+1)%a.n;
+      const iREAL r[2] = {a.q[i1][0]-a.q[i][0], a.q[i1][1]-a.q[i][1]};
+      for(int j=0; j<edgesB; j++)
+      {
+        const int j1 = (j+1)%b.n;
+        const iREAL s[2] = {b.q[j1][0]-b.q[j][0], b.q[j1][1]-b.q[j][1]};
+        const iREAL denominator = r[0]*s[1] - r[1]*s[0];
+        if(fabs(denominator) <= GJK_TOLERANCE*(r[0]*r[0]+r[1]*r[1]+s[0]*s[0]+s[1]*s[1])) continue;
+
+        const iREAL w[2] = {b.q[j][0]-a.q[i][0], b.q[j][1]-a.q[i][1]};
+        const iREAL alpha = (w[0]*s[1] - w[1]*s[0])/denominator;
+        const iREAL beta  = (w[0]*r[1] - w[1]*r[0])/denominator;
+        if(alpha < 0 || alpha > 1 || beta < 0 || beta > 1) continue;
+
+        iREAL pa[3], pb[3];
+        for(int d=0; d<3; d++)
+        {
+          pa[d] = a.p[i][d] + alpha*(a.p[i1][d]-a.p[i][d]);
+          pb[d] = b.p[j][d] + beta*(b.p[j1][d]-b.p[j][d]);
+        }
+        iREAL offset[3];
+        SUB(pa, pb, offset);
+        const unsigned key = (unsigned(a.vertex[i])*65599u + unsigned(b.vertex[j])) & 0x1FFFFFFFu;
+        add(pa, pb, DOT(normal, offset), 1 + 3*int(key));
+      }
+    }
+    return n;
+  }
+}
+
+template<typename T>
+iREAL demolish::detection::convexDistance(
+  const T*        xCoordinatesOfPointsOfGeometryA,
+  const T*        yCoordinatesOfPointsOfGeometryA,
+  const T*        zCoordinatesOfPointsOfGeometryA,
+  const int*      vertexCornersA,
+  const int       numberOfVerticesA,
+  const int*      neighbourOffsetsA,
+  const int*      neighboursA,
+
+  const T*        xCoordinatesOfPointsOfGeometryB,
+  const T*        yCoordinatesOfPointsOfGeometryB,
+  const T*        zCoordinatesOfPointsOfGeometryB,
+  const int*      vertexCornersB,
+  const int       numberOfVerticesB,
+  const int*      neighbourOffsetsB,
+  const int*      neighboursB,
+
+  iREAL           PA[3],
+  iREAL           PB[3],
+  iREAL           normal[3])
+{
+  Hull<T> A = {xCoordinatesOfPointsOfGeometryA, yCoordinatesOfPointsOfGeometryA, zCoordinatesOfPointsOfGeometryA,
+            vertexCornersA, numberOfVerticesA, neighbourOffsetsA, neighboursA, 0};
+  Hull<T> B = {xCoordinatesOfPointsOfGeometryB, yCoordinatesOfPointsOfGeometryB, zCoordinatesOfPointsOfGeometryB,
+            vertexCornersB, numberOfVerticesB, neighbourOffsetsB, neighboursB, 0};
+
+  SupportPoint s[4];
+  int n = 1;
+  iREAL v[3] = {1, 0, 0};
+
+  supportPoint(A, B, v, s[0]);
+  COPY(s[0].w, v);
+
+  bool intersect = DOT(v, v) <= 0;
+
+  for(int iteration=0; iteration<GJK_MAX_ITERATIONS && !intersect; iteration++)
+  {
+    iREAL minusV[3] = {-v[0], -v[1], -v[2]};
+    SupportPoint p;
+    supportPoint(A, B, minusV, p);
+
+    // no progress towards the origin: v is the closest point
+    iREAL vv = DOT(v, v);
+    if(vv - DOT(v, p.w) <= GJK_TOLERANCE*vv) break;
+
+    bool duplicate = false;
+    for(int i=0; i<n; i++)
+    {
+      if(s[i].w[0] == p.w[0] && s[i].w[1] == p.w[1] && s[i].w[2] == p.w[2]) duplicate = true;
+    }
+    if(duplicate) break;
+
+    s[n++] = p;
+    intersect = solveSimplex(s, n, v);
+
+    iREAL maxww = 0;
+    for(int i=0; i<n; i++) maxww = MAX(maxww, DOT(s[i].w, s[i].w));
+    if(DOT(v, v) <= GJK_TOLERANCE*GJK_TOLERANCE*maxww) intersect = true;
+  }
+
+  if(!intersect)
+  {
+    // s is already reduced to the sub-simplex supporting v
+    iREAL lambda[4] = {1, 0, 0, 0};
+    if(n == 2)
+    {
+      iREAL ab[3];
+      SUB(s[1].w, s[0].w, ab);
+      iREAL denom = DOT(ab, ab);
+      iREAL t = denom > 0 ? -DOT(s[0].w, ab)/denom : 0;
+      t = t < 0 ? 0 : (t > 1 ? 1 : t);
+      lambda[0] = 1-t;
+      lambda[1] = t;
+    }
+    else if(n == 3)
+    {
+      closestOnTriangle(s[0].w, s[1].w, s[2].w, lambda);
+    }
+
+    PA[0] = PA[1] = PA[2] = 0;
+    PB[0] = PB[1] = PB[2] = 0;
+    for(int i=0; i<n; i++)
+    {
+      PA[0] += lambda[i]*s[i].a[0]; PA[1] += lambda[i]*s[i].a[1]; PA[2] += lambda[i]*s[i].a[2];
+      PB[0] += lambda[i]*s[i].b[0]; PB[1] += lambda[i]*s[i].b[1]; PB[2] += lambda[i]*s[i].b[2];
+    }
+
+    iREAL distance = LEN(v);
+    normal[0] = v[0]/distance;
+    normal[1] = v[1]/distance;
+    normal[2] = v[2]/distance;
+    return distance;
+  }
+
+  if(!completeTetrahedron(A, B, s, n))
+  {
+    // the hulls touch in a point, an edge or a face without overlapping,
+    // so separate along the line between the vertex centroids
+    iREAL centre[3] = {0, 0, 0};
+    for(int v=0; v<A.numberOfVertices; v++)
+    {
+      int c = A.corners[v];
+      if(c < 0) continue;
+      centre[0] += A.x[c]/A.numberOfVertices; centre[1] += A.y[c]/A.numberOfVertices; centre[2] += A.z[c]/A.numberOfVertices;
+    }
+    for(int v=0; v<B.numberOfVertices; v++)
+    {
+      int c = B.corners[v];
+      if(c < 0) continue;
+      centre[0] -= B.x[c]/B.numberOfVertices; centre[1] -= B.y[c]/B.numberOfVertices; centre[2] -= B.z[c]/B.numberOfVertices;
+    }
+    iREAL length = LEN(centre);
+    normal[0] = length > 0 ? centre[0]/length : 0;
+    normal[1] = length > 0 ? centre[1]/length : 1;
+    normal[2] = length > 0 ? centre[2]/length : 0;
+    COPY(s[0].a, PA);
+    COPY(s[0].b, PB);
+    return 0;
+  }
+
+  return -epa(A, B, s, PA, PB, normal);
+}
+
+template<typename T>
+void demolish::detection::gjk(
+  const T*        xCoordinatesOfPointsOfGeometryA,
+  const T*        yCoordinatesOfPointsOfGeometryA,
+  const T*        zCoordinatesOfPointsOfGeometryA,
+  const int*      vertexCornersA,
+  const int       numberOfVerticesA,
+  const int*      neighbourOffsetsA,
+  const int*      neighboursA,
+  const iREAL     epsilonA,
+  const bool      frictionA,
+  const int	  	  particleA,
+
+  const T*        xCoordinatesOfPointsOfGeometryB,
+  const T*        yCoordinatesOfPointsOfGeometryB,
+  const T*        zCoordinatesOfPointsOfGeometryB,
+  const int*      vertexCornersB,
+  const int       numberOfVerticesB,
+  const int*      neighbourOffsetsB,
+  const int*      neighboursB,
+  const iREAL     epsilonB,
+  const bool      frictionB,
+  const int		  particleB,
+
+  std::vector<demolish::ContactPoint>& contactpoints)
+{
+  iREAL PA[3], PB[3], normal[3];
+  iREAL distance = convexDistance(xCoordinatesOfPointsOfGeometryA,
+                                  yCoordinatesOfPointsOfGeometryA,
+                                  zCoordinatesOfPointsOfGeometryA,
+                                  vertexCornersA,
+                                  numberOfVerticesA,
+                                  neighbourOffsetsA,
+                                  neighboursA,
+                                  xCoordinatesOfPointsOfGeometryB,
+                                  yCoordinatesOfPointsOfGeometryB,
+                                  zCoordinatesOfPointsOfGeometryB,
+                                  vertexCornersB,
+                                  numberOfVerticesB,
+                                  neighbourOffsetsB,
+                                  neighboursB,
+                                  PA, PB, normal);
+
+  if(distance >= epsilonA+epsilonB) return;
+
+  bool fric = bool(frictionA == true && frictionB == true);
+
+  // faces and edges that rest on each other carry more than one point
+  Hull<T> A = {xCoordinatesOfPointsOfGeometryA, yCoordinatesOfPointsOfGeometryA, zCoordinatesOfPointsOfGeometryA,
+            vertexCornersA, numberOfVerticesA, neighbourOffsetsA, neighboursA, 0};
+  Hull<T> B = {xCoordinatesOfPointsOfGeometryB, yCoordinatesOfPointsOfGeometryB, zCoordinatesOfPointsOfGeometryB,
+            vertexCornersB, numberOfVerticesB, neighbourOffsetsB, neighboursB, 0};
+  ManifoldPoint points[MANIFOLD_MAX_POINTS];
+  const int numberOfPoints = manifold(A, B, normal, distance, epsilonA+epsilonB, points);
+  for(int i=0; i<numberOfPoints; i++)
+  {
+    demolish::ContactPoint newContactPoint(points[i].a[0], points[i].a[1], points[i].a[2],
+                                           points[i].b[0], points[i].b[1], points[i].b[2],
+                                           true,
+                                           epsilonA,
+                                           epsilonB,
+                                           particleA,
+                                           particleB,
+                                           fric);
+    newContactPoint.normal[0] = normal[0];
+    newContactPoint.normal[1] = normal[1];
+    newContactPoint.normal[2] = normal[2];
+    newContactPoint.distance  = points[i].distance;
+    newContactPoint.depth     = (epsilonA+epsilonB)-points[i].distance;
+    newContactPoint.feature   = points[i].feature;
+    contactpoints.push_back(newContactPoint);
+  }
+  if(numberOfPoints > 0) return;
+
+  // a cap too large for the manifold, the deepest point only
+  demolish::ContactPoint newContactPoint(PA[0], PA[1], PA[2],
+                                         PB[0], PB[1], PB[2],
+                                         true,
+                                         epsilonA,
+                                         epsilonB,
+                                         particleA,
+                                         particleB,
+                                         fric);
+
+  // the witness points coincide or cross over once the hulls overlap,
+  // so take normal and distance from the query rather than from PA-PB
+  newContactPoint.normal[0] = normal[0];
+  newContactPoint.normal[1] = normal[1];
+  newContactPoint.normal[2] = normal[2];
+  newContactPoint.distance  = distance;
+  newContactPoint.depth     = (epsilonA+epsilonB)-distance;
+
+  contactpoints.push_back(newContactPoint);
+}
+
+#define DEMOLISH_INSTANTIATE_GJK(T) \
+  template void demolish::detection::gjk<T>( \
+    const T*, const T*, const T*, const int*, const int, const int*, const int*, const iREAL, const bool, const int, \
+    const T*, const T*, const T*, const int*, const int, const int*, const int*, const iREAL, const bool, const int, \
+    std::vector<demolish::ContactPoint>&); \
+  template iREAL demolish::detection::convexDistance<T>( \
+    const T*, const T*, const T*, const int*, const int, const int*, const int*, \
+    const T*, const T*, const T*, const int*, const int, const int*, const int*, \
+    iREAL*, iREAL*, iREAL*);
+
+DEMOLISH_INSTANTIATE_GJK(float)
+DEMOLISH_INSTANTIATE_GJK(double)
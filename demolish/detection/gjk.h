@@ -0,0 +1,103 @@
+#ifndef DEMOLISH_CONTACT_DETECTION_GJK_H_
+#define DEMOLISH_CONTACT_DETECTION_GJK_H_
+
+#include "../ContactPoint.h"
+#include <vector>
+
+namespace demolish {
+    namespace detection {
+
+	  /*
+	   *  GJK/EPA
+	   *
+	   *  Narrow phase for a pair of convex meshes. The GJK distance
+	   *  query finds the closest points of the two hulls; if the hulls
+	   *  overlap, EPA gives the penetration depth. Both only touch the
+	   *  mesh vertices through a support mapping, so the cost is
+	   *  independent of the number of triangle pairs.
+	   *
+	   *  The support mapping scans all vertices of small hulls and
+	   *  hill-climbs over the vertex adjacency of large ones (see
+	   *  Mesh::getVertexNeighbourOffsets).
+	   *
+	   *  The coordinates have the scalar type T (float or double); the
+	   *  simplex and polytope arithmetic always runs in iREAL.
+	   *
+	   *  A face or edge that rests on the other hull gets a contact
+	   *  manifold: the vertices of both hulls within the contact shell
+	   *  are projected onto the contact plane and clipped against each
+	   *  other. Every vertex over the other hull and every crossing of
+	   *  edges is a point with its own distance and a feature that
+	   *  identifies it in the next step. All share the normal of the
+	   *  query. If a cap has more than 16 vertices only the deepest
+	   *  point is reported.
+	   *
+	   *  @param xCoordinatesOfPointsOfGeometryA : flattened spatial x coordinates of A
+	   *  @param vertexCornersA                 : unique vertex to flattened corner map of A
+	   *  @param numberOfVerticesA              : number of unique vertices of A
+	   *  @param neighbourOffsetsA              : vertex adjacency offsets of A (may be nullptr)
+	   *  @param neighboursA                    : vertex adjacency of A (may be nullptr)
+	   *  @param contactpoints                  : buffer the contact points are appended to
+	   */
+	  template<typename T>
+	  void gjk(
+		const T*        xCoordinatesOfPointsOfGeometryA,
+		const T*        yCoordinatesOfPointsOfGeometryA,
+		const T*        zCoordinatesOfPointsOfGeometryA,
+		const int*      vertexCornersA,
+		const int       numberOfVerticesA,
+		const int*      neighbourOffsetsA,
+		const int*      neighboursA,
+		const iREAL     epsilonA,
+		const bool      frictionA,
+		const int 	    particleA,
+
+		const T*        xCoordinatesOfPointsOfGeometryB,
+		const T*        yCoordinatesOfPointsOfGeometryB,
+		const T*        zCoordinatesOfPointsOfGeometryB,
+		const int*      vertexCornersB,
+		const int       numberOfVerticesB,
+		const int*      neighbourOffsetsB,
+		const int*      neighboursB,
+		const iREAL     epsilonB,
+		const bool      frictionB,
+		const int       particleB,
+
+		std::vector<demolish::ContactPoint>& contactpoints
+		);
+
+	  /*
+	   *  Convex Distance
+	   *
+	   *  Signed distance between two convex hulls. Positive values are
+	   *  the separation, negative values the penetration depth found by
+	   *  EPA. PA and PB are the witness points on A and B; normal points
+	   *  from B to A.
+	   *
+	   *  @returns signed distance
+	   */
+	  template<typename T>
+	  iREAL convexDistance(
+		const T*        xCoordinatesOfPointsOfGeometryA,
+		const T*        yCoordinatesOfPointsOfGeometryA,
+		const T*        zCoordinatesOfPointsOfGeometryA,
+		const int*      vertexCornersA,
+		const int       numberOfVerticesA,
+		const int*      neighbourOffsetsA,
+		const int*      neighboursA,
+
+		const T*        xCoordinatesOfPointsOfGeometryB,
+		const T*        yCoordinatesOfPointsOfGeometryB,
+		const T*        zCoordinatesOfPointsOfGeometryB,
+		const int*      vertexCornersB,
+		const int       numberOfVerticesB,
+		const int*      neighbourOffsetsB,
+		const int*      neighboursB,
+
+		iREAL           PA[3],
+		iREAL           PB[3],
+		iREAL           normal[3]);
+	}
+}
+
+#endif
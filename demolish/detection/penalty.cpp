@@ -1,156 +1,224 @@
 #include"penalty.h"
+#include"../profile.h"
 #include<algorithm>
 
 int  MaxNumberOfNewtonIterations =  120;
-std::vector<demolish::ContactPoint> demolish::detection::penalty(
-  const iREAL*    xCoordinatesOfPointsOfGeometryA,
-  const iREAL*    yCoordinatesOfPointsOfGeometryA,
-  const iREAL*    zCoordinatesOfPointsOfGeometryA,
+template<typename T>
+void demolish::detection::penalty(
+  const T*        xCoordinatesOfPointsOfGeometryA,
+  const T*        yCoordinatesOfPointsOfGeometryA,
+  const T*        zCoordinatesOfPointsOfGeometryA,
   const int       numberOfTrianglesOfGeometryA,
   const iREAL     epsilonA,
   const bool      frictionA,
   const int	  	  particleA,
 
-  const iREAL*    xCoordinatesOfPointsOfGeometryB,
-  const iREAL*    yCoordinatesOfPointsOfGeometryB,
-  const iREAL*    zCoordinatesOfPointsOfGeometryB,
+  const T*        xCoordinatesOfPointsOfGeometryB,
+  const T*        yCoordinatesOfPointsOfGeometryB,
+  const T*        zCoordinatesOfPointsOfGeometryB,
   const int       numberOfTrianglesOfGeometryB,
   const iREAL     epsilonB,
   const bool      frictionB,
-  const int		  particleB
+  const int		  particleB,
+
+  std::vector<demolish::ContactPoint>& contactpoints
 )
 {
-  std::vector<demolish::ContactPoint>  result;
-  std::vector<iREAL> distanceVector;
-  std::vector<demolish::ContactPoint> cnps;
+  // scratch for the triangle geometry, kept per thread between calls
+  thread_local std::vector<TriangleGeometry<T>> trianglesA, trianglesB;
+  trianglesA.resize(numberOfTrianglesOfGeometryA);
+  trianglesB.resize(numberOfTrianglesOfGeometryB);
+  computeTriangleGeometry(xCoordinatesOfPointsOfGeometryA, yCoordinatesOfPointsOfGeometryA, zCoordinatesOfPointsOfGeometryA,
+                          numberOfTrianglesOfGeometryA, trianglesA.data());
+  computeTriangleGeometry(xCoordinatesOfPointsOfGeometryB, yCoordinatesOfPointsOfGeometryB, zCoordinatesOfPointsOfGeometryB,
+                          numberOfTrianglesOfGeometryB, trianglesB.data());
+
+  penalty(trianglesA.data(), numberOfTrianglesOfGeometryA, epsilonA, frictionA, particleA,
+          trianglesB.data(), numberOfTrianglesOfGeometryB, epsilonB, frictionB, particleB,
+          contactpoints);
+}
+
+template<typename T>
+void demolish::detection::penalty(
+  const TriangleGeometry<T>* trianglesOfGeometryA,
+  const int       numberOfTrianglesOfGeometryA,
+  const iREAL     epsilonA,
+  const bool      frictionA,
+  const int	  	  particleA,
 
-  int numberOfTrianglesA = numberOfTrianglesOfGeometryA * 3;
-  int numberOfTrianglesB = numberOfTrianglesOfGeometryB * 3;
+  const TriangleGeometry<T>* trianglesOfGeometryB,
+  const int       numberOfTrianglesOfGeometryB,
+  const iREAL     epsilonB,
+  const bool      frictionB,
+  const int		  particleB,
 
-  for(int iA=0; iA<numberOfTrianglesA; iA+=3)
+  std::vector<demolish::ContactPoint>& contactpoints
+)
+{
+  const T MaxError = (epsilonA+epsilonB) / 16.0;
+  iREAL epsilonMargin = 1*(epsilonA+epsilonB);
+
+  // only the closest pair is reported, so keep track of it on the fly
+  T     minimum = epsilonMargin;
+  T     xPAmin, yPAmin, zPAmin, xPBmin, yPBmin, zPBmin;
+  int   featureMin;
+  bool  found = false;
+  long  iterations = 0;
+
+  for(int iA=0; iA<numberOfTrianglesOfGeometryA; iA++)
   {
-        iREAL xPA[10000], yPA[10000], zPA[10000], xPB[10000], yPB[10000], zPB[10000], d[10000];
-        for (int iB=0; iB<numberOfTrianglesB; iB+=3)
+        const TriangleGeometry<T>& triangleA = trianglesOfGeometryA[iA];
+        for (int iB=0; iB<numberOfTrianglesOfGeometryB; iB++)
         {
-            bool failed = false;
-            const iREAL MaxError = (epsilonA+epsilonB) / 16.0;
-            penaltySolver(	xCoordinatesOfPointsOfGeometryA+(iA),
-					        yCoordinatesOfPointsOfGeometryA+(iA),
-					        zCoordinatesOfPointsOfGeometryA+(iA),
-					        xCoordinatesOfPointsOfGeometryB+(iB),
-					        yCoordinatesOfPointsOfGeometryB+(iB),
-					        zCoordinatesOfPointsOfGeometryB+(iB),
-					        xPA[iB], yPA[iB], zPA[iB],
-                            xPB[iB], yPB[iB], zPB[iB],
+            const TriangleGeometry<T>& triangleB = trianglesOfGeometryB[iB];
+
+            // bounding spheres out of reach. Not against the closest pair
+            // found so far: the penalised solution may undershoot the
+            // true distance, and the pair reported would change
+            T c[3];
+            SUB(triangleB.centre, triangleA.centre, c);
+            T bound = epsilonMargin + triangleA.radius + triangleB.radius;
+            if (DOT(c,c) > bound*bound) continue;
+
+            T xPA, yPA, zPA, xPB, yPB, zPB;
+            int numberOfNewtonIterations;
+            penaltySolver(	triangleA,
+					        triangleB,
+					        xPA, yPA, zPA,
+                            xPB, yPB, zPB,
 					        MaxError,
-                            MaxNumberOfNewtonIterations);
+                            numberOfNewtonIterations);
+            iterations += numberOfNewtonIterations;
 
-            d[iB] = std::sqrt(((xPB[iB]-xPA[iB])*(xPB[iB]-xPA[iB]))
-                             +((yPB[iB]-yPA[iB])*(yPB[iB]-yPA[iB]))
-                             +((zPB[iB]-zPA[iB])*(zPB[iB]-zPA[iB])));
-            
-        }
+            T d = std::sqrt(((xPB-xPA)*(xPB-xPA))
+                               +((yPB-yPA)*(yPB-yPA))
+                               +((zPB-zPA)*(zPB-zPA)));
 
-        iREAL epsilonMargin = 1*(epsilonA+epsilonB);
-
-
-        for (int iB=0; iB<numberOfTrianglesB; iB+=3)
-        {
-            bool outside = true;
-            if (d[iB] < epsilonMargin)
+            if (d < minimum)
             {
-                bool fric =  bool(frictionA == true && frictionB == true);
-    		    cnps.push_back(demolish::ContactPoint(
-                xPA[iB],
-                yPA[iB],
-                zPA[iB],
-                xPB[iB],
-                yPB[iB],
-                zPB[iB],
+                minimum = d;
+                found   = true;
+                xPAmin = xPA; yPAmin = yPA; zPAmin = zPA;
+                xPBmin = xPB; yPBmin = yPB; zPBmin = zPB;
+                featureMin = iA*numberOfTrianglesOfGeometryB + iB;
+            }
+        }
+    }
+    DEMOLISH_PROFILE_COUNT(NEWTONITERATIONS, iterations);
+
+    if(found)
+    {
+        bool outside = true;
+        bool fric =  bool(frictionA == true && frictionB == true);
+        demolish::ContactPoint newContactPoint(
+                iREAL(xPAmin),
+                iREAL(yPAmin),
+                iREAL(zPAmin),
+                iREAL(xPBmin),
+                iREAL(yPBmin),
+                iREAL(zPBmin),
                 outside,
                 epsilonA,
                 epsilonB,
                 particleA,
                 particleB,
-                fric));
-
-                distanceVector.push_back(d[iB]);
-            }
-        }
+                fric);
+        newContactPoint.feature = featureMin;
+        contactpoints.push_back(newContactPoint);
     }
-    if(cnps.size()>0)
-    {
-        int minElementIndex = std::min_element(distanceVector.begin(),distanceVector.end()) - distanceVector.begin();
-        result.push_back(cnps[minElementIndex]);
-    }
-
-  return result;
 }
 
  
+template<typename T>
 void demolish::detection::penaltySolver(
-  const iREAL			*xCoordinatesOfTriangleA,
-  const iREAL			*yCoordinatesOfTriangleA,
-  const iREAL			*zCoordinatesOfTriangleA,
-  const iREAL			*xCoordinatesOfTriangleB,
-  const iREAL			*yCoordinatesOfTriangleB,
-  const iREAL			*zCoordinatesOfTriangleB,
-  iREAL&					xPA,
-  iREAL&					yPA,
-  iREAL&					zPA,
-  iREAL&					xPB,
-  iREAL&					yPB,
-  iREAL&					zPB,
-  iREAL					maxError,
+  const T			*xCoordinatesOfTriangleA,
+  const T			*yCoordinatesOfTriangleA,
+  const T			*zCoordinatesOfTriangleA,
+  const T			*xCoordinatesOfTriangleB,
+  const T			*yCoordinatesOfTriangleB,
+  const T			*zCoordinatesOfTriangleB,
+  T&					xPA,
+  T&					yPA,
+  T&					zPA,
+  T&					xPB,
+  T&					yPB,
+  T&					zPB,
+  T					maxError,
+  int&          			numberOfNewtonIterationsRequired)
+{
+  // the solver reads the corner, the edges and their dot products only
+  TriangleGeometry<T> triangles[2];
+  const T* x[2] = {xCoordinatesOfTriangleA, xCoordinatesOfTriangleB};
+  const T* y[2] = {yCoordinatesOfTriangleA, yCoordinatesOfTriangleB};
+  const T* z[2] = {zCoordinatesOfTriangleA, zCoordinatesOfTriangleB};
+  for(int t=0; t<2; t++)
+  {
+    TriangleGeometry<T>& g = triangles[t];
+    g.origin[0] = x[t][0];
+    g.origin[1] = y[t][0];
+    g.origin[2] = z[t][0];
+    g.edge0[0]  = x[t][1] - x[t][0];
+    g.edge0[1]  = y[t][1] - y[t][0];
+    g.edge0[2]  = z[t][1] - z[t][0];
+    g.edge1[0]  = x[t][2] - x[t][0];
+    g.edge1[1]  = y[t][2] - y[t][0];
+    g.edge1[2]  = z[t][2] - z[t][0];
+    g.e0e0      = DOT(g.edge0, g.edge0);
+    g.e0e1      = DOT(g.edge0, g.edge1);
+    g.e1e1      = DOT(g.edge1, g.edge1);
+  }
+
+  penaltySolver(triangles[0], triangles[1],
+                xPA, yPA, zPA, xPB, yPB, zPB,
+                maxError, numberOfNewtonIterationsRequired);
+}
+
+template<typename T>
+void demolish::detection::penaltySolver(
+  const TriangleGeometry<T>&	triangleA,
+  const TriangleGeometry<T>&	triangleB,
+  T&					xPA,
+  T&					yPA,
+  T&					zPA,
+  T&					xPB,
+  T&					yPB,
+  T&					zPB,
+  T					maxError,
   int&          			numberOfNewtonIterationsRequired)
  {
-  iREAL BA[3];
-  iREAL CA[3];
-  iREAL ED[3];
-  iREAL FD[3];
-  iREAL hessian[16];
-  iREAL x[4];
-
-  BA[0] = xCoordinatesOfTriangleA[1] - xCoordinatesOfTriangleA[0];
-  BA[1] = yCoordinatesOfTriangleA[1] - yCoordinatesOfTriangleA[0];
-  BA[2] = zCoordinatesOfTriangleA[1] - zCoordinatesOfTriangleA[0];
-
-  CA[0] = xCoordinatesOfTriangleA[2] - xCoordinatesOfTriangleA[0];
-  CA[1] = yCoordinatesOfTriangleA[2] - yCoordinatesOfTriangleA[0];
-  CA[2] = zCoordinatesOfTriangleA[2] - zCoordinatesOfTriangleA[0];
-
-  ED[0] = xCoordinatesOfTriangleB[1] - xCoordinatesOfTriangleB[0];
-  ED[1] = yCoordinatesOfTriangleB[1] - yCoordinatesOfTriangleB[0];
-  ED[2] = zCoordinatesOfTriangleB[1] - zCoordinatesOfTriangleB[0];
-
-  FD[0] = xCoordinatesOfTriangleB[2] - xCoordinatesOfTriangleB[0];
-  FD[1] = yCoordinatesOfTriangleB[2] - yCoordinatesOfTriangleB[0];
-  FD[2] = zCoordinatesOfTriangleB[2] - zCoordinatesOfTriangleB[0];
-
-  hessian[0] = 2.*DOT(BA,BA);
-  hessian[1] = 2.*DOT(CA,BA);
-  hessian[2] = -2.*DOT(ED,BA);
-  hessian[3] = -2.*DOT(FD,BA);
+  const T* A  = triangleA.origin;
+  const T* BA = triangleA.edge0;
+  const T* CA = triangleA.edge1;
+  const T* D  = triangleB.origin;
+  const T* ED = triangleB.edge0;
+  const T* FD = triangleB.edge1;
+  T hessian[16];
+  T x[4];
+
+  hessian[0] = T(2)*triangleA.e0e0;
+  hessian[1] = T(2)*triangleA.e0e1;
+  hessian[2] = -T(2)*DOT(ED,BA);
+  hessian[3] = -T(2)*DOT(FD,BA);
 
   hessian[4] = hessian[1]; //use symmetry
-  hessian[5] = 2.*DOT(CA,CA);
-  hessian[6] = -2.*DOT(ED,CA);
-  hessian[7] = -2.*DOT(FD,CA);
+  hessian[5] = T(2)*triangleA.e1e1;
+  hessian[6] = -T(2)*DOT(ED,CA);
+  hessian[7] = -T(2)*DOT(FD,CA);
 
   hessian[8] = hessian[2];
   hessian[9] = hessian[6];
-  hessian[10] = 2.*DOT(ED,ED);
-  hessian[11] = 2.*DOT(FD,ED);
+  hessian[10] = T(2)*triangleB.e0e0;
+  hessian[11] = T(2)*triangleB.e0e1;
 
   hessian[12] = hessian[3];
   hessian[13] = hessian[7];
   hessian[14] = hessian[11];
-  hessian[15] = 2.*DOT(FD,FD);
+  hessian[15] = T(2)*triangleB.e1e1;
 
-  iREAL eps = 1E-2;
-  iREAL delta = (hessian[0]+hessian[5]+hessian[10]+hessian[15]) * eps;
-  iREAL lambda = sqrt(0.0125*(hessian[0]+hessian[5]+hessian[10]+hessian[15]));
-  iREAL r = lambda*1E5;
+  T eps = T(1E-2);
+  T delta = (hessian[0]+hessian[5]+hessian[10]+hessian[15]) * eps;
+  T lambda = std::sqrt(T(0.0125)*(hessian[0]+hessian[5]+hessian[10]+hessian[15]));
+  T r = lambda*T(1E5);
 
   //initial guess
   x[0] = 0.33;
@@ -158,16 +226,18 @@ void demolish::detection::penaltySolver(
   x[2] = 0.33;
   x[3] = 0.33;
 
+  numberOfNewtonIterationsRequired = MaxNumberOfNewtonIterations;
+
    //Newton loop
   for(int i=0;i<MaxNumberOfNewtonIterations;i++)
   {
     //Declare loop variables;
-    iREAL dx[4];
-    iREAL a[16] ;
-    iREAL SUBXY[3] ;
-    iREAL b[4];
-    iREAL dh[8];
-    iREAL tmp1, tmp2,tmp3, tmp4, tmp5, tmp6, mx[6];
+    T dx[4];
+    T a[16] ;
+    T SUBXY[3] ;
+    T b[4];
+    T dh[8];
+    T tmp1, tmp2,tmp3, tmp4, tmp5, tmp6, mx[6];
 
     dh[0] = (-x[0] <= 0) ? 0.0 : -1;
     mx[0] = (-x[0] <= 0) ? 0.0 : -x[0];
@@ -187,11 +257,11 @@ void demolish::detection::penaltySolver(
     dh[5] = dh[7] = (x[2]+x[3]-1 <= 0) ? 0.0 : 1;
     mx[5] = (x[2]+x[3]-1 <=0) ? 0.0 : x[2]+x[3]-1;
 
-    delta = i < 3 ? delta : 1E5*delta;
+    delta = i < 3 ? delta : T(1E5)*delta;
 
-    SUBXY[0] = (xCoordinatesOfTriangleA[0]+(BA[0] * x[0])+(CA[0] * x[1])) - (xCoordinatesOfTriangleB[0]+(ED[0] * x[2])+(FD[0] * x[3]));
-    SUBXY[1] = (yCoordinatesOfTriangleA[0]+(BA[1] * x[0])+(CA[1] * x[1])) - (yCoordinatesOfTriangleB[0]+(ED[1] * x[2])+(FD[1] * x[3]));
-    SUBXY[2] = (zCoordinatesOfTriangleA[0]+(BA[2] * x[0])+(CA[2] * x[1])) - (zCoordinatesOfTriangleB[0]+(ED[2] * x[2])+(FD[2] * x[3]));
+    SUBXY[0] = (A[0]+(BA[0] * x[0])+(CA[0] * x[1])) - (D[0]+(ED[0] * x[2])+(FD[0] * x[3]));
+    SUBXY[1] = (A[1]+(BA[1] * x[0])+(CA[1] * x[1])) - (D[1]+(ED[1] * x[2])+(FD[1] * x[3]));
+    SUBXY[2] = (A[2]+(BA[2] * x[0])+(CA[2] * x[1])) - (D[2]+(ED[2] * x[2])+(FD[2] * x[3]));
 
     b[0] = 2*DOT(SUBXY,BA) + r * (dh[0] * mx[0] + dh[1] * mx[2]);
     a[0] = hessian[0] + r * (dh[0] * dh[0] + dh[1] * dh[1]) + delta;
@@ -215,9 +285,10 @@ void demolish::detection::penaltySolver(
     dx[1] = (b[1] - (a[9] * dx[2] + a[13] * dx[3])) / a[5];
     dx[0] = (b[0] - (a[4] * dx[1] + hessian[8] * dx[2] + hessian[12] * dx[3])) / a[0];
 
-    iREAL error = DOT4(dx,dx)/DOT4(x,x);
+    T error = DOT4(dx,dx)/DOT4(x,x);
 
     if (error < maxError*maxError) {
+      numberOfNewtonIterationsRequired = i+1;
       break;
     }
 
@@ -227,12 +298,30 @@ void demolish::detection::penaltySolver(
     x[3] = x[3] - dx[3];
   }
 
-  xPA = xCoordinatesOfTriangleA[0]+(BA[0] * x[0])+(CA[0] * x[1]);
-  yPA = yCoordinatesOfTriangleA[0]+(BA[1] * x[0])+(CA[1] * x[1]);
-  zPA = zCoordinatesOfTriangleA[0]+(BA[2] * x[0])+(CA[2] * x[1]);
+  xPA = A[0]+(BA[0] * x[0])+(CA[0] * x[1]);
+  yPA = A[1]+(BA[1] * x[0])+(CA[1] * x[1]);
+  zPA = A[2]+(BA[2] * x[0])+(CA[2] * x[1]);
 
-  xPB = xCoordinatesOfTriangleB[0]+(ED[0] * x[2])+(FD[0] * x[3]);
-  yPB = yCoordinatesOfTriangleB[0]+(ED[1] * x[2])+(FD[1] * x[3]);
-  zPB = zCoordinatesOfTriangleB[0]+(ED[2] * x[2])+(FD[2] * x[3]);
+  xPB = D[0]+(ED[0] * x[2])+(FD[0] * x[3]);
+  yPB = D[1]+(ED[1] * x[2])+(FD[1] * x[3]);
+  zPB = D[2]+(ED[2] * x[2])+(FD[2] * x[3]);
 }
 
+#define DEMOLISH_INSTANTIATE_PENALTY(T) \
+  template void demolish::detection::penalty<T>( \
+    const T*, const T*, const T*, const int, const iREAL, const bool, const int, \
+    const T*, const T*, const T*, const int, const iREAL, const bool, const int, \
+    std::vector<demolish::ContactPoint>&); \
+  template void demolish::detection::penaltySolver<T>( \
+    const T*, const T*, const T*, const T*, const T*, const T*, \
+    T&, T&, T&, T&, T&, T&, T, int&); \
+  template void demolish::detection::penalty<T>( \
+    const TriangleGeometry<T>*, const int, const iREAL, const bool, const int, \
+    const TriangleGeometry<T>*, const int, const iREAL, const bool, const int, \
+    std::vector<demolish::ContactPoint>&); \
+  template void demolish::detection::penaltySolver<T>( \
+    const TriangleGeometry<T>&, const TriangleGeometry<T>&, \
+    T&, T&, T&, T&, T&, T&, T, int&);
+
+DEMOLISH_INSTANTIATE_PENALTY(float)
+DEMOLISH_INSTANTIATE_PENALTY(double)
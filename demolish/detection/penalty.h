@@ -3,42 +3,109 @@
 #include <limits>
 #include <float.h>
 #include "../algo.h"
+#include "triangles.h"
 
 
 namespace demolish {
     namespace detection {
-	  std::vector<demolish::ContactPoint> penalty(
-		const iREAL*    xCoordinatesOfPointsOfGeometryA,
-		const iREAL*    yCoordinatesOfPointsOfGeometryA,
-		const iREAL*    zCoordinatesOfPointsOfGeometryA,
+	  /*
+	   *  Penalty
+	   *
+	   *  Runs the penalty solver on all triangle pairs of A and B and
+	   *  appends the closest pair within epsilonA+epsilonB to
+	   *  contactpoints. The buffer is owned by the caller, so nothing is
+	   *  allocated once it has grown to its working size.
+	   *
+	   *  The coordinates and the solver use the scalar type T, which is
+	   *  instantiated for float and double.
+	   */
+	  template<typename T>
+	  void penalty(
+		const T*        xCoordinatesOfPointsOfGeometryA,
+		const T*        yCoordinatesOfPointsOfGeometryA,
+		const T*        zCoordinatesOfPointsOfGeometryA,
 		const int       numberOfTrianglesOfGeometryA,
 		const iREAL     epsilonA,
 		const bool      frictionA,
 		const int 	    particleA,
 
-		const iREAL*    xCoordinatesOfPointsOfGeometryB,
-		const iREAL*    yCoordinatesOfPointsOfGeometryB,
-		const iREAL*    zCoordinatesOfPointsOfGeometryB,
+		const T*        xCoordinatesOfPointsOfGeometryB,
+		const T*        yCoordinatesOfPointsOfGeometryB,
+		const T*        zCoordinatesOfPointsOfGeometryB,
 		const int       numberOfTrianglesOfGeometryB,
 		const iREAL     epsilonB,
 		const bool      frictionB,
-		const int       particleB
+		const int       particleB,
+
+		std::vector<demolish::ContactPoint>& contactpoints
 		);
 
+	  /*
+	   *  Penalty
+	   *
+	   *  As above, on the triangle geometry the meshes keep up to date
+	   *  (see TriangleGeometry). Pairs whose bounding spheres are
+	   *  farther apart than epsilonA+epsilonB are skipped without
+	   *  running the solver.
+	   */
+	  template<typename T>
+	  void penalty(
+		const TriangleGeometry<T>* trianglesOfGeometryA,
+		const int       numberOfTrianglesOfGeometryA,
+		const iREAL     epsilonA,
+		const bool      frictionA,
+		const int 	    particleA,
+
+		const TriangleGeometry<T>* trianglesOfGeometryB,
+		const int       numberOfTrianglesOfGeometryB,
+		const iREAL     epsilonB,
+		const bool      frictionB,
+		const int       particleB,
+
+		std::vector<demolish::ContactPoint>& contactpoints
+		);
+
+	  /*
+	   *  Penalty Solver
+	   *
+	   *  Closest points of two triangles by a penalised Newton method.
+	   *  On return numberOfNewtonIterationsRequired holds the number of
+	   *  iterations the solver took.
+	   */
+	  template<typename T>
+	  void penaltySolver(
+		const T			*xCoordinatesOfTriangleA,
+		const T			*yCoordinatesOfTriangleA,
+		const T			*zCoordinatesOfTriangleA,
+		const T			*xCoordinatesOfTriangleB,
+		const T			*yCoordinatesOfTriangleB,
+		const T			*zCoordinatesOfTriangleB,
+		T&				xPA,
+		T&				yPA,
+		T&				zPA,
+		T&				xPB,
+		T&				yPB,
+		T&				zPB,
+		T				maxError,
+		int&          		numberOfNewtonIterationsRequired);
+
+	  /*
+	   *  Penalty Solver
+	   *
+	   *  As above, on precomputed triangle geometry; only the dot
+	   *  products between the two triangles are formed.
+	   */
+	  template<typename T>
 	  void penaltySolver(
-		const iREAL			*xCoordinatesOfTriangleA,
-		const iREAL			*yCoordinatesOfTriangleA,
-		const iREAL			*zCoordinatesOfTriangleA,
-		const iREAL			*xCoordinatesOfTriangleB,
-		const iREAL			*yCoordinatesOfTriangleB,
-		const iREAL			*zCoordinatesOfTriangleB,
-		iREAL&				xPA,
-		iREAL&				yPA,
-		iREAL&				zPA,
-		iREAL&				xPB,
-		iREAL&				yPB,
-		iREAL&				zPB,
-		iREAL				maxError,
+		const TriangleGeometry<T>&	triangleA,
+		const TriangleGeometry<T>&	triangleB,
+		T&				xPA,
+		T&				yPA,
+		T&				zPA,
+		T&				xPB,
+		T&				yPB,
+		T&				zPB,
+		T				maxError,
 		int&          		numberOfNewtonIterationsRequired);
 	}
 }
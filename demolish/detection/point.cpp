@@ -1,36 +1,54 @@
 #include "point.h"
 #include "../algo.h"
 
-iREAL demolish::detection::pt(iREAL TP1[3], iREAL TP2[3], iREAL TP3[3], iREAL cPoint[3], iREAL tq[3])
+template<typename T>
+T demolish::detection::pt(T TP1[3], T TP2[3], T TP3[3], T cPoint[3], T tq[3])
 {
-  //191 flops
-  iREAL E0[3];
-  E0[0] = TP2[0] - TP1[0];
-  E0[1] = TP2[1] - TP1[1];
-  E0[2] = TP2[2] - TP1[2];
-
-  iREAL E1[3];
-  E1[0] = TP3[0] - TP1[0];
-  E1[1] = TP3[1] - TP1[1];
-  E1[2] = TP3[2] - TP1[2];
-
-  iREAL D[3];
+  TriangleGeometry<T> triangle;
+  triangle.origin[0] = TP1[0];
+  triangle.origin[1] = TP1[1];
+  triangle.origin[2] = TP1[2];
+
+  triangle.edge0[0] = TP2[0] - TP1[0];
+  triangle.edge0[1] = TP2[1] - TP1[1];
+  triangle.edge0[2] = TP2[2] - TP1[2];
+
+  triangle.edge1[0] = TP3[0] - TP1[0];
+  triangle.edge1[1] = TP3[1] - TP1[1];
+  triangle.edge1[2] = TP3[2] - TP1[2];
+
+  triangle.e0e0 = DOT(triangle.edge0,triangle.edge0);
+  triangle.e0e1 = DOT(triangle.edge0,triangle.edge1);
+  triangle.e1e1 = DOT(triangle.edge1,triangle.edge1);
+
+  return pt(triangle, cPoint, tq);
+}
+
+template<typename T>
+T demolish::detection::pt(const TriangleGeometry<T>& triangle, const T cPoint[3], T tq[3])
+{
+  // the edge terms are precomputed, 21 of the 191 flops
+  const T* TP1 = triangle.origin;
+  const T* E0  = triangle.edge0;
+  const T* E1  = triangle.edge1;
+
+  T D[3];
   D[0] = TP1[0] - cPoint[0];
   D[1] = TP1[1] - cPoint[1];
   D[2] = TP1[2] - cPoint[2];
 
-  iREAL a = DOT(E0,E0);
-  iREAL b = DOT(E0,E1);
-  iREAL c = DOT(E1,E1);
-  iREAL d = DOT(E0,D);
-  iREAL e = DOT(E1,D);
-  iREAL f = DOT(D,D);
+  T a = triangle.e0e0;
+  T b = triangle.e0e1;
+  T c = triangle.e1e1;
+  T d = DOT(E0,D);
+  T e = DOT(E1,D);
+  T f = DOT(D,D);
 
-  iREAL det = a*c - b*b; //% do we have to use abs here?
-  iREAL s   = b*e - c*d;
-  iREAL t   = b*d - a*e;
+  T det = a*c - b*b; //% do we have to use abs here?
+  T s   = b*e - c*d;
+  T t   = b*d - a*e;
 
-  iREAL sqrDistance=0;
+  T sqrDistance=0;
 
   if ((s+t) <= det){
 	  if (s < 0){
@@ -94,7 +112,7 @@ iREAL demolish::detection::pt(iREAL TP1[3], iREAL TP2[3], iREAL TP3[3], iREAL cP
 			  }
 		  }else {
 			  // region 0
-			  iREAL invDet = 1/det;
+			  T invDet = 1/det;
 			  s = s*invDet;
 			  t = t*invDet;
 			  sqrDistance = s*(a*s + b*t + 2*d) + t*(b*s + c*t + 2*e) + f;
@@ -103,11 +121,11 @@ iREAL demolish::detection::pt(iREAL TP1[3], iREAL TP2[3], iREAL TP3[3], iREAL cP
   }else {
 	  if (s < 0){
 		  // region 2
-		  iREAL tmp0 = b + d;
-		  iREAL tmp1 = c + e;
+		  T tmp0 = b + d;
+		  T tmp1 = c + e;
 		  if (tmp1 > tmp0){ // minimum on edge s+t=1
-			  iREAL numer = tmp1 - tmp0;
-			  iREAL denom = a - 2*b + c;
+			  T numer = tmp1 - tmp0;
+			  T denom = a - 2*b + c;
 			  if (numer >= denom){
 				  s = 1;
 				  t = 0;
@@ -135,11 +153,11 @@ iREAL demolish::detection::pt(iREAL TP1[3], iREAL TP2[3], iREAL TP3[3], iREAL cP
 	  }else {
 		  if (t < 0) {
 			  //region6
-			  iREAL tmp0 = b + e;
-			  iREAL tmp1 = a + d;
+			  T tmp0 = b + e;
+			  T tmp1 = a + d;
 			  if (tmp1 > tmp0){
-				  iREAL numer = tmp1 - tmp0;
-				  iREAL denom = a-2*b+c;
+				  T numer = tmp1 - tmp0;
+				  T denom = a-2*b+c;
 				  if (numer >= denom){
 					  t = 1;
 					  s = 0;
@@ -167,13 +185,13 @@ iREAL demolish::detection::pt(iREAL TP1[3], iREAL TP2[3], iREAL TP3[3], iREAL cP
 			  //end of region 6
 		  }else {
 			  // region 1
-			  iREAL numer = c + e - b - d;
+			  T numer = c + e - b - d;
 			  if (numer <= 0){
 				  s = 0;
 				  t = 1;
 				  sqrDistance = c + 2*e + f;
 			  }else {
-				  iREAL denom = a - 2*b + c;
+				  T denom = a - 2*b + c;
 				  if (numer >= denom){
 					  s = 1;
 					  t = 0;
@@ -197,9 +215,14 @@ iREAL demolish::detection::pt(iREAL TP1[3], iREAL TP2[3], iREAL TP3[3], iREAL cP
   tq[1] = TP1[1] + (E1[1] * t) + (E0[1] * s);
   tq[2] = TP1[2] + (E1[2] * t) + (E0[2] * s);
 
-  return sqrt(sqrDistance);
+  return std::sqrt(sqrDistance);
 }
 
+template float  demolish::detection::pt<float>(float TP1[3], float TP2[3], float TP3[3], float cPoint[3], float tq[3]);
+template double demolish::detection::pt<double>(double TP1[3], double TP2[3], double TP3[3], double cPoint[3], double tq[3]);
+template float  demolish::detection::pt<float>(const TriangleGeometry<float>& triangle, const float cPoint[3], float tq[3]);
+template double demolish::detection::pt<double>(const TriangleGeometry<double>& triangle, const double cPoint[3], double tq[3]);
+
 std::vector<demolish::ContactPoint> demolish::detection::pointToGeometry(
 iREAL   xCoordinatesOfPointOfGeometryA,
 iREAL   yCoordinatesOfPointOfGeometryA,
@@ -243,7 +266,7 @@ iREAL   			epsilonB)
 	if(distance <= (epsilonA+epsilonB))
 	{
 	  demolish::ContactPoint newContactPoint(P[0], P[1], P[2],
-                                            Q[0], Q[1], Q[2],false);
+                                            Q[0], Q[1], Q[2],true);
 	  result.push_back( newContactPoint );
 	}
   }
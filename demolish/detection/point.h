@@ -4,6 +4,7 @@
 #define DEMOLISH_CONTACT_DETECTION_POINT_H_
 
 #include "../ContactPoint.h"
+#include "triangles.h"
 #include<vector>
 
 namespace demolish{
@@ -23,7 +24,23 @@ namespace demolish{
 		int				particleB,
 		iREAL   			epsilonB);
 
-	iREAL pt(iREAL TP1[3], iREAL TP2[3], iREAL TP3[3], iREAL cPoint[3], iREAL tq[3]);
+	/*
+	 *  Point Triangle
+	 *
+	 *  Distance of cPoint to the triangle (TP1, TP2, TP3); tq is the
+	 *  closest point on the triangle. Instantiated for float and double.
+	 */
+	template<typename T>
+	T pt(T TP1[3], T TP2[3], T TP3[3], T cPoint[3], T tq[3]);
+
+	/*
+	 *  Point Triangle
+	 *
+	 *  As above, on precomputed triangle geometry; only the terms that
+	 *  involve cPoint are formed.
+	 */
+	template<typename T>
+	T pt(const TriangleGeometry<T>& triangle, const T cPoint[3], T tq[3]);
 
 	} 
 } 
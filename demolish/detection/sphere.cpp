@@ -1,6 +1,7 @@
 #include "sphere.h"
+#include "../algo.h"
 
-std::vector<demolish::ContactPoint> demolish::detection::spherewithsphere(
+void demolish::detection::spherewithsphere(
   const iREAL   xCoordinatesOfPointsOfGeometryA,
   const iREAL   yCoordinatesOfPointsOfGeometryA,
   const iREAL   zCoordinatesOfPointsOfGeometryA,
@@ -15,15 +16,15 @@ std::vector<demolish::ContactPoint> demolish::detection::spherewithsphere(
   const iREAL   radB,
   const iREAL   epsilonB,
   const bool    frictionB,
-  const int 	  	particleB)
-{
-  std::vector<demolish::ContactPoint> result;
+  const int 	  	particleB,
 
+  std::vector<demolish::ContactPoint>& contactpoints)
+{
   iREAL distance = std::sqrt(((xCoordinatesOfPointsOfGeometryB-xCoordinatesOfPointsOfGeometryA)*(xCoordinatesOfPointsOfGeometryB-xCoordinatesOfPointsOfGeometryA))+((yCoordinatesOfPointsOfGeometryB-yCoordinatesOfPointsOfGeometryA)*(yCoordinatesOfPointsOfGeometryB-yCoordinatesOfPointsOfGeometryA))+((zCoordinatesOfPointsOfGeometryB-zCoordinatesOfPointsOfGeometryA)*(zCoordinatesOfPointsOfGeometryB-zCoordinatesOfPointsOfGeometryA)));
 
   if(distance>radA+radB+epsilonA+epsilonB)
   {
-      return result;
+      return;
   }
 
 
@@ -51,14 +52,69 @@ std::vector<demolish::ContactPoint> demolish::detection::spherewithsphere(
                                          epsilonA,
                                          epsilonB,
                                          (frictionA && frictionB));
+
+  // touching spheres have PA on QB, the centres still give the normal
+  if(xPA == xPB && yPA == yPB && zPA == zPB)
+  {
+    newContactPoint.normal[0] = -xnormal;
+    newContactPoint.normal[1] = -ynormal;
+    newContactPoint.normal[2] = -znormal;
+  }
   newContactPoint.indexA = particleA;
   newContactPoint.indexB = particleB;
-  result.push_back( newContactPoint );
-  return result;
+  contactpoints.push_back( newContactPoint );
 }
 
 
-std::vector<demolish::ContactPoint> demolish::detection::sphereWithMesh(
+namespace {
+  template<typename T>
+  void appendSphereMeshContact(
+    const T       P[3],
+    const T       Q[3],
+    iREAL         distance,
+    iREAL         radA,
+    iREAL         epsilonA,
+    bool          frictionA,
+    int           particleA,
+    iREAL         epsilonB,
+    bool          frictionB,
+    int           particleB,
+    int           triangle,
+    std::vector<demolish::ContactPoint>& contactpoints)
+  {
+	iREAL xPA, yPA, zPA, xPB, yPB, zPB;
+
+	iREAL xnormal = (Q[0] - P[0])/(distance+radA);
+	iREAL ynormal = (Q[1] - P[1])/(distance+radA);
+	iREAL znormal = (Q[2] - P[2])/(distance+radA);
+
+	xPA = P[0] + (radA * xnormal);
+	yPA = P[1] + (radA * ynormal);
+	zPA = P[2] + (radA * znormal);
+
+	xPB = Q[0];
+	yPB = Q[1];
+	zPB = Q[2];
+
+    bool outside = true;
+    if(distance <0) outside = false;
+	demolish::ContactPoint newContactPoint(xPA,yPA, zPA,
+                                    xPB, yPB, zPB,
+                                    outside,
+                                    epsilonA,
+                                    epsilonB,
+                                    (frictionA && frictionB));
+    
+
+    newContactPoint.indexA  = particleA;
+    newContactPoint.indexB  = particleB;
+    newContactPoint.feature = triangle;
+    contactpoints.push_back( newContactPoint );
+  }
+}
+
+template<typename T>
+void demolish::detection::sphereWithMesh(
   iREAL   xCoordinatesOfPointsOfGeometryA,
   iREAL   yCoordinatesOfPointsOfGeometryA,
   iREAL   zCoordinatesOfPointsOfGeometryA,
@@ -67,22 +123,21 @@ std::vector<demolish::ContactPoint> demolish::detection::sphereWithMesh(
   bool    frictionA,
   int 	  particleA,
 
-  const iREAL   *xCoordinatesOfPointsOfGeometryB,
-  const iREAL   *yCoordinatesOfPointsOfGeometryB,
-  const iREAL   *zCoordinatesOfPointsOfGeometryB,
+  const T       *xCoordinatesOfPointsOfGeometryB,
+  const T       *yCoordinatesOfPointsOfGeometryB,
+  const T       *zCoordinatesOfPointsOfGeometryB,
   int   			numberOfTrianglesOfGeometryB,
   iREAL   		epsilonB,
   bool    		frictionB,
-  int 			particleB)
-{
-  std::vector<demolish::ContactPoint> result;
+  int 			particleB,
 
+  std::vector<demolish::ContactPoint>& contactpoints)
+{
   for(int i=0; i<numberOfTrianglesOfGeometryB*3; i+=3)
   {
-	iREAL P[3], Q[3];
-	iREAL xPA, yPA, zPA, xPB, yPB, zPB;
+	T P[3], Q[3];
 
-	iREAL TP1[3], TP2[3], TP3[3];
+	T TP1[3], TP2[3], TP3[3];
 	TP1[0] = xCoordinatesOfPointsOfGeometryB[i];
 	TP1[1] = yCoordinatesOfPointsOfGeometryB[i];
 	TP1[2] = zCoordinatesOfPointsOfGeometryB[i];
@@ -99,39 +154,68 @@ std::vector<demolish::ContactPoint> demolish::detection::sphereWithMesh(
 	P[1] = yCoordinatesOfPointsOfGeometryA;
 	P[2] = zCoordinatesOfPointsOfGeometryA;
 
-   // std::cout << TP1[0] << " " << TP1[1] << " " << TP1[2] << std::endl;
-   // std::cout << TP2[0] << " " << TP2[1] << " " << TP2[2] << std::endl;
-   // std::cout << TP3[0] << " " << TP3[1] << " " << TP3[2] << std::endl;
 	iREAL distance = demolish::detection::pt(TP1, TP2, TP3, P, Q) - radA;
     if(distance > epsilonA + epsilonB) continue;
-    //std::cout << distance << std::endl;
-	iREAL xnormal = (Q[0] - P[0])/(distance+radA);
-	iREAL ynormal = (Q[1] - P[1])/(distance+radA);
-	iREAL znormal = (Q[2] - P[2])/(distance+radA);
 
-	xPA = P[0] + (radA * xnormal);
-	yPA = P[1] + (radA * ynormal);
-	zPA = P[2] + (radA * znormal);
+    appendSphereMeshContact(P, Q, distance, radA, epsilonA, frictionA, particleA,
+                            epsilonB, frictionB, particleB, i/3, contactpoints);
+    break;
+  }
+}
 
-	xPB = Q[0];
-	yPB = Q[1];
-	zPB = Q[2];
+template<typename T>
+void demolish::detection::sphereWithMesh(
+  iREAL   xCoordinatesOfPointsOfGeometryA,
+  iREAL   yCoordinatesOfPointsOfGeometryA,
+  iREAL   zCoordinatesOfPointsOfGeometryA,
+  iREAL   radA,
+  iREAL   epsilonA,
+  bool    frictionA,
+  int 	  particleA,
 
-    bool outside = true;
-    if(distance <0) outside = false;
-	demolish::ContactPoint newContactPoint(xPA,yPA, zPA,
-                                    xPB, yPB, zPB,
-                                    outside,
-                                    epsilonA,
-                                    epsilonB,
-                                    (frictionA && frictionB));
-    
+  const TriangleGeometry<T> *trianglesOfGeometryB,
+  int   			numberOfTrianglesOfGeometryB,
+  iREAL   		epsilonB,
+  bool    		frictionB,
+  int 			particleB,
+
+  std::vector<demolish::ContactPoint>& contactpoints)
+{
+  T P[3];
+  P[0] = xCoordinatesOfPointsOfGeometryA;
+  P[1] = yCoordinatesOfPointsOfGeometryA;
+  P[2] = zCoordinatesOfPointsOfGeometryA;
+  const T reach = radA + epsilonA + epsilonB;
+
+  for(int i=0; i<numberOfTrianglesOfGeometryB; i++)
+  {
+	const TriangleGeometry<T>& triangle = trianglesOfGeometryB[i];
 
-    newContactPoint.indexA = particleA;
-    newContactPoint.indexB = particleB;
-    result.push_back( newContactPoint );
+	// out of reach of the whole bounding sphere of the triangle
+	T c[3];
+	SUB(triangle.centre, P, c);
+	T bound = reach + triangle.radius;
+	if(DOT(c,c) > bound*bound) continue;
+
+	T Q[3];
+	iREAL distance = demolish::detection::pt(triangle, P, Q) - radA;
+    if(distance > epsilonA + epsilonB) continue;
+
+    appendSphereMeshContact(P, Q, distance, radA, epsilonA, frictionA, particleA,
+                            epsilonB, frictionB, particleB, i, contactpoints);
     break;
-	
   }
-  return result;
 }
+
+#define DEMOLISH_INSTANTIATE_SPHEREWITHMESH(T) \
+  template void demolish::detection::sphereWithMesh<T>( \
+    iREAL, iREAL, iREAL, iREAL, iREAL, bool, int, \
+    const T*, const T*, const T*, int, iREAL, bool, int, \
+    std::vector<demolish::ContactPoint>&); \
+  template void demolish::detection::sphereWithMesh<T>( \
+    iREAL, iREAL, iREAL, iREAL, iREAL, bool, int, \
+    const TriangleGeometry<T>*, int, iREAL, bool, int, \
+    std::vector<demolish::ContactPoint>&);
+
+DEMOLISH_INSTANTIATE_SPHEREWITHMESH(float)
+DEMOLISH_INSTANTIATE_SPHEREWITHMESH(double)
@@ -7,7 +7,7 @@
 #include "point.h"
 namespace demolish {
 	namespace detection {
-	  std::vector<demolish::ContactPoint> spherewithsphere(
+	  void spherewithsphere(
 		const iREAL   xCoordinatesOfPointsOfGeometryA,
 		const iREAL   yCoordinatesOfPointsOfGeometryA,
 		const iREAL   zCoordinatesOfPointsOfGeometryA,
@@ -22,10 +22,47 @@ namespace demolish {
 		const iREAL   radA,
 		const iREAL   epsilonB,
 		const bool    frictionB,
-		const int 	  particleB
+		const int 	  particleB,
+
+		std::vector<demolish::ContactPoint>& contactpoints
 		);
     
-      std::vector<demolish::ContactPoint> sphereWithMesh(
+      /*
+       *  Sphere With Mesh
+       *
+       *  The mesh coordinates and the point-triangle test use the scalar
+       *  type T, which is instantiated for float and double.
+       */
+      template<typename T>
+      void sphereWithMesh(
+		const iREAL   xCoordinatesOfPointsOfGeometryA,
+		const iREAL   yCoordinatesOfPointsOfGeometryA,
+		const iREAL   zCoordinatesOfPointsOfGeometryA,
+		const iREAL   radA,
+		const iREAL   epsilonA,
+		const bool    frictionA,
+		const int	  particleA,
+
+		const T       *xCoordinatesOfPointsOfGeometryB,
+		const T       *yCoordinatesOfPointsOfGeometryB,
+		const T       *zCoordinatesOfPointsOfGeometryB,
+		const int	  numberOfTrianglesOfGeometryB,
+		const iREAL   epsilonB,
+		const bool 	  frictionB,
+		const int 	  particleB,
+
+		std::vector<demolish::ContactPoint>& contactpoints
+		);
+
+      /*
+       *  Sphere With Mesh
+       *
+       *  As above, on the triangle geometry the mesh keeps up to date
+       *  (see TriangleGeometry). Triangles whose bounding sphere is out
+       *  of reach are skipped without the point-triangle test.
+       */
+      template<typename T>
+      void sphereWithMesh(
 		const iREAL   xCoordinatesOfPointsOfGeometryA,
 		const iREAL   yCoordinatesOfPointsOfGeometryA,
 		const iREAL   zCoordinatesOfPointsOfGeometryA,
@@ -34,13 +71,13 @@ namespace demolish {
 		const bool    frictionA,
 		const int	  particleA,
 
-		const iREAL   *xCoordinatesOfPointsOfGeometryB,
-		const iREAL   *yCoordinatesOfPointsOfGeometryB,
-		const iREAL   *zCoordinatesOfPointsOfGeometryB,
+		const TriangleGeometry<T> *trianglesOfGeometryB,
 		const int	  numberOfTrianglesOfGeometryB,
 		const iREAL   epsilonB,
 		const bool 	  frictionB,
-		const int 	  particleB
+		const int 	  particleB,
+
+		std::vector<demolish::ContactPoint>& contactpoints
 		);
 
     }
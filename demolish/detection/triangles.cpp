@@ -0,0 +1,98 @@
+#include "triangles.h"
+#include "../algo.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+  template<typename T>
+  void fill(
+    const T  A[3],
+    const T  B[3],
+    const T  C[3],
+    demolish::detection::TriangleGeometry<T>& g)
+  {
+    g.origin[0] = A[0];
+    g.origin[1] = A[1];
+    g.origin[2] = A[2];
+
+    g.edge0[0] = B[0] - A[0];
+    g.edge0[1] = B[1] - A[1];
+    g.edge0[2] = B[2] - A[2];
+
+    g.edge1[0] = C[0] - A[0];
+    g.edge1[1] = C[1] - A[1];
+    g.edge1[2] = C[2] - A[2];
+
+    g.e0e0 = DOT(g.edge0, g.edge0);
+    g.e0e1 = DOT(g.edge0, g.edge1);
+    g.e1e1 = DOT(g.edge1, g.edge1);
+
+    T n[3];
+    PRODUCT(g.edge0, g.edge1, n);
+    T length = std::sqrt(DOT(n, n));
+    T scale  = length > T(0) ? T(1)/length : T(0);
+    g.normal[0] = n[0]*scale;
+    g.normal[1] = n[1]*scale;
+    g.normal[2] = n[2]*scale;
+
+    g.centre[0] = (A[0] + B[0] + C[0]) / T(3);
+    g.centre[1] = (A[1] + B[1] + C[1]) / T(3);
+    g.centre[2] = (A[2] + B[2] + C[2]) / T(3);
+
+    const T* corners[3] = {A, B, C};
+    T radius = 0;
+    for(int c=0; c<3; c++)
+    {
+      T d[3];
+      SUB(corners[c], g.centre, d);
+      radius = std::max(radius, T(DOT(d, d)));
+    }
+    g.radius = std::sqrt(radius);
+  }
+}
+
+template<typename T>
+void demolish::detection::computeTriangleGeometry(
+  const T*              x,
+  const T*              y,
+  const T*              z,
+  int                   numberOfTriangles,
+  TriangleGeometry<T>*  geometry)
+{
+  for(int t=0; t<numberOfTriangles; t++)
+  {
+    const int i = 3*t;
+    T A[3] = {x[i],   y[i],   z[i]};
+    T B[3] = {x[i+1], y[i+1], z[i+1]};
+    T C[3] = {x[i+2], y[i+2], z[i+2]};
+    fill(A, B, C, geometry[t]);
+  }
+}
+
+template<typename T>
+void demolish::detection::computeTriangleGeometry(
+  const T*                    x,
+  const T*                    y,
+  const T*                    z,
+  const std::array<int, 3>*   faces,
+  int                         numberOfTriangles,
+  TriangleGeometry<T>*        geometry)
+{
+  for(int t=0; t<numberOfTriangles; t++)
+  {
+    const std::array<int, 3>& f = faces[t];
+    T A[3] = {x[f[0]], y[f[0]], z[f[0]]};
+    T B[3] = {x[f[1]], y[f[1]], z[f[1]]};
+    T C[3] = {x[f[2]], y[f[2]], z[f[2]]};
+    fill(A, B, C, geometry[t]);
+  }
+}
+
+template void demolish::detection::computeTriangleGeometry<float>(
+  const float*, const float*, const float*, int, TriangleGeometry<float>*);
+template void demolish::detection::computeTriangleGeometry<double>(
+  const double*, const double*, const double*, int, TriangleGeometry<double>*);
+template void demolish::detection::computeTriangleGeometry<float>(
+  const float*, const float*, const float*, const std::array<int, 3>*, int, TriangleGeometry<float>*);
+template void demolish::detection::computeTriangleGeometry<double>(
+  const double*, const double*, const double*, const std::array<int, 3>*, int, TriangleGeometry<double>*);
@@ -0,0 +1,317 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  const char     magic[8] = {'D','E','M','O','C','K','P','T'};
+  const uint32_t version  = 6;
+
+  struct Header {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  realBytes;        // sizeof(iREAL) of the writing build
+    uint32_t  stateBytes;       // sizeof(Object::State) of the writing build
+    uint32_t  numberOfMaterials;
+    uint64_t  numberOfBodies;
+    uint64_t  numberOfShapes;
+    uint64_t  numberOfFields;
+    uint64_t  cacheBytes;
+    iREAL     gravity;
+    iREAL     timestep;
+    iREAL     maxTimestep;
+    iREAL     penetrationThreshold;
+    iREAL     predictedPenetration;
+    int32_t   timeStamp;
+    int32_t   lastTimeStampChanged;
+    int32_t   multiRateLevels;
+    int32_t   contactSolver;
+    int32_t   solverSweeps;
+    int32_t   padding;
+    iREAL     solverResidual;
+  };
+
+  struct ShapeHeader {
+    uint64_t  numberOfTriangles;
+    uint64_t  numberOfVertices;
+  };
+
+  struct FieldRecord {
+    int32_t   particle;
+    int32_t   padding;
+    iREAL     cellSize;
+    iREAL     bandWidth;
+    uint64_t  maxMemory;
+  };
+
+  std::size_t padded(std::size_t bytes)
+  {
+    return (bytes+7) & ~std::size_t(7);
+  }
+
+  // unbuffered writer, the sections are large and written in one call each
+  class Output {
+    public:
+      Output(int file): _file(file), _failed(false) {}
+
+      void append(const void* data, std::size_t bytes)
+      {
+        const char* pointer = static_cast<const char*>(data);
+        while(bytes > 0 && !_failed)
+        {
+          ssize_t written = ::write(_file, pointer, bytes);
+          if(written <= 0)
+          {
+            _failed = true;
+            return;
+          }
+          pointer += written;
+          bytes   -= written;
+        }
+      }
+
+      // every section starts on an 8 byte boundary
+      void pad(std::size_t bytes)
+      {
+        const char zeros[8] = {0};
+        append(zeros, padded(bytes)-bytes);
+      }
+
+      bool failed() const {return _failed;}
+
+    private:
+      int   _file;
+      bool  _failed;
+  };
+
+  // bounds checked cursor over the mapped file
+  class Input {
+    public:
+      Input(const char* data, std::size_t bytes): _data(data), _bytes(bytes), _offset(0), _failed(false) {}
+
+      const char* take(std::size_t bytes)
+      {
+        if(_failed || bytes > _bytes-_offset)
+        {
+          _failed = true;
+          return nullptr;
+        }
+        const char* pointer = _data+_offset;
+        _offset = std::min(padded(_offset+bytes), _bytes);
+        return pointer;
+      }
+
+      template<typename T>
+      bool copy(T* destination, std::size_t count)
+      {
+        const char* source = take(count*sizeof(T));
+        if(source == nullptr) return false;
+        std::memcpy(destination, source, count*sizeof(T));
+        return true;
+      }
+
+      bool failed() const {return _failed;}
+
+    private:
+      const char*  _data;
+      std::size_t  _bytes;
+      std::size_t  _offset;
+      bool         _failed;
+  };
+}
+
+bool demolish::checkpoint::write(
+  const std::string&          filename,
+  const Snapshot&             snapshot,
+  const std::vector<Shape>&   shapes)
+{
+  const std::string temporary = filename + ".tmp";
+  int file = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(file < 0) return false;
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version              = version;
+  header.realBytes            = sizeof(iREAL);
+  header.stateBytes           = sizeof(demolish::Object::State);
+  header.numberOfMaterials    = demolish::material::NUMBEROFMATERIALS;
+  header.numberOfBodies       = snapshot.bodies.size();
+  header.numberOfShapes       = shapes.size();
+  header.numberOfFields       = snapshot.fields.size();
+  header.cacheBytes           = snapshot.cache.size();
+  header.gravity              = snapshot.gravity;
+  header.timestep             = snapshot.timestep;
+  header.maxTimestep          = snapshot.maxTimestep;
+  header.penetrationThreshold = snapshot.penetrationThreshold;
+  header.predictedPenetration = snapshot.predictedPenetration;
+  header.timeStamp            = snapshot.timeStamp;
+  header.lastTimeStampChanged = snapshot.lastTimeStampChanged;
+  header.multiRateLevels      = snapshot.multiRateLevels;
+  header.contactSolver        = snapshot.contactSolver;
+  header.solverSweeps         = snapshot.solverSweeps;
+  header.solverResidual       = snapshot.solverResidual;
+
+  Output output(file);
+  output.append(&header, sizeof(header));
+  output.pad(sizeof(header));
+
+  for(const Shape& shape : shapes)
+  {
+    ShapeHeader shapeHeader = {shape.triangles.size(), shape.vertices.size()/3};
+    output.append(&shapeHeader, sizeof(shapeHeader));
+    output.append(shape.triangles.data(), shape.triangles.size()*sizeof(std::array<int, 3>));
+    output.pad(shape.triangles.size()*sizeof(std::array<int, 3>));
+    output.append(shape.vertices.data(), shape.vertices.size()*sizeof(iREAL));
+    output.append(shape.originalTriangles.data(), shape.triangles.size()*sizeof(int));
+    output.pad(shape.triangles.size()*sizeof(int));
+  }
+
+  output.append(snapshot.bodies.data(), snapshot.bodies.size()*sizeof(demolish::Object::State));
+  output.pad(snapshot.bodies.size()*sizeof(demolish::Object::State));
+  output.append(snapshot.shapeOfBody.data(), snapshot.shapeOfBody.size()*sizeof(int));
+  output.pad(snapshot.shapeOfBody.size()*sizeof(int));
+  output.append(snapshot.slotOfBody.data(), snapshot.slotOfBody.size()*sizeof(int));
+  output.pad(snapshot.slotOfBody.size()*sizeof(int));
+
+  for(const Field& field : snapshot.fields)
+  {
+    FieldRecord record = {field.particle, 0, field.cellSize, field.bandWidth, field.maxMemory};
+    output.append(&record, sizeof(record));
+  }
+
+  output.append(snapshot.materials, sizeof(snapshot.materials));
+  output.pad(sizeof(snapshot.materials));
+  output.append(snapshot.cache.data(), snapshot.cache.size());
+  output.pad(snapshot.cache.size());
+
+  bool success = !output.failed();
+  if(::close(file) != 0) success = false;
+  if(success) success = std::rename(temporary.c_str(), filename.c_str()) == 0;
+  if(!success) std::remove(temporary.c_str());
+  return success;
+}
+
+bool demolish::checkpoint::read(
+  const std::string&          filename,
+  Snapshot&                   snapshot,
+  std::vector<Shape>&         shapes)
+{
+  int file = ::open(filename.c_str(), O_RDONLY);
+  if(file < 0) return false;
+
+  struct stat status;
+  if(::fstat(file, &status) != 0 || status.st_size < sizeof(Header))
+  {
+    ::close(file);
+    return false;
+  }
+  const std::size_t bytes = status.st_size;
+  void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if(mapping == MAP_FAILED) return false;
+
+  Input input(static_cast<const char*>(mapping), bytes);
+
+  Header header;
+  input.copy(&header, 1);
+  bool success = std::memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+                 header.version           == version &&
+                 header.realBytes         == sizeof(iREAL) &&
+                 header.stateBytes        == sizeof(demolish::Object::State) &&
+                 header.numberOfMaterials == demolish::material::NUMBEROFMATERIALS;
+
+  // counts are checked against the file size before anything is allocated
+  success = success && header.numberOfShapes <= bytes && header.numberOfBodies <= bytes &&
+                       header.numberOfFields <= bytes && header.cacheBytes <= bytes;
+
+  if(success)
+  {
+    snapshot.gravity              = header.gravity;
+    snapshot.timestep             = header.timestep;
+    snapshot.maxTimestep          = header.maxTimestep;
+    snapshot.penetrationThreshold = header.penetrationThreshold;
+    snapshot.predictedPenetration = header.predictedPenetration;
+    snapshot.timeStamp            = header.timeStamp;
+    snapshot.lastTimeStampChanged = header.lastTimeStampChanged;
+    snapshot.multiRateLevels      = header.multiRateLevels;
+    snapshot.contactSolver        = header.contactSolver;
+    snapshot.solverSweeps         = header.solverSweeps;
+    snapshot.solverResidual       = header.solverResidual;
+
+    shapes.resize(header.numberOfShapes);
+    for(Shape& shape : shapes)
+    {
+      ShapeHeader shapeHeader;
+      if(!input.copy(&shapeHeader, 1)) break;
+      if(shapeHeader.numberOfTriangles > bytes || shapeHeader.numberOfVertices > bytes)
+      {
+        success = false;
+        break;
+      }
+      shape.triangles.resize(shapeHeader.numberOfTriangles);
+      shape.vertices.resize(3*shapeHeader.numberOfVertices);
+      input.copy(shape.triangles.data(), shape.triangles.size());
+      input.copy(shape.vertices.data(), shape.vertices.size());
+      shape.originalTriangles.resize(shapeHeader.numberOfTriangles);
+      input.copy(shape.originalTriangles.data(), shape.originalTriangles.size());
+    }
+  }
+
+  if(success && !input.failed())
+  {
+    snapshot.bodies.resize(header.numberOfBodies);
+    snapshot.shapeOfBody.resize(header.numberOfBodies);
+    input.copy(snapshot.bodies.data(), snapshot.bodies.size());
+    input.copy(snapshot.shapeOfBody.data(), snapshot.shapeOfBody.size());
+    snapshot.slotOfBody.resize(header.numberOfBodies);
+    input.copy(snapshot.slotOfBody.data(), snapshot.slotOfBody.size());
+
+    snapshot.fields.resize(header.numberOfFields);
+    for(Field& field : snapshot.fields)
+    {
+      FieldRecord record;
+      if(!input.copy(&record, 1)) break;
+      field.particle  = record.particle;
+      field.cellSize  = record.cellSize;
+      field.bandWidth = record.bandWidth;
+      field.maxMemory = record.maxMemory;
+    }
+
+    input.copy(&snapshot.materials[0][0][0], sizeof(snapshot.materials)/sizeof(demolish::material::InteractionParameters));
+    snapshot.cache.resize(header.cacheBytes);
+    input.copy(snapshot.cache.data(), snapshot.cache.size());
+  }
+  success = success && !input.failed();
+
+  // shape indices have to be valid before the World dereferences them
+  for(int i=0; success && i<snapshot.shapeOfBody.size(); i++)
+  {
+    if(snapshot.shapeOfBody[i] < -1 || snapshot.shapeOfBody[i] >= int(shapes.size())) success = false;
+  }
+  // the World places every body in its slot, every slot once
+  std::vector<char> taken(success ? snapshot.slotOfBody.size() : 0, 0);
+  for(int i=0; success && i<snapshot.slotOfBody.size(); i++)
+  {
+    const int slot = snapshot.slotOfBody[i];
+    if(slot < 0 || slot >= int(snapshot.slotOfBody.size()) || taken[slot]) success = false;
+    else taken[slot] = 1;
+  }
+  for(int s=0; success && s<shapes.size(); s++)
+  {
+    for(const std::array<int, 3>& triangle : shapes[s].triangles)
+    for(int k=0; k<3; k++)
+    {
+      if(triangle[k] < 0 || 3*std::size_t(triangle[k]) >= shapes[s].vertices.size()) success = false;
+    }
+  }
+
+  ::munmap(mapping, bytes);
+  return success;
+}
@@ -0,0 +1,108 @@
+#ifndef DEMOLISH_IO_CHECKPOINT
+#define DEMOLISH_IO_CHECKPOINT
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstddef>
+
+#include "../Object.h"
+#include "../material.h"
+
+/*
+ * Binary checkpoints of a World
+ *
+ * A checkpoint holds everything a World needs to continue a run exactly
+ * where it stopped: the state of every body, the reference geometry of
+ * the meshes, the contact cache, the material table, the distance field
+ * parameters and the step control (timestep, timestamp, last change).
+ * Bodies are stored by id together with the position every body had in
+ * the particle order, so a reordered World continues in the same order.
+ *
+ * Meshes are stored once per shape. Bodies that were built from the same
+ * geometry share a shape and only carry their own state. Distance fields
+ * are not stored, they are rebuilt from their parameters when loading.
+ *
+ * The file is a fixed header followed by 8 byte aligned sections in
+ * native byte order. It is written to <filename>.tmp first and renamed,
+ * so a crash while writing never leaves a half written checkpoint under
+ * the final name. Reading maps the file and copies the sections out.
+ */
+
+namespace demolish {
+  namespace checkpoint {
+
+    /*
+     * Reference geometry of a mesh. The vertices are the unique vertices
+     * in the frame the mesh was built in, x y z interleaved. The
+     * triangles are in the order of the mesh, originalTriangles holds
+     * the index every triangle had when the mesh was built.
+     */
+    struct Shape {
+      std::vector<std::array<int, 3>> triangles;
+      std::vector<iREAL>              vertices;
+      std::vector<int>                originalTriangles;
+    };
+
+    struct Field {
+      int          particle;
+      iREAL        cellSize;
+      iREAL        bandWidth;
+      std::size_t  maxMemory;
+    };
+
+    /*
+     * Copy of the World state that can be written while the World goes
+     * on. Shapes are not part of it, they never change during a run.
+     */
+    struct Snapshot {
+      iREAL                                  gravity;
+      iREAL                                  timestep;
+      iREAL                                  maxTimestep;
+      iREAL                                  penetrationThreshold;
+      iREAL                                  predictedPenetration;
+      int                                    timeStamp;
+      int                                    lastTimeStampChanged;
+      int                                    multiRateLevels;
+      int                                    contactSolver;
+      int                                    solverSweeps;
+      iREAL                                  solverResidual;
+
+      std::vector<demolish::Object::State>   bodies;
+      std::vector<int>                       shapeOfBody;  // -1 for spheres
+      std::vector<int>                       slotOfBody;   // position in the World's particle order
+      std::vector<Field>                     fields;
+      std::vector<char>                      cache;        // ContactCache::save
+      demolish::material::InteractionParameters materials[2][demolish::material::NUMBEROFMATERIALS][demolish::material::NUMBEROFMATERIALS];
+    };
+
+    /*
+     *  Write
+     *
+     *  @param filename : checkpoint file
+     *  @param snapshot : state of the World
+     *  @param shapes   : shapes the snapshot refers to
+     *  @returns false if the file cannot be written
+     */
+    bool write(
+      const std::string&          filename,
+      const Snapshot&             snapshot,
+      const std::vector<Shape>&   shapes);
+
+    /*
+     *  Read
+     *
+     *  @param filename : checkpoint file
+     *  @param snapshot : state of the World
+     *  @param shapes   : shapes the snapshot refers to
+     *  @returns false if the file cannot be read, is truncated or was
+     *           written by a build with a different layout
+     */
+    bool read(
+      const std::string&          filename,
+      Snapshot&                   snapshot,
+      std::vector<Shape>&         shapes);
+  }
+}
+
+#endif
@@ -1,6 +1,384 @@
 #include"input.h"
 
-demolish::Mesh* demolish::input::readGeometry(char * fileName)
+#include <omp.h>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  struct MappedFile {
+    const char*  data  = nullptr;
+    std::size_t  bytes = 0;
+
+    bool open(const char* fileName)
+    {
+      int file = ::open(fileName, O_RDONLY);
+      if(file < 0) return false;
+      struct stat status;
+      if(::fstat(file, &status) != 0 || status.st_size == 0)
+      {
+        ::close(file);
+        return false;
+      }
+      void* mapping = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+      ::close(file);
+      if(mapping == MAP_FAILED) return false;
+      ::madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+      data  = static_cast<const char*>(mapping);
+      bytes = status.st_size;
+      return true;
+    }
+
+    ~MappedFile()
+    {
+      if(data != nullptr) ::munmap(const_cast<char*>(data), bytes);
+    }
+  };
+
+  bool hasExtension(const std::string& fileName, const std::string& extension)
+  {
+    if(fileName.size() < extension.size()) return false;
+    for(int i=0; i<extension.size(); i++)
+    {
+      if(std::tolower(fileName[fileName.size()-extension.size()+i]) != extension[i]) return false;
+    }
+    return true;
+  }
+
+  inline const char* skipBlanks(const char* p, const char* end)
+  {
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+  }
+
+  inline const char* nextLine(const char* p, const char* end)
+  {
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', end-p));
+    return newline ? newline+1 : end;
+  }
+
+  inline bool startsWith(const char* p, const char* end, const char* word)
+  {
+    const std::size_t length = std::strlen(word);
+    return std::size_t(end-p) >= length && std::memcmp(p, word, length) == 0;
+  }
+
+  inline bool parseReal(const char*& p, const char* end, iREAL& value)
+  {
+    p = skipBlanks(p, end);
+    if(p < end && *p == '+') p++;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if(result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+  }
+
+  inline bool parseInt(const char*& p, const char* end, long& value)
+  {
+    if(p < end && *p == '+') p++;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if(result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+  }
+
+  /*
+   * Splits [begin, end) into one range per thread. Every range starts at
+   * the beginning of a line, so the line parsers can run on them
+   * independently and their results concatenated in order.
+   */
+  std::vector<const char*> splitIntoLines(const char* begin, const char* end, int parts)
+  {
+    std::vector<const char*> bounds(parts+1);
+    bounds[0]     = begin;
+    bounds[parts] = end;
+    for(int t=1; t<parts; t++)
+    {
+      const char* p = begin + (end-begin)*std::size_t(t)/parts;
+      bounds[t] = std::max(bounds[t-1], p > begin ? nextLine(p-1, end) : begin);
+    }
+    return bounds;
+  }
+
+  // ****************************************************
+  //  STL
+  // ****************************************************
+
+  bool isBinarySTL(const MappedFile& file)
+  {
+    if(file.bytes < 84) return false;
+    uint32_t numberOfTriangles;
+    std::memcpy(&numberOfTriangles, file.data+80, sizeof(numberOfTriangles));
+    // ASCII files start with "solid" as well, the size decides
+    return file.bytes == 84 + 50*std::size_t(numberOfTriangles);
+  }
+
+  void readBinarySTL(const MappedFile& file, std::vector<iREAL>& corners)
+  {
+    uint32_t numberOfTriangles;
+    std::memcpy(&numberOfTriangles, file.data+80, sizeof(numberOfTriangles));
+    corners.resize(9*std::size_t(numberOfTriangles));
+
+    #pragma omp parallel for schedule(static)
+    for(int64_t t=0; t<numberOfTriangles; t++)
+    {
+      // normal, three corners, attribute count; the normal is recomputed
+      float xyz[9];
+      std::memcpy(xyz, file.data+84+50*t+12, sizeof(xyz));
+      for(int k=0; k<9; k++) corners[9*t+k] = xyz[k];
+    }
+  }
+
+  bool readAsciiSTL(const MappedFile& file, std::vector<iREAL>& corners)
+  {
+    const int parts = omp_get_max_threads();
+    std::vector<const char*> bounds = splitIntoLines(file.data, file.data+file.bytes, parts);
+    std::vector<std::vector<iREAL>> local(parts);
+    std::vector<char> failed(parts, 0);
+
+    #pragma omp parallel for schedule(static, 1)
+    for(int t=0; t<parts; t++)
+    {
+      for(const char* p=bounds[t]; p<bounds[t+1]; p=nextLine(p, bounds[t+1]))
+      {
+        const char* q = skipBlanks(p, bounds[t+1]);
+        if(!startsWith(q, bounds[t+1], "vertex")) continue;
+        q += 6;
+        iREAL x, y, z;
+        if(!parseReal(q, bounds[t+1], x) || !parseReal(q, bounds[t+1], y) || !parseReal(q, bounds[t+1], z))
+        {
+          failed[t] = 1;
+          break;
+        }
+        local[t].push_back(x);
+        local[t].push_back(y);
+        local[t].push_back(z);
+      }
+    }
+
+    corners.clear();
+    for(int t=0; t<parts; t++)
+    {
+      if(failed[t]) return false;
+      corners.insert(corners.end(), local[t].begin(), local[t].end());
+    }
+    return corners.size()%9 == 0;
+  }
+
+  // ****************************************************
+  //  OBJ
+  // ****************************************************
+
+  /*
+   * Triangles of one range of lines. Indices are 0-based; negative OBJ
+   * indices count back from the last vertex, so they are stored relative
+   * to the vertices of the range and resolved once the ranges before are
+   * counted.
+   */
+  struct ObjRange {
+    std::vector<iREAL>              vertices;
+    std::vector<std::array<long, 3>> triangles;
+    std::vector<char>               relative;   // bit k set: corner k is relative
+    bool                            failed = false;
+  };
+
+  // "f" corner: v, v/t, v//n or v/t/n; only v is used
+  inline bool parseCorner(const char*& p, const char* end, long numberOfVertices, long& index, bool& relative)
+  {
+    long value;
+    if(!parseInt(p, end, value) || value == 0) return false;
+    while(p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+    relative = value < 0;
+    index    = relative ? numberOfVertices+value : value-1;
+    return true;
+  }
+
+  void readObjRange(const char* begin, const char* end, ObjRange& range)
+  {
+    std::vector<long> polygon;
+    std::vector<char> polygonRelative;
+
+    for(const char* p=begin; p<end; p=nextLine(p, end))
+    {
+      const char* q = skipBlanks(p, end);
+      if(q+1 >= end || (q[1] != ' ' && q[1] != '\t')) continue;
+
+      if(q[0] == 'v')
+      {
+        q++;
+        iREAL x, y, z;
+        if(!parseReal(q, end, x) || !parseReal(q, end, y) || !parseReal(q, end, z))
+        {
+          range.failed = true;
+          return;
+        }
+        range.vertices.push_back(x);
+        range.vertices.push_back(y);
+        range.vertices.push_back(z);
+      }
+      else if(q[0] == 'f')
+      {
+        q++;
+        polygon.clear();
+        polygonRelative.clear();
+        const char* lineEnd = nextLine(q, end);
+        while(true)
+        {
+          q = skipBlanks(q, lineEnd);
+          if(q >= lineEnd || *q == '\n' || *q == '#') break;
+          long index;
+          bool relative;
+          if(!parseCorner(q, lineEnd, range.vertices.size()/3, index, relative))
+          {
+            range.failed = true;
+            return;
+          }
+          polygon.push_back(index);
+          polygonRelative.push_back(relative);
+        }
+        if(polygon.size() < 3)
+        {
+          range.failed = true;
+          return;
+        }
+        for(int k=1; k+1<polygon.size(); k++)
+        {
+          range.triangles.push_back({polygon[0], polygon[k], polygon[k+1]});
+          range.relative.push_back(polygonRelative[0] | polygonRelative[k] << 1 | polygonRelative[k+1] << 2);
+        }
+      }
+    }
+  }
+
+  bool readOBJ(const MappedFile& file, std::vector<iREAL>& vertices, std::vector<std::array<long, 3>>& triangles)
+  {
+    const int parts = omp_get_max_threads();
+    std::vector<const char*> bounds = splitIntoLines(file.data, file.data+file.bytes, parts);
+    std::vector<ObjRange> ranges(parts);
+
+    #pragma omp parallel for schedule(static, 1)
+    for(int t=0; t<parts; t++)
+    {
+      readObjRange(bounds[t], bounds[t+1], ranges[t]);
+    }
+
+    vertices.clear();
+    triangles.clear();
+    for(int t=0; t<parts; t++)
+    {
+      if(ranges[t].failed) return false;
+
+      // relative corners are relative to the vertices before the range
+      const long offset = vertices.size()/3;
+      for(int i=0; i<ranges[t].triangles.size(); i++)
+      {
+        std::array<long, 3> triangle = ranges[t].triangles[i];
+        for(int k=0; k<3; k++)
+        {
+          if(ranges[t].relative[i] & (1 << k)) triangle[k] += offset;
+        }
+        triangles.push_back(triangle);
+      }
+      vertices.insert(vertices.end(), ranges[t].vertices.begin(), ranges[t].vertices.end());
+    }
+
+    const long numberOfVertices = vertices.size()/3;
+    for(const std::array<long, 3>& triangle : triangles)
+    for(int k=0; k<3; k++)
+    {
+      if(triangle[k] < 0 || triangle[k] >= numberOfVertices) return false;
+    }
+    return true;
+  }
+
+  /*
+   * Welds the interleaved vertices and maps the triangles onto the unique
+   * vertices. Triangles with two corners on the same unique vertex are
+   * dropped.
+   */
+  void weld(
+    const std::vector<iREAL>&            vertices,
+    const std::vector<std::array<long, 3>>& triangles,
+    std::vector<std::array<int, 3>>&      meshTriangles,
+    std::vector<demolish::Vertex>&        meshVertices)
+  {
+    const long n = vertices.size()/3;
+    std::vector<iREAL> x(n), y(n), z(n);
+    iREAL lower[3] = { iREAL_MAX,  iREAL_MAX,  iREAL_MAX};
+    iREAL upper[3] = {-iREAL_MAX, -iREAL_MAX, -iREAL_MAX};
+    for(long i=0; i<n; i++)
+    {
+      x[i] = vertices[3*i];
+      y[i] = vertices[3*i+1];
+      z[i] = vertices[3*i+2];
+      lower[0] = std::min(lower[0], x[i]); upper[0] = std::max(upper[0], x[i]);
+      lower[1] = std::min(lower[1], y[i]); upper[1] = std::max(upper[1], y[i]);
+      lower[2] = std::min(lower[2], z[i]); upper[2] = std::max(upper[2], z[i]);
+    }
+    const iREAL diagonal = n > 0 ? std::sqrt((upper[0]-lower[0])*(upper[0]-lower[0]) +
+                                             (upper[1]-lower[1])*(upper[1]-lower[1]) +
+                                             (upper[2]-lower[2])*(upper[2]-lower[2])) : 0.0;
+
+    std::vector<int> uniqueIndex;
+    demolish::operators::weldVertices(x.data(), y.data(), z.data(), n, demolish::operators::weldTolerance*diagonal, uniqueIndex, meshVertices);
+
+    meshTriangles.clear();
+    meshTriangles.reserve(triangles.size());
+    for(const std::array<long, 3>& triangle : triangles)
+    {
+      std::array<int, 3> face = {uniqueIndex[triangle[0]], uniqueIndex[triangle[1]], uniqueIndex[triangle[2]]};
+      if(face[0] == face[1] || face[1] == face[2] || face[2] == face[0]) continue;
+      meshTriangles.push_back(face);
+    }
+  }
+}
+
+demolish::Mesh* demolish::input::readGeometry(const char* fileName)
 {
+  MappedFile file;
+  if(!file.open(fileName))
+  {
+    std::cout << "cannot read geometry " << fileName << std::endl;
+    return nullptr;
+  }
+
+  std::vector<iREAL>               vertices;
+  std::vector<std::array<long, 3>> triangles;
+
+  if(hasExtension(fileName, ".obj"))
+  {
+    if(!readOBJ(file, vertices, triangles))
+    {
+      std::cout << "invalid OBJ file " << fileName << std::endl;
+      return nullptr;
+    }
+  }
+  else
+  {
+    bool valid = isBinarySTL(file) ? (readBinarySTL(file, vertices), true) : readAsciiSTL(file, vertices);
+    if(!valid)
+    {
+      std::cout << "invalid STL file " << fileName << std::endl;
+      return nullptr;
+    }
+    // STL is a triangle soup, every triangle has its own three corners
+    triangles.resize(vertices.size()/9);
+    for(long t=0; t<triangles.size(); t++) triangles[t] = {3*t, 3*t+1, 3*t+2};
+  }
+
+  std::vector<std::array<int, 3>> meshTriangles;
+  std::vector<demolish::Vertex>   meshVertices;
+  weld(vertices, triangles, meshTriangles, meshVertices);
+  if(meshTriangles.empty())
+  {
+    std::cout << "no triangles in " << fileName << std::endl;
+    return nullptr;
+  }
 
+  return new demolish::Mesh(meshTriangles, meshVertices);
 }
@@ -15,7 +15,22 @@
 
 namespace demolish{
     namespace input{
-        demolish::Mesh* readGeometry(char* fileName);
+        /*
+         *  Read Geometry
+         *
+         *  Loads a triangle mesh from a binary or ASCII STL file or a
+         *  Wavefront OBJ file. The format is chosen by the extension, a
+         *  file without a known extension is taken as STL. The file is
+         *  memory mapped and parsed in parallel. Vertices closer than a
+         *  millionth of the bounding box diagonal are welded, triangles
+         *  that collapse in the process are dropped. Polygons in OBJ
+         *  files are split into fans of triangles.
+         *
+         *  @param fileName : STL or OBJ file
+         *  @returns the mesh, owned by the caller, or nullptr if the file
+         *           cannot be read
+         */
+        demolish::Mesh* readGeometry(const char* fileName);
     }
 }
 
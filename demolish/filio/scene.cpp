@@ -0,0 +1,479 @@
+#include "scene.h"
+#include "input.h"
+#include "../builder/GeometryBuilder.h"
+
+#include <omp.h>
+#include <map>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace {
+  struct Shape {
+    bool                              isSphere;
+    bool                              isConvex;
+    iREAL                             radius;      // spheres only
+    iREAL                             size;        // extent in any orientation
+    // template of the instances, never handed to an Object
+    std::unique_ptr<demolish::Mesh>   mesh;
+  };
+
+  struct Options {
+    int                    material      = int(demolish::material::MaterialType::WOOD);
+    bool                   isObstacle    = false;
+    bool                   isFriction    = true;
+    int                    convexity     = -1;    // -1 default of the shape, 0 concave, 1 convex
+    iREAL                  epsilon       = -1.0;  // negative: default of the geometry
+    std::array<iREAL, 3>   linear        = {0, 0, 0};
+    std::array<iREAL, 3>   angular       = {0, 0, 0};
+    iREAL                  cellSize      = 0.0;   // distance field, 0 for none
+    iREAL                  bandWidth     = 0.0;
+  };
+
+  enum PlacementType {
+    BODY,
+    GRID,
+    EMIT
+  };
+
+  // one body, grid or emitter statement, expanded when the objects are built
+  struct Placement {
+    PlacementType          type;
+    int                    shape;
+    int                    count;
+    std::array<iREAL, 3>   lower;      // location, grid origin or emitter corner
+    std::array<iREAL, 3>   step;       // grid or lattice step
+    std::array<int, 3>     sites;      // grid or lattice sites per axis
+    iREAL                  jitter;     // emitter: largest shift per axis
+    iREAL                  speed;      // emitter: largest random velocity per axis
+    uint64_t               seed;
+    Options                options;
+  };
+
+  uint64_t mix(uint64_t x)
+  {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+  // uniform in [-1, 1), a function of seed, body and stream only
+  iREAL random(uint64_t seed, uint64_t index, int stream)
+  {
+    return iREAL(mix(seed ^ mix(8*index + stream)) >> 11) * (2.0/9007199254740992.0) - 1.0;
+  }
+
+  std::string directoryOf(const std::string& filename)
+  {
+    std::size_t slash = filename.find_last_of('/');
+    return slash == std::string::npos ? "" : filename.substr(0, slash+1);
+  }
+
+  std::string resolve(const std::string& directory, const std::string& path)
+  {
+    return path.empty() || path[0] == '/' ? path : directory + path;
+  }
+
+  iREAL diagonalOf(const std::vector<demolish::Vertex>& vertices)
+  {
+    iREAL lower[3] = { std::numeric_limits<iREAL>::max(),  std::numeric_limits<iREAL>::max(),  std::numeric_limits<iREAL>::max()};
+    iREAL upper[3] = {-std::numeric_limits<iREAL>::max(), -std::numeric_limits<iREAL>::max(), -std::numeric_limits<iREAL>::max()};
+    for(const demolish::Vertex& vertex : vertices)
+    {
+      const iREAL xyz[3] = {vertex.getX(), vertex.getY(), vertex.getZ()};
+      for(int d=0; d<3; d++)
+      {
+        lower[d] = std::min(lower[d], xyz[d]);
+        upper[d] = std::max(upper[d], xyz[d]);
+      }
+    }
+    if(vertices.empty()) return 0.0;
+    return std::sqrt((upper[0]-lower[0])*(upper[0]-lower[0]) +
+                     (upper[1]-lower[1])*(upper[1]-lower[1]) +
+                     (upper[2]-lower[2])*(upper[2]-lower[2]));
+  }
+
+  // reads the shape after "shape name", false if the line is invalid
+  bool readShape(std::istringstream& stream, const std::string& directory, Shape& shape, std::string& error)
+  {
+    std::string type;
+    stream >> type;
+
+    std::vector<demolish::Vertex>   meshVertices;
+    std::vector<std::array<int, 3>> meshTriangles;
+    shape.isSphere = false;
+    shape.isConvex = true;
+    shape.radius   = 0.0;
+
+    if(type == "sphere")
+    {
+      shape.isSphere = true;
+      if(!(stream >> shape.radius) || shape.radius <= 0.0)
+      {
+        error = "expected a positive radius";
+        return false;
+      }
+      shape.size = 2.0*shape.radius;
+      return true;
+    }
+    else if(type == "box")
+    {
+      iREAL dx, dy, dz;
+      if(!(stream >> dx >> dy >> dz))
+      {
+        error = "expected three box dimensions";
+        return false;
+      }
+      demolish::CreateBox(dx, dy, dz, meshVertices, meshTriangles);
+    }
+    else if(type == "cone")
+    {
+      iREAL top, bottom, height;
+      int resolution;
+      if(!(stream >> top >> bottom >> height >> resolution) || resolution < 3)
+      {
+        error = "expected top and bottom radius, height and a resolution of at least 3";
+        return false;
+      }
+      demolish::CreateTrunCone(top, bottom, height, resolution, meshVertices, meshTriangles);
+    }
+    else if(type == "hopper")
+    {
+      iREAL top, bottom, height;
+      if(!(stream >> top >> bottom >> height))
+      {
+        error = "expected top and bottom radius and height";
+        return false;
+      }
+      demolish::CreateHopper(top, bottom, height, meshVertices, meshTriangles);
+      shape.isConvex = false;
+    }
+    else if(type == "mesh")
+    {
+      std::string file, keyword;
+      iREAL scale = 1.0;
+      if(!(stream >> file))
+      {
+        error = "expected a mesh file";
+        return false;
+      }
+      if(stream >> keyword && (keyword != "scale" || !(stream >> scale) || scale <= 0.0))
+      {
+        error = "expected scale and a positive factor after the mesh file";
+        return false;
+      }
+      const std::string path = resolve(directory, file);
+      std::unique_ptr<demolish::Mesh> loaded(demolish::input::readGeometry(path.c_str()));
+      if(!loaded)
+      {
+        error = "cannot load mesh " + path;
+        return false;
+      }
+      meshVertices  = loaded->getUniqueVertices();
+      meshTriangles = loaded->getTriangleFaces();
+      for(demolish::Vertex& vertex : meshVertices) vertex = vertex*scale;
+      shape.isConvex = false;
+    }
+    else
+    {
+      error = "unknown shape " + type;
+      return false;
+    }
+
+    shape.size = diagonalOf(meshVertices);
+    shape.mesh.reset(new demolish::Mesh(meshTriangles, meshVertices));
+    return true;
+  }
+
+  /*
+   * Reads the options at the end of a body, grid or emit line. The
+   * emitter keywords are only accepted for emitters.
+   */
+  bool readOptions(std::istringstream& stream, Placement& placement, iREAL& spacing, std::string& error)
+  {
+    Options& options = placement.options;
+    std::string keyword;
+    while(stream >> keyword)
+    {
+      bool valid = true;
+      if(keyword == "material")
+      {
+        std::string name;
+        stream >> name;
+        options.material = demolish::material::getMaterialFromName(name);
+        valid = options.material >= 0;
+      }
+      else if(keyword == "obstacle")      options.isObstacle = true;
+      else if(keyword == "frictionless")  options.isFriction = false;
+      else if(keyword == "convex")        options.convexity  = 1;
+      else if(keyword == "concave")       options.convexity  = 0;
+      else if(keyword == "epsilon")       valid = bool(stream >> options.epsilon) && options.epsilon >= 0.0;
+      else if(keyword == "velocity")      valid = bool(stream >> options.linear[0] >> options.linear[1] >> options.linear[2]);
+      else if(keyword == "spin")          valid = bool(stream >> options.angular[0] >> options.angular[1] >> options.angular[2]);
+      else if(keyword == "field")         valid = bool(stream >> options.cellSize >> options.bandWidth) && options.cellSize > 0.0;
+      else if(keyword == "spacing" && placement.type == EMIT) valid = bool(stream >> spacing) && spacing > 0.0;
+      else if(keyword == "speed"   && placement.type == EMIT) valid = bool(stream >> placement.speed) && placement.speed >= 0.0;
+      else if(keyword == "seed"    && placement.type == EMIT) valid = bool(stream >> placement.seed);
+      else
+      {
+        error = "unknown option " + keyword;
+        return false;
+      }
+      if(!valid)
+      {
+        error = "invalid value of " + keyword;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // location and velocity of the k-th body of a placement
+  void place(const Placement& placement, int k, std::array<iREAL, 3>& location, std::array<iREAL, 3>& linear)
+  {
+    linear = placement.options.linear;
+    if(placement.type == BODY)
+    {
+      location = placement.lower;
+      return;
+    }
+
+    // grids run x first, then y, then z; emitters fill a layer in x and z
+    // before the next one in y
+    const int a = placement.type == GRID ? 1 : 2;
+    const int b = placement.type == GRID ? 2 : 1;
+    int site[3];
+    site[0] = k % placement.sites[0];
+    site[a] = (k / placement.sites[0]) % placement.sites[a];
+    site[b] = k / (placement.sites[0]*placement.sites[a]);
+
+    for(int d=0; d<3; d++)
+    {
+      if(placement.type == GRID)
+      {
+        location[d] = placement.lower[d] + site[d]*placement.step[d];
+      }
+      else
+      {
+        location[d] = placement.lower[d] + (site[d]+0.5)*placement.step[d] + placement.jitter*random(placement.seed, k, d);
+        linear[d]  += placement.speed*random(placement.seed, k, 3+d);
+      }
+    }
+  }
+}
+
+bool demolish::scene::load(const std::string& filename, Scene& scene)
+{
+  std::ifstream file(filename);
+  if(!file)
+  {
+    std::cout << "cannot open scene file " << filename << std::endl;
+    return false;
+  }
+
+  scene = Scene();
+  const std::string directory = directoryOf(filename);
+
+  std::map<std::string, int> shapeIndex;
+  std::vector<Shape>         shapes;
+  std::vector<Placement>     placements;
+  long                       numberOfObjects = 0;
+
+  std::string line;
+  int lineNumber = 0;
+  while(std::getline(file, line))
+  {
+    lineNumber++;
+    std::istringstream stream(line);
+    std::string statement;
+    if(!(stream >> statement) || statement[0] == '#') continue;
+
+    std::string error;
+    if(statement == "gravity")
+    {
+      if(!(stream >> scene.gravity)) error = "expected the gravity";
+    }
+    else if(statement == "steps")
+    {
+      if(!(stream >> scene.steps) || scene.steps < 0) error = "expected a number of steps";
+    }
+    else if(statement == "materials")
+    {
+      std::string materials;
+      if(!(stream >> materials)) error = "expected a material file";
+      else if(!demolish::material::materialInit(resolve(directory, materials))) error = "cannot read the material file";
+    }
+    else if(statement == "trajectory")
+    {
+      std::string contacts;
+      if(!(stream >> scene.trajectory >> scene.trajectoryInterval) || scene.trajectoryInterval < 1) error = "expected a trajectory file and an interval";
+      else if(stream >> contacts)
+      {
+        if(contacts == "contacts") scene.trajectoryContacts = true;
+        else                       error = "unknown option " + contacts;
+      }
+    }
+    else if(statement == "checkpoint")
+    {
+      if(!(stream >> scene.checkpoint)) error = "expected a checkpoint file";
+    }
+    else if(statement == "reorder")
+    {
+      if(!(stream >> scene.reorderInterval) || scene.reorderInterval < 0) error = "expected a number of steps";
+    }
+    else if(statement == "timestep")
+    {
+      if(!(stream >> scene.timestep) || scene.timestep <= 0) error = "expected a timestep";
+    }
+    else if(statement == "multirate")
+    {
+      if(!(stream >> scene.multiRateLevels) || scene.multiRateLevels < 0) error = "expected a number of levels";
+    }
+    else if(statement == "solver")
+    {
+      std::string solver;
+      if(!(stream >> solver))      error = "expected penalty or impulses";
+      else if(solver == "penalty")  scene.contactSolver = demolish::resolution::ContactSolver::PENALTY;
+      else if(solver == "impulses") scene.contactSolver = demolish::resolution::ContactSolver::GAUSSSEIDEL;
+      else                          error = "unknown solver " + solver;
+
+      int   sweeps;
+      iREAL residual;
+      if(error.empty() && stream >> sweeps)
+      {
+        scene.solverSweeps = sweeps;
+        if(sweeps < 1)                                  error = "expected a number of sweeps";
+        else if(stream >> residual && residual >= 0.0) scene.solverResidual = residual;
+      }
+    }
+    else if(statement == "shape")
+    {
+      std::string name;
+      Shape shape;
+      if(!(stream >> name)) error = "expected a shape name";
+      else if(shapeIndex.count(name)) error = "shape " + name + " is declared twice";
+      else if(readShape(stream, directory, shape, error))
+      {
+        shapeIndex[name] = shapes.size();
+        shapes.push_back(std::move(shape));
+      }
+    }
+    else if(statement == "body" || statement == "grid" || statement == "emit")
+    {
+      Placement placement;
+      placement.type   = statement == "body" ? BODY : (statement == "grid" ? GRID : EMIT);
+      placement.count  = 1;
+      placement.step   = {0, 0, 0};
+      placement.sites  = {1, 1, 1};
+      placement.jitter = 0.0;
+      placement.speed  = 0.0;
+      placement.seed   = 0;
+
+      std::string name;
+      std::array<iREAL, 3> upper;
+      bool valid = bool(stream >> name);
+      if(valid && placement.type == GRID)
+      {
+        valid = bool(stream >> placement.sites[0] >> placement.sites[1] >> placement.sites[2]) &&
+                placement.sites[0] > 0 && placement.sites[1] > 0 && placement.sites[2] > 0;
+        const long count = valid ? long(placement.sites[0])*placement.sites[1]*placement.sites[2] : 0;
+        valid = valid && count <= std::numeric_limits<int>::max();
+        placement.count = count;
+      }
+      if(valid && placement.type == EMIT) valid = bool(stream >> placement.count) && placement.count > 0;
+      if(valid) valid = bool(stream >> placement.lower[0] >> placement.lower[1] >> placement.lower[2]);
+      if(valid && placement.type == GRID) valid = bool(stream >> placement.step[0] >> placement.step[1] >> placement.step[2]);
+      if(valid && placement.type == EMIT) valid = bool(stream >> upper[0] >> upper[1] >> upper[2]);
+
+      iREAL spacing = 0.0;
+      if(!valid)                      error = "expected a shape and the " + statement + " parameters";
+      else if(!shapeIndex.count(name)) error = "unknown shape " + name;
+      else if(readOptions(stream, placement, spacing, error))
+      {
+        placement.shape = shapeIndex[name];
+        const Shape& shape = shapes[placement.shape];
+        if(placement.options.cellSize > 0.0 && (shape.isSphere || !placement.options.isObstacle))
+        {
+          error = "only obstacle meshes have distance fields";
+        }
+
+        // lattice of the emitter, the free space of a cell is the jitter
+        if(placement.type == EMIT && error.empty())
+        {
+          if(spacing == 0.0) spacing = shape.size;
+          long sites = 1;
+          for(int d=0; d<3; d++)
+          {
+            placement.sites[d] = int(std::min(iREAL(std::numeric_limits<int>::max()), std::max(iREAL(0.0), std::floor((upper[d]-placement.lower[d])/spacing))));
+            placement.step[d]  = spacing;
+            sites *= placement.sites[d];
+          }
+          placement.jitter = std::max(0.0, 0.5*(spacing-shape.size));
+          if(sites < placement.count) error = "the region holds " + std::to_string(sites) + " bodies";
+        }
+        numberOfObjects += placement.count;
+        if(numberOfObjects > std::numeric_limits<int>::max()) error = "too many bodies";
+        if(error.empty()) placements.push_back(placement);
+      }
+    }
+    else
+    {
+      error = "unknown statement " + statement;
+    }
+
+    if(!error.empty())
+    {
+      std::cout << filename << ":" << lineNumber << ": " << error << std::endl;
+      scene = Scene();
+      return false;
+    }
+  }
+
+  scene.objects.resize(numberOfObjects);
+  scene.meshes.resize(numberOfObjects);
+
+  int first = 0;
+  for(const Placement& placement : placements)
+  {
+    const Shape&   shape   = shapes[placement.shape];
+    const Options& options = placement.options;
+    const auto     material = demolish::material::MaterialType(options.material);
+    const bool     isConvex = options.convexity < 0 ? shape.isConvex : options.convexity == 1;
+    const iREAL    epsilon  = options.epsilon >= 0.0 ? options.epsilon : (shape.isSphere ? 0.1 : 0.5);
+
+    // bodies are independent, every one copies the template of its shape
+    #pragma omp parallel for schedule(static)
+    for(int k=0; k<placement.count; k++)
+    {
+      const int id = first+k;
+      std::array<iREAL, 3> location, linear;
+      place(placement, k, location, linear);
+
+      if(shape.isSphere)
+      {
+        scene.objects[id] = demolish::Object(shape.radius, id, location, material, options.isObstacle,
+                                             options.isFriction, epsilon, linear, options.angular);
+      }
+      else
+      {
+        scene.meshes[id].reset(new demolish::Mesh(*shape.mesh));
+        scene.objects[id] = demolish::Object(id, scene.meshes[id].get(), location, material, options.isObstacle,
+                                             options.isFriction, isConvex, epsilon, linear, options.angular);
+      }
+    }
+
+    if(options.cellSize > 0.0)
+    {
+      for(int k=0; k<placement.count; k++)
+      {
+        scene.fields.push_back({first+k, options.cellSize, options.bandWidth, 0});
+      }
+    }
+    first += placement.count;
+  }
+  return true;
+}
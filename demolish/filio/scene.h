@@ -0,0 +1,106 @@
+#ifndef DEMOLISH_IO_SCENE
+#define DEMOLISH_IO_SCENE
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "../Object.h"
+#include "checkpoint.h"
+#include "../resolution/impulses.h"
+
+/*
+ * Scene files
+ *
+ * A scene is a text file with one statement per line. Lines starting
+ * with # are skipped. Shapes are declared once and instanced by name.
+ * Every mesh instance gets a copy of its shape, built and welded once.
+ *
+ *   gravity     g                          acceleration in y, -9.81
+ *   steps       n                          steps of a batch run
+ *   materials   file                       contact parameters, see material.h
+ *   trajectory  file interval [contacts]   see World::openTrajectory
+ *   checkpoint  file                       written after the last step
+ *   reorder     interval                   see World::setReorderInterval,
+ *                                          100 by default
+ *   timestep    dt                         see World::setTimestep
+ *   multirate   levels                     see World::setMultiRateLevels
+ *   solver      penalty|impulses [sweeps [residual]]
+ *                                          see World::setContactSolver and
+ *                                          World::setSolverLimits
+ *
+ *   shape name box     dx dy dz
+ *   shape name cone    topRadius bottomRadius height resolution
+ *   shape name hopper  topRadius bottomRadius height
+ *   shape name mesh    file [scale s]      STL or OBJ, see input.h
+ *   shape name sphere  radius
+ *
+ *   body  shape x y z [options]
+ *   grid  shape nx ny nz  x y z  dx dy dz [options]
+ *   emit  shape count  x0 y0 z0  x1 y1 z1 [spacing s] [speed v] [seed n] [options]
+ *
+ * options:
+ *   material GOLD|GRAPHITE|WOOD   WOOD by default
+ *   obstacle                      fixed in space
+ *   frictionless
+ *   convex | concave              hoppers and loaded meshes are concave,
+ *                                 the other shapes convex
+ *   epsilon e                     contact margin, 0.5 for meshes and 0.1
+ *                                 for spheres
+ *   velocity vx vy vz
+ *   spin wx wy wz
+ *   field cellSize bandWidth      distance field of an obstacle, see
+ *                                 World::createDistanceField
+ *
+ * A grid places nx*ny*nz bodies from x y z in steps of dx dy dz. An
+ * emitter fills the box x0..x1 with count bodies: they sit on a lattice
+ * one body size apart (or spacing) from the bottom layer up, are moved
+ * randomly within the free space of their lattice cell and get a random
+ * velocity of up to speed per axis on top of their velocity. The random
+ * numbers depend on seed and the index of the body only, so a scene is
+ * the same for every number of threads.
+ *
+ * Relative paths of materials and mesh files are taken from the
+ * directory of the scene file. Output files are relative to the working
+ * directory.
+ */
+
+namespace demolish {
+  namespace scene {
+    struct Scene {
+      // global particle id = index, ready for World
+      std::vector<demolish::Object>                  objects;
+      // mesh of every object, empty for spheres; must outlive the World
+      std::vector<std::unique_ptr<demolish::Mesh>>   meshes;
+      std::vector<demolish::checkpoint::Field>       fields;
+
+      iREAL                                          gravity            = -9.81;
+      int                                            steps              = 0;
+      std::string                                    trajectory;
+      int                                            trajectoryInterval = 1;
+      bool                                           trajectoryContacts = false;
+      std::string                                    checkpoint;
+      int                                            reorderInterval    = 100;
+      iREAL                                          timestep           = 0.005;
+      int                                            multiRateLevels    = 0;
+      demolish::resolution::ContactSolver            contactSolver      = demolish::resolution::ContactSolver::PENALTY;
+      int                                            solverSweeps       = 50;
+      iREAL                                          solverResidual     = 1e-4;
+    };
+
+    /*
+     *  Load
+     *
+     *  Reads a scene file and builds its objects. Mesh templates are
+     *  built once per shape; the objects are constructed in parallel.
+     *
+     *  @param filename : scene file
+     *  @param scene    : filled with the objects and run settings
+     *  @returns false if the file, a material or a mesh file cannot be
+     *           read or a line is invalid; a message gives the line
+     */
+    bool load(const std::string& filename, Scene& scene);
+  }
+}
+
+#endif
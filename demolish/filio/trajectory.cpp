@@ -0,0 +1,394 @@
+#include "trajectory.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  const char     magic[8] = {'D','E','M','O','T','R','A','J'};
+  const uint32_t version  = 1;
+  const uint32_t marker   = 0x454d5246; // "FRME"
+
+  enum FileFlags {
+    CONTACTS = 1
+  };
+
+  struct FileHeader {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  realBytes;
+    uint32_t  flags;
+    uint32_t  padding;
+  };
+
+  struct FrameHeader {
+    uint32_t  marker;
+    uint32_t  padding;
+    int64_t   step;
+    iREAL     timestep;
+    uint64_t  numberOfBodies;
+    uint64_t  numberOfContacts;
+  };
+
+  uint64_t frameBytes(const FrameHeader& header)
+  {
+    return sizeof(FrameHeader) + header.numberOfBodies*sizeof(demolish::trajectory::Body)
+                               + header.numberOfContacts*sizeof(demolish::trajectory::Contact);
+  }
+}
+
+// ****************************************************
+//  writer
+// ****************************************************
+
+demolish::trajectory::Writer::Writer(int numberOfBuffers):
+  _frames(std::max(numberOfBuffers, 1)),
+  _acquired(-1),
+  _closing(false),
+  _failed(false),
+  _contacts(false),
+  _file(nullptr),
+  _index(nullptr),
+  _offset(0)
+{
+}
+
+demolish::trajectory::Writer::~Writer()
+{
+  close();
+}
+
+bool demolish::trajectory::Writer::open(const std::string& filename, bool contacts)
+{
+  close();
+
+  _file  = std::fopen(filename.c_str(), "wb");
+  _index = std::fopen((filename + ".idx").c_str(), "wb");
+  if(_file == nullptr || _index == nullptr)
+  {
+    close();
+    return false;
+  }
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version   = version;
+  header.realBytes = sizeof(iREAL);
+  header.flags     = contacts ? CONTACTS : 0;
+  if(std::fwrite(&header, sizeof(header), 1, _file) != 1 || std::fflush(_file) != 0)
+  {
+    close();
+    return false;
+  }
+
+  _offset   = sizeof(header);
+  _contacts = contacts;
+  _failed   = false;
+  _closing  = false;
+  _acquired = -1;
+  _free.clear();
+  _queued.clear();
+  for(int i=0; i<_frames.size(); i++) _free.push_back(i);
+
+  _thread = std::thread(&demolish::trajectory::Writer::run, this);
+  return true;
+}
+
+bool demolish::trajectory::Writer::isOpen() const
+{
+  return _file != nullptr;
+}
+
+bool demolish::trajectory::Writer::getWritesContacts() const
+{
+  return _contacts;
+}
+
+demolish::trajectory::Frame& demolish::trajectory::Writer::acquire()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _changed.wait(lock, [this]() {return !_free.empty();});
+  _acquired = _free.front();
+  _free.pop_front();
+  return _frames[_acquired];
+}
+
+void demolish::trajectory::Writer::submit()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_acquired < 0) return;
+    _queued.push_back(_acquired);
+    _acquired = -1;
+  }
+  _changed.notify_all();
+}
+
+bool demolish::trajectory::Writer::close()
+{
+  if(_thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _closing = true;
+    }
+    _changed.notify_all();
+    _thread.join();
+  }
+
+  if(_file  != nullptr && std::fclose(_file)  != 0) _failed = true;
+  if(_index != nullptr && std::fclose(_index) != 0) _failed = true;
+  _file  = nullptr;
+  _index = nullptr;
+  return !_failed;
+}
+
+void demolish::trajectory::Writer::run()
+{
+  while(true)
+  {
+    int frame;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _changed.wait(lock, [this]() {return !_queued.empty() || _closing;});
+      if(_queued.empty()) return;
+      frame = _queued.front();
+      _queued.pop_front();
+    }
+
+    // a failed write keeps the buffers cycling, the simulation must not hang
+    if(!_failed && !write(_frames[frame])) _failed = true;
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _free.push_back(frame);
+    }
+    _changed.notify_all();
+  }
+}
+
+bool demolish::trajectory::Writer::write(const Frame& frame)
+{
+  FrameHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.marker           = marker;
+  header.step             = frame.step;
+  header.timestep         = frame.timestep;
+  header.numberOfBodies   = frame.bodies.size();
+  header.numberOfContacts = _contacts ? frame.contacts.size() : 0;
+
+  if(std::fwrite(&header, sizeof(header), 1, _file) != 1) return false;
+  if(std::fwrite(frame.bodies.data(), sizeof(Body), header.numberOfBodies, _file) != header.numberOfBodies) return false;
+  if(std::fwrite(frame.contacts.data(), sizeof(Contact), header.numberOfContacts, _file) != header.numberOfContacts) return false;
+  if(std::fflush(_file) != 0) return false;
+
+  // the frame is complete, only now it is listed
+  IndexEntry entry = {frame.step, _offset};
+  if(std::fwrite(&entry, sizeof(entry), 1, _index) != 1 || std::fflush(_index) != 0) return false;
+  _offset += frameBytes(header);
+  return true;
+}
+
+// ****************************************************
+//  reader
+// ****************************************************
+
+demolish::trajectory::Reader::Reader():
+  _data(nullptr),
+  _bytes(0)
+{
+}
+
+demolish::trajectory::Reader::~Reader()
+{
+  close();
+}
+
+void demolish::trajectory::Reader::close()
+{
+  if(_data != nullptr) ::munmap(const_cast<char*>(_data), _bytes);
+  _data  = nullptr;
+  _bytes = 0;
+  _offsets.clear();
+}
+
+bool demolish::trajectory::Reader::open(const std::string& filename)
+{
+  close();
+
+  int file = ::open(filename.c_str(), O_RDONLY);
+  if(file < 0) return false;
+  struct stat status;
+  if(::fstat(file, &status) != 0 || status.st_size < sizeof(FileHeader))
+  {
+    ::close(file);
+    return false;
+  }
+  void* mapping = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if(mapping == MAP_FAILED) return false;
+  _data  = static_cast<const char*>(mapping);
+  _bytes = status.st_size;
+
+  FileHeader header;
+  std::memcpy(&header, _data, sizeof(header));
+  if(std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.realBytes != sizeof(iREAL))
+  {
+    close();
+    return false;
+  }
+
+  // a frame is valid if its header has the marker and it fits the file
+  auto isFrame = [this](uint64_t offset)
+  {
+    if(offset > _bytes || _bytes-offset < sizeof(FrameHeader)) return false;
+    FrameHeader frame;
+    std::memcpy(&frame, _data+offset, sizeof(frame));
+    if(frame.marker != marker) return false;
+    if(frame.numberOfBodies > _bytes || frame.numberOfContacts > _bytes) return false;
+    return frameBytes(frame) <= _bytes-offset;
+  };
+
+  std::ifstream index(filename + ".idx", std::ios::binary);
+  IndexEntry entry;
+  while(index.read(reinterpret_cast<char*>(&entry), sizeof(entry)))
+  {
+    if(!isFrame(entry.offset))
+    {
+      _offsets.clear();
+      break;
+    }
+    _offsets.push_back(entry.offset);
+  }
+
+  // no index, or one that does not match: walk the frames
+  if(_offsets.empty())
+  {
+    uint64_t offset = sizeof(FileHeader);
+    while(isFrame(offset))
+    {
+      _offsets.push_back(offset);
+      FrameHeader frame;
+      std::memcpy(&frame, _data+offset, sizeof(frame));
+      offset += frameBytes(frame);
+    }
+  }
+  return true;
+}
+
+int demolish::trajectory::Reader::getNumberOfFrames() const
+{
+  return _offsets.size();
+}
+
+bool demolish::trajectory::Reader::readFrame(int frame, Frame& data) const
+{
+  if(frame < 0 || frame >= _offsets.size()) return false;
+
+  const char* pointer = _data + _offsets[frame];
+  FrameHeader header;
+  std::memcpy(&header, pointer, sizeof(header));
+  pointer += sizeof(header);
+
+  data.step     = header.step;
+  data.timestep = header.timestep;
+  data.bodies.resize(header.numberOfBodies);
+  data.contacts.resize(header.numberOfContacts);
+  std::memcpy(data.bodies.data(), pointer, header.numberOfBodies*sizeof(Body));
+  pointer += header.numberOfBodies*sizeof(Body);
+  std::memcpy(data.contacts.data(), pointer, header.numberOfContacts*sizeof(Contact));
+  return true;
+}
+
+// ****************************************************
+//  VTK export
+// ****************************************************
+
+int demolish::trajectory::convertToVTK(
+  const std::string&   filename,
+  const std::string&   prefix)
+{
+  Reader reader;
+  if(!reader.open(filename)) return -1;
+
+  Frame frame;
+  for(int f=0; f<reader.getNumberOfFrames(); f++)
+  {
+    if(!reader.readFrame(f, frame)) return f;
+
+    std::ofstream out(prefix + "_" + std::to_string(f) + ".vtk");
+    if(!out) return f;
+    out << std::setprecision(17);
+    const int n = frame.bodies.size();
+
+    out << "# vtk DataFile Version 3.0\n";
+    out << "demolish step " << frame.step << " timestep " << frame.timestep << "\n";
+    out << "ASCII\nDATASET POLYDATA\n";
+    out << "POINTS " << n << " double\n";
+    for(const Body& body : frame.bodies)
+    {
+      out << body.location[0] << " " << body.location[1] << " " << body.location[2] << "\n";
+    }
+    out << "VERTICES " << n << " " << 2*n << "\n";
+    for(int i=0; i<n; i++) out << "1 " << i << "\n";
+
+    out << "POINT_DATA " << n << "\n";
+    out << "SCALARS id int 1\nLOOKUP_TABLE default\n";
+    for(const Body& body : frame.bodies) out << body.id << "\n";
+    out << "SCALARS flags int 1\nLOOKUP_TABLE default\n";
+    for(const Body& body : frame.bodies) out << body.flags << "\n";
+    out << "VECTORS linearVelocity double\n";
+    for(const Body& body : frame.bodies)
+    {
+      out << body.linearVelocity[0] << " " << body.linearVelocity[1] << " " << body.linearVelocity[2] << "\n";
+    }
+    out << "VECTORS angularVelocity double\n";
+    for(const Body& body : frame.bodies)
+    {
+      out << body.angularVelocity[0] << " " << body.angularVelocity[1] << " " << body.angularVelocity[2] << "\n";
+    }
+    // the orientation is column-major, VTK reads tensors row by row
+    out << "TENSORS orientation double\n";
+    for(const Body& body : frame.bodies)
+    {
+      const iREAL* R = body.orientation;
+      out << R[0] << " " << R[3] << " " << R[6] << "\n"
+          << R[1] << " " << R[4] << " " << R[7] << "\n"
+          << R[2] << " " << R[5] << " " << R[8] << "\n";
+    }
+    if(!out) return f;
+
+    if(frame.contacts.empty()) continue;
+
+    std::ofstream contacts(prefix + "_contacts_" + std::to_string(f) + ".vtk");
+    if(!contacts) return f;
+    contacts << std::setprecision(17);
+    const int m = frame.contacts.size();
+
+    contacts << "# vtk DataFile Version 3.0\n";
+    contacts << "demolish contacts step " << frame.step << "\n";
+    contacts << "ASCII\nDATASET POLYDATA\n";
+    contacts << "POINTS " << m << " double\n";
+    for(const Contact& contact : frame.contacts)
+    {
+      contacts << contact.x[0] << " " << contact.x[1] << " " << contact.x[2] << "\n";
+    }
+    contacts << "VERTICES " << m << " " << 2*m << "\n";
+    for(int i=0; i<m; i++) contacts << "1 " << i << "\n";
+    contacts << "POINT_DATA " << m << "\n";
+    contacts << "SCALARS depth double 1\nLOOKUP_TABLE default\n";
+    for(const Contact& contact : frame.contacts) contacts << contact.depth << "\n";
+    contacts << "VECTORS normal double\n";
+    for(const Contact& contact : frame.contacts)
+    {
+      contacts << contact.normal[0] << " " << contact.normal[1] << " " << contact.normal[2] << "\n";
+    }
+    if(!contacts) return f;
+  }
+  return reader.getNumberOfFrames();
+}
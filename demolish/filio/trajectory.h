@@ -0,0 +1,198 @@
+#ifndef DEMOLISH_IO_TRAJECTORY
+#define DEMOLISH_IO_TRAJECTORY
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+
+#include "../demolish.h"
+
+/*
+ * Trajectory output
+ *
+ * A trajectory is an append-only binary file of frames. Every frame holds
+ * the position, orientation and velocities of all bodies after a step
+ * and, optionally, the contact points of that step. Next to it,
+ * <filename>.idx lists the step and file offset of every frame, so a
+ * frame can be found without reading the ones before it. An index entry
+ * is only appended once its frame is on disk. If the run stops while a
+ * frame is written, the index still describes a valid prefix.
+ *
+ * The Writer copies a frame on the simulation thread and writes it on a
+ * thread of its own. It owns a fixed number of frame buffers. When all of
+ * them are queued, the simulation waits for the disk (back-pressure), so
+ * the memory of the writer is bounded by the number of buffers.
+ *
+ * Frames are in native byte order:
+ *
+ *   file    : magic "DEMOTRAJ", version, sizeof(iREAL), flags
+ *   frame   : FrameHeader, Body[numberOfBodies], Contact[numberOfContacts]
+ *   index   : IndexEntry per frame
+ */
+
+namespace demolish {
+  namespace trajectory {
+    struct Body {
+      int32_t   id;
+      int32_t   flags;             // SPHERE | OBSTACLE
+      iREAL     location[3];
+      iREAL     orientation[9];
+      iREAL     linearVelocity[3];
+      iREAL     angularVelocity[3];
+    };
+
+    enum BodyFlags {
+      SPHERE   = 1,
+      OBSTACLE = 2
+    };
+
+    struct Contact {
+      int32_t   indexA;
+      int32_t   indexB;
+      iREAL     x[3];
+      iREAL     normal[3];
+      iREAL     depth;
+    };
+
+    struct Frame {
+      int64_t               step;
+      iREAL                 timestep;
+      std::vector<Body>     bodies;
+      std::vector<Contact>  contacts;
+    };
+
+    struct IndexEntry {
+      int64_t   step;
+      uint64_t  offset;
+    };
+
+    class Writer;
+    class Reader;
+
+    /*
+     *  Convert To VTK
+     *
+     *  Writes every frame as a legacy VTK poly data file
+     *  <prefix>_<frame>.vtk with the body centres as points and id,
+     *  velocities and orientation as point data. Frames with contacts
+     *  also get <prefix>_contacts_<frame>.vtk with the contact points,
+     *  their normals and depths.
+     *
+     *  @param filename : trajectory file
+     *  @param prefix   : prefix of the VTK files, may contain a directory
+     *  @returns the number of frames written, -1 if the trajectory
+     *           cannot be read
+     */
+    int convertToVTK(
+      const std::string&   filename,
+      const std::string&   prefix);
+  }
+}
+
+class demolish::trajectory::Writer {
+  public:
+	/*
+	 *  Writer
+	 *
+	 *  @param numberOfBuffers : frames that may be in flight, two gives
+	 *                           double buffering
+	 */
+	Writer(int numberOfBuffers = 2);
+
+	// writes the frames still queued
+	~Writer();
+
+	/*
+	 *  Open
+	 *
+	 *  Starts a new trajectory and its index, existing files are
+	 *  replaced.
+	 *
+	 *  @returns false if a file cannot be created
+	 */
+	bool open(const std::string& filename, bool contacts);
+
+	bool isOpen() const;
+	bool getWritesContacts() const;
+
+	/*
+	 *  Acquire
+	 *
+	 *  Returns a free frame buffer to be filled by the caller. Blocks
+	 *  while all buffers are waiting to be written. The buffer keeps its
+	 *  storage from earlier frames.
+	 */
+	Frame& acquire();
+
+	/*
+	 *  Submit
+	 *
+	 *  Queues the frame returned by the last acquire for writing.
+	 */
+	void submit();
+
+	/*
+	 *  Close
+	 *
+	 *  Writes the queued frames and closes the files.
+	 *
+	 *  @returns false if any frame could not be written
+	 */
+	bool close();
+
+  private:
+	void run();
+	bool write(const Frame& frame);
+
+	std::vector<Frame>        _frames;
+	std::deque<int>           _free;
+	std::deque<int>           _queued;
+	int                       _acquired;
+
+	std::thread               _thread;
+	std::mutex                _mutex;
+	std::condition_variable   _changed;
+	bool                      _closing;
+	bool                      _failed;
+	bool                      _contacts;
+
+	std::FILE*                _file;
+	std::FILE*                _index;
+	uint64_t                  _offset;
+};
+
+/*
+ * Maps a trajectory and its index. Without a usable index the frames are
+ * found by walking the file from the start.
+ */
+class demolish::trajectory::Reader {
+  public:
+	Reader();
+	~Reader();
+
+	bool open(const std::string& filename);
+	void close();
+
+	int  getNumberOfFrames() const;
+
+	/*
+	 *  Read Frame
+	 *
+	 *  @param frame : index of the frame, 0 is the first one
+	 *  @param data  : filled with the frame
+	 *  @returns false if the frame is out of range or damaged
+	 */
+	bool readFrame(int frame, Frame& data) const;
+
+  private:
+	const char*               _data;
+	std::size_t               _bytes;
+	std::vector<uint64_t>     _offsets;
+};
+
+#endif
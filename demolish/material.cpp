@@ -2,14 +2,93 @@
 
 #include "material.h"
 
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace {
+  struct DefaultTable {
+    DefaultTable()
+    {
+      demolish::material::materialInit();
+    }
+  };
+}
+
+demolish::material::InteractionParameters demolish::material::interactionTable[2][demolish::material::NUMBEROFMATERIALS][demolish::material::NUMBEROFMATERIALS];
+
+static DefaultTable defaultTable;
+
 void demolish::material::materialInit()
 {
-    // hello
+  for(int a=0; a<NUMBEROFMATERIALS; a++)
+  {
+    for(int b=0; b<NUMBEROFMATERIALS; b++)
+    {
+      interactionTable[MESH][a][b]   = defaultMeshInteraction;
+      interactionTable[SPHERE][a][b] = defaultSphereInteraction;
+    }
+  }
 }
 
-int demolish::material::getInterfaceType(int materialA, int materialB)
+int demolish::material::getMaterialFromName(const std::string& name)
 {
-  return materialA*materialB;
+  if(name == "GOLD")     return int(demolish::material::MaterialType::GOLD);
+  if(name == "GRAPHITE") return int(demolish::material::MaterialType::GRAPHITE);
+  if(name == "WOOD")     return int(demolish::material::MaterialType::WOOD);
+  return -1;
 }
 
+bool demolish::material::materialInit(const std::string& filename)
+{
+  materialInit();
+
+  std::ifstream file(filename);
+  if(!file)
+  {
+    std::cout << "cannot open material file " << filename << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int lineNumber = 0;
+  while(std::getline(file, line))
+  {
+    lineNumber++;
+    if(line.empty() || line[0] == '#') continue;
 
+    std::istringstream stream(line);
+    std::string geometryName, nameA, nameB;
+    InteractionParameters parameters = defaultMeshInteraction;
+    if(!(stream >> geometryName)) continue;
+    stream >> nameA >> nameB >> parameters.spring >> parameters.damper >> parameters.friction;
+    if(!stream)
+    {
+      std::cout << filename << ":" << lineNumber << ": expected geometry, two materials, spring, damper and friction" << std::endl;
+      return false;
+    }
+    stream >> parameters.tangential;
+
+    int geometry  = geometryName == "sphere" ? SPHERE : (geometryName == "mesh" ? MESH : -1);
+    int materialA = getMaterialFromName(nameA);
+    int materialB = getMaterialFromName(nameB);
+    if(geometry < 0 || materialA < 0 || materialB < 0)
+    {
+      std::cout << filename << ":" << lineNumber << ": unknown geometry or material" << std::endl;
+      return false;
+    }
+
+    interactionTable[geometry][materialA][materialB] = parameters;
+    interactionTable[geometry][materialB][materialA] = parameters;
+  }
+
+#ifdef DEMOLISH_SINGLE_MATERIAL
+  std::cout << "built with DEMOLISH_SINGLE_MATERIAL, " << filename << " is ignored by the contact kernels" << std::endl;
+#endif
+  return true;
+}
+
+int demolish::material::getInterfaceType(int materialA, int materialB)
+{
+  return materialA*NUMBEROFMATERIALS + materialB;
+}
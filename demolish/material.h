@@ -5,6 +5,7 @@
 #include"demolish.h"
 
 #include <map>
+#include <string>
 
 namespace demolish {
     namespace material {
@@ -28,10 +29,81 @@ namespace demolish {
     	  		  { demolish::material::MaterialType::GRAPHITE, 1000},
     	  		  { demolish::material::MaterialType::GOLD,     1000}});
 
+      /*
+       * Contact parameters of a material pair. The sphere kernel uses its
+       * own stiffness scale, so every pair has one entry for mesh and one
+       * for sphere-sphere contacts.
+       */
+      struct InteractionParameters {
+        iREAL spring;     // normal stiffness
+        iREAL damper;     // normal damping ratio
+        iREAL friction;   // Coulomb coefficient
+        iREAL tangential; // tangential over normal stiffness
+      };
+
+      // largest MaterialType value plus one
+      constexpr int NUMBEROFMATERIALS = 4;
+
+      enum Geometry {
+        MESH   = 0,
+        SPHERE = 1
+      };
+
+      constexpr InteractionParameters defaultMeshInteraction   = {5E3, 0.5, 1.0, 2.0/7.0};
+      // 200000^(3/2), the stiffness the sphere kernel has always used
+      constexpr InteractionParameters defaultSphereInteraction = {8.94427190999916E7, 0.5, 1.0, 2.0/7.0};
+
+      // dense [geometry][materialA][materialB] table, symmetric in A and B
+      extern InteractionParameters interactionTable[2][NUMBEROFMATERIALS][NUMBEROFMATERIALS];
+
+      /*
+       *  Get Interaction
+       *
+       *  Returns the contact parameters of a material pair. With
+       *  DEMOLISH_SINGLE_MATERIAL the defaults are compile-time constants
+       *  and the lookup folds away.
+       *
+       *  @param geometry  : MESH or SPHERE
+       *  @param materialA : material of A
+       *  @param materialB : material of B
+       *  @returns parameters of the pair
+       */
+#ifdef DEMOLISH_SINGLE_MATERIAL
+      constexpr InteractionParameters getInteraction(int geometry, int materialA, int materialB)
+      {
+        return geometry == SPHERE ? defaultSphereInteraction : defaultMeshInteraction;
+      }
+#else
+      inline const InteractionParameters& getInteraction(int geometry, int materialA, int materialB)
+      {
+        return interactionTable[geometry][materialA][materialB];
+      }
+#endif
 
       int getInterfaceType(int materialA, int materialB);
 
+      /*
+       *  Get Material From Name
+       *
+       *  @param name : GOLD, GRAPHITE or WOOD
+       *  @returns the MaterialType as int, -1 if the name is unknown
+       */
+      int getMaterialFromName(const std::string& name);
+
+      /*
+       *  Material Init
+       *
+       *  Resets the table to the defaults. The second version then reads
+       *  the pairs given in a file, one per line:
+       *
+       *    mesh|sphere  MATERIALA  MATERIALB  spring  damper  friction  [tangential]
+       *
+       *  Lines starting with # are skipped. A pair sets both A-B and B-A.
+       *
+       *  @returns false if the file cannot be read or has an invalid line
+       */
       extern void materialInit();
+      bool materialInit(const std::string& filename);
       int getCollisionInterface();
     }
   }
@@ -1,5 +1,6 @@
 #include "math.h"
 #include <cmath>
+#include <algorithm>
 
 
 
@@ -66,3 +67,30 @@ void demolish::normalise(iREAL x[3]) {
   x[1] /= length;
   x[2] /= length;
 }
+
+
+namespace {
+  // inserts two zero bits after every one of the lowest 21 bits
+  uint64_t spread(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8)  & 0x100f00f00f00f00full;
+    v = (v | v << 4)  & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2)  & 0x1249249249249249ull;
+    return v;
+  }
+}
+
+
+uint64_t demolish::mortonCode(const iREAL x[3], const iREAL lower[3], const iREAL upper[3]) {
+  const iREAL cells = (1 << 21) - 1;
+  uint64_t code = 0;
+  for(int d=0; d<3; d++) {
+    iREAL width = upper[d] - lower[d];
+    iREAL t     = width > 0.0 ? (x[d] - lower[d]) / width : 0.0;
+    t = std::min(std::max(t, iREAL(0.0)), iREAL(1.0));
+    code |= spread(uint64_t(t * cells)) << d;
+  }
+  return code;
+}
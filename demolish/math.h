@@ -5,6 +5,7 @@
 
 #include "demolish.h"
 #include "Vertex.h"
+#include <cstdint>
 
 namespace demolish {
   /**
@@ -36,6 +37,13 @@ namespace demolish {
   void mult(iREAL col0[3], iREAL col1[3], iREAL col2[3], iREAL x[3], iREAL result[3]);
 
   void normalise(iREAL x[3]);
+
+  /**
+   * Morton code of x within the box lower..upper: every coordinate is
+   * quantised to 21 bits and the bits are interleaved, x lowest. Points
+   * outside the box are clamped to it.
+   */
+  uint64_t mortonCode(const iREAL x[3], const iREAL lower[3], const iREAL upper[3]);
 }
 
 #endif
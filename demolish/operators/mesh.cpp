@@ -1,10 +1,16 @@
 
 #include "mesh.h"
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <limits>
 
 void demolish::operators::shiftMesh(
-    std::vector<iREAL> &xCoordinates,
-    std::vector<iREAL> &yCoordinates,
-    std::vector<iREAL> &zCoordinates,
+    std::vector<iVERTEX> &xCoordinates,
+    std::vector<iVERTEX> &yCoordinates,
+    std::vector<iVERTEX> &zCoordinates,
     std::vector<demolish::Vertex> &verts,
     iREAL center[3])
 {
@@ -30,9 +36,9 @@ void demolish::operators::shiftMesh(
 
 
 void demolish::operators::scaleXYZ(
-    std::vector<iREAL> &xCoordinates,
-    std::vector<iREAL> &yCoordinates,
-    std::vector<iREAL> &zCoordinates,
+    std::vector<iVERTEX> &xCoordinates,
+    std::vector<iVERTEX> &yCoordinates,
+    std::vector<iVERTEX> &zCoordinates,
     std::vector<demolish::Vertex> &verts,
     iREAL scale,
     iREAL position[3])
@@ -51,9 +57,9 @@ void demolish::operators::scaleXYZ(
 }
 
 void demolish::operators::rotateX(
-    std::vector<iREAL> &xCoordinates,
-    std::vector<iREAL> &yCoordinates,
-    std::vector<iREAL> &zCoordinates,
+    std::vector<iVERTEX> &xCoordinates,
+    std::vector<iVERTEX> &yCoordinates,
+    std::vector<iVERTEX> &zCoordinates,
     iREAL alphaX)
 {
   const iREAL pi = std::acos(-1);
@@ -77,9 +83,9 @@ void demolish::operators::rotateX(
 }
 
 void demolish::operators::rotateY(
-    std::vector<iREAL> &xCoordinates,
-    std::vector<iREAL> &yCoordinates,
-    std::vector<iREAL> &zCoordinates,
+    std::vector<iVERTEX> &xCoordinates,
+    std::vector<iVERTEX> &yCoordinates,
+    std::vector<iVERTEX> &zCoordinates,
     iREAL alphaY)
 {
   const iREAL pi = std::acos(-1);
@@ -101,9 +107,9 @@ void demolish::operators::rotateY(
 }
 
 void demolish::operators::rotateZ(
-    std::vector<iREAL> &xCoordinates,
-    std::vector<iREAL> &yCoordinates,
-    std::vector<iREAL> &zCoordinates,
+    std::vector<iVERTEX> &xCoordinates,
+    std::vector<iVERTEX> &yCoordinates,
+    std::vector<iVERTEX> &zCoordinates,
     iREAL alphaZ)
 {
   const iREAL pi = std::acos(-1);
@@ -127,3 +133,241 @@ void demolish::operators::rotateZ(
 
 
 
+
+namespace {
+  inline uint64_t cellHash(const int64_t cell[3])
+  {
+    uint64_t hash = uint64_t(cell[0])*0x9E3779B97F4A7C15ull ^ uint64_t(cell[1])*0xC2B2AE3D27D4EB4Full ^ uint64_t(cell[2])*0x165667B19E3779F9ull;
+    return hash ^ (hash >> 29);
+  }
+
+  // identical coordinates get identical keys, -0 is folded onto 0
+  inline int64_t coordinateKey(iREAL x)
+  {
+    int64_t bits;
+    iREAL   folded = x+0.0;
+    std::memcpy(&bits, &folded, sizeof(bits));
+    return bits;
+  }
+
+  /*
+   * Hash grid over a fixed set of vertices. Cells are the quantised
+   * coordinates, or the coordinate bits if the grid is exact. The table is
+   * open addressing, every slot holds the lowest vertex index of its cell
+   * and the head of a chain through all vertices of the cell. The chain
+   * order depends on the threads, the lowest index does not.
+   */
+  class VertexGrid {
+    public:
+      VertexGrid(const iREAL* x, const iREAL* y, const iREAL* z, int n, iREAL cellSize):
+        _exact(cellSize <= 0.0),
+        _inverse(cellSize > 0.0 ? 1.0/cellSize : 0.0),
+        _points(n),
+        _slotOf(n),
+        _next(n)
+      {
+        // interleaved, a comparison touches one cache line instead of three
+        #pragma omp parallel for
+        for(int i=0; i<n; i++) _points[i] = {x[i], y[i], z[i]};
+
+        std::size_t capacity = 16;
+        while(capacity < 2*std::size_t(n)) capacity *= 2;
+        _mask = capacity-1;
+
+        _head   = std::vector<std::atomic<int>>(capacity);
+        _lowest = std::vector<std::atomic<int>>(capacity);
+        #pragma omp parallel for
+        for(std::size_t s=0; s<capacity; s++)
+        {
+          _head[s].store(-1, std::memory_order_relaxed);
+          _lowest[s].store(std::numeric_limits<int>::max(), std::memory_order_relaxed);
+        }
+
+        #pragma omp parallel for
+        for(int i=0; i<n; i++)
+        {
+          int64_t cell[3];
+          cellOf(i, cell);
+          std::size_t slot = cellHash(cell) & _mask;
+          while(true)
+          {
+            int head = _head[slot].load();
+            if(head < 0)
+            {
+              _next[i] = -1;
+              if(_head[slot].compare_exchange_strong(head, i)) break;
+            }
+            if(isInCell(head, cell))
+            {
+              // all vertices of the chain share the cell, a retry stays in it
+              do {_next[i] = head;} while(!_head[slot].compare_exchange_weak(head, i));
+              break;
+            }
+            slot = (slot+1) & _mask;
+          }
+          _slotOf[i] = slot;
+
+          int lowest = _lowest[slot].load();
+          while(i < lowest && !_lowest[slot].compare_exchange_weak(lowest, i));
+        }
+      }
+
+      const std::array<iREAL, 3>& point(int i) const
+      {
+        return _points[i];
+      }
+
+      void cellOf(int i, int64_t cell[3]) const
+      {
+        for(int d=0; d<3; d++)
+        {
+          cell[d] = _exact ? coordinateKey(_points[i][d]) : int64_t(std::floor(_points[i][d]*_inverse));
+        }
+      }
+
+      // side of the cell centre the vertex is on, -1 or 1 per axis
+      void sideOf(int i, int64_t side[3]) const
+      {
+        for(int d=0; d<3; d++)
+        {
+          const iREAL position = _points[i][d]*_inverse;
+          side[d] = position-std::floor(position) < 0.5 ? -1 : 1;
+        }
+      }
+
+      int ownSlot(int i) const
+      {
+        return _slotOf[i];
+      }
+
+      // slot of a cell, -1 if no vertex lies in it
+      int find(const int64_t cell[3]) const
+      {
+        std::size_t slot = cellHash(cell) & _mask;
+        while(true)
+        {
+          int head = _head[slot].load(std::memory_order_relaxed);
+          if(head < 0) return -1;
+          if(isInCell(head, cell)) return slot;
+          slot = (slot+1) & _mask;
+        }
+      }
+
+      int lowest(int slot) const
+      {
+        return _lowest[slot].load(std::memory_order_relaxed);
+      }
+
+      // lowest vertex of the slot below bound that satisfies the predicate,
+      // bound if there is none
+      template<typename Predicate>
+      int lowest(int slot, int bound, Predicate predicate) const
+      {
+        const int first = lowest(slot);
+        if(first >= bound) return bound;
+        if(predicate(first)) return first;
+        for(int j=_head[slot].load(std::memory_order_relaxed); j>=0; j=_next[j])
+        {
+          if(j < bound && predicate(j)) bound = j;
+        }
+        return bound;
+      }
+
+    private:
+      bool isInCell(int i, const int64_t cell[3]) const
+      {
+        int64_t own[3];
+        cellOf(i, own);
+        return own[0] == cell[0] && own[1] == cell[1] && own[2] == cell[2];
+      }
+
+      bool                               _exact;
+      iREAL                              _inverse;
+      std::vector<std::array<iREAL, 3>>  _points;
+      std::vector<int>                   _slotOf;
+      std::vector<int>                   _next;
+      std::size_t                        _mask;
+      std::vector<std::atomic<int>>      _head;
+      std::vector<std::atomic<int>>      _lowest;
+  };
+}
+
+void demolish::operators::weldVertices(
+	const iREAL*                    xCoordinates,
+	const iREAL*                    yCoordinates,
+	const iREAL*                    zCoordinates,
+	int                             n,
+	iREAL                           tolerance,
+	std::vector<int>&               uniqueIndex,
+	std::vector<demolish::Vertex>&  uniqueVertices)
+{
+  uniqueIndex.resize(n);
+
+  // cells are twice the tolerance wide, so a vertex within tolerance lies
+  // in the own cell or in the neighbour on the nearer side of every axis:
+  // eight cells instead of 27
+  const bool exact = tolerance <= 0.0;
+  const VertexGrid grid(xCoordinates, yCoordinates, zCoordinates, n, exact ? 0.0 : 2.0*tolerance);
+
+  // every vertex links to the lowest earlier index within tolerance in its
+  // own cell or, if there is none, in the neighbour cells. This does not
+  // depend on the number of threads
+  std::vector<int>& link = uniqueIndex;
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for(int i=0; i<n; i++)
+  {
+    if(exact)
+    {
+      link[i] = grid.lowest(grid.ownSlot(i));
+      continue;
+    }
+
+    const std::array<iREAL, 3>& p = grid.point(i);
+    auto isWithinTolerance = [&](int j)
+    {
+      const std::array<iREAL, 3>& q = grid.point(j);
+      return std::abs(q[0]-p[0]) <= tolerance && std::abs(q[1]-p[1]) <= tolerance && std::abs(q[2]-p[2]) <= tolerance;
+    };
+
+    // the own cell decides if it holds an earlier vertex within tolerance,
+    // only otherwise are the neighbours searched
+    int best = grid.lowest(grid.ownSlot(i), i, isWithinTolerance);
+
+    int64_t cell[3], side[3];
+    grid.cellOf(i, cell);
+    grid.sideOf(i, side);
+    for(int neighbour=1; neighbour<8 && best==i; neighbour++)
+    {
+      const int64_t probe[3] = {cell[0] + ((neighbour & 1) ? side[0] : 0),
+                                cell[1] + ((neighbour & 2) ? side[1] : 0),
+                                cell[2] + ((neighbour & 4) ? side[2] : 0)};
+      const int slot = grid.find(probe);
+      if(slot >= 0) best = grid.lowest(slot, best, isWithinTolerance);
+    }
+    link[i] = best;
+  }
+
+  // links point backwards, so one ascending sweep resolves them to a
+  // vertex that links to itself, these become the unique vertices
+  std::vector<int> numberOfUnique(n);
+  int count = 0;
+  for(int i=0; i<n; i++)
+  {
+    link[i] = link[link[i]];
+    numberOfUnique[i] = count;
+    if(link[i] == i) count++;
+  }
+
+  uniqueVertices.resize(count);
+  #pragma omp parallel for
+  for(int i=0; i<n; i++)
+  {
+    if(link[i] == i) uniqueVertices[numberOfUnique[i]] = demolish::Vertex(xCoordinates[i], yCoordinates[i], zCoordinates[i]);
+  }
+
+  #pragma omp parallel for
+  for(int i=0; i<n; i++)
+  {
+    link[i] = numberOfUnique[link[i]];
+  }
+}
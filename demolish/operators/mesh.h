@@ -13,39 +13,73 @@
 namespace demolish {
 	namespace operators {
 	    void shiftMesh(
-		    std::vector<iREAL> &xCoordinates,
-		    std::vector<iREAL> &yCoordinates,
-		    std::vector<iREAL> &zCoordinates,
+		    std::vector<iVERTEX> &xCoordinates,
+		    std::vector<iVERTEX> &yCoordinates,
+		    std::vector<iVERTEX> &zCoordinates,
             std::vector<demolish::Vertex> &verts,
 		    iREAL center[3]);
 
 		void scaleXYZ(
-			std::vector<iREAL> &xCoordinates,
-			std::vector<iREAL> &yCoordinates,
-			std::vector<iREAL> &zCoordinates,
+			std::vector<iVERTEX> &xCoordinates,
+			std::vector<iVERTEX> &yCoordinates,
+			std::vector<iVERTEX> &zCoordinates,
             std::vector<demolish::Vertex> &verts,
 		    iREAL scale,
 		    iREAL position[3]);
 
 		void rotateX(
-			std::vector<iREAL> &xCoordinates,
-			std::vector<iREAL> &yCoordinates,
-			std::vector<iREAL> &zCoordinates,
+			std::vector<iVERTEX> &xCoordinates,
+			std::vector<iVERTEX> &yCoordinates,
+			std::vector<iVERTEX> &zCoordinates,
 			iREAL alphaX);
 
 		void rotateY(
-			std::vector<iREAL> &xCoordinates,
-			std::vector<iREAL> &yCoordinates,
-			std::vector<iREAL> &zCoordinates,
+			std::vector<iVERTEX> &xCoordinates,
+			std::vector<iVERTEX> &yCoordinates,
+			std::vector<iVERTEX> &zCoordinates,
 			iREAL alphaY);
 
 		void rotateZ(
-			std::vector<iREAL> &xCoordinates,
-			std::vector<iREAL> &yCoordinates,
-			std::vector<iREAL> &zCoordinates,
+			std::vector<iVERTEX> &xCoordinates,
+			std::vector<iVERTEX> &yCoordinates,
+			std::vector<iVERTEX> &zCoordinates,
 			iREAL alphaZ);
 
-        
+		// merge distance of meshes built from triangle soups, relative to
+		// the bounding box diagonal
+		const iREAL weldTolerance = 1E-6;
+
+		/*
+		 *  Weld Vertices
+		 *
+		 *  Merges vertices that lie within tolerance of each other. The
+		 *  vertices are put into an open addressing hash grid with cells
+		 *  twice the tolerance wide, so a vertex is only compared with the
+		 *  vertices of its own cell and of the seven cells on its nearer
+		 *  sides. Every vertex links to the lowest earlier vertex within
+		 *  tolerance, preferring its own cell, and the links are followed
+		 *  to a vertex that links to itself. The grid is built and queried in parallel, the result
+		 *  does not depend on the number of threads.
+		 *
+		 *  @param xCoordinates   : x of the n input vertices
+		 *  @param yCoordinates   : y of the n input vertices
+		 *  @param zCoordinates   : z of the n input vertices
+		 *  @param n              : number of input vertices
+		 *  @param tolerance      : merge distance per axis, 0 merges only
+		 *                          identical coordinates
+		 *  @param uniqueIndex    : index of the unique vertex of every
+		 *                          input vertex
+		 *  @param uniqueVertices : the unique vertices in order of first use
+		 *  @returns void but through parameters by reference
+		 */
+		void weldVertices(
+			const iREAL*                    xCoordinates,
+			const iREAL*                    yCoordinates,
+			const iREAL*                    zCoordinates,
+			int                             n,
+			iREAL                           tolerance,
+			std::vector<int>&               uniqueIndex,
+			std::vector<demolish::Vertex>&  uniqueVertices);
   }
 }
 
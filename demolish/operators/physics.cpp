@@ -1,9 +1,9 @@
 #include "physics.h"
 
 iREAL demolish::operators::computeVolume(
-	std::vector<iREAL>& xCoordinates,
-	std::vector<iREAL>& yCoordinates,
-	std::vector<iREAL>& zCoordinates)
+	std::vector<iVERTEX>& xCoordinates,
+	std::vector<iVERTEX>& yCoordinates,
+	std::vector<iVERTEX>& zCoordinates)
 {
 
   iREAL vol=0, a[3], b[3], c[3], J;
@@ -39,9 +39,9 @@ iREAL demolish::operators::computeVolume(
  * gets the inertia using simplex integration from solfec
  */
 void demolish::operators::computeInertia(
-	std::vector<iREAL>& xCoordinates,
-	std::vector<iREAL>& yCoordinates,
-	std::vector<iREAL>& zCoordinates,
+	std::vector<iVERTEX>& xCoordinates,
+	std::vector<iVERTEX>& yCoordinates,
+	std::vector<iVERTEX>& zCoordinates,
 	demolish::material::MaterialType material,
 	iREAL& mass,
 	iREAL center[3],
@@ -133,9 +133,9 @@ void demolish::operators::computeInertia(
 }
 
 iREAL demolish::operators::computeMass(
-	std::vector<iREAL>& xCoordinates,
-	std::vector<iREAL>& yCoordinates,
-	std::vector<iREAL>& zCoordinates,
+	std::vector<iVERTEX>& xCoordinates,
+	std::vector<iVERTEX>& yCoordinates,
+	std::vector<iVERTEX>& zCoordinates,
     demolish::material::MaterialType material)
 {
 
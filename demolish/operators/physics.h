@@ -19,9 +19,9 @@ namespace demolish {
 		 *  @return iREAL
 		 */
 		iREAL computeVolume(
-			std::vector<iREAL>& xCoordinates,
-			std::vector<iREAL>& yCoordinates,
-			std::vector<iREAL>& zCoordinates);
+			std::vector<iVERTEX>& xCoordinates,
+			std::vector<iVERTEX>& yCoordinates,
+			std::vector<iVERTEX>& zCoordinates);
 
 		/*
 		 *  Get Inertia Matrix
@@ -36,9 +36,9 @@ namespace demolish {
 		 *  @returns void
 		 */
 		void computeInertia(
-			std::vector<iREAL>& xCoordinates,
-			std::vector<iREAL>& yCoordinates,
-			std::vector<iREAL>& zCoordinates,
+			std::vector<iVERTEX>& xCoordinates,
+			std::vector<iVERTEX>& yCoordinates,
+			std::vector<iVERTEX>& zCoordinates,
 			demolish::material::MaterialType material,
 			iREAL& mass,
 			iREAL center[3],
@@ -57,9 +57,9 @@ namespace demolish {
 		 *  @returns iREAL
 		 */
 		iREAL computeMass(
-			std::vector<iREAL>& xCoordinates,
-			std::vector<iREAL>& yCoordinates,
-			std::vector<iREAL>& zCoordinates,
+			std::vector<iVERTEX>& xCoordinates,
+			std::vector<iVERTEX>& yCoordinates,
+			std::vector<iVERTEX>& zCoordinates,
 			demolish::material::MaterialType material);
 
 		/*
@@ -4,9 +4,9 @@
 
 
 iREAL demolish::operators::computeXYZw(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   iREAL xw = demolish::operators::computeXw(xCoordinates, yCoordinates, zCoordinates);
   iREAL yw = demolish::operators::computeYw(xCoordinates, yCoordinates, zCoordinates);
@@ -18,9 +18,9 @@ iREAL demolish::operators::computeXYZw(
 }
 
 iREAL demolish::operators::computeXZw(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   iREAL xw = demolish::operators::computeXw(xCoordinates, yCoordinates, zCoordinates);
   iREAL zw = demolish::operators::computeZw(xCoordinates, yCoordinates, zCoordinates);
@@ -29,9 +29,9 @@ iREAL demolish::operators::computeXZw(
 }
 
 iREAL demolish::operators::computeXw(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   demolish::Vertex min = demolish::operators::computeBoundaryMinVertex(xCoordinates, yCoordinates, zCoordinates);
   demolish::Vertex max = demolish::operators::computeBoundaryMaxVertex(xCoordinates, yCoordinates, zCoordinates);
@@ -40,9 +40,9 @@ iREAL demolish::operators::computeXw(
 }
 
 iREAL demolish::operators::computeYw(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   demolish::Vertex min = demolish::operators::computeBoundaryMinVertex(xCoordinates, yCoordinates, zCoordinates);
   demolish::Vertex max = demolish::operators::computeBoundaryMaxVertex(xCoordinates, yCoordinates, zCoordinates);
@@ -51,9 +51,9 @@ iREAL demolish::operators::computeYw(
 }
 
 iREAL demolish::operators::computeZw(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   demolish::Vertex min = demolish::operators::computeBoundaryMinVertex(xCoordinates, yCoordinates, zCoordinates);
   demolish::Vertex max = demolish::operators::computeBoundaryMaxVertex(xCoordinates, yCoordinates, zCoordinates);
@@ -62,9 +62,9 @@ iREAL demolish::operators::computeZw(
 }
 
 std::array<iREAL, 6> demolish::operators::computeBbox(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   demolish::Vertex vertexMin = computeBoundaryMinVertex(xCoordinates, yCoordinates, zCoordinates);
   demolish::Vertex vertexMax = computeBoundaryMaxVertex(xCoordinates, yCoordinates, zCoordinates);
@@ -75,9 +75,9 @@ std::array<iREAL, 6> demolish::operators::computeBbox(
 }
 
 demolish::Vertex demolish::operators::computeBoundaryMinVertex(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   demolish::Vertex vertex = {computeMin(xCoordinates),
 								computeMin(yCoordinates),
@@ -86,9 +86,9 @@ demolish::Vertex demolish::operators::computeBoundaryMinVertex(
 }
 
 demolish::Vertex demolish::operators::computeBoundaryMaxVertex(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   demolish::Vertex vertex = {computeMax(xCoordinates),
 							computeMax(yCoordinates),
@@ -98,9 +98,9 @@ demolish::Vertex demolish::operators::computeBoundaryMaxVertex(
 }
 
 iREAL demolish::operators::computeDiagonal(
-	std::vector<iREAL> xCoordinates,
-	std::vector<iREAL> yCoordinates,
-	std::vector<iREAL> zCoordinates)
+	std::vector<iVERTEX> xCoordinates,
+	std::vector<iVERTEX> yCoordinates,
+	std::vector<iVERTEX> zCoordinates)
 {
   Vertex minPoint, maxPoint;
 
@@ -120,7 +120,7 @@ iREAL demolish::operators::computeDistanceAB(
 }
 
 iREAL demolish::operators::computeMin(
-	  std::vector<iREAL> coordinates)
+	  std::vector<iVERTEX> coordinates)
 {
   iREAL min = std::numeric_limits<iREAL>::max();
 
@@ -132,7 +132,7 @@ iREAL demolish::operators::computeMin(
 }
 
 iREAL demolish::operators::computeMax(
-	  std::vector<iREAL> coordinates)
+	  std::vector<iVERTEX> coordinates)
 {
   iREAL max = std::numeric_limits<iREAL>::min();
 
@@ -12,55 +12,55 @@
 namespace demolish {
     namespace operators {
 		iREAL computeXYZw(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 		iREAL computeXZw(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 		iREAL computeXw(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 		iREAL computeYw(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 		iREAL computeZw(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 
 		demolish::Vertex computeBoundaryMinVertex(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 
 		demolish::Vertex computeBoundaryMaxVertex(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 
 		std::array<iREAL, 6> computeBbox(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 
 		iREAL computeDiagonal(
-			std::vector<iREAL> xCoordinates,
-			std::vector<iREAL> yCoordinates,
-			std::vector<iREAL> zCoordinates);
+			std::vector<iVERTEX> xCoordinates,
+			std::vector<iVERTEX> yCoordinates,
+			std::vector<iVERTEX> zCoordinates);
 
 		iREAL computeDistanceAB(
 		    demolish::Vertex A,
 		    demolish::Vertex B);
 
 		iREAL computeMin(
-			  std::vector<iREAL> coordinates);
+			  std::vector<iVERTEX> coordinates);
 
 		iREAL computeMax(
-			  std::vector<iREAL> coordinates);
+			  std::vector<iVERTEX> coordinates);
 
    } 
 } 
@@ -0,0 +1,183 @@
+#include "demolish.h"
+#include "Mesh.h"
+#include "builder/GeometryBuilder.h"
+#include "detection/penalty.h"
+#include "detection/sphere.h"
+#include <omp.h>
+#include <cmath>
+#include <random>
+#include <iostream>
+
+/*
+ * Compares the float and the double instantiation of the narrow phase
+ * kernels on the meshes of the test scene: a 2x4x3 box that is dropped
+ * onto the 50x0.1x50 floor, and spheres that touch the hopper.
+ *
+ * For every random placement both versions see the same double
+ * coordinates, the float one after rounding. We report the largest
+ * deviation of contact point and depth, the number of placements where
+ * the two found a different number of contacts, and the time per pair.
+ */
+
+namespace {
+  struct Arrays {
+    std::vector<double> x, y, z;
+    std::vector<float>  fx, fy, fz;
+  };
+
+  Arrays place(demolish::Mesh& mesh, iREAL angle, iREAL offset[3])
+  {
+    Arrays a;
+    iREAL c = std::cos(angle), s = std::sin(angle);
+    for(int i=0; i<mesh.getNumberOfTriangles()*3; i++)
+    {
+      iREAL x = mesh.getXCoordinates()[i];
+      iREAL y = mesh.getYCoordinates()[i];
+      iREAL z = mesh.getZCoordinates()[i];
+
+      a.x.push_back( c*x + s*z + offset[0]);
+      a.y.push_back( y         + offset[1]);
+      a.z.push_back(-s*x + c*z + offset[2]);
+    }
+    a.fx.assign(a.x.begin(), a.x.end());
+    a.fy.assign(a.y.begin(), a.y.end());
+    a.fz.assign(a.z.begin(), a.z.end());
+    return a;
+  }
+
+  struct Deviation {
+    iREAL point    = 0;
+    iREAL depth    = 0;
+    int   mismatch = 0;
+    int   contacts = 0;
+
+    void compare(
+      const std::vector<demolish::ContactPoint>& single,
+      const std::vector<demolish::ContactPoint>& twice)
+    {
+      contacts += twice.size();
+      if(single.size() != twice.size())
+      {
+        mismatch++;
+        return;
+      }
+      for(int i=0; i<twice.size(); i++)
+      {
+        for(int k=0; k<3; k++)
+        {
+          point = std::max(point, std::abs(single[i].x[k]-twice[i].x[k]));
+        }
+        depth = std::max(depth, std::abs(single[i].depth-twice[i].depth));
+      }
+    }
+
+    void print(const char* name, int trials, double timeFloat, double timeDouble, long pairs)
+    {
+      std::cout << name << ": " << contacts << " contacts in " << trials << " placements, "
+                << mismatch << " with a different contact count" << std::endl
+                << "  max point deviation " << point << ", max depth deviation " << depth << std::endl
+                << "  float " << 1E9*timeFloat/pairs << " ns/pair, double " << 1E9*timeDouble/pairs << " ns/pair" << std::endl;
+    }
+  };
+}
+
+int main() {
+  const int    trials  = 200;
+  const iREAL  epsilon = 0.5;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<iREAL> uniform(0.0, 1.0);
+
+  std::vector<demolish::Vertex> meshVertices;
+  std::vector<std::array<int, 3>> meshTriangles;
+
+  demolish::CreateBox(2.0,4.0,3.0,meshVertices,meshTriangles);
+  demolish::Mesh box(meshTriangles,meshVertices);
+
+  meshTriangles.clear();meshVertices.clear();
+  demolish::CreateBox(50.0,0.1,50.0,meshVertices,meshTriangles);
+  demolish::Mesh floor(meshTriangles,meshVertices);
+
+  meshTriangles.clear();meshVertices.clear();
+  demolish::CreateHopper(40.0,10.0,20.0,meshVertices,meshTriangles);
+  demolish::Mesh hopper(meshTriangles,meshVertices);
+
+  iREAL origin[3] = {0,0,0};
+  Arrays floorArrays  = place(floor, 0.0, origin);
+  Arrays hopperArrays = place(hopper, 0.0, origin);
+
+  // ***********************************
+  // box on floor, penalty
+  // ***********************************
+  {
+    Deviation deviation;
+    double timeFloat = 0, timeDouble = 0;
+    long   pairs = 0;
+    for(int t=0; t<trials; t++)
+    {
+      // somewhere between just touching and one margin deep
+      iREAL offset[3] = {40*uniform(generator)-20, 2.05 + 2*epsilon*uniform(generator) - epsilon, 40*uniform(generator)-20};
+      Arrays boxArrays = place(box, 0.3*uniform(generator), offset);
+
+      std::vector<demolish::ContactPoint> single, twice;
+
+      double start = omp_get_wtime();
+      demolish::detection::penalty(
+        boxArrays.fx.data(), boxArrays.fy.data(), boxArrays.fz.data(), box.getNumberOfTriangles(), epsilon, false, 0,
+        floorArrays.fx.data(), floorArrays.fy.data(), floorArrays.fz.data(), floor.getNumberOfTriangles(), epsilon, false, 1,
+        single);
+      timeFloat += omp_get_wtime()-start;
+
+      start = omp_get_wtime();
+      demolish::detection::penalty(
+        boxArrays.x.data(), boxArrays.y.data(), boxArrays.z.data(), box.getNumberOfTriangles(), epsilon, false, 0,
+        floorArrays.x.data(), floorArrays.y.data(), floorArrays.z.data(), floor.getNumberOfTriangles(), epsilon, false, 1,
+        twice);
+      timeDouble += omp_get_wtime()-start;
+
+      pairs += long(box.getNumberOfTriangles())*floor.getNumberOfTriangles();
+      deviation.compare(single, twice);
+    }
+    deviation.print("penalty box/floor", trials, timeFloat, timeDouble, pairs);
+  }
+
+  // ***********************************
+  // sphere on hopper
+  // ***********************************
+  {
+    Deviation deviation;
+    double timeFloat = 0, timeDouble = 0;
+    long   pairs = 0;
+    for(int t=0; t<trials; t++)
+    {
+      // pick a random hopper triangle and put a sphere just above it
+      int   i = 3*int(hopper.getNumberOfTriangles()*uniform(generator));
+      iREAL radius = 1.0;
+      iREAL centre[3];
+      centre[0] = (hopperArrays.x[i] + hopperArrays.x[i+1] + hopperArrays.x[i+2])/3.0;
+      centre[1] = (hopperArrays.y[i] + hopperArrays.y[i+1] + hopperArrays.y[i+2])/3.0 + radius + epsilon*uniform(generator);
+      centre[2] = (hopperArrays.z[i] + hopperArrays.z[i+1] + hopperArrays.z[i+2])/3.0;
+
+      std::vector<demolish::ContactPoint> single, twice;
+
+      double start = omp_get_wtime();
+      demolish::detection::sphereWithMesh(
+        centre[0], centre[1], centre[2], radius, epsilon, false, 0,
+        hopperArrays.fx.data(), hopperArrays.fy.data(), hopperArrays.fz.data(), hopper.getNumberOfTriangles(), epsilon, false, 1,
+        single);
+      timeFloat += omp_get_wtime()-start;
+
+      start = omp_get_wtime();
+      demolish::detection::sphereWithMesh(
+        centre[0], centre[1], centre[2], radius, epsilon, false, 0,
+        hopperArrays.x.data(), hopperArrays.y.data(), hopperArrays.z.data(), hopper.getNumberOfTriangles(), epsilon, false, 1,
+        twice);
+      timeDouble += omp_get_wtime()-start;
+
+      pairs += hopper.getNumberOfTriangles();
+      deviation.compare(single, twice);
+    }
+    deviation.print("sphere/hopper", trials, timeFloat, timeDouble, pairs);
+  }
+
+  return 0;
+}
@@ -0,0 +1,301 @@
+#include "profile.h"
+
+#include <omp.h>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+  const int NUMBEROFPHASES   = demolish::profile::NUMBEROFPHASES;
+  const int NUMBEROFCOUNTERS = demolish::profile::NUMBEROFCOUNTERS;
+  const int NUMBEROFGAUGES   = demolish::profile::NUMBEROFGAUGES;
+
+  // one per thread, on its own cache line so the threads do not share
+  struct alignas(64) Slot {
+    double time[NUMBEROFPHASES];
+    double first[NUMBEROFPHASES];
+    long   counters[NUMBEROFCOUNTERS];
+  };
+
+  struct Record {
+    int    step;
+    double start;
+    double wall;
+    double time[NUMBEROFPHASES];
+    double first[NUMBEROFPHASES];  // relative to start, negative if the phase did not run
+    long   counters[NUMBEROFCOUNTERS];
+    double gauges[NUMBEROFGAUGES];
+  };
+
+  std::vector<Slot>   slots;
+  std::vector<Record> records(1024);
+  int                 head      = 0;  // next record to write
+  int                 size      = 0;
+  bool                open      = false;
+  int                 openStep  = 0;
+  double              openStart = 0.0;
+  double              openGauges[NUMBEROFGAUGES];
+
+  void clear(Slot& slot)
+  {
+    for(int p=0; p<NUMBEROFPHASES; p++)
+    {
+      slot.time[p]  = 0.0;
+      slot.first[p] = -1.0;
+    }
+    for(int c=0; c<NUMBEROFCOUNTERS; c++) slot.counters[c] = 0;
+  }
+
+  bool isSummedOverThreads(int phase)
+  {
+    return phase >= demolish::profile::SPHERESPHERE && phase <= demolish::profile::PENALTY;
+  }
+
+  // records in the ring buffer, oldest first
+  const Record& getRecord(int i)
+  {
+    return records[(head - size + i + records.size()) % records.size()];
+  }
+}
+
+const char* demolish::profile::getPhaseName(Phase phase)
+{
+  switch(phase)
+  {
+    case BROADPHASE:   return "broad phase";
+    case DETECTION:    return "detection";
+    case SPHERESPHERE: return "sphere-sphere";
+    case SPHEREMESH:   return "sphere-mesh";
+    case SPHEREFIELD:  return "sphere-field";
+    case MESHFIELD:    return "mesh-field";
+    case GJK:          return "gjk";
+    case PENALTY:      return "penalty";
+    case RESOLUTION:   return "resolution";
+    case INTEGRATION:  return "integration";
+    case ADVANCEMENT:  return "advancement";
+    case VERTICES:     return "vertices";
+    case ROLLBACK:     return "rollback";
+    case REORDER:      return "reorder";
+    case SUBSTEPS:     return "substeps";
+    case RENDERING:    return "rendering";
+    case OUTPUT:       return "output";
+    default:           return "unknown";
+  }
+}
+
+const char* demolish::profile::getCounterName(Counter counter)
+{
+  switch(counter)
+  {
+    case PAIRS:            return "pairs";
+    case CONTACTS:         return "contacts";
+    case NEWTONITERATIONS: return "newton iterations";
+    case ROLLBACKS:        return "rollbacks";
+    case ISLANDS:          return "islands";
+    case RESIMULATED:      return "re-simulated bodies";
+    case SUBSTEPPED:       return "substepped bodies";
+    case LIMITED:          return "limited bodies";
+    case SWEEPS:           return "solver sweeps";
+    case COLOURS:          return "contact colours";
+    default:               return "unknown";
+  }
+}
+
+const char* demolish::profile::getGaugeName(Gauge gauge)
+{
+  switch(gauge)
+  {
+    case TIMESTEP:             return "timestep";
+    case PENETRATION:          return "penetration";
+    case PREDICTEDPENETRATION: return "predicted penetration";
+    case RESIDUAL:             return "solver residual";
+    default:                   return "unknown";
+  }
+}
+
+void demolish::profile::setCapacity(int steps)
+{
+  records.assign(std::max(steps, 1), Record());
+  head = 0;
+  size = 0;
+}
+
+double demolish::profile::now()
+{
+  return omp_get_wtime();
+}
+
+void demolish::profile::beginStep(int step)
+{
+  if(open) endStep();
+
+  if(slots.size() < omp_get_max_threads()) slots.resize(omp_get_max_threads());
+  for(int t=0; t<slots.size(); t++) clear(slots[t]);
+  for(int g=0; g<NUMBEROFGAUGES; g++) openGauges[g] = 0.0;
+
+  open      = true;
+  openStep  = step;
+  openStart = now();
+}
+
+void demolish::profile::endStep()
+{
+  if(!open) return;
+  open = false;
+
+  Record& record = records[head];
+  record.step  = openStep;
+  record.start = openStart;
+  record.wall  = now() - openStart;
+
+  for(int p=0; p<NUMBEROFPHASES; p++)
+  {
+    record.time[p]  = 0.0;
+    record.first[p] = -1.0;
+    for(int t=0; t<slots.size(); t++)
+    {
+      if(slots[t].first[p] < 0.0) continue;
+      record.time[p] += slots[t].time[p];
+      if(record.first[p] < 0.0 || slots[t].first[p] < record.first[p]) record.first[p] = slots[t].first[p];
+    }
+  }
+  for(int c=0; c<NUMBEROFCOUNTERS; c++)
+  {
+    record.counters[c] = 0;
+    for(int t=0; t<slots.size(); t++) record.counters[c] += slots[t].counters[c];
+  }
+  for(int g=0; g<NUMBEROFGAUGES; g++) record.gauges[g] = openGauges[g];
+
+  head = (head+1) % records.size();
+  size = std::min(size+1, int(records.size()));
+}
+
+void demolish::profile::addTime(Phase phase, double start, double end)
+{
+  int thread = omp_get_thread_num();
+  if(!open || thread >= slots.size()) return;
+
+  Slot& slot = slots[thread];
+  if(slot.first[phase] < 0.0) slot.first[phase] = start - openStart;
+  slot.time[phase] += end - start;
+}
+
+void demolish::profile::addCount(Counter counter, long n)
+{
+  int thread = omp_get_thread_num();
+  if(!open || thread >= slots.size()) return;
+
+  slots[thread].counters[counter] += n;
+}
+
+void demolish::profile::setGauge(Gauge gauge, double value)
+{
+  if(open) openGauges[gauge] = value;
+}
+
+demolish::profile::Timer::Timer(Phase phase):
+  _phase(phase),
+  _start(now())
+{
+}
+
+demolish::profile::Timer::~Timer()
+{
+  addTime(_phase, _start, now());
+}
+
+bool demolish::profile::writeJSON(const std::string& filename)
+{
+  std::ofstream file(filename);
+  if(!file)
+  {
+    std::cout << "cannot open profile file " << filename << std::endl;
+    return false;
+  }
+
+  file << "{\"steps\": [" << std::endl;
+  for(int i=0; i<size; i++)
+  {
+    const Record& record = getRecord(i);
+    file << "  {\"step\": " << record.step << ", \"wall\": " << record.wall << ", \"phases\": {";
+    bool first = true;
+    for(int p=0; p<NUMBEROFPHASES; p++)
+    {
+      if(record.first[p] < 0.0) continue;
+      file << (first ? "" : ", ") << "\"" << getPhaseName(Phase(p)) << "\": " << record.time[p];
+      first = false;
+    }
+    file << "}, \"counters\": {";
+    for(int c=0; c<NUMBEROFCOUNTERS; c++)
+    {
+      file << (c==0 ? "" : ", ") << "\"" << getCounterName(Counter(c)) << "\": " << record.counters[c];
+    }
+    file << "}, \"gauges\": {";
+    for(int g=0; g<NUMBEROFGAUGES; g++)
+    {
+      file << (g==0 ? "" : ", ") << "\"" << getGaugeName(Gauge(g)) << "\": " << record.gauges[g];
+    }
+    file << "}}" << (i+1<size ? "," : "") << std::endl;
+  }
+  file << "]}" << std::endl;
+  return true;
+}
+
+bool demolish::profile::writeChromeTrace(const std::string& filename)
+{
+  std::ofstream file(filename);
+  if(!file)
+  {
+    std::cout << "cannot open profile file " << filename << std::endl;
+    return false;
+  }
+  if(size == 0)
+  {
+    file << "{\"traceEvents\": []}" << std::endl;
+    return true;
+  }
+
+  // trace times are microseconds since the oldest step
+  const double origin = getRecord(0).start;
+
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+  file << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"step\"}}," << std::endl;
+  file << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 1, \"args\": {\"name\": \"narrow phase, summed over threads\"}}";
+  for(int i=0; i<size; i++)
+  {
+    const Record& record = getRecord(i);
+    const double start = 1E6*(record.start - origin);
+
+    file << "," << std::endl << "  {\"name\": \"step " << record.step << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": "
+         << start << ", \"dur\": " << 1E6*record.wall << "}";
+
+    // summed phases are laid out one after the other from the start of the detection
+    double summed = record.first[DETECTION] < 0.0 ? start : start + 1E6*record.first[DETECTION];
+    for(int p=0; p<NUMBEROFPHASES; p++)
+    {
+      if(record.first[p] < 0.0) continue;
+
+      double ts = isSummedOverThreads(p) ? summed : start + 1E6*record.first[p];
+      file << "," << std::endl << "  {\"name\": \"" << getPhaseName(Phase(p)) << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": "
+           << (isSummedOverThreads(p) ? 1 : 0) << ", \"ts\": " << ts << ", \"dur\": " << 1E6*record.time[p] << "}";
+      if(isSummedOverThreads(p)) summed += 1E6*record.time[p];
+    }
+
+    file << "," << std::endl << "  {\"name\": \"counters\", \"ph\": \"C\", \"pid\": 0, \"ts\": " << start << ", \"args\": {";
+    for(int c=0; c<NUMBEROFCOUNTERS; c++)
+    {
+      file << (c==0 ? "" : ", ") << "\"" << getCounterName(Counter(c)) << "\": " << record.counters[c];
+    }
+    file << "}}";
+
+    file << "," << std::endl << "  {\"name\": \"gauges\", \"ph\": \"C\", \"pid\": 0, \"ts\": " << start << ", \"args\": {";
+    for(int g=0; g<NUMBEROFGAUGES; g++)
+    {
+      file << (g==0 ? "" : ", ") << "\"" << getGaugeName(Gauge(g)) << "\": " << record.gauges[g];
+    }
+    file << "}}";
+  }
+  file << std::endl << "]}" << std::endl;
+  return true;
+}
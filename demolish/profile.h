@@ -0,0 +1,152 @@
+#ifndef _DEMOLISH_PROFILE
+#define _DEMOLISH_PROFILE
+
+#include "demolish.h"
+#include <string>
+
+/*
+ * Per-step instrumentation of the hot path
+ *
+ * Scoped timers add the time spent in a phase to the current step,
+ * counters add up events. Both may be used from inside OpenMP regions,
+ * every thread writes into its own slot. Times of phases that run on
+ * several threads (the narrow phase) are summed over the threads, so
+ * they can exceed the wall time of the detection. Gauges hold one value
+ * per step, such as the timestep, and are set outside of parallel
+ * regions.
+ *
+ * Steps are kept in a ring buffer of fixed size. The oldest step is
+ * overwritten once the buffer is full. The buffer can be written as
+ * plain JSON or in the Chrome trace format (chrome://tracing, Perfetto).
+ *
+ * Building with -DDEMOLISH_NO_PROFILE removes the timers and counters
+ * from the kernels and from World, the macros below expand to nothing.
+ * The counts and values are not evaluated then, but stay in use, so a
+ * variable that only feeds a counter does not warn.
+ */
+
+namespace demolish {
+  namespace profile {
+    enum Phase {
+      BROADPHASE,
+      DETECTION,     // narrow phase pair loop, wall time
+      SPHERESPHERE,  // narrow phase by pair type, summed over threads
+      SPHEREMESH,
+      SPHEREFIELD,
+      MESHFIELD,
+      GJK,
+      PENALTY,
+      RESOLUTION,    // contact forces and velocity update
+      INTEGRATION,   // positions and rotations
+      ADVANCEMENT,   // limiting the motion of fast particles
+      VERTICES,      // vertex update
+      ROLLBACK,
+      REORDER,       // sorting the particles along a Morton curve
+      SUBSTEPS,      // islands on finer timestep levels
+      RENDERING,
+      OUTPUT,        // copying trajectory frames, waiting for the disk
+      NUMBEROFPHASES
+    };
+
+    enum Counter {
+      PAIRS,            // particle pairs handed to the narrow phase
+      CONTACTS,         // contact points after detection
+      NEWTONITERATIONS, // iterations of the penalty solver
+      ROLLBACKS,        // steps in which islands were re-simulated
+      ISLANDS,          // contact islands with at least one contact
+      RESIMULATED,      // bodies whose last step was redone in substeps
+      SUBSTEPPED,       // bodies on finer timestep levels
+      LIMITED,          // fast bodies that were held back in a step
+      SWEEPS,           // Gauss-Seidel sweeps of the impulse solver
+      COLOURS,          // colours of the contact graph
+      NUMBEROFCOUNTERS
+    };
+
+    // values of a step, the last one set wins
+    enum Gauge {
+      TIMESTEP,
+      PENETRATION,          // deepest contact after the step
+      PREDICTEDPENETRATION, // deepest contact the step was predicted to leave
+      RESIDUAL,             // velocity change of the last impulse sweep
+      NUMBEROFGAUGES
+    };
+
+    const char* getPhaseName(Phase phase);
+    const char* getCounterName(Counter counter);
+    const char* getGaugeName(Gauge gauge);
+
+    /*
+     *  Set Capacity
+     *
+     *  Number of steps kept in the ring buffer. Clears the buffer.
+     *
+     *  @param steps : ring buffer size, 1024 by default
+     */
+    void setCapacity(int steps);
+
+    /*
+     *  Begin Step
+     *
+     *  Closes the open step, if there is one, and opens a new one.
+     *  Timers and counters outside of a step are dropped.
+     *
+     *  @param step : step number that is written with the record
+     */
+    void beginStep(int step);
+
+    /*
+     *  End Step
+     *
+     *  Sums the thread slots and moves the open step into the ring
+     *  buffer.
+     */
+    void endStep();
+
+    void addTime(Phase phase, double start, double end);
+    void addCount(Counter counter, long n);
+    void setGauge(Gauge gauge, double value);
+
+    double now();
+
+    /*
+     *  Write
+     *
+     *  Writes the steps in the ring buffer, oldest first. The JSON file
+     *  holds one object per step with the times in seconds. The trace
+     *  file places every phase of a step as a complete event at its
+     *  first start; phases summed over threads go to a second track.
+     *  Counters and gauges become counter events.
+     *
+     *  @param filename : output file
+     *  @returns false if the file cannot be written
+     */
+    bool writeJSON(const std::string& filename);
+    bool writeChromeTrace(const std::string& filename);
+
+    class Timer {
+      public:
+        Timer(Phase phase);
+        ~Timer();
+      private:
+        Phase  _phase;
+        double _start;
+    };
+  }
+}
+
+#ifdef DEMOLISH_NO_PROFILE
+  #define DEMOLISH_PROFILE_SCOPE(phase)
+  #define DEMOLISH_PROFILE_COUNT(counter, n)   ((void)sizeof(n))
+  #define DEMOLISH_PROFILE_GAUGE(gauge, value)  ((void)sizeof(value))
+#else
+  #define DEMOLISH_PROFILE_CONCAT2(a, b) a##b
+  #define DEMOLISH_PROFILE_CONCAT(a, b)  DEMOLISH_PROFILE_CONCAT2(a, b)
+  #define DEMOLISH_PROFILE_SCOPE(phase) \
+    demolish::profile::Timer DEMOLISH_PROFILE_CONCAT(profileTimer, __LINE__)(demolish::profile::phase)
+  #define DEMOLISH_PROFILE_COUNT(counter, n) \
+    demolish::profile::addCount(demolish::profile::counter, n)
+  #define DEMOLISH_PROFILE_GAUGE(gauge, value) \
+    demolish::profile::setGauge(demolish::profile::gauge, value)
+#endif
+
+#endif
@@ -1,14 +1,16 @@
 #include "dynamics.h"
 #include <vector>
 #include "math.h"
+#include <cmath>
 
 /* vectorizable exponential map */
-void expmap (iREAL Omega1, iREAL Omega2, iREAL Omega3,
-                iREAL &Lambda1, iREAL &Lambda2, iREAL &Lambda3,
-			          iREAL &Lambda4, iREAL &Lambda5, iREAL &Lambda6,
-			          iREAL &Lambda7, iREAL &Lambda8, iREAL &Lambda9)
+template<typename T>
+void demolish::dynamics::expmap (T Omega1, T Omega2, T Omega3,
+                T &Lambda1, T &Lambda2, T &Lambda3,
+			          T &Lambda4, T &Lambda5, T &Lambda6,
+			          T &Lambda7, T &Lambda8, T &Lambda9)
 {
-  iREAL angsq, sx, cx, v0, v1, v2, v01, v02, v12, s0, s1, s2;
+  T angsq, sx, cx, v0, v1, v2, v01, v02, v12, s0, s1, s2;
 
   v0 = Omega1 * Omega1;
   v1 = Omega2 * Omega2;
@@ -45,11 +47,11 @@ void expmap (iREAL Omega1, iREAL Omega2, iREAL Omega3,
   }
   else
   {
-    iREAL t, s, c;
+    T t, s, c;
     t = angsq;
-    angsq = sqrt (angsq);
-    s = sin (angsq);
-    c = cos (angsq);
+    angsq = std::sqrt (angsq);
+    s = std::sin (angsq);
+    c = std::cos (angsq);
     sx = s / angsq;
     cx = (1.0 - c) / t;
   }
@@ -81,13 +83,14 @@ void expmap (iREAL Omega1, iREAL Omega2, iREAL Omega3,
   Lambda9 += 1.0;
 }
 
- void demolish::dynamics::updateRotationMatrix(
-     iREAL *angular,
-     iREAL *refAngular,
-     iREAL *rotation,
-     iREAL step)
+template<typename T>
+void demolish::dynamics::updateRotationMatrix(
+     T *angular,
+     T *refAngular,
+     T *rotation,
+     T step)
 {
-  iREAL DL[9], rot0[9];
+  T DL[9], rot0[9];
   expmap (step*refAngular[0], step*refAngular[1], step*refAngular[2], DL[0], DL[1], DL[2], DL[3], DL[4], DL[5], DL[6], DL[7], DL[8]);
 
   rot0[0] = rotation[0];
@@ -117,26 +120,27 @@ void expmap (iREAL Omega1, iREAL Omega2, iREAL Omega3,
   angular[2] = rotation[2]*refAngular[0]+rotation[5]*refAngular[1]+rotation[8]*refAngular[2];
 }
 
+template<typename T>
 void demolish::dynamics::updateAngular(
-    iREAL *refAngular,
-    iREAL *rotation,
-    iREAL *inertia,
-    iREAL *inverse,
-    iREAL *torque,
-    iREAL step)
+    T *refAngular,
+    T *rotation,
+    T *inertia,
+    T *inverse,
+    T *torque,
+    T step)
 {
-	iREAL half = 0.5*step;
+	T half = 0.5*step;
 
-	iREAL T[3];
-	iREAL DL[9];
-	iREAL A[3];
-	iREAL B[3];
+	T Tq[3]; // torque in the body frame
+	T DL[9];
+	T A[3];
+	T B[3];
 
 	////EQUATION (13) START
 	///////////////////////
-	T[0] = rotation[0]*torque[0]+rotation[1]*torque[1]+rotation[2]*torque[2];
-	T[1] = rotation[3]*torque[0]+rotation[4]*torque[1]+rotation[5]*torque[2];
-	T[2] = rotation[6]*torque[0]+rotation[7]*torque[1]+rotation[8]*torque[2];
+	Tq[0] = rotation[0]*torque[0]+rotation[1]*torque[1]+rotation[2]*torque[2];
+	Tq[1] = rotation[3]*torque[0]+rotation[4]*torque[1]+rotation[5]*torque[2];
+	Tq[2] = rotation[6]*torque[0]+rotation[7]*torque[1]+rotation[8]*torque[2];
 	////EQUATION (13) END
 	/////////////////////
 
@@ -154,10 +158,10 @@ void demolish::dynamics::updateAngular(
 	B[1] = DL[1]*A[0]+DL[4]*A[1]+DL[7]*A[2];
 	B[2] = DL[2]*A[0]+DL[5]*A[1]+DL[8]*A[2];
 
-	//ADDMUL (B, half, T, B);
-	B[0] = B[0] + half*T[0];
-	B[1] = B[1] + half*T[1];
-	B[2] = B[2] + half*T[2];
+	//ADDMUL (B, half, Tq, B);
+	B[0] = B[0] + half*Tq[0];
+	B[1] = B[1] + half*Tq[1];
+	B[2] = B[2] + half*Tq[2];
 
 	//NVMUL (inverse, B, A); // O(t+h/2)
 	A[0] = inverse[0]*B[0]+inverse[3]*B[1]+inverse[6]*B[2];
@@ -174,31 +178,32 @@ void demolish::dynamics::updateAngular(
 	B[1] = inertia[1]*A[0]+inertia[4]*A[1]+inertia[7]*A[2];
 	B[2] = inertia[2]*A[0]+inertia[5]*A[1]+inertia[8]*A[2];
 
-	//PRODUCTSUB (A, B, T); // T - O(t+h/2) x J O(t+h/2)
-	T[0] -= A[1]*B[2] - A[2]*B[1];
-	T[1] -= A[2]*B[0] - A[0]*B[2];
-	T[2] -= A[0]*B[1] - A[1]*B[0];
+	//PRODUCTSUB (A, B, Tq); // Tq - O(t+h/2) x J O(t+h/2)
+	Tq[0] -= A[1]*B[2] - A[2]*B[1];
+	Tq[1] -= A[2]*B[0] - A[0]*B[2];
+	Tq[2] -= A[0]*B[1] - A[1]*B[0];
 
-	//SCALE (T, step);
-	T[0] *= step;
-	T[1] *= step;
-	T[2] *= step;
+	//SCALE (Tq, step);
+	Tq[0] *= step;
+	Tq[1] *= step;
+	Tq[2] *= step;
 
-	//NVADDMUL (refAngular, inverse, T, refAngular); // O(t+h)
-	refAngular[0] = refAngular[0] + inverse[0]*T[0]+inverse[3]*T[1]+inverse[6]*T[2];
-	refAngular[1] = refAngular[1] + inverse[1]*T[0]+inverse[4]*T[1]+inverse[7]*T[2];
-	refAngular[2] = refAngular[2] + inverse[2]*T[0]+inverse[5]*T[1]+inverse[8]*T[2];
+	//NVADDMUL (refAngular, inverse, Tq, refAngular); // O(t+h)
+	refAngular[0] = refAngular[0] + inverse[0]*Tq[0]+inverse[3]*Tq[1]+inverse[6]*Tq[2];
+	refAngular[1] = refAngular[1] + inverse[1]*Tq[0]+inverse[4]*Tq[1]+inverse[7]*Tq[2];
+	refAngular[2] = refAngular[2] + inverse[2]*Tq[0]+inverse[5]*Tq[1]+inverse[8]*Tq[2];
 	////EQUATION (15) END
 	/////////////////////
 }
 
+template<typename T>
 void demolish::dynamics::updateVertices(
-    iREAL *x,
-    iREAL *y,
-    iREAL *z,
-    iREAL *refx,
-    iREAL *refy,
-    iREAL *refz,
+    T *x,
+    T *y,
+    T *z,
+    T *refx,
+    T *refy,
+    T *refz,
     iREAL *rotation,
     iREAL *position,
     iREAL *refposition)
@@ -220,3 +225,14 @@ void demolish::dynamics::updateVertices(
 	*y = c[1];
 	*z = c[2];
 }
+
+template void demolish::dynamics::updateVertices<float>(float*, float*, float*, float*, float*, float*, iREAL*, iREAL*, iREAL*);
+template void demolish::dynamics::updateVertices<double>(double*, double*, double*, double*, double*, double*, iREAL*, iREAL*, iREAL*);
+
+#define DEMOLISH_INSTANTIATE_DYNAMICS(T) \
+  template void demolish::dynamics::expmap<T>(T, T, T, T&, T&, T&, T&, T&, T&, T&, T&, T&); \
+  template void demolish::dynamics::updateRotationMatrix<T>(T*, T*, T*, T); \
+  template void demolish::dynamics::updateAngular<T>(T*, T*, T*, T*, T*, T);
+
+DEMOLISH_INSTANTIATE_DYNAMICS(float)
+DEMOLISH_INSTANTIATE_DYNAMICS(double)
@@ -8,6 +8,20 @@
 namespace demolish {
   namespace dynamics {
 
+	/*
+	* Exponential Map
+	*
+	* Rotation matrix Lambda (column major) of the rotation vector Omega.
+	* Uses a Taylor expansion for small angles. Like the angular and
+	* rotation updates it is instantiated for float and double.
+	*/
+    template<typename T>
+    void expmap(
+        T Omega1, T Omega2, T Omega3,
+        T &Lambda1, T &Lambda2, T &Lambda3,
+        T &Lambda4, T &Lambda5, T &Lambda6,
+        T &Lambda7, T &Lambda8, T &Lambda9);
+
 	/*
 	* Update Angular Velocity
 	*
@@ -22,13 +36,14 @@ namespace demolish {
 	* @param step is the step size
 	* @return void
 	*/
+    template<typename T>
     void updateAngular(
-        iREAL *refAngular,
-        iREAL *rotation,
-        iREAL *inertia,
-        iREAL *inverse,
-        iREAL *torque,
-        iREAL step);
+        T *refAngular,
+        T *rotation,
+        T *inertia,
+        T *inverse,
+        T *torque,
+        T step);
 
 	/*
 	* Update Rotational Matrix
@@ -41,11 +56,12 @@ namespace demolish {
 	* @param step is the step size
 	* @return void
 	*/
+    template<typename T>
     void updateRotationMatrix(
-        iREAL *angular,
-        iREAL *refAngular,
-        iREAL *rotation,
-        iREAL step);
+        T *angular,
+        T *refAngular,
+        T *rotation,
+        T step);
 
 	/*
 	* Update Vertices
@@ -63,13 +79,14 @@ namespace demolish {
 	* @param refposition is the referential center of mass
 	* @return void
 	*/
+    template<typename T>
     void updateVertices(
-        iREAL* x,
-        iREAL* y,
-        iREAL* z,
-        iREAL* refx,
-        iREAL* refy,
-        iREAL* refz,
+        T* x,
+        T* y,
+        T* z,
+        T* refx,
+        T* refy,
+        T* refz,
         iREAL* rotation,
         iREAL* position,
         iREAL* refposition);
@@ -1,196 +1,231 @@
 #include "forces.h"
 
-#define SPRING 5E3
-#define DAMPER 0.5
 
-#define FRICTION 1.0
+static demolish::resolution::DampingMode dampingMode = demolish::resolution::DampingMode::REDUCEDMASS;
 
-//sphere parameters for piling simulation
-#define SFRICTIONGOLD 1
-#define SFRICTIONWOOD 1
-#define SFRICTIONROLLING 0.5
+void demolish::resolution::setDampingMode(demolish::resolution::DampingMode mode)
+{
+  dampingMode = mode;
+}
 
-void demolish::resolution::spring(
-    iREAL normal[3],
-    iREAL conpnt[3],
-    iREAL depth,
-    iREAL vij[3],
-    iREAL positionASpatial[3],
-    iREAL positionBSpatial[3],
-    iREAL positionAReferential[3],
-    iREAL positionBReferential[3],
-    iREAL massA,
-    iREAL massB,
-    iREAL rotationA[9],
-    iREAL rotationB[9],
-    iREAL inverseA[9],
-    iREAL inverseB[9],
-    std::array<iREAL, 3>& f,
-    iREAL &forc)
+demolish::resolution::DampingMode demolish::resolution::getDampingMode()
+{
+  return dampingMode;
+}
+
+template<typename T>
+T demolish::resolution::effectiveMass(
+    T normal[3],
+    T conpnt[3],
+    T positionASpatial[3],
+    T positionBSpatial[3],
+    T massA,
+    T massB,
+    T rotationA[9],
+    T rotationB[9],
+    T inverseA[9],
+    T inverseB[9])
 {
-  //RefConPoint = Rotation^T *(spatial contact point - spatial centre) + RefCentre;
-  iREAL refconptA[3], refconptB[3], conptSubPosition[3];
+  //W_NN = H_N M^-1 H_N^T. The translational block of M^-1 is 1/m times the
+  //identity and the angular block is the referential inverse inertia, so
+  //only h = R^T (r x n) is needed per body: W_NN = 1/m + h^T I^-1 h.
+  T W_NN = (T(1)/massA) + (T(1)/massB);
 
-  conptSubPosition[0] = conpnt[0] - positionASpatial[0];
-  conptSubPosition[1] = conpnt[1] - positionASpatial[1];
-  conptSubPosition[2] = conpnt[2] - positionASpatial[2];
+  T* position[2] = {positionASpatial, positionBSpatial};
+  T* rotation[2] = {rotationA, rotationB};
+  T* inverse[2]  = {inverseA, inverseB};
 
-  refconptA[0] = (conptSubPosition[0]*rotationA[0] + conptSubPosition[1]*rotationA[1] + conptSubPosition[2]*rotationA[2])+positionAReferential[0];
-  refconptA[1] = (conptSubPosition[0]*rotationA[3] + conptSubPosition[1]*rotationA[4] + conptSubPosition[2]*rotationA[5])+positionAReferential[1];
-  refconptA[2] = (conptSubPosition[0]*rotationA[6] + conptSubPosition[1]*rotationA[7] + conptSubPosition[2]*rotationA[8])+positionAReferential[2];
+  for(int body=0; body<2; body++)
+  {
+    T r[3], rn[3], h[3];
+    r[0] = conpnt[0] - position[body][0];
+    r[1] = conpnt[1] - position[body][1];
+    r[2] = conpnt[2] - position[body][2];
+
+    rn[0] = r[1]*normal[2] - r[2]*normal[1];
+    rn[1] = r[2]*normal[0] - r[0]*normal[2];
+    rn[2] = r[0]*normal[1] - r[1]*normal[0];
+
+    T* R = rotation[body];
+    h[0] = rn[0]*R[0] + rn[1]*R[1] + rn[2]*R[2];
+    h[1] = rn[0]*R[3] + rn[1]*R[4] + rn[2]*R[5];
+    h[2] = rn[0]*R[6] + rn[1]*R[7] + rn[2]*R[8];
+
+    T* I = inverse[body];
+    W_NN += h[0]*(I[0]*h[0] + I[3]*h[1] + I[6]*h[2])
+          + h[1]*(I[1]*h[0] + I[4]*h[1] + I[7]*h[2])
+          + h[2]*(I[2]*h[0] + I[5]*h[1] + I[8]*h[2]);
+  }
 
+  return T(1)/W_NN;
+}
 
-  conptSubPosition[0] = conpnt[0] - positionBSpatial[0];
-  conptSubPosition[1] = conpnt[1] - positionBSpatial[1];
-  conptSubPosition[2] = conpnt[2] - positionBSpatial[2];
-  
+template<typename T>
+void demolish::resolution::spring(
+    T normal[3],
+    T conpnt[3],
+    T depth,
+    T vij[3],
+    T positionASpatial[3],
+    T positionBSpatial[3],
+    T massA,
+    T massB,
+    T rotationA[9],
+    T rotationB[9],
+    T inverseA[9],
+    T inverseB[9],
+    const demolish::material::InteractionParameters& parameters,
+    std::array<T, 3>& f,
+    T &forc)
+{
+  T ma;
+  if(dampingMode == DampingMode::EFFECTIVEMASS)
+  {
+    ma = effectiveMass(normal, conpnt, positionASpatial, positionBSpatial,
+                       massA, massB, rotationA, rotationB, inverseA, inverseB);
+  } else {
+    ma = T(1)/((T(1)/massA) + (T(1)/massB));
+  }
 
-  refconptB[0] = (conptSubPosition[0]*rotationB[0] + conptSubPosition[1]*rotationB[1] + conptSubPosition[2]*rotationB[2])+positionBReferential[0];
-  refconptB[1] = (conptSubPosition[0]*rotationB[3] + conptSubPosition[1]*rotationB[4] + conptSubPosition[2]*rotationB[5])+positionBReferential[1];
-  refconptB[2] = (conptSubPosition[0]*rotationB[6] + conptSubPosition[1]*rotationB[7] + conptSubPosition[2]*rotationB[8])+positionBReferential[2];
-
-  iREAL rPositionContactPnti[9];//3x3
-  iREAL rPositionContactPntj[9];
-
-  rPositionContactPnti[0] = 0.0;
-  rPositionContactPnti[3] = -positionAReferential[2]-refconptA[2];
-  rPositionContactPnti[6] = positionAReferential[1]-refconptA[1];
-  rPositionContactPnti[1] = positionAReferential[2]-refconptA[2];
-  rPositionContactPnti[4] = 0.0;
-  rPositionContactPnti[7] = -positionAReferential[0]-refconptA[0];
-  rPositionContactPnti[2] = -positionAReferential[1]-refconptA[1];
-  rPositionContactPnti[5] = positionAReferential[0]-refconptA[0];
-  rPositionContactPnti[8] = 0.0;
-  rPositionContactPntj[0] = 0.0;
-  rPositionContactPntj[3] = -positionBReferential[2]-refconptB[2];
-  rPositionContactPntj[6] = positionBReferential[1]-refconptB[1];
-  rPositionContactPntj[1] = positionBReferential[2]-refconptB[2];
-  rPositionContactPntj[4] = 0.0;
-  rPositionContactPntj[7] = -positionBReferential[0]-refconptB[0];
-  rPositionContactPntj[2] = -positionBReferential[1]-refconptB[1];
-  rPositionContactPntj[5] = positionBReferential[0]-refconptB[0];	
-  rPositionContactPntj[8] = 0.0;
-
-
-  iREAL RIi[18];//[Rotation*(RefCentre-RefConPnt)   Identity]
-  iREAL RIj[18];
-
-  NNMUL(rotationA, rPositionContactPnti, RIi);
-
-  RIi[9] = 1.0;		RIi[12] = 0.0;	RIi[15] = 0.0;
-  RIi[10] = 0.0;	RIi[13] = 1.0;	RIi[16] = 0.0;
-  RIi[11] = 0.0;	RIi[14] = 0.0;	RIi[17] = 1.0;
-
-  NNMUL(rotationB, rPositionContactPntj, RIj);
-
-  RIj[9] = 1.0;		RIj[12] = 0.0;	RIj[15] = 0.0;
-  RIj[10] = 0.0;	RIj[13] = 1.0;	RIj[16] = 0.0;
-  RIj[11] = 0.0;	RIj[14] = 0.0;	RIj[17] = 1.0;
-
-  //H_N is a 1x6 matrix; n^T is a 1x3 "matrix" (normal vector transposed);
-  //[Rotation*(RefCentre-RefConPnt)   Identity] is a 3x6 matrix; 1x3 * 3x6 = 1x6;
-  iREAL Hi_n[6];
-  iREAL Hj_n[6];
-
-
-  Hi_n[0] = normal[0]*RIi[0] + normal[1]*RIi[1] + normal[2]*RIi[2];
-  Hi_n[1] = normal[0]*RIi[3] + normal[1]*RIi[4] + normal[2]*RIi[5];
-  Hi_n[2] = normal[0]*RIi[6] + normal[1]*RIi[7] + normal[2]*RIi[8];
-  Hi_n[3] = normal[0]*RIi[9] + normal[1]*RIi[10] + normal[2]*RIi[11];
-  Hi_n[4] = normal[0]*RIi[12] + normal[1]*RIi[13] + normal[2]*RIi[14];
-  Hi_n[5] = normal[0]*RIi[15] + normal[1]*RIi[16] + normal[2]*RIi[17];
-
-  Hj_n[0] = normal[0]*RIj[0] + normal[1]*RIj[1] + normal[2]*RIj[2];
-  Hj_n[1] = normal[0]*RIj[3] + normal[1]*RIj[4] + normal[2]*RIj[5];
-  Hj_n[2] = normal[0]*RIj[6] + normal[1]*RIj[7] + normal[2]*RIj[8];
-  Hj_n[3] = normal[0]*RIj[9] + normal[1]*RIj[10] + normal[2]*RIj[11];
-  Hj_n[4] = normal[0]*RIj[12] + normal[1]*RIj[13] + normal[2]*RIj[14];
-  Hj_n[5] = normal[0]*RIj[15] + normal[1]*RIj[16] + normal[2]*RIj[17];
-
-  iREAL ui[36];
-  ui[0] = inverseA[0]; ui[6] = inverseA[3];	ui[12] = inverseA[6];	ui[18] = 0.0;		  	  ui[24] = 0.0; 		    ui[30] = 0.0;
-  ui[1] = inverseA[1]; ui[7] = inverseA[4];	ui[13] = inverseA[7];	ui[19] = 0.0;			    ui[25] = 0.0; 		    ui[31] = 0.0;
-  ui[2] = inverseA[2]; ui[8] = inverseA[5];	ui[14] = inverseA[8];	ui[20] = 0.0;   		  ui[26] = 0.0; 		    ui[32] = 0.0;
-  ui[3] = 0.0; 		   	 ui[9] = 0.0;				  ui[15] = 0.0;				  ui[21] = (1.0/massA); ui[27] = 0.0; 		    ui[33] = 0.0;
-  ui[4] = 0.0;		     ui[10] = 0.0;			  ui[16] = 0.0;				  ui[22] = 0.0;   		  ui[28] = (1.0/massA); ui[34] = 0.0;
-  ui[5] = 0.0;		     ui[11] = 0.0;			  ui[17] = 0.0;				  ui[23] = 0.0;   		  ui[29] = 0.0; 		    ui[35] = (1.0/massA);
-
-  iREAL uj[36];
-  uj[0] = inverseB[0]; uj[6] = inverseB[3];	uj[12] = inverseB[6];	uj[18] = 0.0;			    uj[24] = 0.0; 		    uj[30] = 0.0;
-  uj[1] = inverseB[1]; uj[7] = inverseB[4];	uj[13] = inverseB[7];	uj[19] = 0.0;			    uj[25] = 0.0; 		    uj[31] = 0.0;
-  uj[2] = inverseB[2]; uj[8] = inverseB[5];	uj[14] = inverseB[8];	uj[20] = 0.0;   		  uj[26] = 0.0; 		    uj[32] = 0.0;
-  uj[3] = 0.0; 		   	 uj[9] = 0;				    uj[15] = 0.0;				  uj[21] = (1.0/massB); uj[27] = 0.0; 		    uj[33] = 0.0;
-  uj[4] = 0.0;		     uj[10] = 0;			    uj[16] = 0.0;				  uj[22] = 0.0;   		  uj[28] = (1.0/massB); uj[34] = 0.0;
-  uj[5] = 0.0;		     uj[11] = 0;			    uj[17] = 0.0;				  uj[23] = 0.0;   		  uj[29] = 0.0; 		    uj[35] = (1.0/massB);
-
-  //H_N (1x6) * [] (6x6)
-  iREAL Hi[6], Hj[6];
-
-  Hi[0] = Hi_n[0]*ui[0] + Hi_n[1]*ui[1] + Hi_n[2]*ui[2] + Hi_n[3]*ui[3] + Hi_n[4]*ui[4] + Hi_n[5]*ui[5];
-  Hi[1] = Hi_n[0]*ui[6] + Hi_n[1]*ui[7] + Hi_n[2]*ui[8] + Hi_n[3]*ui[9] + Hi_n[4]*ui[10] + Hi_n[5]*ui[11];
-  Hi[2] = Hi_n[0]*ui[12] + Hi_n[1]*ui[13] + Hi_n[2]*ui[14] + Hi_n[3]*ui[15] + Hi_n[4]*ui[16] + Hi_n[5]*ui[17];
-  Hi[3] = Hi_n[0]*ui[18] + Hi_n[1]*ui[19] + Hi_n[2]*ui[20] + Hi_n[3]*ui[21] + Hi_n[4]*ui[22] + Hi_n[5]*ui[23];
-  Hi[4] = Hi_n[0]*ui[24] + Hi_n[1]*ui[25] + Hi_n[2]*ui[26] + Hi_n[3]*ui[27] + Hi_n[4]*ui[28] + Hi_n[5]*ui[29];
-  Hi[5] = Hi_n[0]*ui[30] + Hi_n[1]*ui[31] + Hi_n[2]*ui[32] + Hi_n[3]*ui[33] + Hi_n[4]*ui[34] + Hi_n[5]*ui[35];
-
-  Hj[0] = Hj_n[0]*uj[0] + Hj_n[1]*uj[1] + Hj_n[2]*uj[2] + Hj_n[3]*uj[3] + Hj_n[4]*uj[4] + Hj_n[5]*uj[5];
-  Hj[1] = Hj_n[0]*uj[6] + Hj_n[1]*uj[7] + Hj_n[2]*uj[8] + Hj_n[3]*uj[9] + Hj_n[4]*uj[10] + Hj_n[5]*uj[11];
-  Hj[2] = Hj_n[0]*uj[12] + Hj_n[1]*uj[13] + Hj_n[2]*uj[14] + Hj_n[3]*uj[15] + Hj_n[4]*uj[16] + Hj_n[5]*uj[17];
-  Hj[3] = Hj_n[0]*uj[18] + Hj_n[1]*uj[19] + Hj_n[2]*uj[20] + Hj_n[3]*uj[21] + Hj_n[4]*uj[22] + Hj_n[5]*uj[23];
-  Hj[4] = Hj_n[0]*uj[24] + Hj_n[1]*uj[25] + Hj_n[2]*uj[26] + Hj_n[3]*uj[27] + Hj_n[4]*uj[28] + Hj_n[5]*uj[29];
-  Hj[5] = Hj_n[0]*uj[30] + Hj_n[1]*uj[31] + Hj_n[2]*uj[32] + Hj_n[3]*uj[33] + Hj_n[4]*uj[34] + Hj_n[5]*uj[35];
-
-  iREAL W_NN = (Hi[0]*Hi_n[0] + Hi[1]*Hi_n[1] + Hi[2]*Hi_n[2] + Hi[3]*Hi_n[3] + Hi[4]*Hi_n[4] + Hi[5]*Hi_n[5]) +
-				   (Hj[0]*Hj_n[0] + Hj[1]*Hj_n[1] + Hj[2]*Hj_n[2] + Hj[3]*Hj_n[3] + Hj[4]*Hj_n[4] + Hj[5]*Hj_n[5]);
-
-
-  iREAL ma = 1.0/((1.0/massA) + (1.0/massB));
-
-  iREAL velocity = (vij[0]*normal[0]) + (vij[1]*normal[1]) + (vij[2]*normal[2]);
-
-  iREAL damp = DAMPER*2.0*SPRING*sqrt(ma)*velocity;
-
-  iREAL force = SPRING*depth+damp;
+  T velocity = (vij[0]*normal[0]) + (vij[1]*normal[1]) + (vij[2]*normal[2]);
+
+  T damp = T(parameters.damper)*T(2)*T(parameters.spring)*std::sqrt(ma)*velocity;
+
+  T force = T(parameters.spring)*depth+damp;
 
   f[0] = force*normal[0];
   f[1] = force*normal[1];
   f[2] = force*normal[2];
-    
 
   forc = force;
 }
 
+template<typename T>
+void demolish::resolution::spring(
+    int          numberOfContacts,
+    const T*     normalX,
+    const T*     normalY,
+    const T*     normalZ,
+    const T*     depth,
+    const T*     vijX,
+    const T*     vijY,
+    const T*     vijZ,
+    const T*     mass,
+    const T*     stiffness,
+    const T*     damper,
+    T*           fX,
+    T*           fY,
+    T*           fZ,
+    T*           forc)
+{
+  #pragma omp simd
+  for(int i=0; i<numberOfContacts; i++)
+  {
+    T velocity = vijX[i]*normalX[i] + vijY[i]*normalY[i] + vijZ[i]*normalZ[i];
+    T force    = stiffness[i]*depth[i] + damper[i]*T(2)*stiffness[i]*std::sqrt(mass[i])*velocity;
+
+    fX[i]   = force*normalX[i];
+    fY[i]   = force*normalY[i];
+    fZ[i]   = force*normalZ[i];
+    forc[i] = force;
+  }
+}
+
+
+iREAL demolish::resolution::stableTimestep(
+    iREAL stiffness,
+    iREAL mass,
+    iREAL approachVelocity,
+    iREAL penetration)
+{
+  iREAL timestep = sqrt(mass/stiffness);
+  if(approachVelocity > 0) timestep = std::min(timestep, 0.5*penetration/approachVelocity);
+  return timestep;
+}
 
+template<typename T>
 void demolish::resolution::friction(
-    iREAL normal[3],
-    iREAL vi[3],
-    iREAL force,
-    std::array<iREAL, 3>& friction,
+    T normal[3],
+    T vi[3],
+    T force,
+    std::array<T, 3>& friction,
     int materialA,
     int materialB,
     bool isSphere)
 {
-  iREAL vt[3];
+  T vt[3];
   vt[0] = vi[0] - normal[0]*((vi[0]*normal[0]) + (vi[1]*normal[1]) + (vi[2]*normal[2]));
   vt[1] = vi[1] - normal[1]*((vi[0]*normal[0]) + (vi[1]*normal[1]) + (vi[2]*normal[2]));
   vt[2] = vi[2] - normal[2]*((vi[0]*normal[0]) + (vi[1]*normal[1]) + (vi[2]*normal[2]));
 
-  if(isSphere)
+  T coefficient = demolish::material::getInteraction(isSphere ? demolish::material::SPHERE : demolish::material::MESH,
+                                                        materialA, materialB).friction;
+
+  friction[0] =  -vt[0]*coefficient*force;
+  friction[1] =  -vt[1]*coefficient*force;
+  friction[2] =  -vt[2]*coefficient*force;
+}
+
+template<typename T>
+void demolish::resolution::springSlider(
+    T normal[3],
+    T vij[3],
+    T force,
+    T stiffness,
+    T coefficient,
+    T timestep,
+    T displacement[3],
+    std::array<T, 3>& friction)
+{
+  T vn = (vij[0]*normal[0]) + (vij[1]*normal[1]) + (vij[2]*normal[2]);
+
+  T vt[3];
+  vt[0] = vij[0] - normal[0]*vn;
+  vt[1] = vij[1] - normal[1]*vn;
+  vt[2] = vij[2] - normal[2]*vn;
+
+  //the contact plane rotates with the bodies, rotate the spring into it
+  T length = std::sqrt((displacement[0]*displacement[0]) + (displacement[1]*displacement[1]) + (displacement[2]*displacement[2]));
+  T dn     = (displacement[0]*normal[0]) + (displacement[1]*normal[1]) + (displacement[2]*normal[2]);
+  displacement[0] -= normal[0]*dn;
+  displacement[1] -= normal[1]*dn;
+  displacement[2] -= normal[2]*dn;
+
+  T projected = std::sqrt((displacement[0]*displacement[0]) + (displacement[1]*displacement[1]) + (displacement[2]*displacement[2]));
+  if(projected > 0)
   {
-    friction[0] =  -vt[0]*SFRICTIONGOLD*force;
-    friction[1] =  -vt[1]*SFRICTIONGOLD*force;
-    friction[2] =  -vt[2]*SFRICTIONGOLD*force;
-  } else {
-    friction[0] =  -vt[0]*FRICTION*force;
-    friction[1] =  -vt[1]*FRICTION*force;
-    friction[2] =  -vt[2]*FRICTION*force;
+    displacement[0] *= length/projected;
+    displacement[1] *= length/projected;
+    displacement[2] *= length/projected;
+  }
+
+  displacement[0] += timestep*vt[0];
+  displacement[1] += timestep*vt[1];
+  displacement[2] += timestep*vt[2];
+
+  friction[0] = -stiffness*displacement[0];
+  friction[1] = -stiffness*displacement[1];
+  friction[2] = -stiffness*displacement[2];
+
+  //Coulomb limit, the contact slides and the spring only keeps the limit
+  T limit     = coefficient*std::abs(force);
+  T magnitude = std::sqrt((friction[0]*friction[0]) + (friction[1]*friction[1]) + (friction[2]*friction[2]));
+  if(magnitude > limit)
+  {
+    T scale = limit/magnitude;
+    friction[0] *= scale;
+    friction[1] *= scale;
+    friction[2] *= scale;
+
+    displacement[0] = -friction[0]/stiffness;
+    displacement[1] = -friction[1]/stiffness;
+    displacement[2] = -friction[2]/stiffness;
   }
 }
 
 void demolish::resolution::getContactForces(
   demolish::ContactPoint &conpnt,
   iREAL positionASpatial[3],
-  iREAL positionAReferential[3],
   iREAL angularA[3],
   iREAL linearA[3],
   iREAL massA,
@@ -199,7 +234,6 @@ void demolish::resolution::getContactForces(
   int   materialA,
 
   iREAL positionBSpatial[3],
-  iREAL positionBReferential[3],
   iREAL angularB[3],
   iREAL linearB[3],
   iREAL massB,
@@ -209,8 +243,12 @@ void demolish::resolution::getContactForces(
 
   std::array<iREAL, 3>& force,
   std::array<iREAL, 3>& torque,
-  bool  isSphere)
+  bool  isSphere,
+  iREAL *tangentialDisplacement,
+  iREAL timestep)
 {
+    //touching surfaces give the detectors no normal, the contact has no force
+    if(!(conpnt.normal[0]*conpnt.normal[0]+conpnt.normal[1]*conpnt.normal[1]+conpnt.normal[2]*conpnt.normal[2] > 0.5)) return;
 
     iREAL z[3], vi[3], vj[3], vij[3];
 
@@ -242,6 +280,10 @@ void demolish::resolution::getContactForces(
     std::array<iREAL, 3> f, friction;
     iREAL forc;
 
+    const demolish::material::InteractionParameters& parameters =
+        demolish::material::getInteraction(isSphere ? demolish::material::SPHERE : demolish::material::MESH,
+                                           materialA, materialB);
+
     if(isSphere)
     {
       demolish::resolution::springSphere(conpnt.normal,
@@ -249,6 +291,7 @@ void demolish::resolution::getContactForces(
                                          vij,
                                          massA,
                                          massB,
+                                         parameters,
                                          f,
                                          forc);
     } else {
@@ -258,39 +301,66 @@ void demolish::resolution::getContactForces(
                                    vij,
                                    positionASpatial,
                                    positionBSpatial,
-                                   positionAReferential,
-                                   positionBReferential,
                                    massA,
                                    massB,
                                    rotationA,
                                    rotationB,
                                    inverseA,
                                    inverseB,
+                                   parameters,
                                    f,
                                    forc);
     }
-    
 
+    //the normal points from B to A, the spring pushes B the other way
+    f[0] = -f[0];
+    f[1] = -f[1];
+    f[2] = -f[2];
+
+    //the normal force acts on every contact, friction only where it is enabled
+    friction[0] = friction[1] = friction[2] = 0.0;
     if(conpnt.friction)
     {
-        demolish::resolution::friction(conpnt.normal, vi, forc, friction, materialA, materialB, isSphere);
-
-        //accumulate force
-        force[0] += f[0] + friction[0];
-        force[1] += f[1] + friction[1];
-        force[2] += f[2] + friction[2];
-
-        iREAL arm[3];
-        //contact-position = arm
-        arm[0] = conpnt.x[0]-positionASpatial[0];
-        arm[1] = conpnt.x[1]-positionASpatial[1];
-        arm[2] = conpnt.x[2]-positionASpatial[2];
-
-        //cross product accumulate torque
-        torque[0] += arm[1]*(f[2]) - arm[2]*(f[1]);
-        torque[1] += arm[2]*(f[0]) - arm[0]*(f[2]);
-        torque[2] += arm[0]*(f[1]) - arm[1]*(f[0]);
+        if(tangentialDisplacement)
+        {
+          demolish::resolution::springSlider(conpnt.normal, vij, forc,
+                                             parameters.tangential*parameters.spring,
+                                             parameters.friction,
+                                             timestep, tangentialDisplacement, friction);
+        } else {
+          demolish::resolution::friction(conpnt.normal, vi, forc, friction, materialA, materialB, isSphere);
+        }
     }
+
+    //accumulate force
+    force[0] += f[0] + friction[0];
+    force[1] += f[1] + friction[1];
+    force[2] += f[2] + friction[2];
+
+    iREAL arm[3];
+    //contact-position = arm
+    arm[0] = conpnt.x[0]-positionASpatial[0];
+    arm[1] = conpnt.x[1]-positionASpatial[1];
+    arm[2] = conpnt.x[2]-positionASpatial[2];
+
+    //cross product accumulate torque
+    //the tangential force is what makes a resting body stop rolling
+    torque[0] += arm[1]*(f[2]+friction[2]) - arm[2]*(f[1]+friction[1]);
+    torque[1] += arm[2]*(f[0]+friction[0]) - arm[0]*(f[2]+friction[2]);
+    torque[2] += arm[0]*(f[1]+friction[1]) - arm[1]*(f[0]+friction[0]);
   
 }
 
+#define DEMOLISH_INSTANTIATE_FORCES(T) \
+  template T    demolish::resolution::effectiveMass<T>(T*, T*, T*, T*, T, T, T*, T*, T*, T*); \
+  template void demolish::resolution::spring<T>( \
+    T*, T*, T, T*, T*, T*, T, T, T*, T*, T*, T*, \
+    const demolish::material::InteractionParameters&, std::array<T, 3>&, T&); \
+  template void demolish::resolution::friction<T>(T*, T*, T, std::array<T, 3>&, int, int, bool); \
+  template void demolish::resolution::springSlider<T>(T*, T*, T, T, T, T, T*, std::array<T, 3>&); \
+  template void demolish::resolution::spring<T>( \
+    int, const T*, const T*, const T*, const T*, const T*, const T*, const T*, \
+    const T*, const T*, const T*, T*, T*, T*, T*);
+
+DEMOLISH_INSTANTIATE_FORCES(float)
+DEMOLISH_INSTANTIATE_FORCES(double)
@@ -1,5 +1,6 @@
 #include"../ContactPoint.h"
 #include"sphere.h"
+#include"../material.h"
 #include <vector>
 #include <cmath>
 #include <iostream>
@@ -10,53 +11,166 @@
 #ifndef _DELTA_FORCES_H_
 #define _DELTA_FORCES_H_
 
-#define NNMUL(A, B, C)\
-{\
- (C) [0] = (A)[0]*(B)[0]+(A)[3]*(B)[1]+(A)[6]*(B)[2];\
- (C) [1] = (A)[1]*(B)[0]+(A)[4]*(B)[1]+(A)[7]*(B)[2];\
- (C) [2] = (A)[2]*(B)[0]+(A)[5]*(B)[1]+(A)[8]*(B)[2];\
- (C) [3] = (A)[0]*(B)[3]+(A)[3]*(B)[4]+(A)[6]*(B)[5];\
- (C) [4] = (A)[1]*(B)[3]+(A)[4]*(B)[4]+(A)[7]*(B)[5];\
- (C) [5] = (A)[2]*(B)[3]+(A)[5]*(B)[4]+(A)[8]*(B)[5];\
- (C) [6] = (A)[0]*(B)[6]+(A)[3]*(B)[7]+(A)[6]*(B)[8];\
- (C) [7] = (A)[1]*(B)[6]+(A)[4]*(B)[7]+(A)[7]*(B)[8];\
- (C) [8] = (A)[2]*(B)[6]+(A)[5]*(B)[7]+(A)[8]*(B)[8];\
-}
-
 namespace demolish {
 	namespace resolution {
+	  /*
+	   *  Damping Mode
+	   *
+	   *  REDUCEDMASS damps with the reduced mass of the two bodies.
+	   *  EFFECTIVEMASS uses the inverse of W_NN, the mass seen along the
+	   *  normal at the contact point, which includes the rotational
+	   *  inertia. Only this mode pays for W_NN.
+	   */
+	  enum class DampingMode {
+		  REDUCEDMASS,
+		  EFFECTIVEMASS
+	  };
+
+	  void        setDampingMode(DampingMode mode);
+	  DampingMode getDampingMode();
+
+	  /*
+	   *  Effective Mass
+	   *
+	   *  Returns 1/W_NN of the contact, without building the 6x6
+	   *  mobility matrices.
+	   */
+	  template<typename T>
+	  T effectiveMass(
+		  T normal[3],
+		  T conpnt[3],
+		  T positionASpatial[3],
+		  T positionBSpatial[3],
+		  T massA,
+		  T massB,
+		  T rotationA[9],
+		  T rotationB[9],
+		  T inverseA[9],
+		  T inverseB[9]);
+
+	  /*
+	   *  Spring
+	   *
+	   *  Normal spring-damper force of a mesh contact. The geometric
+	   *  arguments are only read in the EFFECTIVEMASS damping mode.
+	   *  Like the friction kernels it is instantiated for float and
+	   *  double.
+	   */
+	  template<typename T>
 	  void spring(
-		  iREAL normal[3],
-		  iREAL conpnt[3],
-		  iREAL depth,
-		  iREAL vij[3],
-		  iREAL positionASpatial[3],
-		  iREAL positionBSpatial[3],
-		  iREAL positionAReferential[3],
-		  iREAL positionBReferential[3],
+		  T normal[3],
+		  T conpnt[3],
+		  T depth,
+		  T vij[3],
+		  T positionASpatial[3],
+		  T positionBSpatial[3],
+		  T massA,
+		  T massB,
+		  T rotationA[9],
+		  T rotationB[9],
+		  T inverseA[9],
+		  T inverseB[9],
+		  const demolish::material::InteractionParameters& parameters,
+		  std::array<T, 3>& f,
+		  T &forc);
 
-		  iREAL massA,
-		  iREAL massB,
-		  iREAL rotationA[9],
-		  iREAL rotationB[9],
-		  iREAL inverseA[9],
-		  iREAL inverseB[9],
-		  std::array<iREAL, 3>& f,
-		  iREAL &forc);
+	  /*
+	   *  Spring (batched)
+	   *
+	   *  Same force for many contacts in structure of arrays form. mass
+	   *  is the reduced or the effective mass of each contact, stiffness
+	   *  and damper come from the material table. The loop vectorises,
+	   *  in float it runs twice as many contacts per instruction.
+	   */
+	  template<typename T>
+	  void spring(
+		  int          numberOfContacts,
+		  const T*     normalX,
+		  const T*     normalY,
+		  const T*     normalZ,
+		  const T*     depth,
+		  const T*     vijX,
+		  const T*     vijY,
+		  const T*     vijZ,
+		  const T*     mass,
+		  const T*     stiffness,
+		  const T*     damper,
+		  T*           fX,
+		  T*           fY,
+		  T*           fZ,
+		  T*           forc);
 
+	  template<typename T>
 	  void friction(
-		  iREAL normal[3],
-		  iREAL vi[3],
-		  iREAL force,
-		  std::array<iREAL,3>& friction,
+		  T normal[3],
+		  T vi[3],
+		  T force,
+		  std::array<T,3>& friction,
 		  int materialA,
 		  int materialB,
 		  bool isSphere);
 
+	  /*
+	   *  Spring Slider
+	   *
+	   *  Cundall-Strack tangential contact. The tangential displacement
+	   *  of the contact is integrated over its lifetime and acts as a
+	   *  spring; once the spring force exceeds the Coulomb limit the
+	   *  contact slides and the displacement is truncated to the limit.
+	   *
+	   *  @param normal       : contact normal
+	   *  @param vij          : relative velocity of B with respect to A
+	   *  @param force        : normal force magnitude
+	   *  @param stiffness    : tangential spring stiffness
+	   *  @param coefficient  : Coulomb friction coefficient
+	   *  @param timestep     : step size
+	   *  @param displacement : accumulated tangential displacement, updated in place
+	   *  @param friction     : tangential force acting on B
+	   *  @returns void
+	   */
+	  template<typename T>
+	  void springSlider(
+		  T normal[3],
+		  T vij[3],
+		  T force,
+		  T stiffness,
+		  T coefficient,
+		  T timestep,
+		  T displacement[3],
+		  std::array<T,3>& friction);
+
+	  /*
+	   *  Stable Timestep
+	   *
+	   *  Longest step a body on contact springs tolerates. The springs
+	   *  oscillate with omega = sqrt(stiffness/mass), an explicit step
+	   *  is stable up to 2/omega and takes half of that. The contacts
+	   *  also must not close by more than half the allowed penetration
+	   *  in one step.
+	   *
+	   *  @param stiffness        : summed normal stiffness of the contacts
+	   *  @param mass             : mass of the body
+	   *  @param approachVelocity : fastest closing speed of the contacts
+	   *  @param penetration      : allowed penetration
+	   *  @returns the step
+	   */
+	  iREAL stableTimestep(
+		  iREAL stiffness,
+		  iREAL mass,
+		  iREAL approachVelocity,
+		  iREAL penetration);
+
+	  /*
+	   *  Get Contact Forces
+	   *
+	   *  Normal spring-damper plus friction. If tangentialDisplacement is
+	   *  given (see ContactCache) friction is the spring-slider, otherwise
+	   *  the viscous model without memory. f is the force on B, A takes
+	   *  it with the opposite sign.
+	   */
 	  void getContactForces(
 		demolish::ContactPoint &conpnt,
 		iREAL positionASpatial[3],
-		iREAL positionAReferential[3],
 		iREAL angularA[3],
 		iREAL linearA[3],
 		iREAL massA,
@@ -65,7 +179,6 @@ namespace demolish {
 		int   materialA,
 
 		iREAL positionB[3],
-		iREAL positionBReferential[3],
 		iREAL angularB[3],
 		iREAL linearB[3],
 		iREAL massB,
@@ -75,7 +188,9 @@ namespace demolish {
 
 		std::array<iREAL, 3> &f ,
 		std::array<iREAL, 3> &torque,
-		bool  isSphere);
+		bool  isSphere,
+		iREAL *tangentialDisplacement,
+		iREAL timestep);
 
 	}
 }
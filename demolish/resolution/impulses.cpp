@@ -0,0 +1,220 @@
+#include "impulses.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+  // share of a penetration beyond the allowed one that is corrected per step
+  const iREAL recovery = 0.2;
+
+  void cross(const iREAL a[3], const iREAL b[3], iREAL c[3])
+  {
+    c[0] = a[1]*b[2]-a[2]*b[1];
+    c[1] = a[2]*b[0]-a[0]*b[2];
+    c[2] = a[0]*b[1]-a[1]*b[0];
+  }
+
+  iREAL dot(const iREAL a[3], const iREAL b[3])
+  {
+    return a[0]*b[0]+a[1]*b[1]+a[2]*b[2];
+  }
+
+  // W of a direction: the velocity change along it per unit impulse
+  iREAL mobility(const demolish::resolution::ImpulseBody& body, const iREAL arm[3], const iREAL direction[3])
+  {
+    if(body.inverseMass == 0.0) return 0.0;
+    iREAL h[3];
+    cross(arm, direction, h);
+    const iREAL* I = body.inverseInertia;
+    return body.inverseMass + h[0]*(I[0]*h[0]+I[3]*h[1]+I[6]*h[2])
+                            + h[1]*(I[1]*h[0]+I[4]*h[1]+I[7]*h[2])
+                            + h[2]*(I[2]*h[0]+I[5]*h[1]+I[8]*h[2]);
+  }
+
+  void push(const demolish::resolution::ImpulseBody& body, iREAL linear[3], iREAL angular[3],
+            const iREAL arm[3], const iREAL impulse[3], iREAL sign)
+  {
+    if(body.inverseMass == 0.0) return;
+    iREAL h[3];
+    cross(arm, impulse, h);
+    const iREAL* I = body.inverseInertia;
+    for(int k=0; k<3; k++)
+    {
+      linear[k]  += sign*body.inverseMass*impulse[k];
+      angular[k] += sign*(I[k]*h[0]+I[k+3]*h[1]+I[k+6]*h[2]);
+    }
+  }
+
+  // velocity of B relative to A at the contact point
+  void relativeVelocity(const demolish::resolution::ImpulseContact& contact,
+                        const iREAL linearA[3], const iREAL angularA[3],
+                        const iREAL linearB[3], const iREAL angularB[3],
+                        iREAL u[3])
+  {
+    iREAL wA[3], wB[3];
+    cross(angularA, contact.armA, wA);
+    cross(angularB, contact.armB, wB);
+    for(int k=0; k<3; k++) u[k] = (linearB[k]+wB[k]) - (linearA[k]+wA[k]);
+  }
+
+  void projectOntoCone(iREAL impulse[3], iREAL friction)
+  {
+    const iREAL limit  = friction*impulse[0];
+    const iREAL length = std::sqrt(impulse[1]*impulse[1]+impulse[2]*impulse[2]);
+    if(length <= limit) return;
+    const iREAL scale = length > 0.0 ? limit/length : 0.0;
+    impulse[1] *= scale;
+    impulse[2] *= scale;
+  }
+}
+
+void demolish::resolution::prepareImpulseContact(
+  ImpulseContact&      contact,
+  const ImpulseBody&   A,
+  const ImpulseBody&   B,
+  const iREAL          x[3],
+  const iREAL          centreA[3],
+  const iREAL          centreB[3],
+  const iREAL          normal[3],
+  iREAL                penetration,
+  iREAL                allowed,
+  iREAL                friction,
+  iREAL                timestep,
+  const iREAL*         warmStart)
+{
+  // touching surfaces give the detectors no normal, the contact stays idle
+  contact.impulse[0] = contact.impulse[1] = contact.impulse[2] = 0.0;
+  contact.correction = 0.0;
+  if(!(dot(normal, normal) > 0.5))
+  {
+    for(int k=0; k<3; k++)
+    {
+      contact.normal[k] = contact.tangent[0][k] = contact.tangent[1][k] = 0.0;
+      contact.armA[k]   = contact.armB[k]       = contact.mass[k]       = 0.0;
+    }
+    contact.bias     = contact.separation = 0.0;
+    contact.friction = 0.0;
+    return;
+  }
+
+  for(int k=0; k<3; k++)
+  {
+    contact.normal[k] = normal[k];
+    contact.armA[k]   = x[k]-centreA[k];
+    contact.armB[k]   = x[k]-centreB[k];
+  }
+
+  // the first tangent is the axis furthest from the normal, made orthogonal
+  int axis = 0;
+  for(int k=1; k<3; k++)
+  {
+    if(std::abs(normal[k]) < std::abs(normal[axis])) axis = k;
+  }
+  iREAL* t = contact.tangent[0];
+  for(int k=0; k<3; k++) t[k] = -normal[axis]*normal[k];
+  t[axis] += 1.0;
+  const iREAL length = std::sqrt(dot(t, t));
+  for(int k=0; k<3; k++) t[k] /= length;
+  cross(normal, t, contact.tangent[1]);
+
+  const iREAL* directions[3] = {contact.normal, contact.tangent[0], contact.tangent[1]};
+  for(int d=0; d<3; d++)
+  {
+    const iREAL W = mobility(A, contact.armA, directions[d]) + mobility(B, contact.armB, directions[d]);
+    contact.mass[d] = W > 0.0 ? 1.0/W : 0.0;
+  }
+
+  // the excess is pushed out by the correction velocities, the contact
+  // gains no momentum from it
+  contact.bias       = std::min(penetration-allowed, iREAL(0.0))/timestep;
+  contact.separation = recovery*std::max(penetration-allowed, iREAL(0.0))/timestep;
+  contact.friction = friction;
+
+  if(warmStart)
+  {
+    contact.impulse[0] = std::max(dot(warmStart, contact.normal), iREAL(0.0));
+    if(friction > 0.0)
+    {
+      contact.impulse[1] = dot(warmStart, contact.tangent[0]);
+      contact.impulse[2] = dot(warmStart, contact.tangent[1]);
+      projectOntoCone(contact.impulse, friction);
+    }
+  }
+}
+
+void demolish::resolution::applyImpulse(
+  const ImpulseContact& contact,
+  const iREAL           impulse[3],
+  ImpulseBody&          A,
+  ImpulseBody&          B)
+{
+  iREAL P[3];
+  for(int k=0; k<3; k++)
+  {
+    P[k] = impulse[0]*contact.normal[k] + impulse[1]*contact.tangent[0][k] + impulse[2]*contact.tangent[1][k];
+  }
+  push(A, A.linear, A.angular, contact.armA, P, -1.0);
+  push(B, B.linear, B.angular, contact.armB, P,  1.0);
+}
+
+iREAL demolish::resolution::solveImpulseContact(
+  ImpulseContact&      contact,
+  ImpulseBody&         A,
+  ImpulseBody&         B)
+{
+  if(contact.mass[0] == 0.0) return 0.0;
+
+  iREAL u[3];
+  relativeVelocity(contact, A.linear, A.angular, B.linear, B.angular, u);
+
+  // the normal impulse only pushes
+  const iREAL normal = std::max(contact.impulse[0] + contact.mass[0]*(contact.bias-dot(u, contact.normal)), iREAL(0.0));
+  iREAL delta[3] = {normal-contact.impulse[0], 0.0, 0.0};
+  contact.impulse[0] = normal;
+  applyImpulse(contact, delta, A, B);
+  iREAL residual = std::abs(delta[0])/contact.mass[0];
+
+  if(contact.friction > 0.0)
+  {
+    relativeVelocity(contact, A.linear, A.angular, B.linear, B.angular, u);
+    iREAL impulse[3] = {contact.impulse[0],
+                        contact.impulse[1] - contact.mass[1]*dot(u, contact.tangent[0]),
+                        contact.impulse[2] - contact.mass[2]*dot(u, contact.tangent[1])};
+    projectOntoCone(impulse, contact.friction);
+
+    delta[0] = 0.0;
+    delta[1] = impulse[1]-contact.impulse[1];
+    delta[2] = impulse[2]-contact.impulse[2];
+    contact.impulse[1] = impulse[1];
+    contact.impulse[2] = impulse[2];
+    applyImpulse(contact, delta, A, B);
+    for(int d=1; d<3; d++)
+    {
+      if(contact.mass[d] > 0.0) residual = std::max(residual, std::abs(delta[d])/contact.mass[d]);
+    }
+  }
+
+  // the correction row on the correction velocities alone
+  if(contact.separation > 0.0)
+  {
+    relativeVelocity(contact, A.linearCorrection, A.angularCorrection, B.linearCorrection, B.angularCorrection, u);
+    const iREAL accumulated = std::max(contact.correction + contact.mass[0]*(contact.separation-dot(u, contact.normal)), iREAL(0.0));
+    iREAL P[3];
+    for(int k=0; k<3; k++) P[k] = (accumulated-contact.correction)*contact.normal[k];
+    push(A, A.linearCorrection, A.angularCorrection, contact.armA, P, -1.0);
+    push(B, B.linearCorrection, B.angularCorrection, contact.armB, P,  1.0);
+    residual = std::max(residual, std::abs(accumulated-contact.correction)/contact.mass[0]);
+    contact.correction = accumulated;
+  }
+  return residual;
+}
+
+void demolish::resolution::getImpulse(
+  const ImpulseContact& contact,
+  iREAL                 impulse[3])
+{
+  for(int k=0; k<3; k++)
+  {
+    impulse[k] = contact.impulse[0]*contact.normal[k] + contact.impulse[1]*contact.tangent[0][k] + contact.impulse[2]*contact.tangent[1][k];
+  }
+}
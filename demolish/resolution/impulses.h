@@ -0,0 +1,147 @@
+#ifndef DEMOLISH_RESOLUTION_IMPULSES_H_
+#define DEMOLISH_RESOLUTION_IMPULSES_H_
+
+#include "../demolish.h"
+
+namespace demolish {
+	namespace resolution {
+
+	  /*
+	   *  Contact Solver
+	   *
+	   *  PENALTY turns the depth of every contact into a spring-damper
+	   *  force, see getContactForces. The step has to resolve the spring
+	   *  oscillation, see stableTimestep.
+	   *  GAUSSSEIDEL solves for contact impulses on the velocity level
+	   *  with projected Gauss-Seidel sweeps: no contact approaches
+	   *  further than the allowed penetration within the step, friction
+	   *  stays within the Coulomb cone. The step is not bound by the
+	   *  stiffness.
+	   */
+	  enum class ContactSolver {
+		  PENALTY,
+		  GAUSSSEIDEL
+	  };
+
+	  /*
+	   *  Impulse Body
+	   *
+	   *  Velocities of a body while the impulses are solved. Obstacles
+	   *  have no inverse mass and inertia, impulses leave them as they
+	   *  are. The correction velocities push overlapping bodies apart
+	   *  within the step, they move the bodies but are not kept.
+	   */
+	  struct ImpulseBody {
+		  iREAL linear[3];
+		  iREAL angular[3];          // spatial
+		  iREAL linearCorrection[3];
+		  iREAL angularCorrection[3]; // spatial
+		  iREAL inverseMass;
+		  iREAL inverseInertia[9];   // spatial, column major
+	  };
+
+	  /*
+	   *  Impulse Contact
+	   *
+	   *  One row block of the contact problem: the normal and two
+	   *  tangents, the arms from the centres of mass, the inverse of
+	   *  W_NN and W_TT along each direction, the normal velocity the
+	   *  contact has to reach, the one its correction has to reach and
+	   *  the accumulated impulses.
+	   */
+	  struct ImpulseContact {
+		  int   a;
+		  int   b;
+		  iREAL normal[3];           // from A to B
+		  iREAL tangent[2][3];
+		  iREAL armA[3];
+		  iREAL armB[3];
+		  iREAL mass[3];             // normal, tangents
+		  iREAL bias;
+		  iREAL separation;
+		  iREAL friction;            // Coulomb coefficient, 0 for none
+		  iREAL impulse[3];          // normal, tangents
+		  iREAL correction;          // normal
+	  };
+
+	  /*
+	   *  Prepare Impulse Contact
+	   *
+	   *  Fills the geometry and masses of a contact and starts it from
+	   *  the impulse of the last step, projected onto the new normal and
+	   *  friction cone. A contact may close down to the allowed
+	   *  penetration within the step. The excess of a deeper one is
+	   *  pushed out by a fraction per step through the correction
+	   *  velocities, which do not turn into momentum. Touching surfaces
+	   *  have no normal, such a contact is left idle.
+	   *
+	   *  @param contact     : filled, a and b have to be set
+	   *  @param A           : body a
+	   *  @param B           : body b
+	   *  @param x           : contact point
+	   *  @param centreA     : centre of mass of a
+	   *  @param centreB     : centre of mass of b
+	   *  @param normal      : normal from A to B
+	   *  @param penetration : overlap of the contact epsilons
+	   *  @param allowed     : penetration a contact may reach
+	   *  @param friction    : Coulomb coefficient
+	   *  @param timestep    : step size
+	   *  @param warmStart   : impulse of the last step in space, may be 0
+	   *  @returns void
+	   */
+	  void prepareImpulseContact(
+		  ImpulseContact&      contact,
+		  const ImpulseBody&   A,
+		  const ImpulseBody&   B,
+		  const iREAL          x[3],
+		  const iREAL          centreA[3],
+		  const iREAL          centreB[3],
+		  const iREAL          normal[3],
+		  iREAL                penetration,
+		  iREAL                allowed,
+		  iREAL                friction,
+		  iREAL                timestep,
+		  const iREAL*         warmStart);
+
+	  /*
+	   *  Apply Impulse
+	   *
+	   *  Adds the impulse along normal and tangents to B and subtracts
+	   *  it from A.
+	   */
+	  void applyImpulse(
+		  const ImpulseContact& contact,
+		  const iREAL           impulse[3],
+		  ImpulseBody&          A,
+		  ImpulseBody&          B);
+
+	  /*
+	   *  Solve Impulse Contact
+	   *
+	   *  One Gauss-Seidel update of a contact: the normal impulse is
+	   *  corrected towards the bias and kept compressive, then the
+	   *  tangential impulse towards sticking and projected onto the
+	   *  friction cone, last the correction impulse of a deep contact.
+	   *  Both bodies are updated at once.
+	   *
+	   *  @returns the largest velocity change of the update, the
+	   *           residual of the contact
+	   */
+	  iREAL solveImpulseContact(
+		  ImpulseContact&      contact,
+		  ImpulseBody&         A,
+		  ImpulseBody&         B);
+
+	  /*
+	   *  Get Impulse
+	   *
+	   *  The accumulated impulse of a contact in space, the warm start
+	   *  of the next step.
+	   */
+	  void getImpulse(
+		  const ImpulseContact& contact,
+		  iREAL                 impulse[3]);
+	}
+}
+
+#endif
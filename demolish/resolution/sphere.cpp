@@ -1,23 +1,25 @@
 #include"sphere.h"
-#include<math.h>
+#include<cmath>
 #include<iostream>
+template<typename T>
 void demolish::resolution::springSphere(
-    iREAL normal[3],
-    iREAL depth,
-    iREAL relativeVelocity[3],
-    iREAL massA,
-    iREAL massB,
-    std::array<iREAL, 3>& f,
-    iREAL &forc)
+    T normal[3],
+    T depth,
+    T relativeVelocity[3],
+    T massA,
+    T massB,
+    const demolish::material::InteractionParameters& parameters,
+    std::array<T, 3>& f,
+    T &forc)
 {
-  iREAL ma = 1.0/sqrt((1.0/massA) + (1.0/massB));
+  T ma = T(1)/std::sqrt((T(1)/massA) + (T(1)/massB));
 
-  iREAL velocity = (relativeVelocity[0]*normal[0]) + (relativeVelocity[1]*normal[1]) + (relativeVelocity[2]*normal[2]);
+  T velocity = (relativeVelocity[0]*normal[0]) + (relativeVelocity[1]*normal[1]) + (relativeVelocity[2]*normal[2]);
 
 
-  iREAL damp = 2.0 * SDAMPER * sqrt(ma)*velocity;
+  T damp = T(2) * T(parameters.damper) * std::sqrt(ma)*velocity;
 
-  iREAL force = SSPRING*sqrt(SSPRING)*depth + damp;
+  T force = T(parameters.spring)*depth + damp;
 
   f[0] = force*normal[0];
   f[1] = force*normal[1];
@@ -30,3 +32,5 @@ void demolish::resolution::springSphere(
   #endif
 }
 
+template void demolish::resolution::springSphere<float>(float*, float, float*, float, float, const demolish::material::InteractionParameters&, std::array<float, 3>&, float&);
+template void demolish::resolution::springSphere<double>(double*, double, double*, double, double, const demolish::material::InteractionParameters&, std::array<double, 3>&, double&);
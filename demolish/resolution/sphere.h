@@ -1,13 +1,8 @@
 #include"../demolish.h"
+#include"../material.h"
 
 #include<array>
 
-#define SSPRING 200000
-#define SDAMPER 0.5
-#define SFRICTIONGOLD 1
-#define SFRICTIONWOOD 1
-#define SFRICTIONROLLING 0.5
-
 namespace demolish{
     namespace resolution{
 
@@ -21,18 +16,21 @@ namespace demolish{
 	   * @param relativeVelocity is the relative velocity between the two spheres
 	   * @param massA is the mass of particle A
 	   * @param massB is the mass of particle B
+	   * @param parameters are the contact parameters of the material pair
 	   * @param f is the vector force at the contact point
 	   * @param force is the force magnitude at the contact point
 	   * @return void
 	   */
+	  template<typename T>
 	  void springSphere(
-		  iREAL normal[3],
-		  iREAL depth,
-		  iREAL relativeVelocity[3],
-		  iREAL massA,
-		  iREAL massB,
-		  std::array<iREAL, 3> & f,
-		  iREAL& forc);
+		  T normal[3],
+		  T depth,
+		  T relativeVelocity[3],
+		  T massA,
+		  T massB,
+		  const demolish::material::InteractionParameters& parameters,
+		  std::array<T, 3> & f,
+		  T& forc);
 
     }
 }
@@ -0,0 +1,90 @@
+#include "World.h"
+#include "filio/scene.h"
+#include <omp.h>
+#include <cstring>
+#include <iostream>
+
+/*
+ * Batch runs of scene files
+ *
+ * Builds the scene described in a scene file (see filio/scene.h), runs
+ * it and writes the trajectory and checkpoint the scene asks for.
+ *
+ * Usage:
+ *   demolish-scene scene.txt [--steps n] [--visualise]
+ *
+ * --steps overrides the steps of the scene. Without a window a scene
+ * needs a number of steps; with --visualise and no steps the run lasts
+ * until the window is closed.
+ */
+
+int main(int argc, char** argv) {
+  if(argc < 2)
+  {
+    std::cout << "usage: " << argv[0] << " scene [--steps n] [--visualise]" << std::endl;
+    return 1;
+  }
+
+  int  steps     = -1;
+  bool visualise = false;
+  for(int i=2; i<argc; i++)
+  {
+    if(std::strcmp(argv[i], "--steps") == 0 && i+1 < argc) steps = std::atoi(argv[++i]);
+    else if(std::strcmp(argv[i], "--visualise") == 0)      visualise = true;
+    else
+    {
+      std::cout << "unknown argument " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  double start = omp_get_wtime();
+  demolish::scene::Scene scene;
+  if(!demolish::scene::load(argv[1], scene)) return 1;
+  std::cout << scene.objects.size() << " bodies built in " << omp_get_wtime()-start << " s" << std::endl;
+  if(steps < 0) steps = scene.steps;
+
+  start = omp_get_wtime();
+  demolish::World world(scene.objects, scene.gravity, visualise);
+  world.setReorderInterval(scene.reorderInterval);
+  world.setTimestep(scene.timestep);
+  world.setMultiRateLevels(scene.multiRateLevels);
+  world.setContactSolver(scene.contactSolver);
+  world.setSolverLimits(scene.solverSweeps, scene.solverResidual);
+  scene.objects.clear();
+  scene.objects.shrink_to_fit();
+  for(const demolish::checkpoint::Field& field : scene.fields)
+  {
+    world.createDistanceField(field.particle, field.cellSize, field.bandWidth, field.maxMemory);
+  }
+  std::cout << "world set up in " << omp_get_wtime()-start << " s" << std::endl;
+
+  if(!scene.trajectory.empty() && !world.openTrajectory(scene.trajectory, scene.trajectoryInterval, scene.trajectoryContacts))
+  {
+    std::cout << "cannot write trajectory " << scene.trajectory << std::endl;
+    return 1;
+  }
+
+  start = omp_get_wtime();
+  if(visualise && steps == 0) world.runSimulation();
+  else                        world.runSimulation(steps);
+  double seconds = omp_get_wtime()-start;
+  if(steps > 0) std::cout << steps << " steps in " << seconds << " s, " << steps/seconds << " steps/s" << std::endl;
+
+  bool success = true;
+  if(!scene.trajectory.empty() && !world.closeTrajectory())
+  {
+    std::cout << "trajectory " << scene.trajectory << " is incomplete" << std::endl;
+    success = false;
+  }
+  if(!scene.checkpoint.empty())
+  {
+    world.writeCheckpoint(scene.checkpoint);
+    if(!world.waitForCheckpoint())
+    {
+      std::cout << "cannot write checkpoint " << scene.checkpoint << std::endl;
+      success = false;
+    }
+  }
+  return success ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+#include "demolish.h"
+#include "World.h"
+#include "builder/GeometryBuilder.h"
+#include <omp.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/*
+ * Headless scenario benchmark
+ *
+ * Builds parameterised scenes, runs a fixed number of steps without a
+ * window and reports steps/s, contacts/s and the peak resident set size.
+ * Every configuration runs in its own process, so the peak memory of one
+ * run does not hide the next one and a run that fails does not end the
+ * sweep.
+ *
+ * Scenes:
+ *   spheres : N spheres with random velocities in a closed box
+ *   boxes   : N 2x4x3 boxes dropped onto the floor, as in test.cpp
+ *   hopper  : N spheres discharged through the CreateHopper funnel
+ *
+ * Usage:
+ *   demolish-scenarios [--scene spheres,boxes,hopper] [--n 100,1000,...]
+ *                      [--threads 1,2,4] [--weak N0] [--steps 50]
+ *                      [--output scenarios.csv]
+ *
+ * --weak N0 replaces the N sweep by N = N0*threads for every thread
+ * count (weak scaling); otherwise every N runs with every thread count
+ * (strong scaling).
+ */
+
+namespace {
+  const iREAL gravity      = -9.81;
+  const iREAL sphereRadius = 0.5;
+  const iREAL spacing      = 1.2;   // lattice spacing of the spheres
+
+  struct Scene {
+    std::vector<demolish::Object>                  objects;
+    // every mesh object points into this storage, it has to outlive the World
+    std::vector<std::unique_ptr<demolish::Mesh>>   meshes;
+
+    void addBox(iREAL dx, iREAL dy, iREAL dz, std::array<iREAL, 3> location, bool isObstacle)
+    {
+      std::vector<demolish::Vertex> meshVertices;
+      std::vector<std::array<int, 3>> meshTriangles;
+      demolish::CreateBox(dx, dy, dz, meshVertices, meshTriangles);
+      addMesh(meshTriangles, meshVertices, location, isObstacle, true);
+    }
+
+    void addMesh(
+      std::vector<std::array<int, 3>>& meshTriangles,
+      std::vector<demolish::Vertex>&   meshVertices,
+      std::array<iREAL, 3>             location,
+      bool                             isObstacle,
+      bool                             isConvex)
+    {
+      std::array<iREAL, 3> zero = {0,0,0};
+      meshes.push_back(std::unique_ptr<demolish::Mesh>(new demolish::Mesh(meshTriangles, meshVertices)));
+      objects.push_back(demolish::Object(objects.size(), meshes.back().get(), location,
+                                         demolish::material::MaterialType::WOOD,
+                                         isObstacle, true, isConvex, 0.5, zero, zero));
+    }
+
+    void addSphere(std::array<iREAL, 3> location, std::array<iREAL, 3> linear)
+    {
+      std::array<iREAL, 3> zero = {0,0,0};
+      objects.push_back(demolish::Object(sphereRadius, objects.size(), location,
+                                         demolish::material::MaterialType::WOOD,
+                                         false, true, 0.1, linear, zero));
+    }
+  };
+
+  // N spheres on a cubic lattice inside five walls
+  void createSpheres(Scene& scene, int n, std::mt19937& generator)
+  {
+    std::uniform_real_distribution<iREAL> velocity(-1.0, 1.0);
+    const int   m = std::ceil(std::cbrt(n));
+    const iREAL L = m*spacing + 1.0;
+
+    scene.addBox(L+2, 1.0, L+2, {L/2, -0.5,  L/2}, true);
+    scene.addBox(1.0, L,   L+2, {-0.5, L/2,  L/2}, true);
+    scene.addBox(1.0, L,   L+2, {L+0.5, L/2, L/2}, true);
+    scene.addBox(L+2, L,   1.0, {L/2, L/2,  -0.5}, true);
+    scene.addBox(L+2, L,   1.0, {L/2, L/2, L+0.5}, true);
+
+    for(int i=0; i<n; i++)
+    {
+      std::array<iREAL, 3> location = {1.0 + spacing*(i%m), 1.0 + spacing*((i/m)%m), 1.0 + spacing*(i/(m*m))};
+      scene.addSphere(location, {velocity(generator), velocity(generator), velocity(generator)});
+    }
+  }
+
+  // N boxes on a lattice above a floor that grows with the lattice
+  void createBoxes(Scene& scene, int n, std::mt19937&)
+  {
+    const int   m = std::ceil(std::cbrt(n));
+    const iREAL L = 6.0*m + 10.0;
+
+    scene.addBox(L, 0.1, L, {0, -30, 0}, true);
+    for(int i=0; i<n; i++)
+    {
+      std::array<iREAL, 3> location = {-3.0*m + 6.0*(i%m), -20.0 + 6.0*(i/(m*m)), -3.0*m + 6.0*((i/m)%m)};
+      scene.addBox(2.0, 4.0, 3.0, location, false);
+    }
+  }
+
+  // N spheres in a column above the hopper of test.cpp
+  void createHopper(Scene& scene, int n, std::mt19937& generator)
+  {
+    std::uniform_real_distribution<iREAL> velocity(-0.1, 0.1);
+
+    scene.addBox(200.0, 1.0, 200.0, {0, -30, 0}, true);
+
+    std::vector<demolish::Vertex> meshVertices;
+    std::vector<std::array<int, 3>> meshTriangles;
+    demolish::CreateHopper(40.0, 10.0, 20.0, meshVertices, meshTriangles);
+    scene.addMesh(meshTriangles, meshVertices, {0, 30, 0}, true, false);
+
+    // lattice points inside |x|+|z| < 20, layer after layer from y = 40
+    std::vector<std::array<iREAL, 2>> layer;
+    for(iREAL x=-20; x<=20; x+=spacing)
+    for(iREAL z=-20; z<=20; z+=spacing)
+    {
+      if(std::abs(x)+std::abs(z) < 20) layer.push_back({x, z});
+    }
+    for(int i=0; i<n; i++)
+    {
+      std::array<iREAL, 2> xz = layer[i%layer.size()];
+      std::array<iREAL, 3> location = {xz[0], 40.0 + spacing*(i/layer.size()), xz[1]};
+      scene.addSphere(location, {velocity(generator), velocity(generator), velocity(generator)});
+    }
+  }
+
+  std::vector<std::string> split(const std::string& list)
+  {
+    std::vector<std::string> result;
+    std::stringstream stream(list);
+    std::string item;
+    while(std::getline(stream, item, ',')) result.push_back(item);
+    return result;
+  }
+
+  /*
+   * Runs one configuration and returns the CSV line. Called in a child
+   * process, so OpenMP is first initialised with the right thread count.
+   */
+  std::string run(const std::string& name, int n, int threads, int steps)
+  {
+    omp_set_num_threads(threads);
+    std::mt19937 generator(12345);
+
+    double start = omp_get_wtime();
+    Scene scene;
+    if(name == "spheres")     createSpheres(scene, n, generator);
+    else if(name == "boxes")  createBoxes(scene, n, generator);
+    else                      createHopper(scene, n, generator);
+
+    demolish::World world(scene.objects, gravity, false);
+    scene.objects.clear();
+    scene.objects.shrink_to_fit();
+    double setup = omp_get_wtime() - start;
+
+    long contacts = 0;
+    start = omp_get_wtime();
+    for(int i=0; i<steps; i++)
+    {
+      world.updateWorld();
+      contacts += world.getNumberOfContactPoints();
+    }
+    double seconds = omp_get_wtime() - start;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::ostringstream line;
+    line << name << "," << n << "," << threads << "," << steps << "," << setup << "," << seconds << ","
+         << steps/seconds << "," << contacts << "," << contacts/seconds << ","
+         << usage.ru_maxrss/1024.0 << ",ok";
+    return line.str();
+  }
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> scenes  = {"spheres", "boxes", "hopper"};
+  std::vector<std::string> sizes   = {"100", "1000", "10000", "100000", "1000000"};
+  std::vector<std::string> threads;
+  int                      steps   = 50;
+  int                      weak    = 0;
+  std::string              output  = "scenarios.csv";
+
+  for(int t=1; t<=omp_get_num_procs(); t*=2) threads.push_back(std::to_string(t));
+
+  for(int i=1; i+1<argc; i+=2)
+  {
+    std::string option = argv[i];
+    if(option == "--scene")        scenes  = split(argv[i+1]);
+    else if(option == "--n")       sizes   = split(argv[i+1]);
+    else if(option == "--threads") threads = split(argv[i+1]);
+    else if(option == "--steps")   steps   = std::stoi(argv[i+1]);
+    else if(option == "--weak")    weak    = std::stoi(argv[i+1]);
+    else if(option == "--output")  output  = argv[i+1];
+    else
+    {
+      std::cout << "unknown option " << option << std::endl;
+      return 1;
+    }
+  }
+
+  std::ofstream file(output);
+  if(!file)
+  {
+    std::cout << "cannot open " << output << std::endl;
+    return 1;
+  }
+  const char* header = "scene,n,threads,steps,setup seconds,seconds,steps/s,contacts,contacts/s,peak rss MB,status";
+  file << header << std::endl;
+  std::cout << header << std::endl;
+
+  for(const std::string& scene : scenes)
+  for(int s=0; s<(weak ? 1 : sizes.size()); s++)
+  for(const std::string& t : threads)
+  {
+    const int numberOfThreads = std::stoi(t);
+    const int n = weak ? weak*numberOfThreads : std::stoi(sizes[s]);
+
+    int channel[2];
+    if(pipe(channel) != 0) return 1;
+
+    pid_t child = fork();
+    if(child == 0)
+    {
+      close(channel[0]);
+      std::string line = run(scene, n, numberOfThreads, steps);
+      if(write(channel[1], line.c_str(), line.size()) < 0) _exit(1);
+      _exit(0);
+    }
+
+    close(channel[1]);
+    std::string line;
+    char buffer[256];
+    ssize_t length;
+    while((length = read(channel[0], buffer, sizeof(buffer))) > 0) line.append(buffer, length);
+    close(channel[0]);
+
+    int status;
+    waitpid(child, &status, 0);
+    if(line.empty())
+    {
+      line = scene + "," + std::to_string(n) + "," + t + "," + std::to_string(steps) + ",,,,,,,failed";
+    }
+    file << line << std::endl;
+    std::cout << line << std::endl;
+  }
+
+  return 0;
+}
@@ -4,13 +4,25 @@
 #include "demolish.h"
 #include "World.h"
 #include "builder/GeometryBuilder.h"
+#include "profile.h"
+#include <cstring>
 #include <iostream>
 
 
 
-int main() {
+int main(int argc, char** argv) {
 
-    
+  // the Chrome trace of the run is only written on request
+  const char* trace = nullptr;
+  for(int i=1;i<argc;i++)
+  {
+    if(std::strcmp(argv[i], "--trace") == 0 && i+1 < argc) trace = argv[++i];
+    else
+    {
+      std::cout << "usage: " << argv[0] << " [--trace file]" << std::endl;
+      return 1;
+    }
+  }
 
 
   // ***********************************
@@ -92,18 +104,20 @@ int main() {
   demolish::Mesh mc(meshTriangles,meshVertices);
   std::array<iREAL, 3> locationOfCone = {0,30,0};
   linear = {0,0,0};
+  // the hopper is hollow, so it must not go through the convex narrow phase
   objz.push_back(demolish::Object(numberOfBodies+1,
                                       &mc,
                                       locationOfCone,
                                       demolish::material::MaterialType::WOOD,
                                       true,
                                       true,
-                                      true,
+                                      false,
                                       0.5,
                                       linear,
                                       angular));
   demolish::World aworld(objz,-0.98);
   std::cout << objz.back().getMass() << std::endl;
   aworld.runSimulation();
+  if(trace) demolish::profile::writeChromeTrace(trace);
   return 0;
 }
@@ -0,0 +1,36 @@
+#include "filio/trajectory.h"
+#include <iostream>
+
+/*
+ * Trajectory to VTK converter
+ *
+ * Writes every frame of a trajectory written by World::openTrajectory as
+ * a legacy VTK file, for ParaView or VisIt.
+ *
+ * Usage:
+ *   demolish-trajectory2vtk trajectory.bin [prefix]
+ *
+ * The prefix defaults to the trajectory file name.
+ */
+
+int main(int argc, char** argv) {
+  if(argc < 2)
+  {
+    std::cout << "usage: " << argv[0] << " trajectory [prefix]" << std::endl;
+    return 1;
+  }
+
+  std::string prefix = argc > 2 ? argv[2] : argv[1];
+  demolish::trajectory::Reader reader;
+  if(!reader.open(argv[1]))
+  {
+    std::cout << "cannot read trajectory " << argv[1] << std::endl;
+    return 1;
+  }
+  const int numberOfFrames = reader.getNumberOfFrames();
+  reader.close();
+
+  const int written = demolish::trajectory::convertToVTK(argv[1], prefix);
+  std::cout << written << " of " << numberOfFrames << " frames written to " << prefix << "_*.vtk" << std::endl;
+  return written == numberOfFrames ? 0 : 1;
+}
@@ -266,19 +266,30 @@ void GeometryGenerator::CreateMeshFromMesh(demolish::Mesh* mesh, MeshData& meshD
 
     std::vector<demolish::Vertex> normals;
 
-    auto XX = mesh->getXCoordinates();
-    auto YY = mesh->getYCoordinates();
-    auto ZZ = mesh->getZCoordinates();
-
-    auto verts = mesh->getVertices();
-
     auto triangles = mesh->getTriangles();
-    std::vector<Vertex> mdvs(verts.size());
+    std::vector<Vertex> mdvs(mesh->getNumberOfUniqueVertices());
+
+    // an indexed mesh holds the positions per vertex already
+    if(mesh->getIsIndexed())
+    {
+        for(int v=0;v<mdvs.size();v++)
+        {
+            mdvs[v].Position.x = mesh->getVertexXCoordinates()[v];
+            mdvs[v].Position.y = mesh->getVertexYCoordinates()[v];
+            mdvs[v].Position.z = mesh->getVertexZCoordinates()[v];
+        }
+    }
     
     int j =0;
     for(int i=0;i<triangles.size();i++)
     {
         demolish::Vertex normal(0,0,0);
+        if(!mesh->getIsIndexed())
+        {
+        auto XX = mesh->getXCoordinates();
+        auto YY = mesh->getYCoordinates();
+        auto ZZ = mesh->getZCoordinates();
+
         mdvs[triangles[i][0]].Position.x = XX[j];    
         mdvs[triangles[i][0]].Position.y = YY[j];    
         mdvs[triangles[i][0]].Position.z = ZZ[j];  
@@ -290,6 +301,7 @@ void GeometryGenerator::CreateMeshFromMesh(demolish::Mesh* mesh, MeshData& meshD
         mdvs[triangles[i][2]].Position.x = XX[j+2];    
         mdvs[triangles[i][2]].Position.y = YY[j+2];    
         mdvs[triangles[i][2]].Position.z = ZZ[j+2];    
+        }
 
         mdvs[triangles[i][0]].Normal.x = normal.getX();    
         mdvs[triangles[i][0]].Normal.y = normal.getY();    